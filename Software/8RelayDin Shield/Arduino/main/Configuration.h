@@ -41,11 +41,17 @@
 #define INTERVAL 300000                       // Interval value (ms) for reporting readings of the sensors: temperature, power usage (default 300000)
 #define INIT_DELAY 200                        // A value (ms) to be multiplied by node ID value to obtain the time to wait during the initialization process
 #define PRESENTATION_DELAY 10                 // Time (ms) to wait between subsequent presentation messages (default 10)
-#define LOOP_TIME 100                         // Main loop wait time (ms); (default 100)
+#define PRESENTATION_TIMEOUT 2000             // Time (ms) to wait for manifest hash stored by controller before presenting all sensors (default 2000)
+#define INIT_SYNC_TIMEOUT 5000                // Time (ms) to wait for controller replies to all startup requests (default 5000)
+#define IO_INTERVAL 20                        // Interval (ms) of reading inputs (default 20)
+#define LOOP_TIME 100                         // Longest main loop wait time (ms), incoming messages are handled meanwhile (default 100)
 
 /*  *******************************************************************************************
  *                                   IO Config
  *  *******************************************************************************************/
+#define EXPANDER_ADDRESS 0x20                 // I2C address of the expander (default 0x20)
+//#define I2C_FAST_MODE                       // Enable 400 kHz I2C clock (default 100 kHz)
+
 #define FIRST_OUTPUT_ID 0                     // default 0; should not be altered (expander pins for outputs: 0-7)
 #define TOTAL_NUMBER_OF_OUTPUTS 8             // Total number of outputs; value from 0-8 (default for 8RelayDin Shield 8; do not change it with this shield)
 
@@ -54,8 +60,11 @@
 #define INPUT_TYPE 0                          // Define input type for independent inputs: 0 - INPUT_PULLUP, 1 - INPUT, 3 - Button
 
 #define NUMBER_OF_OUTPUTS TOTAL_NUMBER_OF_OUTPUTS-INDEPENDENT_IO
+#define NUMBER_OF_LONGPRESSES (NUMBER_OF_OUTPUTS + (INPUT_TYPE == 3 ? INDEPENDENT_IO : 0))   // Buttons with long press functionality
 
 #define SPECIAL_BUTTON                        // Enables long press functionality for all buttons
+#define LONGPRESS_DURATION 1000               // Duration (ms) of long press (default 1000)
+#define DEBOUNCE_VALUE 50                     // Time (ms) an input has to be stable to change its state (default 50)
 
 #define INVERT_BUTTON_LOGIC false             // Invert logic of relay-related inputs 
 #define INVERT_INPUT_LOGIC true               // Invert logic of independend inputs
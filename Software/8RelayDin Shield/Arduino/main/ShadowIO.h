@@ -0,0 +1,189 @@
+/*
+ * ShadowIO.h file
+ * Shadow registers of the PCF8575 expander: all 16 pins are read with a single I2C transmission
+ * at the beginning of an IO pass and all outputs are written with a single transmission at its end.
+ * Debounce and long press detection of every channel run on the RAM copy.
+ *
+ * ShadowIO channels replace ExpanderIO instances: same SensorType, State & NewState semantics,
+ * NewState == 2 signals a long press.
+ *
+ */
+
+#ifndef ShadowIO_h
+#define ShadowIO_h
+
+#include <Wire.h>
+#include <PCF8575.h>
+
+#define NO_PIN 0xFF
+
+class ShadowExpander {
+
+  public:
+    /**
+     * @brief Initializes expander
+     *
+     * @param Address I2C address of the expander
+     */
+    void Begin(uint8_t Address)  {
+      _Exp.begin(Address);
+      #ifdef I2C_FAST_MODE
+        Wire.setClock(400000);
+      #endif
+    }
+
+    /**
+     * @brief Configures pin as an output; all other pins stay inputs (written high)
+     *
+     */
+    void Output(uint8_t Pin)  {
+      _Exp.pinMode(Pin, OUTPUT);
+      _OutputMask |= (uint16_t)1 << Pin;
+    }
+
+    /**
+     * @brief Reads all expander pins at once
+     *
+     */
+    void Read()  {
+      _Inputs = _Exp.read();
+    }
+
+    /**
+     * @brief Writes all outputs at once, only if any of them has changed
+     *
+     */
+    void Write()  {
+      if(_Dirty)  {
+        _Exp.write(_Outputs | ~_OutputMask);
+        _Dirty = false;
+      }
+    }
+
+    /**
+     * @brief Pin state from the last Read()
+     *
+     */
+    bool Get(uint8_t Pin)  {
+      return _Inputs & ((uint16_t)1 << Pin);
+    }
+
+    /**
+     * @brief Sets output in the shadow register; sent to the expander by Write()
+     *
+     */
+    void Set(uint8_t Pin, bool State)  {
+      uint16_t Outputs = State ? _Outputs | ((uint16_t)1 << Pin) : _Outputs & ~((uint16_t)1 << Pin);
+
+      _Dirty |= Outputs != _Outputs;
+      _Outputs = Outputs;
+    }
+
+  private:
+    PCF8575 _Exp;
+    uint16_t _OutputMask = 0;
+    uint16_t _Outputs = 0;
+    uint16_t _Inputs = 0xFFFF;
+    bool _Dirty = true;
+};
+
+class ShadowIO {
+
+  public:
+    uint8_t SensorType;                     // 0 - input, 1 - motion sensor, 2 - relay, 3 - button, 4 - button + relay
+    uint8_t State = 0;
+    uint8_t NewState = 0;
+
+    /**
+     * @brief Sets channel parameters
+     *
+     * @param Exp shadowed expander
+     * @param RelayOff relay OFF state
+     * @param Invert invert input logic (by default input is active low)
+     * @param Type sensor type
+     * @param Pin1 input pin; output pin for relay (type 2)
+     * @param Pin2 output pin for button + relay (type 4)
+     */
+    void SetValues(ShadowExpander &Exp, bool RelayOff, bool Invert, uint8_t Type, uint8_t Pin1, uint8_t Pin2 = NO_PIN)  {
+      SensorType = Type;
+      _RelayOff = RelayOff;
+      _Invert = Invert;
+      _Input = Type == 2 ? NO_PIN : Pin1;
+      _Relay = Type == 2 ? Pin1 : (Type == 4 ? Pin2 : NO_PIN);
+
+      if(_Relay != NO_PIN)  {
+        Exp.Output(_Relay);
+        Exp.Set(_Relay, _RelayOff);
+      }
+    }
+
+    /**
+     * @brief Debounces input from the last expander read and sets NewState
+     *
+     * @param Exp shadowed expander
+     */
+    void CheckInput(ShadowExpander &Exp)  {
+      if(_Input == NO_PIN)  return;
+
+      uint32_t Now = millis();
+      bool Active = !Exp.Get(_Input) ^ _Invert;
+
+      if(Active != _Raw)  {
+        _Raw = Active;
+        _Since = Now;
+        return;
+      }
+
+      if(SensorType < 2)  {
+        // Inputs follow the debounced level
+        if(Active != NewState && Now - _Since >= DEBOUNCE_VALUE) {
+          NewState = Active;
+        }
+        return;
+      }
+
+      if(Active != _Pressed && Now - _Since >= DEBOUNCE_VALUE) {
+        _Pressed = Active;
+        if(_Pressed)  {
+          _Longpress = false;
+        }
+        else if(!_Longpress) {
+          // Short press released: toggle
+          NewState = !State;
+        }
+      }
+      #ifdef SPECIAL_BUTTON
+        else if(_Pressed && !_Longpress && Now - _Since >= LONGPRESS_DURATION) {
+          _Longpress = true;
+          NewState = 2;
+        }
+      #endif
+    }
+
+    /**
+     * @brief Sets relay according to NewState in the shadow register
+     *
+     * @param Exp shadowed expander
+     */
+    void SetRelay(ShadowExpander &Exp)  {
+      if(_Relay != NO_PIN)  {
+        Exp.Set(_Relay, NewState ? !_RelayOff : _RelayOff);
+      }
+      State = NewState;
+    }
+
+  private:
+    uint8_t _Input;
+    uint8_t _Relay;
+    bool _RelayOff;
+    bool _Invert;
+    bool _Raw = false;                      // Last raw reading
+    bool _Pressed = false;                  // Debounced button state
+    bool _Longpress = false;                // Long press already reported for this press
+    uint32_t _Since = 0;                    // Time of the last raw change
+};
+
+#endif
+/*
+   EOF
+*/
@@ -23,18 +23,29 @@
 /***** INCLUDES *****/
 #include "Configuration.h"
 #include <GoWired2.h>
+#include "Scheduler.h"
+#include "ShadowIO.h"
+#include "Manifest.h"
 
 /***** Globals *****/
 bool InitConfirm = false;                           // Additional presentation status required by Home Assistant
-uint8_t NumberOfLongpresses = NUMBER_OF_OUTPUTS;    // Number of long press functionalities
+uint8_t SyncPending = 0;                            // Number of values requested at startup & not yet received from controller
+bool SyncComplete = false;
+uint8_t SyncTask;                                   // Startup synchronization timeout
 
 // Module Safety Indicators
 bool THERMAL_ERROR = false;                         // Thermal error status
 
 /***** Constructors *****/
-// Expander Input constructor
-ExpanderIO EIO[TOTAL_NUMBER_OF_OUTPUTS+INDEPENDENT_IO];
+// Scheduler
+Scheduler Sched;
+
+// Expander & IO channels constructors
+ShadowExpander Expander;
+ShadowIO EIO[TOTAL_NUMBER_OF_OUTPUTS+INDEPENDENT_IO];
 MyMessage msgSTATUS(0, V_STATUS);
+MyMessage msgREADY(NODE_SENSOR_ID, V_VAR1);
+Manifest Presentation(NODE_SENSOR_ID);
 
 /**
  * @brief Function called before setup(); resets wdt
@@ -60,51 +71,79 @@ void setup() {
     wdt_enable(WDTO_4S);
   #endif
   
-  // This function calls Expander.begin(0x20);
-  EIO[0].ExpanderInit();
+  Expander.Begin(EXPANDER_ADDRESS);
 
   for(int i=FIRST_OUTPUT_ID; i<FIRST_OUTPUT_ID+INDEPENDENT_IO; i++)  {
-    EIO[i].SetValues(RELAY_OFF, false, 2, i);
-    EIO[i+TOTAL_NUMBER_OF_OUTPUTS].SetValues(RELAY_OFF, INVERT_INPUT_LOGIC, INPUT_TYPE, i+TOTAL_NUMBER_OF_OUTPUTS);
+    EIO[i].SetValues(Expander, RELAY_OFF, false, 2, i);
+    EIO[i+TOTAL_NUMBER_OF_OUTPUTS].SetValues(Expander, RELAY_OFF, INVERT_INPUT_LOGIC, INPUT_TYPE, i+TOTAL_NUMBER_OF_OUTPUTS);
   }
 
   uint8_t j = FIRST_OUTPUT_ID + INDEPENDENT_IO;
     
   for(int i=j; i<j+NUMBER_OF_OUTPUTS; i++)  {
-    EIO[i].SetValues(RELAY_OFF, INVERT_BUTTON_LOGIC, 4, i+TOTAL_NUMBER_OF_OUTPUTS, i);
+    EIO[i].SetValues(Expander, RELAY_OFF, INVERT_BUTTON_LOGIC, 4, i+TOTAL_NUMBER_OF_OUTPUTS, i);
   }
+
+  Expander.Write();
+
+  // Tasks
+  Sched.AddTask(UpdateIO, IO_INTERVAL);
+  SyncTask = Sched.AddTask(SyncUpdate, 0);
 }
 
+/***** Presentation manifest *****/
+const char NameRelay[] PROGMEM = "8RD Relay";
+const char NameInput[] PROGMEM = "8RD Input";
+const char NameButtonRelay[] PROGMEM = "8RD B+R";
+const char NameLongpress[] PROGMEM = "Longpress";
+
+// Sensor ID, count, presentation, name
+const PresentEntry Sensors[] PROGMEM = {
+  {FIRST_OUTPUT_ID, INDEPENDENT_IO, S_BINARY, NameRelay},
+  {FIRST_OUTPUT_ID+INDEPENDENT_IO, NUMBER_OF_OUTPUTS, S_BINARY, NameButtonRelay},
+  {FIRST_OUTPUT_ID+TOTAL_NUMBER_OF_OUTPUTS, INDEPENDENT_IO, S_BINARY, NameInput},
+  {FIRST_OUTPUT_ID+TOTAL_NUMBER_OF_OUTPUTS+INDEPENDENT_IO, NUMBER_OF_LONGPRESSES, S_BINARY, NameLongpress}
+};
+
+#define NUMBER_OF_PRESENTED (sizeof(Sensors) / sizeof(Sensors[0]))
+
 /**
  * @brief Presents module to the controller, send name, software version, info about sensors
  * 
  */
 void presentation() {
 
-  sendSketchInfo(MN, FV);
+  sendSketchInfo(F(MN), F(FV));
 
-  uint8_t Current_ID = FIRST_OUTPUT_ID;
+  // At startup sensors are presented only if the controller doesn't know this manifest, see loop()
+  if(Presentation.Check(Manifest::Hash(HashString_P(HashString_P(FNV_OFFSET, PSTR(MN)), PSTR(FV)), Sensors, NUMBER_OF_PRESENTED))) return;
 
-  for(int i=Current_ID; i<Current_ID+INDEPENDENT_IO; i++)  {
-    present(i, S_BINARY, "8RD Relay");  wait(PRESENTATION_DELAY);
-    present(i+TOTAL_NUMBER_OF_OUTPUTS, S_BINARY, "8RD Input"); wait(PRESENTATION_DELAY);
-  }
+  Manifest::Present(Sensors, NUMBER_OF_PRESENTED, PRESENTATION_DELAY);
+  Presentation.Presented();
+}
 
-  Current_ID += INDEPENDENT_IO;
+/**
+ * @brief Requests sensor value from controller without waiting for the reply; the reply is handled by receive()
+ * 
+ * @param Sensor sensor ID
+ * @param Type value type
+ */
+void SyncRequest(uint8_t Sensor, uint8_t Type) {
 
-  for(int i=Current_ID; i<Current_ID+NUMBER_OF_OUTPUTS; i++)  {
-    present(i, S_BINARY, "8RD B+R");  wait(PRESENTATION_DELAY);
-  }
+  request(Sensor, Type);
+  SyncPending++;
+}
 
-  if(INPUT_TYPE == 3) {
-    NumberOfLongpresses += INDEPENDENT_IO;
-  }
+/**
+ * @brief Finishes startup synchronization when all requested values arrived or INIT_SYNC_TIMEOUT passed; reports boot-to-ready time
+ * 
+ */
+void SyncUpdate() {
 
-  Current_ID = TOTAL_NUMBER_OF_OUTPUTS + INDEPENDENT_IO;
+  if(SyncComplete)  return;
 
-  for(int i=Current_ID; i<Current_ID+NumberOfLongpresses; i++)  {
-    present(i, S_BINARY, "Longpress"); wait(PRESENTATION_DELAY);
-  }    
+  SyncComplete = true;
+  send(msgREADY.set(millis()));
 }
 
 /**
@@ -117,19 +156,18 @@ void InitConfirmation() {
 
   for(int i=FIRST_OUTPUT_ID; i<FIRST_OUTPUT_ID+SensorsToConfirm; i++)  {
     send(msgSTATUS.setSensor(i).set(EIO[i].NewState));
-    request(i, V_STATUS);
-    wait(1000, C_SET, V_STATUS);
+    SyncRequest(i, V_STATUS);
   }
 
   uint8_t FirstLongpressID = FIRST_OUTPUT_ID+SensorsToConfirm;
 
-  for(int i=FirstLongpressID; i<FirstLongpressID+NumberOfLongpresses; i++)  {
+  for(int i=FirstLongpressID; i<FirstLongpressID+NUMBER_OF_LONGPRESSES; i++)  {
     send(msgSTATUS.setSensor(i).set("0"));
-    request(i, V_STATUS);
-    wait(1000, C_SET, V_STATUS);
+    SyncRequest(i, V_STATUS);
   }
     
   InitConfirm = true;
+  Sched.RunIn(SyncTask, INIT_SYNC_TIMEOUT);
   
 }
 
@@ -140,18 +178,29 @@ void InitConfirmation() {
  */
 void receive(const MyMessage &message)  {
 
+  // Manifest hash stored by the controller
+  if(Presentation.Receive(message)) return;
+
+  // Reply to a startup request
+  if(!SyncComplete && SyncPending > 0 && message.getCommand() == C_SET) {
+    if(--SyncPending == 0)  {
+      Sched.RunNow(SyncTask);
+    }
+  }
+
   if(message.type == V_STATUS)  {
     for(int i=FIRST_OUTPUT_ID; i<FIRST_OUTPUT_ID+TOTAL_NUMBER_OF_OUTPUTS; i++)  {
       if(message.sensor == i)  {
         EIO[i].NewState = message.getBool();
-        EIO[i].SetRelay();
+        EIO[i].SetRelay(Expander);
       }
     }
+    Expander.Write();
   }
 }
 
 /**
- * @brief Updates ExpanderIO class instances; checks inputs and set outputs
+ * @brief Updates IO channels from the last expander read; checks inputs and sets outputs in the shadow register
  * 
  * @param FirstSensor first sensor ID to check
  * @param NumberOfSensors number of sensors to check
@@ -159,7 +208,7 @@ void receive(const MyMessage &message)  {
 void IOUpdate(uint8_t FirstSensor, uint8_t NumberOfSensors) {
 
   for(int i=FirstSensor; i<FirstSensor+NumberOfSensors; i++)  {
-    EIO[i].CheckInput();
+    EIO[i].CheckInput(Expander);
     if(EIO[i].NewState != EIO[i].State)  {
       switch(EIO[i].SensorType)  {
         case 0:
@@ -190,7 +239,7 @@ void IOUpdate(uint8_t FirstSensor, uint8_t NumberOfSensors) {
           // Button input + Relay output
           if(EIO[i].NewState != 2)  {
             if(!THERMAL_ERROR)  {
-              EIO[i].SetRelay();
+              EIO[i].SetRelay(Expander);
               send(msgSTATUS.setSensor(i).set(EIO[i].NewState));
             }
           }
@@ -210,15 +259,12 @@ void IOUpdate(uint8_t FirstSensor, uint8_t NumberOfSensors) {
 }
 
 /**
- * @brief main loop
+ * @brief Scheduled task: reads all expander pins, checks all inputs and writes changed outputs
  * 
  */
-void loop() {
+void UpdateIO() {
 
-  // Extended presentation as required by Home Assistant; runs only after startup
-  if(!InitConfirm)  {
-    InitConfirmation();
-  }
+  Expander.Read();
 
   if(INDEPENDENT_IO > 0)  {
     IOUpdate(TOTAL_NUMBER_OF_OUTPUTS, INDEPENDENT_IO);
@@ -230,6 +276,29 @@ void loop() {
     IOUpdate(FIRST_OUTPUT_ID, NUMBER_OF_OUTPUTS);
   }
 
-  wait(LOOP_TIME);
+  Expander.Write();
+}
+
+/**
+ * @brief main loop: runs all tasks which are due, waits for the next one
+ * 
+ */
+void loop() {
+
+  // Presentation deferred at startup: controller doesn't know this manifest or didn't reply
+  if(Presentation.Due())  {
+    Manifest::Present(Sensors, NUMBER_OF_PRESENTED, PRESENTATION_DELAY);
+    Presentation.Presented();
+  }
+
+  // Extended presentation as required by Home Assistant; runs only after startup
+  if(!InitConfirm && Presentation.Synced())  {
+    InitConfirmation();
+  }
+
+  Sched.Run();
+
+  // Handling incoming messages until the next task is due
+  wait(Sched.TimeToNext(LOOP_TIME));
 
 }
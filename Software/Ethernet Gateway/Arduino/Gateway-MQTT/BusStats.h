@@ -0,0 +1,282 @@
+/*
+ * BusStats.h file
+ * Bus statistics of the gateway. Within a report window it counts for every node frames received
+ * and their mean & longest inter-arrival time, frames sent to the node, failed transmissions & retries,
+ * and request -> reply round-trip time (C_REQ in one direction answered by C_SET of the same sensor & type
+ * in the other one; one pending request per node). A retry is the same frame (command, sensor, type &
+ * payload) sent to the node again within BUS_RETRY_TIME, e.g. by the controller missing an echo. For the
+ * whole bus it counts frames received, sent, failed transmissions & retries. Chatty nodes show high frame
+ * counts & short intervals, failing nodes long intervals, failed transmissions, retries & long round trips,
+ * a saturated segment failed transmissions & retries.
+ *
+ * Report() returns one line per call, so reports are spread over subsequent loop passes:
+ *   node:frames/mean interval (ms)/longest interval (ms)
+ *   node>frames sent/failed/retries/mean round trip (ms)/longest round trip (ms)
+ *   bus:received/sent/failed/retries
+ *   fwd:stored/dropped/forwarded (store-and-forward buffer, see ForwardQueue.h)
+ *   ram:least free RAM since boot (bytes; only if sampled with Memory())
+ * After the last line the window is cleared; node table is kept. Nodes beyond the table size
+ * are counted in bus totals only (retries not at all), nodes without ID (AUTO) aren't tracked.
+ *
+ */
+
+#ifndef BusStats_h
+#define BusStats_h
+
+#define BUS_RETRY_TIME 5000                 // Same frame sent to a node again within it (ms) is a retry
+
+template<uint8_t Nodes>
+class BusStats {
+
+  public:
+    enum Counter : uint8_t { BUS_RX, BUS_TX, BUS_ERR, BUS_RETRY, FWD_STORED, FWD_DROPPED, FWD_SENT, COUNTERS };
+
+    /**
+     * @brief Records a frame received from a node
+     *
+     * @param Node sender ID
+     * @param Now current time
+     */
+    void Received(uint8_t Node, uint32_t Now)  {
+      Entry *E = Find(Node);
+
+      if(E == nullptr)  return;
+
+      if(E->Seen) {
+        uint32_t Interval = Now - E->Last;
+
+        E->IntervalSum += Interval;
+        E->MaxInterval = Interval > E->MaxInterval ? Interval : E->MaxInterval;
+        E->Intervals++;
+      }
+      E->Seen = true;
+      E->Last = Now;
+      E->Frames++;
+    }
+
+    /**
+     * @brief Records a frame sent to a node or its failed transmission; counts a retry if it repeats the previous frame
+     *
+     * @param Node destination ID
+     * @param Frame key of the frame, see Key()
+     * @param Failed true if the transmission failed
+     * @param Now current time
+     */
+    void Sent(uint8_t Node, uint16_t Frame, bool Failed, uint32_t Now)  {
+      Entry *E = Find(Node);
+
+      if(E == nullptr)  return;
+
+      if(Failed)  E->Failed++;
+      else  E->Out++;
+
+      if(E->OutSeen && E->OutFrame == Frame && (uint16_t)Now - E->OutTime < BUS_RETRY_TIME) {
+        E->Retries++;
+        _Counter[BUS_RETRY]++;
+      }
+      E->OutSeen = true;
+      E->OutFrame = Frame;
+      E->OutTime = Now;
+    }
+
+    /**
+     * @brief Key of a frame to recognize its retries
+     *
+     * @param Payload, Length payload of the frame
+     * @return uint16_t command, sensor & type folded with the payload
+     */
+    static uint16_t Key(uint8_t Command, uint8_t Sensor, uint8_t Type, const void *Payload, uint8_t Length)  {
+      uint16_t Frame = (uint16_t)Command << 13 ^ (uint16_t)Sensor << 5 ^ Type;
+
+      for(uint8_t i=0; i<Length; i++) {
+        Frame = (Frame << 3 | Frame >> 13) ^ ((const uint8_t *)Payload)[i];
+      }
+
+      return Frame;
+    }
+
+    /**
+     * @brief Records a request (C_REQ) to or from a node; replaces a pending one
+     *
+     * @param Node node ID
+     * @param Sensor, Type requested value
+     * @param ToNode true - request of the controller sent to the node; false - request of the node
+     * @param Now current time
+     */
+    void Request(uint8_t Node, uint8_t Sensor, uint8_t Type, bool ToNode, uint32_t Now)  {
+      Entry *E = Find(Node);
+
+      if(E == nullptr)  return;
+
+      E->Pending = ToNode ? TO_NODE : FROM_NODE;
+      E->ReqSensor = Sensor;
+      E->ReqType = Type;
+      E->ReqTime = Now;
+    }
+
+    /**
+     * @brief Records a value (C_SET) to or from a node; measures round-trip time if it replies the pending request
+     *
+     * @param Node node ID
+     * @param Sensor, Type value
+     * @param ToNode true - value sent to the node; false - value sent by the node
+     * @param Now current time
+     */
+    void Reply(uint8_t Node, uint8_t Sensor, uint8_t Type, bool ToNode, uint32_t Now)  {
+      Entry *E = Find(Node);
+
+      // The reply goes the other way than the request
+      if(E == nullptr || E->Pending != (ToNode ? FROM_NODE : TO_NODE))  return;
+      if(E->ReqSensor != Sensor || E->ReqType != Type)  return;
+
+      uint32_t Rtt = Now - E->ReqTime;
+      uint16_t Ms = Rtt < 0xFFFF ? Rtt : 0xFFFF;
+
+      E->RttSum += Ms;
+      E->RttMax = Ms > E->RttMax ? Ms : E->RttMax;
+      E->Rtts++;
+      E->Pending = NONE;
+    }
+
+    /**
+     * @brief Increments a bus counter
+     *
+     */
+    void Count(Counter C)  {
+      _Counter[C]++;
+    }
+
+    /**
+     * @brief Records a sample of free RAM; the least one since boot is reported
+     *
+     * @param Free bytes between heap & stack
+     */
+    void Memory(uint16_t Free)  {
+      _Memory = Free < _Memory ? Free : _Memory;
+    }
+
+    /**
+     * @brief Prints next line of the report
+     *
+     * @param Text buffer
+     * @param Size buffer size
+     * @return false if the report is complete; the window is cleared
+     */
+    bool Report(char *Text, uint8_t Size)  {
+      while(_Next < Nodes && _Entry[_Next].Node == 0) _Next++;
+
+      if(_Next < Nodes) {
+        Entry &E = _Entry[_Next];
+
+        if(!_Second)  {
+          uint32_t Mean = E.Intervals > 0 ? E.IntervalSum / E.Intervals : 0;
+
+          snprintf_P(Text, Size, PSTR("%u:%u/%lu/%lu"), E.Node, E.Frames, Mean, E.MaxInterval);
+        }
+        else  {
+          uint16_t Mean = E.Rtts > 0 ? E.RttSum / E.Rtts : 0;
+
+          snprintf_P(Text, Size, PSTR("%u>%u/%u/%u/%u/%u"), E.Node, E.Out, E.Failed, E.Retries, Mean, E.RttMax);
+          _Next++;
+        }
+        _Second = !_Second;
+
+        return true;
+      }
+
+      if(_Next == Nodes)  {
+        _Next++;
+        snprintf_P(Text, Size, PSTR("bus:%u/%u/%u/%u"), _Counter[BUS_RX], _Counter[BUS_TX], _Counter[BUS_ERR], _Counter[BUS_RETRY]);
+
+        return true;
+      }
+
+      if(_Next == Nodes + 1)  {
+        _Next++;
+        snprintf_P(Text, Size, PSTR("fwd:%u/%u/%u"), _Counter[FWD_STORED], _Counter[FWD_DROPPED], _Counter[FWD_SENT]);
+
+        return true;
+      }
+
+      if(_Next == Nodes + 2 && _Memory != 0xFFFF)  {
+        _Next++;
+        snprintf_P(Text, Size, PSTR("ram:%u"), _Memory);
+
+        return true;
+      }
+
+      for(uint8_t i=0; i<Nodes; i++)  {
+        _Entry[i].Frames = 0;
+        _Entry[i].Intervals = 0;
+        _Entry[i].IntervalSum = 0;
+        _Entry[i].MaxInterval = 0;
+        _Entry[i].Out = 0;
+        _Entry[i].Failed = 0;
+        _Entry[i].Retries = 0;
+        _Entry[i].Rtts = 0;
+        _Entry[i].RttSum = 0;
+        _Entry[i].RttMax = 0;
+      }
+      memset(_Counter, 0, sizeof(_Counter));
+      _Next = 0;
+
+      return false;
+    }
+
+  private:
+    enum RequestState : uint8_t { NONE, TO_NODE, FROM_NODE };
+
+    struct Entry {
+      uint8_t Node = 0;                     // Node ID; 0 - free
+      bool Seen = false;                    // Last is valid
+      uint16_t Frames = 0;
+      uint16_t Intervals = 0;
+      uint32_t Last = 0;                    // Time of the last frame
+      uint32_t IntervalSum = 0;
+      uint32_t MaxInterval = 0;
+      uint16_t Out = 0;                     // Frames sent to the node
+      uint16_t Failed = 0;                  // Failed transmissions to the node
+      uint16_t Retries = 0;                 // Frames sent to the node again
+      bool OutSeen = false;                 // OutFrame & OutTime are valid
+      uint16_t OutFrame = 0;                // Key of the last frame sent to the node
+      uint16_t OutTime = 0;                 // & its time (ms, low 16 bits)
+      uint16_t Rtts = 0;                    // Number of measured round trips
+      uint16_t RttMax = 0;                  // Longest round trip (ms)
+      uint32_t RttSum = 0;
+      RequestState Pending = NONE;          // Request waiting for reply
+      uint8_t ReqSensor = 0;
+      uint8_t ReqType = 0;
+      uint32_t ReqTime = 0;
+    };
+
+    /**
+     * @brief Finds entry of a node, takes a free one for a new node
+     *
+     * @return Entry* nullptr if the table is full or the node has no ID yet (AUTO)
+     */
+    Entry *Find(uint8_t Node)  {
+      if(Node == 0 || Node == AUTO) return nullptr;
+
+      for(uint8_t i=0; i<Nodes; i++)  {
+        if(_Entry[i].Node == 0) {
+          _Entry[i].Node = Node;
+        }
+        if(_Entry[i].Node == Node)  {
+          return &_Entry[i];
+        }
+      }
+
+      return nullptr;
+    }
+
+    Entry _Entry[Nodes];
+    uint16_t _Counter[COUNTERS] = {};
+    uint16_t _Memory = 0xFFFF;              // Least free RAM; 0xFFFF - not sampled
+    uint8_t _Next = 0;                      // Next report line
+    bool _Second = false;                   // Second line of the node is next
+};
+
+#endif
+/*
+   EOF
+*/
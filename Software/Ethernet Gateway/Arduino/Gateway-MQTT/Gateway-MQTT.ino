@@ -55,18 +55,52 @@
  * Watchdog resets the gateway in case of any software hang. Enabling it should result in
  * more robustness and long term reliability.
  * Uplink Check tests the connection between the Gateway and the Controller.
- * In case of connection loss, gateway will be reset be watchdog. 
+ * A failed test is repeated after UPLINK_RETRY_TIME, doubled with every next failure;
+ * the bus is served meanwhile. After UPLINK_CHECK_RETRIES failed tests in a row
+ * the gateway is reset by watchdog; while the store-and-forward buffer holds frames,
+ * the reset is postponed up to UPLINK_HOLD_TIME after the first failed test.
  * Time interval between tests can be customized.
- * Use CONTROLLER UPLINK CHECK only together with WATCHDOG.
  */
 #define ENABLE_WATCHDOG                                   // Resets the Gateway in case of any software hang
 #define ENABLE_UPLINK_CHECK                               // Resets the Gateway in case of connection loss with the controller
 #define UPLINK_CHECK_INTERVAL 60000                       // Time interval for the uplink check (default 60000)
+#define UPLINK_RETRY_TIME 5000                            // Time to the first retry of a failed uplink check; doubled with every retry (default 5000)
+#define UPLINK_CHECK_RETRIES 3                            // Number of failed uplink checks in a row resetting the Gateway (default 3)
+#define UPLINK_HOLD_TIME 600000                           // Longest postponed reset while frames are stored (default 600000)
+
+/*
+ * BUS STATISTICS
+ * Gateway counts frames of every node & bus transmissions and reports them every STATS_INTERVAL
+ * as text messages of its own sensor STATS_SENSOR_ID, two lines per node (see BusStats.h).
+ */
+#define ENABLE_BUS_STATS                                  // Reports bus statistics to the controller
+#define STATS_INTERVAL 300000                             // Time interval for bus statistics report (default 300000)
+#define STATS_NODES 8                                     // Number of nodes tracked (default 8)
+#define STATS_SENSOR_ID 1                                 // Sensor ID of bus statistics (default 1)
+#define STATS_FREE_RAM                                    // Reports the least free RAM between heap & stack
+
+/*
+ * STORE-AND-FORWARD
+ * Frames of nodes received while the controller uplink is down are stored and forwarded once
+ * it is back (see ForwardQueue.h), the latest one per node, sensor, command & type. Every stored
+ * frame takes 5 + FORWARD_PAYLOAD bytes of RAM; frames with a longer payload aren't stored.
+ */
+#define ENABLE_STORE_FORWARD                              // Buffers frames of nodes during uplink outages
+#define FORWARD_QUEUE_SIZE 32                             // Number of stored frames, e.g. 8 nodes * 4 sensors (default 32)
+#define FORWARD_PAYLOAD 8                                 // Longest stored payload in bytes (default 8)
+#define FORWARD_PER_PASS 4                                // Stored frames forwarded per loop pass (default 4)
+#define FORWARD_WAIT 20                                   // Loop wait (ms) while stored frames are being forwarded (default 20)
+
+#ifdef ENABLE_BUS_STATS
+  #define MY_INDICATION_HANDLER                           // Bus transmissions counted in indication()
+#endif
 
 // Includes
 #include <UIPEthernet.h>
 #include <MySensors.h>
 #include <avr/wdt.h>
+#include "BusStats.h"
+#include "ForwardQueue.h"
 
 // Definitions
 #define CONF_BUTTON A0
@@ -79,6 +113,24 @@ bool ButtonHigh = false;
 bool CheckControllerUplink = true;
 uint32_t TIME_1 = 0;
 uint32_t LastUpdate = 0;
+uint32_t UplinkCheckTime = UPLINK_CHECK_INTERVAL;
+uint8_t UplinkFailures = 0;
+uint32_t UplinkLost = 0;                                  // Time of the first failed uplink check
+
+#ifdef ENABLE_BUS_STATS
+  BusStats<STATS_NODES> Stats;
+  MyMessage msgSTATS(STATS_SENSOR_ID, V_TEXT);
+  uint32_t LastStats = 0;
+#endif
+
+#ifdef ENABLE_STORE_FORWARD
+  ForwardQueue<FORWARD_QUEUE_SIZE, FORWARD_PAYLOAD> Forward;
+#endif
+
+#ifdef STATS_FREE_RAM
+  extern uint8_t __heap_start;
+  extern void *__brkval;
+#endif
 
 void before() {
 
@@ -122,16 +174,180 @@ void setup()  {
   
 }
 
+/**
+ * @brief Checks connection to the MQTT broker; the MySensors gateway transport is compiled into this sketch, so its state is read directly
+ * 
+ */
+bool UplinkConnected()  {
+
+  return _MQTT_client.connected();
+}
+
+/**
+ * @brief Postpones the reset of failed uplink checks while frames are stored, so an outage doesn't discard them
+ * 
+ */
+bool HoldReset()  {
+
+  #ifdef ENABLE_STORE_FORWARD
+    return !Forward.Empty() && millis() - UplinkLost < UPLINK_HOLD_TIME;
+  #else
+    return false;
+  #endif
+}
+
+#ifdef ENABLE_BUS_STATS
+  /**
+   * @brief Samples free RAM between heap & stack; called from loop() & from indication() inside the transport
+   *
+   */
+  void SampleMemory() {
+
+    #ifdef STATS_FREE_RAM
+      uint8_t *HeapEnd = __brkval != nullptr ? (uint8_t *)__brkval : &__heap_start;
+      Stats.Memory(SP - (uint16_t)HeapEnd);
+    #endif
+  }
+
+  void presentation() {
+
+    present(STATS_SENSOR_ID, S_INFO, "Bus statistics");
+  }
+#endif
+
+#if defined(ENABLE_BUS_STATS) || defined(ENABLE_STORE_FORWARD)
+  void receive(const MyMessage &message)  {
+
+    // Frames of nodes; controller messages to the gateway have sender 0
+    if(message.sender == GATEWAY_ADDRESS) return;
+
+    #ifdef ENABLE_BUS_STATS
+      uint32_t Now = millis();
+
+      Stats.Received(message.sender, Now);
+      if(message.getCommand() == C_REQ) {
+        Stats.Request(message.sender, message.sensor, message.type, false, Now);
+      }
+      else if(message.getCommand() == C_SET)  {
+        Stats.Reply(message.sender, message.sensor, message.type, false, Now);
+      }
+    #endif
+
+    #ifdef ENABLE_STORE_FORWARD
+      // MySensors has already tried to forward the frame; it was lost if the uplink is down
+      if(UplinkConnected()) {
+        Forward.Supersede(message);
+      }
+      else  {
+        uint8_t Result = Forward.Push(message);
+        #ifdef ENABLE_BUS_STATS
+          if(Result != Forward.NOT_STORED)  Stats.Count(Stats.FWD_STORED);
+          if(Result != Forward.STORED)  Stats.Count(Stats.FWD_DROPPED);
+        #endif
+      }
+    #endif
+  }
+#endif
+
+#ifdef ENABLE_BUS_STATS
+  /**
+   * @brief Counts a frame sent to a node & its retries; a controller message routed to the bus is held by MySensors in _msg
+   *
+   * @param Failed true if the transmission failed
+   */
+  void CountSent(bool Failed) {
+
+    uint8_t Node = _msg.getDestination();
+
+    // Own frames of the gateway (e.g. ACK of a node frame held in _msg) aren't counted per node
+    if(Node == GATEWAY_ADDRESS || Node == BROADCAST_ADDRESS)  return;
+
+    uint16_t Frame = Stats.Key(_msg.getCommand(), _msg.getSensor(), _msg.getType(), _msg.getCustom(), _msg.getLength());
+
+    Stats.Sent(Node, Frame, Failed, millis());
+    if(!Failed) {
+      if(_msg.getCommand() == C_REQ)  {
+        Stats.Request(Node, _msg.getSensor(), _msg.getType(), true, millis());
+      }
+      else if(_msg.getCommand() == C_SET) {
+        Stats.Reply(Node, _msg.getSensor(), _msg.getType(), true, millis());
+      }
+    }
+  }
+
+  void indication(const indication_t Indication)  {
+
+    SampleMemory();
+
+    switch(Indication)  {
+      case INDICATION_RX:
+        Stats.Count(Stats.BUS_RX);
+        break;
+      case INDICATION_TX:
+        Stats.Count(Stats.BUS_TX);
+        CountSent(false);
+        break;
+      case INDICATION_ERR_TX:
+        Stats.Count(Stats.BUS_ERR);
+        CountSent(true);
+        break;
+      default:
+        break;
+    }
+  }
+#endif
+
 void loop() {
 
-  wait(500);
+  #ifdef ENABLE_STORE_FORWARD
+    wait(Forward.Empty() ? 500 : FORWARD_WAIT);
+
+    // Stored frames are forwarded a few per pass, so the bus keeps being served
+    for(uint8_t i=0; i<FORWARD_PER_PASS && !Forward.Empty() && UplinkConnected(); i++) {
+      MyMessage Msg = Forward.Front();
+      if(!gatewayTransportSend(Msg)) break;
+      Forward.Pop();
+      #ifdef ENABLE_BUS_STATS
+        Stats.Count(Stats.FWD_SENT);
+      #endif
+    }
+  #else
+    wait(500);
+  #endif
 
   #ifdef ENABLE_UPLINK_CHECK
-    if((millis() > LastUpdate + UPLINK_CHECK_INTERVAL) && CheckControllerUplink) {
-      if(!requestTime())  {
-        delay(10000);
-      }
+    if((millis() - LastUpdate >= UplinkCheckTime) && CheckControllerUplink) {
       LastUpdate = millis();
+      if(requestTime())  {
+        UplinkFailures = 0;
+        UplinkCheckTime = UPLINK_CHECK_INTERVAL;
+      }
+      else  {
+        if(UplinkFailures == 0) UplinkLost = millis();
+        if(UplinkFailures < 0xFF) UplinkFailures++;
+
+        if(UplinkFailures >= UPLINK_CHECK_RETRIES && !HoldReset()) {
+          // Connection lost; reset by watchdog
+          wdt_enable(WDTO_15MS);
+          while(true);
+        }
+        UplinkCheckTime = (uint32_t)UPLINK_RETRY_TIME << (min(UplinkFailures, UPLINK_CHECK_RETRIES) - 1);
+      }
+    }
+  #endif
+
+  #ifdef ENABLE_BUS_STATS
+    SampleMemory();
+
+    // One line of the report per pass
+    if(millis() - LastStats >= STATS_INTERVAL) {
+      char Text[26];                                      // MySensors payload & terminator
+      if(Stats.Report(Text, sizeof(Text)))  {
+        send(msgSTATS.set(Text));
+      }
+      else  {
+        LastStats = millis();
+      }
     }
   #endif
 
@@ -0,0 +1,144 @@
+/*
+ * ForwardQueue.h file
+ * Store-and-forward buffer between the bus and the controller uplink. MySensors forwards a frame of
+ * a node to the controller before receive() is called; if the uplink (controller TCP connection or
+ * MQTT broker) is down at that moment, the frame is lost. Such frames are stored here and forwarded
+ * again, oldest first, once the uplink is back.
+ *
+ * A frame replaces a stored one of the same node, sensor, command & type, so only the latest state
+ * (request, internal message...) of every sensor is forwarded; Size is the number of such keys kept,
+ * e.g. nodes * sensors. Frames are stored compactly, Payload bytes at most (5 + Payload bytes of RAM
+ * per frame instead of 32 of MyMessage); longer frames (e.g. presentation) aren't stored. When the
+ * buffer is full, the oldest frame is dropped. Not stored & dropped frames are counted by the caller.
+ *
+ */
+
+#ifndef ForwardQueue_h
+#define ForwardQueue_h
+
+template<uint8_t Size, uint8_t Payload>
+class ForwardQueue {
+
+  static_assert(Size < 128, "ForwardQueue indexes are int8_t");
+
+  public:
+    enum Result : uint8_t { STORED, DROPPED_OLDEST, NOT_STORED };
+
+    /**
+     * @brief Stores a frame which couldn't be forwarded; replaces a stored frame of the same node, sensor, command & type
+     *
+     * @param Msg frame received from a node
+     * @return Result NOT_STORED if the payload is longer than Payload, DROPPED_OLDEST if the oldest frame had to be dropped
+     */
+    Result Push(const MyMessage &Msg)  {
+      if(Msg.getLength() > Payload) return NOT_STORED;
+
+      int8_t i = Find(Msg);
+      Result R = STORED;
+
+      if(i < 0) {
+        if(_Count == Size)  {
+          Remove(0);
+          R = DROPPED_OLDEST;
+        }
+        i = _Count++;
+      }
+
+      Slot &S = _Queue[i];
+
+      S.Sender = Msg.getSender();
+      S.Sensor = Msg.getSensor();
+      S.Type = Msg.getType();
+      S.Command = Msg.getCommand() | Msg.getRequestEcho() << 3 | Msg.isEcho() << 4 | Msg.getPayloadType() << 5;
+      S.Length = Msg.getLength();
+      memcpy(S.Data, Msg.getCustom(), S.Length);
+
+      return R;
+    }
+
+    /**
+     * @brief Removes a stored frame superseded by a frame which has just been forwarded
+     *
+     * @param Msg forwarded frame
+     */
+    void Supersede(const MyMessage &Msg)  {
+      int8_t i = Find(Msg);
+
+      if(i >= 0)  Remove(i);
+    }
+
+    /**
+     * @brief Oldest stored frame; valid only if the queue isn't empty
+     *
+     */
+    MyMessage Front()  {
+      const Slot &S = _Queue[0];
+      MyMessage Msg(S.Sensor, S.Type);
+
+      Msg.setSender(S.Sender);
+      Msg.setLast(S.Sender);
+      Msg.setDestination(GATEWAY_ADDRESS);
+      Msg.setCommand(S.Command & 0x07);
+      Msg.setRequestEcho(S.Command & 0x08);
+      Msg.setEcho(S.Command & 0x10);
+      Msg.set(S.Data, S.Length);
+      Msg.setPayloadType((mysensors_payload_t)(S.Command >> 5));
+
+      return Msg;
+    }
+
+    /**
+     * @brief Removes the oldest stored frame after it has been forwarded
+     *
+     */
+    void Pop()  {
+      if(_Count > 0)  Remove(0);
+    }
+
+    bool Empty()  {
+      return _Count == 0;
+    }
+
+  private:
+    struct Slot {
+      uint8_t Sender;
+      uint8_t Sensor;
+      uint8_t Type;
+      uint8_t Command;                      // Command, request echo, echo & payload type as in MyMessage
+      uint8_t Length;
+      uint8_t Data[Payload];
+    };
+
+    /**
+     * @brief Finds a stored frame of the same node, sensor, command & type
+     *
+     * @return int8_t index; -1 if not found
+     */
+    int8_t Find(const MyMessage &Msg)  {
+      for(uint8_t i=0; i<_Count; i++)  {
+        const Slot &S = _Queue[i];
+        if(S.Sender == Msg.getSender() && S.Sensor == Msg.getSensor() && (S.Command & 0x07) == Msg.getCommand() && S.Type == Msg.getType())  {
+          return i;
+        }
+      }
+
+      return -1;
+    }
+
+    /**
+     * @brief Removes a frame keeping the order of the others
+     *
+     */
+    void Remove(uint8_t Index)  {
+      memmove(&_Queue[Index], &_Queue[Index+1], (_Count - Index - 1) * sizeof(Slot));
+      _Count--;
+    }
+
+    Slot _Queue[Size];
+    uint8_t _Count = 0;
+};
+
+#endif
+/*
+   EOF
+*/
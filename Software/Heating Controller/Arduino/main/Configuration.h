@@ -35,7 +35,9 @@
 // Shield - choose only 1
 // Define this if your shield utilizes an I2C Expander (Heating Shield, I/O Shield, etc.)
 #define EXPANDER_SHIELD
-#define EXPANDER_ADDRESS 0x20
+#define EXPANDER_ADDRESS 0x20                         // Address of the first expander; next ones are addressed in sequence: 0x21, 0x22... (max 0x27)
+#define SECTIONS_PER_EXPANDER 8                       // Number of expander pins used by sections, starting from pin 0 (default 8)
+//#define I2C_FAST_MODE                                 // Enable 400 kHz I2C clock (default 100 kHz)
 
 // Define this if your shield controls outputs directly, by uC pins (2SSR Shield - up to 2 sections, 4RelayDin Shield - up to 4 sections)                                 
 //#define DIRECT_SHIELD                                 
@@ -45,7 +47,7 @@
 #define RELAY_OFF LOW
 
 // Sections and setpoints
-#define HEATING_SECTIONS 8                              // Number of heating sections (default 8, available 1-8)
+#define HEATING_SECTIONS 8                              // Number of heating sections (default 8, available 1-64 with EXPANDER_SHIELD, 1-4 with DIRECT_SHIELD)
 #define DEFAULT_DAY_SP 20                               // Default day setpoint temperature (default 20)
 #define DEFAULT_NIGHT_SP 18                           // Default night setpoint (default 18)
 #define DEFAULT_HOLIDAY_SP 10                         // Default holiday setpoint (default 10)
@@ -58,15 +60,8 @@
 #define SPH_ID SPN_ID+1                                 // Holiday set point ID (one for all sections)
 #define HYSTERESIS_ID SPH_ID+1                          // Hysteresis ID
 
-// Section temperature sensors IDs
-#define T_ID_1 31                     
-#define T_ID_2 35
-#define T_ID_3 37
-#define T_ID_4 38
-#define T_ID_5 40
-#define T_ID_6 51
-#define T_ID_7 52
-#define T_ID_8 53
+// Section temperature sensors IDs - node IDs of thermometers, one for every section, in order of sections
+#define SECTION_SENSORS 31, 35, 37, 38, 40, 51, 52, 53
 
 // I2C Sensors
 //#define INTERNAL_TEMP
@@ -77,10 +72,19 @@
 #endif
 
 // Main loop definitions
-#define INTERVAL 300000                    // Interval value for reporting readings of the sensors: temperature, power usage (default 300000)
+#define INTERVAL 300000                    // Longest interval (ms) between reports of a sensor (heartbeat) (default 300000)
+#define SENSOR_INTERVAL 10000                // Interval (ms) of temperature & humidity readings (default 10000)
 #define INIT_DELAY 200                       // A value to be multiplied by node ID value to obtain the time to wait during the initialization process
 #define PRESENTATION_DELAY 10       // Time (ms) to wait between subsequent presentation messages (default 10)
-#define LOOP_TIME 5000                       // Main loop wait time (default 100)        
+#define PRESENTATION_TIMEOUT 2000            // Time (ms) to wait for manifest hash stored by controller before presenting all sensors (default 2000)
+#define INIT_SYNC_TIMEOUT 10000              // Time (ms) to wait for controller replies to all startup requests (default 10000)
+#define HEATING_INTERVAL 5000                // Interval (ms) of heating logic updates; changes received from controller are handled immediately (default 5000)
+#define MEASURING_INTERVAL 1000              // Interval (ms) of board temperature safety checks (default 1000)
+#define LOOP_TIME 1000                       // Longest main loop wait time (ms), incoming messages are handled meanwhile (default 1000)
+
+// Report policies: absolute deadband, relative deadband (%), hysteresis, min interval (ms), max interval (ms), smoothing (EMA of ~2^n readings, 0 - off)
+#define ITT_POLICY 0.2, 0, 0.1, 30000, INTERVAL, 1        // Onboard thermometer (C)
+#define ITH_POLICY 1.0, 0, 0.5, 30000, INTERVAL, 1        // Onboard hygrometer (%)
 
 /*  *******************************************************************************************
  *                                   MCU Pin Definitions
@@ -139,11 +143,26 @@
 #define SIZE_OF_BYTE 1
 #define SIZE_OF_FLOAT 4
 #define EEPROM_OFFSET 512                     // First eeprom address to use (MySensors uses prior addresses)
-#define EA_HM EEPROM_OFFSET                   // EEPROM address to save Heating Mode value (byte)
+#define EA_HM EEPROM_OFFSET                   // EEPROM address to save Heating Mode value (byte) (legacy, read if journal is empty)
 #define EA_SPN EA_HM+SIZE_OF_BYTE             // EEPROM address to save thermostat value for night mode (float)
 #define EA_SPH EA_SPN+SIZE_OF_FLOAT           // EEPROM address to save thermostat value for holiday mode (float)
 #define EA_HYSTERESIS EA_SPH+SIZE_OF_FLOAT    // EEPROM address to save hysteresis value (float)
 #define EA_FIRST_SECTION EA_HYSTERESIS+SIZE_OF_FLOAT  // EEPROM address to save section values (float)
+#define EA_JOURNAL EA_FIRST_SECTION+HEATING_SECTIONS*SIZE_OF_FLOAT  // EEPROM address of the settings journal (15 bytes per slot)
+#define JOURNAL_SLOTS 16                      // Number of journal slots; every slot is written once per JOURNAL_SLOTS changes (default 16)
+#define JOURNAL_DELAY 5000                    // Time (ms) to collect changes before they are stored in EEPROM (default 5000)
+
+/*  *******************************************************************************************
+ *                                  Derived Definitions
+ *  *******************************************************************************************/
+#ifdef EXPANDER_SHIELD
+  #define NUMBER_OF_EXPANDERS ((HEATING_SECTIONS + SECTIONS_PER_EXPANDER - 1) / SECTIONS_PER_EXPANDER)
+  #define OUTPUT_BANKS NUMBER_OF_EXPANDERS              // Section output bit masks, one per expander
+  #define SECTIONS_PER_BANK SECTIONS_PER_EXPANDER
+#else
+  #define OUTPUT_BANKS 1
+  #define SECTIONS_PER_BANK 16
+#endif
 
  
 #endif
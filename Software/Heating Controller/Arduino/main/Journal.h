@@ -0,0 +1,156 @@
+/*
+ * Journal.h file
+ * Wear leveled EEPROM store: every change of a value is appended as a new record (sequence number,
+ * data, CRC8) to the next slot of a ring, so writes are spread over all slots. The newest valid record
+ * is recovered with a single scan at boot; an interrupted write leaves the previous record intact.
+ *
+ * Put() only stages the value; Commit() writes one byte at a time and never waits for the EEPROM,
+ * so it can be called from the main loop without stalling it.
+ *
+ */
+
+#ifndef Journal_h
+#define Journal_h
+
+#include <EEPROM.h>
+#include <avr/eeprom.h>
+#include <util/crc16.h>
+
+#define JOURNAL_IDLE 0xFF
+#define JOURNAL_WRITE_TIME 4                // EEPROM byte write time (ms), interval of Commit() calls
+
+template<typename T, uint8_t Slots>
+class Journal {
+
+  static_assert(Slots > 1 && Slots < 128, "Journal needs 2-127 slots");
+
+  public:
+    /**
+     * @brief Constructor
+     *
+     * @param Address first EEPROM address of the ring; Size bytes are used
+     */
+    Journal(uint16_t Address) : _Address(Address) {}
+
+    /**
+     * @brief Finds the newest valid record
+     *
+     * @param Value recovered value; not altered if the journal is empty
+     * @return true if a valid record was found
+     */
+    bool Begin(T &Value)  {
+      bool Found = false;
+      Record R;
+
+      for(uint8_t i=0; i<Slots; i++)  {
+        EEPROM.get(SlotAddress(i), R);
+        if(!Valid(R)) continue;
+        // Sequence numbers of valid records are never more than Slots apart, so the comparison survives overflow
+        if(!Found || (int8_t)(R.Seq - _Seq) > 0) {
+          Found = true;
+          _Seq = R.Seq;
+          _Slot = i;
+          Value = R.Data;
+        }
+      }
+
+      _Pending = Value;
+      return Found;
+    }
+
+    /**
+     * @brief Stages a new value; consecutive changes are coalesced into one record
+     *
+     * @param Value value to be stored
+     * @return true if value has changed and Commit() is needed
+     */
+    bool Put(const T &Value)  {
+      if(memcmp(&Value, &_Pending, sizeof(T)) == 0)  return _Dirty;
+
+      _Pending = Value;
+      _Dirty = true;
+
+      return true;
+    }
+
+    /**
+     * @brief Writes the next byte of a pending record if the EEPROM is ready
+     *
+     * @return true if there is still something to write
+     */
+    bool Commit()  {
+      if(_Byte == JOURNAL_IDLE)  {
+        if(!_Dirty) return false;
+
+        _Record.Seq = _Seq + 1;
+        _Record.Data = _Pending;
+        _Record.CRC = CRC(_Record);
+        _Slot = _Slot + 1 < Slots ? _Slot + 1 : 0;
+        _Byte = 0;
+        _Dirty = false;
+      }
+
+      if(!eeprom_is_ready())  return true;
+
+      // Sequence number first, CRC last: a partially written record is invalid
+      EEPROM.update(SlotAddress(_Slot) + _Byte, ((uint8_t *)&_Record)[_Byte]);
+
+      if(++_Byte == sizeof(Record))  {
+        _Byte = JOURNAL_IDLE;
+        _Seq = _Record.Seq;
+        return _Dirty;
+      }
+
+      return true;
+    }
+
+  private:
+    struct __attribute__((packed)) Record {
+      uint8_t Seq;
+      T Data;
+      uint8_t CRC;
+    };
+
+  public:
+    static constexpr uint16_t Size = Slots * sizeof(Record);  // EEPROM bytes used by the journal
+
+  private:
+    uint16_t SlotAddress(uint8_t Slot)  {
+      return _Address + Slot * sizeof(Record);
+    }
+
+    static uint8_t CRC(const Record &R)  {
+      const uint8_t *Data = (const uint8_t *)&R;
+      uint8_t Sum = 0;
+
+      for(uint8_t i=0; i<sizeof(Record)-1; i++) {
+        Sum = _crc8_ccitt_update(Sum, Data[i]);
+      }
+
+      return Sum;
+    }
+
+    static bool Valid(const Record &R)  {
+      const uint8_t *Data = (const uint8_t *)&R;
+      bool Erased = true;
+
+      for(uint8_t i=0; i<sizeof(Record); i++) {
+        Erased &= Data[i] == 0xFF;
+      }
+
+      return !Erased && R.CRC == CRC(R);
+    }
+
+    uint16_t _Address;
+    uint8_t _Slot = Slots - 1;              // Slot of the newest record
+    uint8_t _Seq = 0;                       // Sequence number of the newest record
+    uint8_t _Byte = JOURNAL_IDLE;           // Next byte of _Record to be written
+    bool _Dirty = false;
+    T _Pending;
+    Record _Record;
+};
+
+#endif
+/*
+   EOF
+*/
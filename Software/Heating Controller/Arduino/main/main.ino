@@ -25,10 +25,16 @@
 #include <GoWired2.h>
 #include <PCF8575.h>
 #include "SHTSensor.h"
+#include "Scheduler.h"
+#include "Journal.h"
+#include "ReportPolicy.h"
+#include "Manifest.h"
 
 /***** Globals *****/
-// Timer
-unsigned long LastUpdate = 0;                      // Interval for updating internal thermometer values to controller
+// Tasks
+uint8_t HeatingTask;                               // Heating logic, run at HEATING_INTERVAL or right after a change
+uint8_t JournalTask;                               // Deferred EEPROM writes
+uint8_t SyncTask;                                  // Startup synchronization timeout
 
 // Heating Values
 bool NewState;
@@ -38,12 +44,50 @@ float SetPointNight;                               // Temperature set by control
 float SetPointHoliday;                             // Temperature set by controller for departures
 float Hysteresis;                                  // Histeresis value, default 0
 
+// Settings stored in EEPROM journal
+struct Settings {
+  uint8_t HeatingMode;
+  float SetPointNight;
+  float SetPointHoliday;
+  float Hysteresis;
+};
+
 #ifdef DIRECT_SHIELD
   uint8_t OutputPins[4] = {OUTPUT_PIN_1, OUTPUT_PIN_2, OUTPUT_PIN_3, OUTPUT_PIN_4};
+  static_assert(HEATING_SECTIONS <= 4, "DIRECT_SHIELD supports up to 4 sections");
+#endif
+
+// Outputs: relay state of section i is bit i % SECTIONS_PER_BANK of Outputs[i / SECTIONS_PER_BANK] (expander pin)
+uint16_t Outputs[OUTPUT_BANKS];                    // Relay states, one bit per section
+uint16_t WrittenOutputs[OUTPUT_BANKS];             // Relay states last written to expanders or pins
+#ifdef EXPANDER_SHIELD
+  static_assert(NUMBER_OF_EXPANDERS <= 8, "Up to 8 expanders (0x20-0x27) are supported");
+  static_assert(SECTIONS_PER_EXPANDER <= 16, "An expander has 16 pins");
+  uint16_t OutputMask[NUMBER_OF_EXPANDERS];        // Expander pins used by sections; other pins are left high (input)
 #endif
 
+// Section thermometers
+#define NO_SECTION 0xFF
+const uint8_t SectionSensors[] PROGMEM = {SECTION_SENSORS};
+static_assert(sizeof(SectionSensors) == HEATING_SECTIONS, "SECTION_SENSORS has to list one thermometer for every section");
+
+/**
+ * @brief Smallest power of 2 holding twice the number of sections; keeps the sender index at most half full
+ * 
+ */
+constexpr uint8_t SenderIndexSize(uint8_t Size = 1) {
+  return Size >= 2 * HEATING_SECTIONS ? Size : SenderIndexSize(Size * 2);
+}
+
+// Thermometer node ID -> section reverse index (open addressing, linear probing)
+uint8_t SenderKey[SenderIndexSize()];              // Thermometer node ID; NO_SECTION - empty slot
+uint8_t SenderSection[SenderIndexSize()];          // First section of this thermometer
+uint8_t NextSection[HEATING_SECTIONS];             // Next section using the same thermometer
+
 // Additional presentation status required by Home Assistant
 bool InitConfirm = false;
+uint8_t SyncPending = 0;                           // Number of values requested at startup & not yet received from controller
+bool SyncComplete = false;
 
 // EEPROM
 uint16_t EEPROM_ADDRESS = EA_FIRST_SECTION;        // Initial EEPROM Address
@@ -54,6 +98,13 @@ bool InformControllerTS = false;                   // Was controller informed ab
 bool IT_STATUS = false;
 
 /***** Constructors *****/
+// Scheduler
+Scheduler Sched;
+
+// EEPROM journal
+Journal<Settings, JOURNAL_SLOTS> SettingsJournal(EA_JOURNAL);
+static_assert(EA_JOURNAL + decltype(SettingsJournal)::Size <= E2END + 1, "Settings journal doesn't fit in EEPROM; reduce JOURNAL_SLOTS");
+
 // Heating constructor
 Heating Section[HEATING_SECTIONS];
 MyMessage msgSTATUS(0, V_STATUS);
@@ -61,20 +112,24 @@ MyMessage msgPERCENTAGE(0, V_PERCENTAGE);
 MyMessage msgHVAC1(0, V_HVAC_SETPOINT_HEAT);
 MyMessage msgHVAC2(0, V_HVAC_FLOW_STATE);
 MyMessage msgTEMP(0, V_TEMP);
+MyMessage msgREADY(NODE_SENSOR_ID, V_VAR1);
+Manifest Presentation(NODE_SENSOR_ID);
 
-// I2C expander
+// I2C expanders
 #ifdef EXPANDER_SHIELD
-  PCF8575 Exp;
+  PCF8575 Exp[NUMBER_OF_EXPANDERS];
 #endif
 
 // SHT30 sensor
 #ifdef INTERNAL_TEMP
   SHTSensor sht;
+  ReportPolicy<float> ITTPolicy(ITT_POLICY);
+  ReportPolicy<float> ITHPolicy(ITH_POLICY);
   MyMessage msgHUM(0, V_HUM);
 #endif
 
 /**
- * @brief Function called before setup(); resets wdt
+ * @brief Function called before setup(); resets wdt, builds the thermometer index (receive() may run during presentation)
  * 
  */
 void before() {
@@ -84,6 +139,12 @@ void before() {
     MCUSR = 0;
     wdt_disable();
   #endif
+
+  memset(SenderKey, NO_SECTION, sizeof(SenderKey));
+
+  for(int i=FIRST_SECTION_ID; i<FIRST_SECTION_ID+HEATING_SECTIONS; i++)  {
+    AddSender(pgm_read_byte(&SectionSensors[i]), i);
+  }
 }
 
 /**
@@ -97,7 +158,12 @@ void setup() {
   #endif
 
   #ifdef EXPANDER_SHIELD
-    Exp.begin(EXPANDER_ADDRESS);
+    for(uint8_t i=0; i<NUMBER_OF_EXPANDERS; i++)  {
+      Exp[i].begin(EXPANDER_ADDRESS + i);
+    }
+    #ifdef I2C_FAST_MODE
+      Wire.setClock(400000);
+    #endif
   #endif
 
   #ifdef INTERNAL_TEMP
@@ -106,63 +172,122 @@ void setup() {
     sht.setAccuracy(SHTSensor::SHT_ACCURACY_MEDIUM);
   #endif
 
-  uint8_t T_ID[8] = {T_ID_1, T_ID_2, T_ID_3, T_ID_4, T_ID_5, T_ID_6, T_ID_7, T_ID_8};
-  
   for(int i=FIRST_SECTION_ID; i<FIRST_SECTION_ID+HEATING_SECTIONS; i++)  {
-    EEPROM_ADDRESS = Section[i].SetSectionValues(T_ID[i], DEFAULT_DAY_SP, EEPROM_ADDRESS, RELAY_OFF);
-    Section[i].RelayState = RELAY_OFF;
+    uint8_t TID = pgm_read_byte(&SectionSensors[i]);
+
+    EEPROM_ADDRESS = Section[i].SetSectionValues(TID, DEFAULT_DAY_SP, EEPROM_ADDRESS, RELAY_OFF);
     #ifdef EXPANDER_SHIELD
-      Exp.pinMode(i, OUTPUT);
-      Exp.digitalWrite(i, Section[i].RelayState);
+      Exp[i / SECTIONS_PER_EXPANDER].pinMode(i % SECTIONS_PER_EXPANDER, OUTPUT);
+      OutputMask[i / SECTIONS_PER_EXPANDER] |= (uint16_t)1 << (i % SECTIONS_PER_EXPANDER);
     #elif defined(DIRECT_SHIELD)
       pinMode(OutputPins[i], OUTPUT);
-      digitalWrite(OutputPins[i], Section[i].RelayState);
+      digitalWrite(OutputPins[i], RELAY_OFF);
     #endif
+    SetOutput(i, RELAY_OFF);
   }
 
-  EEPROM.get(EA_HM, HeatingMode);
+  #ifdef EXPANDER_SHIELD
+    for(uint8_t i=0; i<NUMBER_OF_EXPANDERS; i++)  {
+      Exp[i].write(Outputs[i] | ~OutputMask[i]);
+    }
+  #endif
+  memcpy(WrittenOutputs, Outputs, sizeof(Outputs));
+
+  // Newest journaled settings; settings saved by older software otherwise
+  Settings Stored;
+
+  EEPROM.get(EA_HM, Stored.HeatingMode);
+  EEPROM.get(EA_SPN, Stored.SetPointNight);
+  EEPROM.get(EA_SPH, Stored.SetPointHoliday);
+  EEPROM.get(EA_HYSTERESIS, Stored.Hysteresis);
+  SettingsJournal.Begin(Stored);
 
+  HeatingMode = Stored.HeatingMode;
   HeatingMode = HeatingMode > 40 ? 0 : HeatingMode;
   HeatingMode = HeatingMode < 0 ? 0 : HeatingMode;
   HeatingStatus = HeatingMode == 0 ? false : true;
   
-  EEPROM.get(EA_SPN, SetPointNight);
-
+  SetPointNight = Stored.SetPointNight;
   SetPointNight = SetPointNight < 100 ? SetPointNight : DEFAULT_NIGHT_SP;
   
-  EEPROM.get(EA_SPH, SetPointHoliday);
-
+  SetPointHoliday = Stored.SetPointHoliday;
   SetPointHoliday = SetPointHoliday < 100 ? SetPointHoliday : DEFAULT_HOLIDAY_SP;
   
-  EEPROM.get(EA_HYSTERESIS, Hysteresis);
-
+  Hysteresis = Stored.Hysteresis;
   Hysteresis = Hysteresis < 100 ? Hysteresis : DEFAULT_HYSTERESIS;
+
+  // Tasks
+  #ifdef INTERNAL_TEMP
+    Sched.AddTask(SafetyUpdate, MEASURING_INTERVAL);
+    Sched.AddTask(ITUpdate, SENSOR_INTERVAL);
+  #endif
+  HeatingTask = Sched.AddTask(HeatingCheck, HEATING_INTERVAL);
+  SyncTask = Sched.AddTask(SyncUpdate, 0);
+  JournalTask = Sched.AddTask(JournalUpdate, 0);
   
 }
 
+/***** Presentation manifest *****/
+const char NameSection[] PROGMEM = "Heating Section";
+const char NameMode[] PROGMEM = "Heating Mode";
+const char NameSetPointNight[] PROGMEM = "SetPoint Night";
+const char NameSetPointHolidays[] PROGMEM = "SetPoint Holidays";
+const char NameHysteresis[] PROGMEM = "SetPoint Hysteresis";
+const char NameTemperature[] PROGMEM = "Onboard SHT30 temperature";
+const char NameHumidity[] PROGMEM = "Onboard SHT30 humidity";
+
+// Sensor ID, count, presentation, name
+const PresentEntry Sensors[] PROGMEM = {
+  {FIRST_SECTION_ID, HEATING_SECTIONS, S_HVAC, NameSection},
+  {SELECTOR_SWITCH_ID, 1, S_DIMMER, NameMode},
+  {SPN_ID, 1, S_HVAC, NameSetPointNight},
+  {SPH_ID, 1, S_HVAC, NameSetPointHolidays},
+  {HYSTERESIS_ID, 1, S_HVAC, NameHysteresis},
+  #ifdef INTERNAL_TEMP
+    {ITT_ID, 1, S_TEMP, NameTemperature},
+    {ITH_ID, 1, S_HUM, NameHumidity},
+  #endif
+};
+
+#define NUMBER_OF_PRESENTED (sizeof(Sensors) / sizeof(Sensors[0]))
+
 /**
  * @brief Presents module to the controller, send name, software version, info about sensors
  * 
  */
 void presentation() {
 
-  sendSketchInfo(SN, SV);
+  sendSketchInfo(F(SN), F(SV));
 
-  for(int i=FIRST_SECTION_ID; i<FIRST_SECTION_ID+HEATING_SECTIONS; i++)  {
-    present(i, S_HVAC, "Heating Section");
-    wait(PRESENTATION_DELAY);
-  }
+  // At startup sensors are presented only if the controller doesn't know this manifest, see loop()
+  if(Presentation.Check(Manifest::Hash(HashString_P(HashString_P(FNV_OFFSET, PSTR(SN)), PSTR(SV)), Sensors, NUMBER_OF_PRESENTED))) return;
 
-  present(SELECTOR_SWITCH_ID, S_DIMMER, "Heating Mode");  wait(PRESENTATION_DELAY);
-  present(SPN_ID, S_HVAC, "SetPoint Night");  wait(PRESENTATION_DELAY);
-  present(SPH_ID, S_HVAC, "SetPoint Holidays"); wait(PRESENTATION_DELAY);
-  present(HYSTERESIS_ID, S_HVAC, "SetPoint Hysteresis");  wait(PRESENTATION_DELAY);
+  Manifest::Present(Sensors, NUMBER_OF_PRESENTED, PRESENTATION_DELAY);
+  Presentation.Presented();
+}
 
-  #ifdef INTERNAL_TEMP
-    present(ITT_ID, S_TEMP, "Onboard SHT30 temperature"); wait(PRESENTATION_DELAY);
-    present(ITH_ID, S_HUM, "Onboard SHT30 humidity"); wait(PRESENTATION_DELAY);
-  #endif
-  
+/**
+ * @brief Requests sensor value from controller without waiting for the reply; the reply is handled by receive()
+ * 
+ * @param Sensor sensor ID
+ * @param Type value type
+ */
+void SyncRequest(uint8_t Sensor, uint8_t Type) {
+
+  request(Sensor, Type);
+  SyncPending++;
+}
+
+/**
+ * @brief Finishes startup synchronization when all requested values arrived or INIT_SYNC_TIMEOUT passed; reports boot-to-ready time
+ * 
+ */
+void SyncUpdate() {
+
+  if(SyncComplete)  return;
+
+  SyncComplete = true;
+  send(msgREADY.set(millis()));
 }
 
 /**
@@ -173,47 +298,38 @@ void InitConfirmation() {
 
   for(int i=FIRST_SECTION_ID; i<FIRST_SECTION_ID+HEATING_SECTIONS; i++)  {   
     send(msgHVAC1.setSensor(i).set(Section[i].SetPointDay, 1));
-    request(i, V_HVAC_SETPOINT_HEAT);
-    wait(2000, C_SET, V_HVAC_SETPOINT_HEAT);
+    SyncRequest(i, V_HVAC_SETPOINT_HEAT);
 
     send(msgHVAC2.setSensor(i).set("Off"));
-    request(i, V_HVAC_FLOW_STATE);
-    wait(2000, C_SET, V_HVAC_FLOW_STATE);
+    SyncRequest(i, V_HVAC_FLOW_STATE);
   }
 
   send(msgSTATUS.setSensor(SELECTOR_SWITCH_ID).set(HeatingStatus));
-  request(SELECTOR_SWITCH_ID, V_STATUS);
-  wait(2000, C_SET, V_STATUS);
+  SyncRequest(SELECTOR_SWITCH_ID, V_STATUS);
   
   send(msgPERCENTAGE.setSensor(SELECTOR_SWITCH_ID).set(HeatingMode));
-  request(SELECTOR_SWITCH_ID, V_PERCENTAGE);
-  wait(2000, C_SET, V_PERCENTAGE);
+  SyncRequest(SELECTOR_SWITCH_ID, V_PERCENTAGE);
   
   send(msgHVAC1.setSensor(SPN_ID).set(SetPointNight, 1));
-  request(SPN_ID, V_HVAC_SETPOINT_HEAT);
-  wait(2000, C_SET, SPN_ID);
+  SyncRequest(SPN_ID, V_HVAC_SETPOINT_HEAT);
 
   send(msgHVAC2.setSensor(SPN_ID).set("Off"));
-  request(SPN_ID, V_HVAC_FLOW_STATE);
-  wait(2000, C_SET, V_HVAC_FLOW_STATE);
+  SyncRequest(SPN_ID, V_HVAC_FLOW_STATE);
   
   send(msgHVAC1.setSensor(SPH_ID).set(SetPointHoliday, 1));
-  request(SPH_ID, V_HVAC_SETPOINT_HEAT);
-  wait(2000, C_SET, SPH_ID);
+  SyncRequest(SPH_ID, V_HVAC_SETPOINT_HEAT);
 
   send(msgHVAC2.setSensor(SPH_ID).set("Off"));
-  request(SPH_ID, V_HVAC_FLOW_STATE);
-  wait(2000, C_SET, V_HVAC_FLOW_STATE);
+  SyncRequest(SPH_ID, V_HVAC_FLOW_STATE);
   
   send(msgHVAC1.setSensor(HYSTERESIS_ID).set(Hysteresis, 1));
-  request(HYSTERESIS_ID, V_HVAC_SETPOINT_HEAT);
-  wait(2000, C_SET, HYSTERESIS_ID);
+  SyncRequest(HYSTERESIS_ID, V_HVAC_SETPOINT_HEAT);
 
   send(msgHVAC2.setSensor(HYSTERESIS_ID).set("Off"));
-  request(HYSTERESIS_ID, V_HVAC_FLOW_STATE);
-  wait(2000, C_SET, V_HVAC_FLOW_STATE);
+  SyncRequest(HYSTERESIS_ID, V_HVAC_FLOW_STATE);
     
   InitConfirm = true;
+  Sched.RunIn(SyncTask, INIT_SYNC_TIMEOUT);
   
 }
 
@@ -224,6 +340,28 @@ void InitConfirmation() {
  */
 void receive(const MyMessage &message)  {
 
+  // Manifest hash stored by the controller
+  if(Presentation.Receive(message)) return;
+
+  // Reply to a startup request
+  if(!SyncComplete && SyncPending > 0 && message.getCommand() == C_SET && message.type != V_TEMP) {
+    if(--SyncPending == 0)  {
+      Sched.RunNow(SyncTask);
+    }
+  }
+
+  switch(message.type)  {
+    case V_STATUS:
+    case V_PERCENTAGE:
+    case V_HVAC_SETPOINT_HEAT:
+    case V_TEMP:
+      // New mode, set point or temperature; recalculate section states without waiting for HEATING_INTERVAL
+      Sched.RunNow(HeatingTask);
+      break;
+    default:
+      break;
+  }
+
   switch(message.type)  {
     // Messages about relay and error status
     case V_STATUS:
@@ -244,7 +382,7 @@ void receive(const MyMessage &message)  {
         int NewValue = message.getInt();
         if(NewValue == 0 || NewValue == 10 || NewValue == 20 || NewValue == 30 || NewValue == 40)  {
           HeatingMode = NewValue;
-          EEPROM.put(EA_HM, HeatingMode);
+          StoreSettings();
         }        
         if(NewValue == 10)  {
           send(msgHVAC2.setSensor(SPN_ID).set("Off"));
@@ -268,32 +406,26 @@ void receive(const MyMessage &message)  {
     case V_HVAC_SETPOINT_HEAT:
       if(message.sensor == SPN_ID) {
         SetPointNight = message.getFloat();
-        EEPROM.put(EA_SPN, SetPointNight);
+        StoreSettings();
       }
       else if(message.sensor == SPH_ID)  {
         SetPointHoliday = message.getFloat();
-        EEPROM.put(EA_SPH, SetPointHoliday);
+        StoreSettings();
       }
       else if(message.sensor == HYSTERESIS_ID) {
         Hysteresis = message.getFloat();
-        EEPROM.put(EA_HYSTERESIS, Hysteresis);
+        StoreSettings();
       }
-      else  {
-        for(int i=FIRST_SECTION_ID; i<FIRST_SECTION_ID+HEATING_SECTIONS; i++)  {
-          if(message.sensor == i)  {
-            Section[i].SetTemperature(message.getFloat());
-          }
-        }
+      else if(message.sensor >= FIRST_SECTION_ID && message.sensor < FIRST_SECTION_ID+HEATING_SECTIONS)  {
+        Section[message.sensor - FIRST_SECTION_ID].SetTemperature(message.getFloat());
       }
       break;
     // Messages from remote sensors reporting temperature
     case V_TEMP:
-      for(int i=FIRST_SECTION_ID; i<FIRST_SECTION_ID+HEATING_SECTIONS; i++)  {
-        if(message.sender == Section[i].GetTID()) {
-          float Temp = message.getFloat();
-          Section[i].ReadTemperature(Temp);
-          send(msgTEMP.setSensor(i).set(Temp, 1));
-        }
+      for(uint8_t i=FindSection(message.sender); i!=NO_SECTION; i=NextSection[i])  {
+        float Temp = message.getFloat();
+        Section[i].ReadTemperature(Temp);
+        send(msgTEMP.setSensor(i).set(Temp, 1));
       }
       break;
     case V_HVAC_FLOW_STATE:
@@ -306,23 +438,18 @@ void receive(const MyMessage &message)  {
       }
       // Manual control; possible to change section states by controller
       else  {
-        for(int i=FIRST_SECTION_ID; i<FIRST_SECTION_ID+HEATING_SECTIONS; i++)  {
-          if(message.sensor == i) {
-            const char *Payload = message.getString();
-            if(Payload == "Off")  {
-              NewState = RELAY_OFF;
-            }
-            else if(Payload == "HeatOn")  {
-              NewState = RELAY_ON;
-            }
-            if(NewState != Section[i].RelayState) {
-              #ifdef EXPANDER_SHIELD
-                Exp.digitalWrite(i, NewState);
-              #elif defined(DIRECT_SHIELD)
-                digitalWrite(OutputPins[i], NewState);
-              #endif
-              Section[i].RelayState = NewState;
-            }
+        if(message.sensor >= FIRST_SECTION_ID && message.sensor < FIRST_SECTION_ID+HEATING_SECTIONS) {
+          uint8_t i = message.sensor - FIRST_SECTION_ID;
+          const char *Payload = message.getString();
+          if(strcmp(Payload, "Off") == 0)  {
+            NewState = RELAY_OFF;
+          }
+          else if(strcmp(Payload, "HeatOn") == 0)  {
+            NewState = RELAY_ON;
+          }
+          if(NewState != RelayState(i)) {
+            SetOutput(i, NewState);
+            WriteOutputs();
           }
         }
         if(message.sensor >= FIRST_SECTION_ID+HEATING_SECTIONS)  {
@@ -335,18 +462,139 @@ void receive(const MyMessage &message)  {
 }
 
 /**
- * @brief Heating controlling backend
+ * @brief Stages current settings in the journal; stored after JOURNAL_DELAY, so a burst of controller messages results in one record
+ * 
+ */
+void StoreSettings()  {
+
+  Settings Current = {HeatingMode, SetPointNight, SetPointHoliday, Hysteresis};
+
+  if(SettingsJournal.Put(Current)) {
+    Sched.RunIn(JournalTask, JOURNAL_DELAY);
+  }
+}
+
+/**
+ * @brief Scheduled task: writes pending journal record byte by byte without waiting for the EEPROM
+ * 
+ */
+void JournalUpdate()  {
+
+  if(SettingsJournal.Commit())  {
+    Sched.RunIn(JournalTask, JOURNAL_WRITE_TIME);
+  }
+}
+
+/**
+ * @brief Adds section to the thermometer node ID -> section index
+ * 
+ * @param Sender thermometer node ID
+ * @param Section section number
+ */
+void AddSender(uint8_t Sender, uint8_t Section) {
+
+  uint8_t Mask = sizeof(SenderKey) - 1;
+  uint8_t Slot = Sender & Mask;
+
+  while(SenderKey[Slot] != NO_SECTION && SenderKey[Slot] != Sender) {
+    Slot = (Slot + 1) & Mask;
+  }
+
+  // Thermometer shared by a few sections: section list
+  NextSection[Section] = SenderKey[Slot] == Sender ? SenderSection[Slot] : NO_SECTION;
+  SenderKey[Slot] = Sender;
+  SenderSection[Slot] = Section;
+}
+
+/**
+ * @brief Finds section controlled by the given thermometer
+ * 
+ * @param Sender thermometer node ID
+ * @return uint8_t first section number, further ones in NextSection[]; NO_SECTION if not found
+ */
+uint8_t FindSection(uint8_t Sender) {
+
+  uint8_t Mask = sizeof(SenderKey) - 1;
+  uint8_t Slot = Sender & Mask;
+
+  while(SenderKey[Slot] != NO_SECTION) {
+    if(SenderKey[Slot] == Sender) {
+      return SenderSection[Slot];
+    }
+    Slot = (Slot + 1) & Mask;
+  }
+
+  return NO_SECTION;
+}
+
+/**
+ * @brief Relay state of a section
+ * 
+ * @param i section number
+ */
+bool RelayState(uint8_t i) {
+
+  return Outputs[i / SECTIONS_PER_BANK] >> (i % SECTIONS_PER_BANK) & 1;
+}
+
+/**
+ * @brief Sets section output in memory; written by WriteOutputs()
+ * 
+ * @param i section number
+ * @param State new relay state
+ */
+void SetOutput(uint8_t i, bool State) {
+
+  uint16_t Pin = (uint16_t)1 << (i % SECTIONS_PER_BANK);
+
+  if(State) {
+    Outputs[i / SECTIONS_PER_BANK] |= Pin;
+  }
+  else  {
+    Outputs[i / SECTIONS_PER_BANK] &= ~Pin;
+  }
+
+  // Heating::TemperatureCompare() keeps the state within the hysteresis band
+  Section[i].RelayState = State;
+}
+
+/**
+ * @brief Writes output states: one I2C transmission per changed expander, or the changed pins
+ * 
+ */
+void WriteOutputs() {
+
+  for(uint8_t i=0; i<OUTPUT_BANKS; i++)  {
+    uint16_t Changed = Outputs[i] ^ WrittenOutputs[i];
+
+    if(!Changed)  continue;
+
+    #ifdef EXPANDER_SHIELD
+      Exp[i].write(Outputs[i] | ~OutputMask[i]);
+    #elif defined(DIRECT_SHIELD)
+      for(uint8_t j=0; j<HEATING_SECTIONS; j++) {
+        if(Changed >> j & 1)  digitalWrite(OutputPins[j], Outputs[i] >> j & 1);
+      }
+    #endif
+    WrittenOutputs[i] = Outputs[i];
+  }
+}
+
+/**
+ * @brief Heating controlling backend; calculates states of all sections, then writes all outputs at once
  * 
  */
 void HeatingUpdate()  {
 
-  bool NewState;
+  uint16_t Demand[OUTPUT_BANKS] = {0};             // New relay states, one bit per section
+  uint16_t Changed[OUTPUT_BANKS];
 
   for(int i=FIRST_SECTION_ID; i<FIRST_SECTION_ID+HEATING_SECTIONS; i++)  {
+    bool NewState = RelayState(i);
+
     switch(HeatingMode) {
       case 0:
         // Heating inactive
-        NewState = Section[i].RelayState;
         break;
       case 10:
         // DAY MODE
@@ -364,18 +612,26 @@ void HeatingUpdate()  {
         // Nothing to do here
         break;
     }
-    if(NewState != Section[i].RelayState) {
-      #ifdef EXPANDER_SHIELD
-        Exp.digitalWrite(i, NewState);
-      #elif defined(DIRECT_SHIELD)
-        digitalWrite(OutputPins[i], NewState);
-      #endif
-      
-      Section[i].RelayState = NewState;
+    if(NewState)  {
+      Demand[i / SECTIONS_PER_BANK] |= (uint16_t)1 << (i % SECTIONS_PER_BANK);
+    }
+  }
+
+  for(uint8_t i=0; i<OUTPUT_BANKS; i++) {
+    Changed[i] = Demand[i] ^ Outputs[i];
+    Outputs[i] = Demand[i];
+  }
+
+  WriteOutputs();
+
+  // Reporting new states
+  for(int i=FIRST_SECTION_ID; i<FIRST_SECTION_ID+HEATING_SECTIONS; i++)  {
+    if(Changed[i / SECTIONS_PER_BANK] >> (i % SECTIONS_PER_BANK) & 1) {
       uint8_t counter = 0;
       bool MessageDelivered;
 
-      if(NewState == RELAY_ON)  {
+      Section[i].RelayState = RelayState(i);   // See SetOutput()
+      if(RelayState(i) == RELAY_ON)  {
         do  {
           MessageDelivered = send(msgHVAC2.setSensor(i).set("HeatOn"));
           counter++;
@@ -406,8 +662,12 @@ void ITUpdate()  {
         IT_STATUS = true;
         send(msgSTATUS.setSensor(IT_STATUS_ID).set(IT_STATUS));
       }
-      send(msgTEMP.setSensor(ITT_ID).set(sht.getTemperature(), 1));
-      send(msgHUM.setSensor(ITH_ID).set(sht.getHumidity(), 1));
+      if(ITTPolicy.Update(sht.getTemperature(), millis())) {
+        send(msgTEMP.setSensor(ITT_ID).set(ITTPolicy.Value(), 1));
+      }
+      if(ITHPolicy.Update(sht.getHumidity(), millis()))  {
+        send(msgHUM.setSensor(ITH_ID).set(ITHPolicy.Value(), 1));
+      }
     }
     else  {
       IT_STATUS = false;
@@ -417,18 +677,12 @@ void ITUpdate()  {
 }
 
 /**
- * @brief main loop
+ * @brief Board temperature safety check
  * 
  */
-void loop() {
-
-  // Extended presentation as required by Home Assistant; runs only after startup
-  if (!InitConfirm)  {
-    InitConfirmation();
-  }
+void SafetyUpdate()  {
 
   #ifdef INTERNAL_TEMP
-    // Safety check
     THERMAL_ERROR = IT.ThermalStatus(IT.MeasureT());
 
     // Handling safety procedures
@@ -437,7 +691,10 @@ void loop() {
       // Turn off relays/triacs
       HeatingStatus = false;
       for(int i=FIRST_SECTION_ID; i<FIRST_SECTION_ID+HEATING_SECTIONS; i++)  {
-        Exp.digitalWrite(i, RELAY_OFF);
+        SetOutput(i, RELAY_OFF);
+      }
+      WriteOutputs();
+      for(int i=FIRST_SECTION_ID; i<FIRST_SECTION_ID+HEATING_SECTIONS; i++)  {
         send(msgSTATUS.setSensor(i).set(RELAY_OFF));
       }
       send(msgSI.setSensor(TS_ID).set(THERMAL_ERROR));
@@ -448,20 +705,41 @@ void loop() {
       send(msgSI.setSensor(TS_ID).set(THERMAL_ERROR));
       InformControllerTS = false;
     }
-
-    // Update internal temperature value to the controller
-    if(millis() > LastUpdate + INTERVAL)  {
-      ITUpdate();
-      LastUpdate = millis();
-    }
   #endif
-  
-  // Heating logic
+}
+
+/**
+ * @brief Scheduled heating logic
+ * 
+ */
+void HeatingCheck()  {
+
   if(HeatingStatus == true && HeatingMode != 40)  {
     HeatingUpdate();
   }
-  
-  wait(LOOP_TIME);
+}
+
+/**
+ * @brief main loop: runs all tasks which are due, waits for the next one
+ * 
+ */
+void loop() {
+
+  // Presentation deferred at startup: controller doesn't know this manifest or didn't reply
+  if(Presentation.Due())  {
+    Manifest::Present(Sensors, NUMBER_OF_PRESENTED, PRESENTATION_DELAY);
+    Presentation.Presented();
+  }
+
+  // Extended presentation as required by Home Assistant; runs only after startup
+  if (!InitConfirm && Presentation.Synced())  {
+    InitConfirmation();
+  }
+
+  Sched.Run();
+
+  // Handling incoming messages until the next task is due
+  wait(Sched.TimeToNext(LOOP_TIME));
 }
 /*
  * 
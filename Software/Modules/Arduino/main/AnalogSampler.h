@@ -0,0 +1,260 @@
+/*
+ * AnalogSampler.h file
+ * Interrupt driven ADC acquisition: channels are converted one after another in the background,
+ * every channel is sampled for a fixed window and its sum & sum of squares are stored as a snapshot.
+ * Mean, RMS and Vcc readings are then O(1) and don't block the main loop.
+ *
+ * All readings are integer: samples are accumulated as deviations from the previous window's mean,
+ * so the variance is computed in 32 bits without cancellation and no soft-float code is needed.
+ *
+ * Don't use analogRead() while the sampler is running. Touch fields aren't sampled here: the field is
+ * charged through its pullup before every conversion (CommonIO::CheckInput2() of GoWired-lib).
+ *
+ */
+
+#ifndef AnalogSampler_h
+#define AnalogSampler_h
+
+#include <util/atomic.h>
+
+#define MAX_ADC_CHANNELS 6                  // Maximum number of sampled channels
+#define ADC_NO_CHANNEL 0xFF                 // No channel left; readings of it are 0
+#define ADC_BANDGAP 0x0E                    // MUX value of the internal 1.1V reference
+#define ADC_BANDGAP_MV 1100                 // Nominal value of the internal reference (mV)
+#define ADC_DISCARD 1                       // Conversions discarded after switching to an external pin
+#define ADC_BANDGAP_DISCARD 4               // Conversions discarded after switching to the internal reference
+#define ADC_CONVERSION_US (13UL * 128UL * 1000000UL / F_CPU)  // Single conversion time with prescaler 128 (us)
+#define ADC_MAX_SAMPLES 4096                // Longest window (conversions) that can't overflow the sum of squares
+#define ADC_INITIAL_OFFSET 512
+
+class AnalogSampler {
+
+  public:
+    /**
+     * @brief Registers a new channel; has to be called before Begin()
+     *
+     * @param Pin analog pin (A0-A7)
+     * @param Window sampling window in ms; use whole mains periods for AC channels
+     * @return uint8_t channel number; ADC_NO_CHANNEL if all MAX_ADC_CHANNELS are used
+     */
+    uint8_t AddChannel(uint8_t Pin, uint16_t Window)  {
+      return Add(Pin >= A0 ? Pin - A0 : Pin, Window);
+    }
+
+    /**
+     * @brief Registers the internal 1.1V reference, read with Vcc(); has to be called before Begin()
+     *
+     * @param Window sampling window in ms
+     * @return uint8_t channel number; ADC_NO_CHANNEL if all MAX_ADC_CHANNELS are used
+     */
+    uint8_t AddBandgap(uint16_t Window)  {
+      return Add(ADC_BANDGAP, Window);
+    }
+
+    /**
+     * @brief Starts background conversions (AVcc reference, prescaler 128, single conversion mode retriggered from ISR)
+     *
+     */
+    void Begin()  {
+      _Current = 0;
+      SelectChannel();
+      ADCSRA = _BV(ADEN) | _BV(ADIE) | _BV(ADPS2) | _BV(ADPS1) | _BV(ADPS0);
+      ADCSRA |= _BV(ADSC);
+    }
+
+    /**
+     * @brief Checks if every channel has completed at least one window
+     *
+     * @return true if all readings are valid
+     */
+    bool Ready()  {
+      for(uint8_t i=0; i<_Count; i++)  {
+        if(Snapshot(i).N == 0)  return false;
+      }
+      return true;
+    }
+
+    /**
+     * @brief Average voltage of the last window
+     *
+     * @param Ch channel number
+     * @param Vcc uC supply voltage (mV)
+     * @return uint16_t voltage in mV
+     */
+    uint16_t Mean(uint8_t Ch, uint16_t Vcc)  {
+      Channel C = Snapshot(Ch);
+
+      if(C.N == 0)  return 0;
+
+      // Counts in 12.4 fixed point
+      uint32_t Mean = ((int32_t)C.Offset * C.N + C.Sum) * 16 / C.N;
+
+      return (Mean * Vcc + 8192) >> 14;
+    }
+
+    /**
+     * @brief RMS of the AC component of the last window (DC offset removed)
+     *
+     * @param Ch channel number
+     * @param Vcc uC supply voltage (mV)
+     * @return uint16_t voltage in mV
+     */
+    uint16_t RMS(uint8_t Ch, uint16_t Vcc)  {
+      Channel C = Snapshot(Ch);
+
+      if(C.N == 0)  return 0;
+
+      // Mean deviation in 12.4, mean square in 24.8 fixed point
+      int32_t Mean = C.Sum * 16 / (int32_t)C.N;
+      uint32_t Square = ((C.SumSq / C.N) << 8) + ((C.SumSq % C.N) << 8) / C.N;
+      uint32_t MeanSquare = Mean * Mean;
+      uint32_t RMS = Square > MeanSquare ? ISqrt(Square - MeanSquare) : 0;
+
+      return (RMS * Vcc + 8192) >> 14;
+    }
+
+    /**
+     * @brief Calculates uC supply voltage from the internal reference channel
+     *
+     * @param Ch channel registered with AddBandgap()
+     * @return uint16_t voltage in mV
+     */
+    uint16_t Vcc(uint8_t Ch)  {
+      Channel C = Snapshot(Ch);
+      uint32_t Sum = (int32_t)C.Offset * C.N + C.Sum;
+
+      if(Sum == 0)  return 0;
+
+      return (ADC_BANDGAP_MV * 1024UL * C.N) / Sum;
+    }
+
+    /**
+     * @brief Integer square root, rounded
+     *
+     * @param X value below 0xFFFF0000
+     */
+    static uint16_t ISqrt(uint32_t X)  {
+      uint32_t Root = 0;
+      uint32_t Bit = 1UL << 30;
+
+      while(Bit > X)  Bit >>= 2;
+
+      while(Bit)  {
+        if(X >= Root + Bit) {
+          X -= Root + Bit;
+          Root = (Root >> 1) + Bit;
+        }
+        else  {
+          Root >>= 1;
+        }
+        Bit >>= 2;
+      }
+
+      // Remainder above Root: sqrt(X) is closer to Root + 1
+      return X > Root ? Root + 1 : Root;
+    }
+
+    /**
+     * @brief Handles a finished conversion; call from ISR(ADC_vect)
+     *
+     * @param Value conversion result
+     */
+    void Sample(uint16_t Value)  {
+      if(_Discard > 0)  {
+        _Discard--;
+      }
+      else  {
+        int16_t Deviation = (int16_t)Value - (int16_t)_Offset;
+
+        _Sum += Deviation;
+        _SumSq += (int32_t)Deviation * Deviation;
+
+        if(++_N >= _Channels[_Current].Samples) {
+          Channel &C = _Channels[_Current];
+
+          C.Offset = _Offset;
+          C.Sum = _Sum;
+          C.SumSq = _SumSq;
+          C.N = _N;
+
+          _Current = _Current + 1 < _Count ? _Current + 1 : 0;
+          SelectChannel();
+        }
+      }
+
+      ADCSRA |= _BV(ADSC);
+    }
+
+  private:
+    struct Channel {
+      uint8_t Mux;
+      uint16_t Samples;                     // Conversions per window
+      uint16_t Offset;                      // Snapshot of the last complete window: samples are deviations from Offset
+      int32_t Sum;
+      uint32_t SumSq;
+      uint16_t N;
+    };
+
+    uint8_t Add(uint8_t Mux, uint16_t Window)  {
+      if(_Count >= MAX_ADC_CHANNELS)  return ADC_NO_CHANNEL;
+
+      Channel &C = _Channels[_Count];
+
+      C.Mux = Mux;
+      C.Samples = (Window * 1000UL) / ADC_CONVERSION_US;
+      C.Samples = C.Samples > 0 ? C.Samples : 1;
+      C.Samples = C.Samples < ADC_MAX_SAMPLES ? C.Samples : ADC_MAX_SAMPLES;
+      C.Offset = ADC_INITIAL_OFFSET;
+      C.Sum = 0;
+      C.N = 0;
+
+      return _Count++;
+    }
+
+    /**
+     * @brief Copies channel snapshot with interrupts disabled; an unknown channel has no samples
+     *
+     */
+    Channel Snapshot(uint8_t Ch)  {
+      Channel C = {};
+
+      if(Ch >= _Count)  return C;
+
+      ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        C = _Channels[Ch];
+      }
+
+      return C;
+    }
+
+    /**
+     * @brief Switches multiplexer to the current channel and clears accumulators
+     *
+     */
+    void SelectChannel()  {
+      Channel &C = _Channels[_Current];
+      uint8_t Mux = C.Mux;
+
+      // Mean of the previous window is the new offset
+      _Offset = C.N > 0 ? (int32_t)C.Offset + C.Sum / (int32_t)C.N : C.Offset;
+      ADMUX = _BV(REFS0) | Mux;
+      _Discard = Mux == ADC_BANDGAP ? ADC_BANDGAP_DISCARD : ADC_DISCARD;
+      _Sum = 0;
+      _SumSq = 0;
+      _N = 0;
+    }
+
+    Channel _Channels[MAX_ADC_CHANNELS];
+    uint8_t _Count = 0;
+    volatile uint8_t _Current;
+    volatile uint8_t _Discard;
+    volatile uint16_t _Offset;
+    volatile int32_t _Sum;
+    volatile uint32_t _SumSq;
+    volatile uint16_t _N;
+};
+
+#endif
+/*
+   EOF
+*/
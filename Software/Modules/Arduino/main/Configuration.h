@@ -28,20 +28,13 @@
 #define MY_TRANSPORT_WAIT_READY_MS 60000        // Time to wait for gateway to respond at startup (default 60000)
 
 /***** Quick Config *****/
-// Output Config - one of these has to be defined
-#define DOUBLE_RELAY              // Define this node as a double relay node, setting below
-//#define ROLLER_SHUTTER            // Define this node as a roller shutter node, setting below
-//#define FOUR_RELAY                // Define this node as a four relay node, setting below
-//#define DIMMER                    // Define this node as a 1-channel dimmer node, setting below
-//#define RGB                       // Define this node as a RGB dimmer node, setting below
-//#define RGBW                      // Define this node as a RGBW dimmer node, setting below
+// Output Config - profile of the board & its output (see NodeProfile.h): DoubleRelayProfile, RollerShutterProfile (2SSR),
+// FourRelayProfile (4RelayDin), DimmerProfile, RGBProfile, RGBWProfile (RGBW)
+#define MODULE_PROFILE DoubleRelayProfile
 
 // Input Config - define according to your needs
-// Digital Inputs
-#define INPUT_1
-#define INPUT_2
-#define INPUT_3
-#define INPUT_4
+// Digital Inputs - in the order of their sensor IDs: Input<pin, pull-up (default true; false - motion sensor), inverted (default false)>
+#define INPUTS Input<INPUT_PIN_3>, Input<INPUT_PIN_4>, Input<INPUT_PIN_5>, Input<INPUT_PIN_6>
 
 // Board dependent
 #define POWER_SENSOR
@@ -89,6 +82,9 @@
 #define LONGPRESS_DURATION 1000
 #define DEBOUNCE_VALUE 50
 
+// Analog inputs
+#define ADC_WINDOW 2                        // Sampling window (ms) of internal thermometer & Vcc (default 2)
+
 // Internal temperature sensor
 #define MVPERC 10                         // V per 1 degree celsius (default 10)
 #define ZEROVOLTAGE 500                     // Voltage output of temperature sensor (default 500)
@@ -96,21 +92,23 @@
 
 // Power Sensor
 #define MAX_CURRENT 3                      // Maximum current the module can handle before reporting error (2SSR - 3; 4RelayDin - 10A or 16)
-#define POWER_MEASURING_TIME 20             // Current measuring takes this long (default 20)
+#define POWER_MEASURING_TIME 20             // Sampling window of each power sensor; whole mains periods (default 20)
 #define MVPERAMP 185                       // mV per 1A (default: 2SSR 185 mV/A; 4RelayDin 73.3 mV/A, RGBW 100 mV/A)
 #define RECEIVER_VOLTAGE 230                // 230V, 24V, 12V - values for power usage calculation, depends on the receiver
+#define ENERGY_INTERVAL 900000              // Interval (ms) of energy (kWh) reports; counters are stored in EEPROM at the same time (default 900000)
 #define COSFI 1                             // cos(fi) value for a given load: resistive load - 1, LED - 0.4 < cos(fi) < 0.99, fluorescent - 
 
 // Dimmer
-#define DIMMING_STEP 1                      // Size of dimming step, increase for faster, less smooth dimming (default 1)
-#define DIMMING_INTERVAL 1                  // Duration of dimming interval, increase for slower dimming (default 10)
+#define FADE_DURATION 1000                  // Duration (ms) of every dimming / color transition, timed by Timer2 (default 1000)
 #define DIMMING_TOGGLE_STEP 20              // Value to increase dimming percentage when using wall switch
 
 // Roller Shutter 
 #define PS_OFFSET 0.2                     // Power sensor offset for roller shutter calibration (default 0.2)
-#define CALIBRATION_SAMPLES 1             // Number of calibration samples for roller shutter calibration (default 2)
+#define CALIBRATION_SAMPLES 3             // Number of calibration passes (down & up) for roller shutter calibration; outliers are rejected (default 3)
 #define UP_TIME 21                        // Manually defined upward movement time in seconds (0-255)
 #define DOWN_TIME 20                      // Manually defined downward movement time in seconds (0-255)
+#define SHUTTER_DEADTIME 500              // Time (ms) both relays are off before movement direction is changed (default 500)
+#define SHUTTER_REPORT_INTERVAL 1000      // Interval (ms) of position reports during movement; 0 - report position after stop only (default 1000)
 
 // Heating system section thermometer
 //#define HEATING_SECTION_SENSOR            // Define if this module if going to be a temperature sensor for a heating controller
@@ -119,168 +117,39 @@
 #endif
 
 // Other
-#define INTERVAL 300000                    // Interval value for reporting readings of the sensors: temperature, power usage (default 300000)
+#define INTERVAL 300000                    // Longest interval (ms) between reports of a sensor (heartbeat) (default 300000)
+#define SENSOR_INTERVAL 10000               // Interval (ms) of temperature & humidity readings (default 10000)
 #define INIT_DELAY 200                       // A value to be multiplied by node ID value to obtain the time to wait during the initialization process
 #define PRESENTATION_DELAY 10       // Time (ms) to wait between subsequent presentation messages (default 10)
-#define LOOP_TIME 80                       // Main loop wait time (default 100)        
-
-/***** Output Config *****/
-// 2SSR DOUBLE_RELAY
-#ifdef DOUBLE_RELAY
-  #define RELAY_ID_1 0
-  #define RELAY_ID_2 1
-  #define RELAY_1 OUTPUT_PIN_1
-  #define RELAY_2 OUTPUT_PIN_2
-  #define BUTTON_1 INPUT_PIN_1
-  #define BUTTON_2 INPUT_PIN_2
-  #define NUMBER_OF_RELAYS 2
-#endif
-
-// Roller Shutter
-#ifdef ROLLER_SHUTTER
-  #define SHUTTER_ID 0
-  #define RELAY_ID_1 0
-  #define RELAY_1 OUTPUT_PIN_1
-  #define RELAY_2 OUTPUT_PIN_2
-  #define BUTTON_1 INPUT_PIN_1
-  #define BUTTON_2 INPUT_PIN_2
-  #define NUMBER_OF_RELAYS 2
-#endif
-
-// 4RelayDin 4 Relay Output
-#ifdef FOUR_RELAY
-  #define RELAY_ID_1 0
-  #define RELAY_ID_2 1
-  #define RELAY_ID_3 2
-  #define RELAY_ID_4 3
-  #define RELAY_1 OUTPUT_PIN_3
-  #define RELAY_2 OUTPUT_PIN_2
-  #define RELAY_3 OUTPUT_PIN_1
-  #define RELAY_4 OUTPUT_PIN_4
-  #define NUMBER_OF_RELAYS 4
-#endif
-
-// Dimmer / RGB / RGBW
-#ifdef DIMMER
-  #define DIMMER_ID 0
-  #define LED_PIN_1 OUTPUT_PIN_1
-  #define LED_PIN_2 OUTPUT_PIN_2
-  #define LED_PIN_3 OUTPUT_PIN_3
-  #define LED_PIN_4 OUTPUT_PIN_4
-  #define BUTTON_1 INPUT_PIN_1
-  #define BUTTON_2 INPUT_PIN_2
-  #define NUMBER_OF_CHANNELS 4
-#endif
-
-#ifdef RGB
-  #define DIMMER_ID 0
-  #define LED_PIN_1 OUTPUT_PIN_4
-  #define LED_PIN_2 OUTPUT_PIN_1
-  #define LED_PIN_3 OUTPUT_PIN_2
-  #define BUTTON_1 INPUT_PIN_1
-  #define BUTTON_2 INPUT_PIN_2
-  #define NUMBER_OF_CHANNELS 3
-#endif
-
-#ifdef RGBW
-  #define DIMMER_ID 0
-  #define LED_PIN_1 OUTPUT_PIN_4
-  #define LED_PIN_2 OUTPUT_PIN_1
-  #define LED_PIN_3 OUTPUT_PIN_2
-  #define LED_PIN_4 OUTPUT_PIN_3
-  #define BUTTON_1 INPUT_PIN_1
-  #define BUTTON_2 INPUT_PIN_2
-  #define NUMBER_OF_CHANNELS 4
-#endif
-
-#ifdef NUMBER_OF_RELAYS
-  #define FIRST_INPUT_ID NUMBER_OF_RELAYS
-#elif defined(NUMBER_OF_CHANNELS)
-  #define FIRST_INPUT_ID 2
-  #define NUMBER_OF_RELAYS 2
-#else
-  #define NUMBER_OF_RELAYS 0
-  #define FIRST_INPUT_ID 0
-#endif
-
-/***** Input Config *****/
-// Digital input - define what inputs to use
-#ifdef INPUT_1
-  #define INPUT_ID_1 FIRST_INPUT_ID
-  #define PIN_1 INPUT_PIN_3
-  #define PULLUP_1
-  #define INVERT_1 false
-  #define NUMBER_OF_INPUTS 1
-#endif
-
-#ifdef INPUT_2
-  #define INPUT_ID_2 INPUT_ID_1+1
-  #define PIN_2 INPUT_PIN_4
-  #define PULLUP_2
-  #define INVERT_2 false
-  #define NUMBER_OF_INPUTS 2
-#endif
-
-#ifdef INPUT_3
-  #define INPUT_ID_3 INPUT_ID_2+1
-  #define PIN_3 INPUT_PIN_5
-  #define PULLUP_3
-  #define INVERT_3 false
-  #define NUMBER_OF_INPUTS 3
-#endif
-
-#ifdef INPUT_4
-  #define INPUT_ID_4 INPUT_ID_3+1
-  #define PIN_4 INPUT_PIN_6
-  #define PULLUP_4
-  #define INVERT_4 false
-  #define NUMBER_OF_INPUTS 4
-#endif
-
-#ifndef NUMBER_OF_INPUTS
-  #define NUMBER_OF_INPUTS 0
-#endif
-
-// Special Button
-#ifdef BUTTON_1
-  #define SPECIAL_BUTTON
-  #define SPECIAL_BUTTON_ID 8
-#endif
-
-// ACS712 Power Sensor
-#ifdef POWER_SENSOR
-  #if defined(DOUBLE_RELAY) || defined(ROLLER_SHUTTER)
-    #define PS_ID SPECIAL_BUTTON_ID+2
-    #define PS_PIN INPUT_PIN_7
-  #elif defined(DIMMER) || defined(RGB) || defined(RGBW)
-    #define PS_ID SPECIAL_BUTTON_ID+2
-    #define PS_PIN INPUT_PIN_8
-  #elif defined(FOUR_RELAY)
-    #define PS_ID_1 4
-    #define PS_ID_2 5
-    #define PS_ID_3 6
-    #define PS_ID_4 7
-    #define PS_PIN_1 INPUT_PIN_7
-    #define PS_PIN_2 I2C_PIN_2
-    #define PS_PIN_3 I2C_PIN_1
-    #define PS_PIN_4 INPUT_PIN_8
-  #endif
-#endif
-
-// Analog Internal Thermometer (Disable for 4RelayDin)
+#define PRESENTATION_TIMEOUT 2000           // Time (ms) to wait for manifest hash stored by controller before presenting all sensors (default 2000)
+#define INIT_SYNC_TIMEOUT 5000              // Time (ms) to wait for controller replies to all startup requests (default 5000)
+#define SEND_QUEUE_SIZE 6                   // Number of sensor reports waiting for transmission, max 8 (default 6)
+#define SEND_BUDGET 10                      // Maximum number of sensor reports sent per second; safety errors are not limited (default 10)
+#define MEASURING_INTERVAL 100              // Interval (ms) of power & temperature measurements and safety checks (default 100)
+#define IO_INTERVAL 20                      // Interval (ms) of reading inputs (default 20)
+#define LOOP_TIME 80                        // Longest main loop wait time (ms), incoming messages are handled meanwhile (default 80)
+
+// Report policies: absolute deadband, relative deadband (%), hysteresis, min interval (ms), max interval (ms), smoothing (EMA of ~2^n readings, 0 - off)
+#define PS_POLICY 100, 10, 20, 1000, INTERVAL, 0          // Power sensor current (mA)
+#define IT_POLICY 10, 0, 5, 30000, INTERVAL, 2            // Internal thermometer (0.1 C)
+#define ETT_POLICY 0.2, 0, 0.1, 30000, INTERVAL, 1        // External thermometer (C)
+#define ETH_POLICY 1.0, 0, 0.5, 30000, INTERVAL, 1        // External hygrometer (%)
+
+/***** Sensor IDs *****/
+// Relays / shutter / dimmer, buttons & digital inputs take IDs 0-7, see NodeProfile.h
+#define SPECIAL_BUTTON_ID 8                 // Longpress of the buttons, one ID per button
+#define PS_ID 10                            // ACS712 Power Sensor, one per board
+#define PS_ID_1 21                          // First of the power sensors, one per relay
+
+// Analog Internal Thermometer (no thermometer on 4RelayDin)
 #ifdef INTERNAL_TEMP
   #define IT_ID 11
-  #if defined(DOUBLE_RELAY) || defined(ROLLER_SHUTTER)
-    #define IT_PIN INPUT_PIN_8
-  #elif defined(DIMMER) || defined(RGB) || defined(RGBW)
-    #define IT_PIN INPUT_PIN_7
-  #endif
 #endif
 
 // 1wire external thermometer (e.g. DHT22)
 #ifdef EXTERNAL_TEMP
-  #define ETT_ID IT_ID+1
-  #define ETH_ID ETT_ID+1
+  #define ETT_ID 12
+  #define ETH_ID 13
   #ifdef DHT22
     #define ET_PIN ONE_WIRE_PIN
   #endif
@@ -295,16 +164,21 @@
     #define ES_ID 15
   #endif
   #ifdef INTERNAL_TEMP
-    #define TS_ID ES_ID+1
+    #define TS_ID 16
   #endif
   #ifdef EXTERNAL_TEMP
-    #define ETS_ID TS_ID+1
+    #define ETS_ID 17
   #endif
 #endif
 
 //#define RS485_DEBUG
 #ifdef RS485_DEBUG
-  #define DEBUG_ID ETS_ID+1
+  #define DEBUG_ID 18
+  //#define LOOP_PROFILING                  // Collect loop() timing, send failures, watchdog margin & free RAM; sent on request of V_CUSTOM on DEBUG_ID
+#endif
+
+#ifdef LOOP_PROFILING
+  #define MY_INDICATION_HANDLER             // Failed transmissions counted in indication()
 #endif
 
 /***** Configuration by message *****/
@@ -316,10 +190,18 @@
 
 /***** EEPROM Definitions *****/
 #define SIZE_OF_BYTE 1
+#define SIZE_OF_LONG 4
 #define EEPROM_OFFSET 512                         // First eeprom address to use (prior addresses are taken)
 #define EEA_SHUTTER_TIME_DOWN EEPROM_OFFSET                        // EEPROM address to save Shutter travel down time
 #define EEA_SHUTTER_TIME_UP EEA_SHUTTER_TIME_DOWN+SIZE_OF_BYTE     // EEPROM address to save Shutter travel up time
-#define EEA_SHUTTER_POSITION EEA_SHUTTER_TIME_UP+SIZE_OF_BYTE      // EEPROM address to save Shutter last known position
+#define EEA_SHUTTER_POSITION EEA_SHUTTER_TIME_UP+SIZE_OF_BYTE      // EEPROM address to save Shutter last known position (legacy, read if journal is empty)
+#define EEA_JOURNAL EEA_SHUTTER_POSITION+SIZE_OF_BYTE              // EEPROM address of the shutter position journal (3 bytes per slot)
+#define EEA_SHUTTER_TRAVEL_DOWN EEA_JOURNAL+JOURNAL_SLOTS*3         // EEPROM address to save Shutter travel down time in ms (uint32_t)
+#define EEA_SHUTTER_TRAVEL_UP EEA_SHUTTER_TRAVEL_DOWN+SIZE_OF_LONG  // EEPROM address to save Shutter travel up time in ms (uint32_t)
+#define JOURNAL_SLOTS 32                          // Number of journal slots; every slot is written once per JOURNAL_SLOTS stops (default 32)
+#define JOURNAL_DELAY 2000                        // Time (ms) to collect changes before they are stored in EEPROM (default 2000)
+#define EEA_ENERGY_JOURNAL EEA_SHUTTER_TRAVEL_UP+SIZE_OF_LONG      // EEPROM address of the energy counters journal
+#define ENERGY_JOURNAL_SLOTS 16                   // Number of energy journal slots; with default ENERGY_INTERVAL every slot is written 6 times a day (default 16)
 
 #endif
 /*
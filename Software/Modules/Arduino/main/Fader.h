@@ -0,0 +1,195 @@
+/*
+ * Fader.h file
+ * Timer driven dimmer: Timer2 compare interrupt ticks at FADE_RATE and moves every channel one step
+ * towards its target, so a transition takes exactly the requested time however busy the main loop is.
+ * Channel values are interpolated in 8.8 fixed point on a perceptual scale and mapped to PWM duty
+ * through a gamma 2.2 table in PROGMEM.
+ *
+ * The main loop only sets targets (state, level, color); Timer2 must not be used by anything else.
+ *
+ */
+
+#ifndef Fader_h
+#define Fader_h
+
+#include <avr/pgmspace.h>
+#include <util/atomic.h>
+
+#define MAX_FADE_CHANNELS 4
+#define FADE_RATE 100                       // Fade engine tick rate (Hz)
+#define FADE_TICK (1000 / FADE_RATE)        // Tick period (ms)
+#define FADE_NO_PIN 0xFF
+
+// Perceptual value (0-255) to PWM duty (0-255), gamma 2.2
+const uint8_t GammaTable[256] PROGMEM = {
+    0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   1,
+    1,   1,   1,   1,   1,   1,   1,   1,   1,   2,   2,   2,   2,   2,   2,   2,
+    3,   3,   3,   3,   3,   4,   4,   4,   4,   5,   5,   5,   5,   6,   6,   6,
+    6,   7,   7,   7,   8,   8,   8,   9,   9,   9,  10,  10,  11,  11,  11,  12,
+   12,  13,  13,  13,  14,  14,  15,  15,  16,  16,  17,  17,  18,  18,  19,  19,
+   20,  20,  21,  22,  22,  23,  23,  24,  25,  25,  26,  26,  27,  28,  28,  29,
+   30,  30,  31,  32,  33,  33,  34,  35,  35,  36,  37,  38,  39,  39,  40,  41,
+   42,  43,  43,  44,  45,  46,  47,  48,  49,  49,  50,  51,  52,  53,  54,  55,
+   56,  57,  58,  59,  60,  61,  62,  63,  64,  65,  66,  67,  68,  69,  70,  71,
+   73,  74,  75,  76,  77,  78,  79,  81,  82,  83,  84,  85,  87,  88,  89,  90,
+   91,  93,  94,  95,  97,  98,  99, 100, 102, 103, 105, 106, 107, 109, 110, 111,
+  113, 114, 116, 117, 119, 120, 121, 123, 124, 126, 127, 129, 130, 132, 133, 135,
+  137, 138, 140, 141, 143, 145, 146, 148, 149, 151, 153, 154, 156, 158, 159, 161,
+  163, 165, 166, 168, 170, 172, 173, 175, 177, 179, 181, 182, 184, 186, 188, 190,
+  192, 194, 196, 197, 199, 201, 203, 205, 207, 209, 211, 213, 215, 217, 219, 221,
+  223, 225, 227, 229, 231, 234, 236, 238, 240, 242, 244, 246, 248, 251, 253, 255
+};
+
+template<uint8_t Channels>
+class Fader {
+
+  static_assert(Channels > 0 && Channels <= MAX_FADE_CHANNELS, "Fader supports 1-4 channels");
+
+  public:
+    bool CurrentState = false;
+
+    /**
+     * @brief Sets PWM pins & transition duration, starts Timer2 (CTC mode, prescaler 1024)
+     *
+     * @param Duration transition duration (ms)
+     * @param Pin1 - Pin4 PWM pins of channels; R, G, B, W for color dimmers
+     */
+    void Begin(uint16_t Duration, uint8_t Pin1, uint8_t Pin2 = FADE_NO_PIN, uint8_t Pin3 = FADE_NO_PIN, uint8_t Pin4 = FADE_NO_PIN)  {
+      const uint8_t Pins[MAX_FADE_CHANNELS] = {Pin1, Pin2, Pin3, Pin4};
+
+      for(uint8_t i=0; i<Channels; i++) {
+        _Pins[i] = Pins[i];
+        _Color[i] = 0xFF;
+        _Value[i] = 0;
+        _Output[i] = 0;
+        pinMode(_Pins[i], OUTPUT);
+        analogWrite(_Pins[i], 0);
+      }
+
+      SetDuration(Duration);
+
+      TCCR2A = _BV(WGM21);
+      TCCR2B = _BV(CS22) | _BV(CS21) | _BV(CS20);
+      OCR2A = F_CPU / 1024 / FADE_RATE - 1;
+      TIMSK2 = _BV(OCIE2A);
+    }
+
+    /**
+     * @brief Sets duration of the following transitions
+     *
+     * @param Duration transition duration (ms); 0 - changes are applied at the next tick
+     */
+    void SetDuration(uint16_t Duration)  {
+      _Duration = Duration / FADE_TICK > 0 ? Duration / FADE_TICK : 1;
+    }
+
+    /**
+     * @brief Turns dimmer on / off
+     *
+     */
+    void ChangeState(bool State)  {
+      CurrentState = State;
+      Fade();
+    }
+
+    /**
+     * @brief Sets new dimming level
+     *
+     * @param Level dimming level 0-100
+     */
+    void SetLevel(uint8_t Level)  {
+      _Level = Level > 100 ? 100 : Level;
+      Fade();
+    }
+
+    /**
+     * @brief Current dimming level (0-100)
+     *
+     */
+    uint8_t Level()  {
+      return _Level;
+    }
+
+    /**
+     * @brief Sets new color
+     *
+     * @param Values hex string: 'rrggbb' or 'rrggbbww'
+     */
+    void NewColorValues(const char *Values)  {
+      for(uint8_t i=0; i<Channels && Values[0] && Values[1]; i++, Values+=2)  {
+        _Color[i] = (HexDigit(Values[0]) << 4) | HexDigit(Values[1]);
+      }
+      Fade();
+    }
+
+    /**
+     * @brief Checks if a transition is in progress
+     *
+     */
+    bool Fading()  {
+      uint16_t Ticks;
+
+      ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        Ticks = _Ticks;
+      }
+
+      return Ticks > 0;
+    }
+
+    /**
+     * @brief Moves all channels one step towards their targets; call from ISR(TIMER2_COMPA_vect)
+     *
+     */
+    void Tick()  {
+      if(_Ticks == 0) return;
+
+      _Ticks--;
+
+      for(uint8_t i=0; i<Channels; i++) {
+        _Value[i] = _Ticks > 0 ? (int32_t)_Value[i] + _Step[i] : (uint16_t)_Target[i] << 8;
+
+        uint8_t Output = pgm_read_byte(&GammaTable[_Value[i] >> 8]);
+
+        if(Output != _Output[i])  {
+          analogWrite(_Pins[i], Output);
+          _Output[i] = Output;
+        }
+      }
+    }
+
+  private:
+    /**
+     * @brief Calculates new targets & per tick steps; the transition starts from the current values
+     *
+     */
+    void Fade()  {
+      ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        for(uint8_t i=0; i<Channels; i++) {
+          _Target[i] = CurrentState ? ((uint16_t)_Color[i] * _Level + 50) / 100 : 0;
+          _Step[i] = (((int32_t)_Target[i] << 8) - (int32_t)_Value[i]) / (int32_t)_Duration;
+        }
+        _Ticks = _Duration;
+      }
+    }
+
+    static uint8_t HexDigit(char C)  {
+      return C >= 'a' ? C - 'a' + 10 : (C >= 'A' ? C - 'A' + 10 : C - '0');
+    }
+
+    uint8_t _Pins[Channels];
+    uint8_t _Color[Channels];               // Color components 0-255
+    uint8_t _Level = 100;                   // Dimming level 0-100
+    uint16_t _Duration = 1;                 // Transition duration (ticks)
+
+    // Shared with ISR
+    uint8_t _Target[Channels];              // Target values, perceptual scale 0-255
+    int32_t _Step[Channels];                // Change per tick, 8.8 fixed point
+    volatile uint16_t _Value[Channels];     // Current values, 8.8 fixed point
+    volatile uint16_t _Ticks = 0;           // Remaining ticks of the transition
+    uint8_t _Output[Channels];              // Last written PWM duty
+};
+
+#endif
+/*
+   EOF
+*/
@@ -0,0 +1,188 @@
+/*
+ * Manifest.h file
+ * Presentation manifest: sensors are described by tables in flash (names included) and hashed (FNV-1a).
+ * After a full presentation the hash is sent to the controller as V_VAR2 of the manifest sensor; after
+ * a reboot the node only requests it back and presents all sensors again if the stored hash differs
+ * or the controller doesn't reply within PRESENTATION_TIMEOUT. Presentation requested by the controller
+ * is always full.
+ *
+ * presentation() calls Check(); if it returns false, sensors are presented at once. Otherwise the loop
+ * presents them when Due() and InitConfirmation() waits until Synced().
+ *
+ */
+
+#ifndef Manifest_h
+#define Manifest_h
+
+#define FNV_OFFSET 2166136261UL
+#define FNV_PRIME 16777619UL
+
+struct PresentEntry {
+  uint8_t Sensor;                           // First sensor ID
+  uint8_t Count;                            // Number of consecutive sensor IDs presented alike
+  uint8_t Presentation;                     // S_ type
+  const char *Name;                         // Presentation name (PROGMEM)
+};
+
+/**
+ * @brief Adds a byte to FNV-1a hash
+ *
+ */
+inline uint32_t HashByte(uint32_t Hash, uint8_t Byte) {
+  return (Hash ^ Byte) * FNV_PRIME;
+}
+
+/**
+ * @brief Adds a string stored in flash (terminator included) to FNV-1a hash
+ *
+ */
+inline uint32_t HashString_P(uint32_t Hash, const char *Text) {
+  uint8_t C;
+
+  do {
+    C = pgm_read_byte(Text++);
+    Hash = HashByte(Hash, C);
+  } while(C != 0);
+
+  return Hash;
+}
+
+/**
+ * @brief Adds a presentation of a sensor to FNV-1a hash
+ *
+ */
+inline uint32_t HashSensor(uint32_t Hash, uint8_t Sensor, uint8_t Presentation, const char *Name) {
+  return HashString_P(HashByte(HashByte(Hash, Sensor), Presentation), Name);
+}
+
+// Sensors of a hardware variant detected at runtime
+struct PresentVariant {
+  const char *Name;                         // Sketch name (PROGMEM)
+  const PresentEntry *Sensors;              // PROGMEM table
+  uint8_t Count;
+};
+
+class Manifest {
+
+  public:
+    /**
+     * @brief Constructor
+     *
+     * @param Sensor sensor ID holding manifest hash at the controller
+     */
+    Manifest(uint8_t Sensor) : _Sensor(Sensor) {}
+
+    /**
+     * @brief Adds table entries to FNV-1a hash
+     *
+     * @param Table PROGMEM table
+     * @param Count number of entries
+     */
+    static uint32_t Hash(uint32_t Hash, const PresentEntry *Table, uint8_t Count)  {
+      for(uint8_t i=0; i<Count; i++)  {
+        PresentEntry E = Read(Table, i);
+        for(uint8_t j=0; j<E.Count; j++)  {
+          Hash = HashSensor(Hash, E.Sensor + j, E.Presentation, E.Name);
+        }
+      }
+
+      return Hash;
+    }
+
+    /**
+     * @brief Presents all table entries
+     *
+     * @param Table PROGMEM table
+     * @param Count number of entries
+     * @param Delay time (ms) to wait between subsequent presentation messages
+     */
+    static void Present(const PresentEntry *Table, uint8_t Count, uint16_t Delay)  {
+      for(uint8_t i=0; i<Count; i++)  {
+        PresentEntry E = Read(Table, i);
+        for(uint8_t j=0; j<E.Count; j++)  {
+          present(E.Sensor + j, E.Presentation, reinterpret_cast<const __FlashStringHelper *>(E.Name));
+          wait(Delay);
+        }
+      }
+    }
+
+    /**
+     * @brief Called from presentation(); at startup requests the stored hash from controller
+     *
+     * @param Hash hash of current manifest
+     * @return true if presentation is deferred until Due()
+     */
+    bool Check(uint32_t Hash)  {
+      _Hash = Hash;
+
+      if(_State != BOOT)  return false;
+
+      _State = WAITING;
+      _Start = millis();
+      request(_Sensor, V_VAR2);
+
+      return true;
+    }
+
+    /**
+     * @brief Handles controller reply; call from receive()
+     *
+     * @param message incoming message
+     * @return true if the message was the stored hash
+     */
+    bool Receive(const MyMessage &message)  {
+      if(_State != WAITING || message.sensor != _Sensor || message.type != V_VAR2 || message.getCommand() != C_SET)  {
+        return false;
+      }
+
+      _State = message.getULong() == _Hash ? SYNCED : PENDING;
+
+      return true;
+    }
+
+    /**
+     * @brief Checks if full presentation has to be sent now
+     *
+     */
+    bool Due()  {
+      return _State == PENDING || (_State == WAITING && millis() - _Start >= PRESENTATION_TIMEOUT);
+    }
+
+    /**
+     * @brief Confirms full presentation; sends the hash to be stored by controller
+     *
+     */
+    void Presented()  {
+      MyMessage Msg(_Sensor, V_VAR2);
+
+      send(Msg.set(_Hash));
+      _State = SYNCED;
+    }
+
+    /**
+     * @brief Checks if controller knows current manifest
+     *
+     */
+    bool Synced()  {
+      return _State == SYNCED;
+    }
+
+  private:
+    enum State : uint8_t { BOOT, WAITING, PENDING, SYNCED };
+
+    static PresentEntry Read(const PresentEntry *Table, uint8_t i)  {
+      PresentEntry E;
+      memcpy_P(&E, &Table[i], sizeof(E));
+      return E;
+    }
+
+    uint8_t _Sensor;
+    State _State = BOOT;
+    uint32_t _Hash = 0;
+    uint32_t _Start = 0;
+};
+
+#endif
+/*
+   EOF
+*/
@@ -0,0 +1,201 @@
+/*
+ * NodeProfile.h file
+ * Compile time profile of the module: the output, buttons, digital inputs, power sensors & internal thermometer
+ * of a board are template parameter packs, sensor IDs, pin maps & array sizes are derived from them by
+ * constexpr functions; nothing is left at runtime. Configuration.h selects a profile of the catalog below
+ * (MODULE_PROFILE) and the digital inputs (INPUTS); main.ino compiles the code of its output only and builds
+ * the sensor table from it.
+ *
+ * CommonIO objects (& their sensor IDs): the relays, each with its button if the board has one (relay outputs),
+ * or the buttons (shutter & dimmer), then the digital inputs. Include after GoWired.h.
+ *
+ */
+
+#ifndef NodeProfile_h
+#define NodeProfile_h
+
+#define NO_PIN 0xFF
+
+/**
+ * @brief Pin at index i of a pin pack (compile time)
+ *
+ */
+constexpr uint8_t PinAt(uint8_t) {
+  return NO_PIN;
+}
+
+template<typename... Rest>
+constexpr uint8_t PinAt(uint8_t i, uint8_t Pin, Rest... Others) {
+  return i == 0 ? Pin : PinAt(i - 1, Others...);
+}
+
+template<uint8_t... Pins>
+struct PinList {
+  static constexpr uint8_t Count = sizeof...(Pins);
+
+  static constexpr uint8_t Pin(uint8_t i)  {
+    return PinAt(i, Pins...);
+  }
+};
+
+// Independent relays, sensor IDs 0...; AC loads
+template<uint8_t... Pins>
+struct RelayOutput : PinList<Pins...> {
+  static constexpr uint8_t Sensors = sizeof...(Pins);
+  static constexpr bool DC = false;
+  static constexpr uint8_t Type = S_BINARY;                         // Presentation
+
+  // CommonIO objects before the inputs
+  static constexpr uint8_t Switches(uint8_t)  {
+    return sizeof...(Pins);
+  }
+};
+
+// Roller shutter: relays of the up & down movement, sensor ID 0; AC motor
+template<uint8_t Up, uint8_t Down>
+struct ShutterOutput : PinList<Up, Down> {
+  static constexpr uint8_t Sensors = 1;
+  static constexpr bool DC = false;
+  static constexpr uint8_t Type = S_COVER;
+
+  static constexpr uint8_t Switches(uint8_t Buttons)  {
+    return Buttons;
+  }
+};
+
+// LED dimmer: PWM channels (R, G, B, W; all dimmed alike if presented as S_DIMMER), sensor ID 0; DC load
+template<uint8_t Presentation, uint8_t... Pins>
+struct DimmerOutput : PinList<Pins...> {
+  static constexpr uint8_t Sensors = 1;
+  static constexpr bool DC = true;
+  static constexpr uint8_t Type = Presentation;
+
+  static constexpr uint8_t Switches(uint8_t Buttons)  {
+    return Buttons;
+  }
+};
+
+// Wall switches on the board
+template<uint8_t... Pins>
+struct ButtonPins : PinList<Pins...> {};
+
+// ACS712 power sensors: one for all loads or one per relay
+template<uint8_t... Pins>
+struct PowerPins : PinList<Pins...> {};
+
+// Digital input: internal pull-up (door / window / button) or not (motion sensor), inverted state
+template<uint8_t Pin_, bool Pullup_ = true, bool Invert_ = false>
+struct Input {
+  static constexpr uint8_t Pin = Pin_;
+  static constexpr bool Pullup = Pullup_;
+  static constexpr bool Invert = Invert_;
+};
+
+template<class... Inputs> struct InputList;
+
+template<> struct InputList<> {
+  static constexpr uint8_t Count = 0;
+
+  static constexpr uint8_t Pin(uint8_t)  { return NO_PIN; }
+  static constexpr bool Pullup(uint8_t)  { return false; }
+  static constexpr bool Invert(uint8_t)  { return false; }
+};
+
+template<class First, class... Rest>
+struct InputList<First, Rest...> {
+  static constexpr uint8_t Count = 1 + sizeof...(Rest);
+
+  static constexpr uint8_t Pin(uint8_t i)  {
+    return i == 0 ? First::Pin : InputList<Rest...>::Pin(i - 1);
+  }
+
+  static constexpr bool Pullup(uint8_t i)  {
+    return i == 0 ? First::Pullup : InputList<Rest...>::Pullup(i - 1);
+  }
+
+  static constexpr bool Invert(uint8_t i)  {
+    return i == 0 ? First::Invert : InputList<Rest...>::Invert(i - 1);
+  }
+};
+
+template<class Output_, class Buttons_, class Inputs_, class PowerSensors_, uint8_t ThermometerPin_ = NO_PIN>
+struct NodeProfile {
+
+  typedef Output_ Output;
+  typedef Buttons_ Buttons;
+  typedef Inputs_ Inputs;
+  typedef PowerSensors_ PowerSensors;
+
+  static constexpr uint8_t ThermometerPin = ThermometerPin_;
+  static constexpr uint8_t FirstInputId = Output::Switches(Buttons::Count);
+  static constexpr uint8_t IOs = FirstInputId + Inputs::Count;     // CommonIO objects
+
+  /**
+   * @brief Sensor ID (and CommonIO index) of a digital input
+   *
+   * @param Input index in INPUTS
+   */
+  static constexpr uint8_t InputId(uint8_t Input)  {
+    return FirstInputId + Input;
+  }
+
+  /**
+   * @brief Sensor ID of a button longpress
+   *
+   */
+  static constexpr uint8_t SpecialButtonId(uint8_t Button)  {
+    return SPECIAL_BUTTON_ID + Button;
+  }
+
+  /**
+   * @brief Sensor ID of a power sensor
+   *
+   */
+  static constexpr uint8_t PowerSensorId(uint8_t Sensor)  {
+    return PowerSensors::Count > 1 ? PS_ID_1 + Sensor : PS_ID;
+  }
+
+  /**
+   * @brief Power sensor measuring the load of an output relay
+   *
+   */
+  static constexpr uint8_t PowerSensorOf(uint8_t Relay)  {
+    return PowerSensors::Count > 1 ? Relay : 0;
+  }
+
+  static_assert(Output::Sensors <= FirstInputId || Inputs::Count == 0, "Output sensor IDs overlap input IDs");
+  static_assert(IOs <= SPECIAL_BUTTON_ID, "Input IDs overlap special button & board sensor IDs");
+  static_assert(FirstInputId >= Buttons::Count, "More buttons than relays");
+  static_assert(PowerSensors::Count <= 1 || PowerSensors::Count == Output::Sensors, "One power sensor or one per relay");
+  static_assert(PowerSensors::Count <= 4, "At most 4 power sensors");
+};
+
+/***** Profiles of the boards *****/
+// 2SSR: two relays & their buttons
+typedef NodeProfile<RelayOutput<OUTPUT_PIN_1, OUTPUT_PIN_2>, ButtonPins<INPUT_PIN_1, INPUT_PIN_2>, InputList<INPUTS>,
+                    PowerPins<INPUT_PIN_7>, INPUT_PIN_8> DoubleRelayProfile;
+
+// 2SSR: roller shutter, up & down buttons
+typedef NodeProfile<ShutterOutput<OUTPUT_PIN_1, OUTPUT_PIN_2>, ButtonPins<INPUT_PIN_1, INPUT_PIN_2>, InputList<INPUTS>,
+                    PowerPins<INPUT_PIN_7>, INPUT_PIN_8> RollerShutterProfile;
+
+// 4RelayDin: four relays, a power sensor per relay, no buttons & no internal thermometer
+typedef NodeProfile<RelayOutput<OUTPUT_PIN_3, OUTPUT_PIN_2, OUTPUT_PIN_1, OUTPUT_PIN_4>, ButtonPins<>, InputList<INPUTS>,
+                    PowerPins<INPUT_PIN_7, I2C_PIN_2, I2C_PIN_1, INPUT_PIN_8>> FourRelayProfile;
+
+// RGBW: 1-color dimmer on all channels, on/off & level buttons
+typedef NodeProfile<DimmerOutput<S_DIMMER, OUTPUT_PIN_1, OUTPUT_PIN_2, OUTPUT_PIN_3, OUTPUT_PIN_4>, ButtonPins<INPUT_PIN_1, INPUT_PIN_2>,
+                    InputList<INPUTS>, PowerPins<INPUT_PIN_8>, INPUT_PIN_7> DimmerProfile;
+
+// RGBW: RGB dimmer
+typedef NodeProfile<DimmerOutput<S_RGB_LIGHT, OUTPUT_PIN_4, OUTPUT_PIN_1, OUTPUT_PIN_2>, ButtonPins<INPUT_PIN_1, INPUT_PIN_2>,
+                    InputList<INPUTS>, PowerPins<INPUT_PIN_8>, INPUT_PIN_7> RGBProfile;
+
+// RGBW: RGBW dimmer
+typedef NodeProfile<DimmerOutput<S_RGBW_LIGHT, OUTPUT_PIN_4, OUTPUT_PIN_1, OUTPUT_PIN_2, OUTPUT_PIN_3>, ButtonPins<INPUT_PIN_1, INPUT_PIN_2>,
+                    InputList<INPUTS>, PowerPins<INPUT_PIN_8>, INPUT_PIN_7> RGBWProfile;
+
+#endif
+/*
+   EOF
+*/
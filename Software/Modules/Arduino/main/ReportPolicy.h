@@ -0,0 +1,131 @@
+/*
+ * ReportPolicy.h file
+ * Report-on-change rules of a single sensor value: a reading is reported only if it differs from
+ * the last reported one by more than a deadband (absolute or relative, whichever is larger),
+ * not sooner than a minimum interval after the previous report and at least once per maximum
+ * (heartbeat) interval. An optional exponential moving average smooths readings first.
+ *
+ * Hysteresis is added to the deadband when the value turns back, so a reading oscillating
+ * around a threshold isn't reported on every swing.
+ *
+ * Policies are configured in Configuration.h as:
+ *   absolute deadband, relative deadband (%), hysteresis, min interval (ms), max interval (ms), smoothing
+ * smoothing n - average over ~2^n readings, 0 - off.
+ *
+ */
+
+#ifndef ReportPolicy_h
+#define ReportPolicy_h
+
+template<typename T>
+class ReportPolicy {
+
+  static_assert(T(-1) < T(0), "ReportPolicy needs a signed type");
+
+  public:
+    /**
+     * @brief Constructor
+     *
+     * @param Absolute minimum change to be reported
+     * @param Relative minimum change to be reported, % of the last reported value; 0 - off
+     * @param Hysteresis added to the deadband when the change reverses direction
+     * @param MinInterval minimum time (ms) between reports
+     * @param MaxInterval maximum time (ms) between reports; 0 - report on change only
+     * @param Smoothing EMA weight of a new reading 1/2^Smoothing; 0 - off
+     */
+    ReportPolicy(T Absolute, uint8_t Relative, T Hysteresis, uint32_t MinInterval, uint32_t MaxInterval, uint8_t Smoothing)
+      : _Absolute(Absolute), _Relative(Relative), _Hysteresis(Hysteresis), _MinInterval(MinInterval), _MaxInterval(MaxInterval), _Smoothing(Smoothing) {}
+
+    /**
+     * @brief Feeds a new reading
+     *
+     * @param Reading measured value
+     * @param Now current time
+     * @return true if Value() has to be reported now; the report is recorded
+     */
+    bool Update(T Reading, uint32_t Now)  {
+      if(_State == EMPTY) {
+        _Value = Reading;
+      }
+      else  {
+        // Division rather than shift: works for float & negative integers alike
+        _Value = _Value + (Reading - _Value) / (T)(1 << _Smoothing);
+      }
+
+      if(_State != REPORTED) {
+        return Record(Now, 0);
+      }
+
+      uint32_t Elapsed = Now - _LastReport;
+
+      if(_MaxInterval > 0 && Elapsed >= _MaxInterval) {
+        return Record(Now, _Direction);
+      }
+      if(Elapsed < _MinInterval)  return false;
+
+      int8_t Direction = _Value > _Reported ? 1 : (_Value < _Reported ? -1 : 0);
+      T Change = Direction > 0 ? _Value - _Reported : _Reported - _Value;
+      T Deadband = _Absolute;
+
+      if(_Relative > 0)  {
+        T Magnitude = _Reported < 0 ? -_Reported : _Reported;
+        // Widened, so percentage of 16 bit values doesn't overflow
+        T RelativeBand = Magnitude * (int32_t)_Relative / 100;
+        Deadband = RelativeBand > Deadband ? RelativeBand : Deadband;
+      }
+      if(Direction != 0 && _Direction != 0 && Direction != _Direction)  {
+        Deadband = Deadband + _Hysteresis;
+      }
+
+      if(Direction == 0 || Change < Deadband) return false;
+
+      return Record(Now, Direction);
+    }
+
+    /**
+     * @brief Next Update() reports regardless of deadband & intervals (errors, controller requests)
+     *
+     */
+    void Force()  {
+      if(_State == REPORTED)  {
+        _State = FORCED;
+      }
+    }
+
+    /**
+     * @brief Value to be reported (smoothed reading)
+     *
+     */
+    T Value()  {
+      return _Value;
+    }
+
+  private:
+    enum State : uint8_t { EMPTY, FORCED, REPORTED };
+
+    bool Record(uint32_t Now, int8_t Direction)  {
+      _State = REPORTED;
+      _Reported = _Value;
+      _LastReport = Now;
+      _Direction = Direction;
+      return true;
+    }
+
+    T _Absolute;
+    uint8_t _Relative;
+    T _Hysteresis;
+    uint32_t _MinInterval;
+    uint32_t _MaxInterval;
+    uint8_t _Smoothing;
+
+    State _State = EMPTY;
+    T _Value = 0;                           // Smoothed reading
+    T _Reported = 0;                        // Last reported value
+    uint32_t _LastReport = 0;
+    int8_t _Direction = 0;                  // Direction of the last reported change
+};
+
+#endif
+/*
+   EOF
+*/
@@ -0,0 +1,171 @@
+/*
+ * Scheduler.h file
+ * Cooperative deadline scheduler: every task has its own period or deadline, main loop waits
+ * exactly until the next task is due. All time comparisons are millis() overflow safe.
+ *
+ */
+
+#ifndef Scheduler_h
+#define Scheduler_h
+
+#ifndef MAX_TASKS
+  #define MAX_TASKS 8                       // Maximum number of registered tasks; may be set in Configuration.h
+#endif
+#define INVALID_TASK 0xFF                   // Returned by AddTask() when all MAX_TASKS slots are taken
+
+typedef void (*TaskCallback)();
+
+class Scheduler {
+
+  public:
+    /**
+     * @brief Registers a new task
+     *
+     * @param Callback function to be called when the task is due
+     * @param Period task period in ms; 0 - one-shot task, inactive until RunAt() / RunIn() / RunNow()
+     * @return uint8_t task ID; INVALID_TASK if there is no free slot
+     */
+    uint8_t AddTask(TaskCallback Callback, uint32_t Period)  {
+      if(_Count >= MAX_TASKS) return INVALID_TASK;
+
+      Task &T = _Tasks[_Count];
+
+      T.Callback = Callback;
+      T.Period = Period;
+      T.Due = millis() + Period;
+      T.Active = Period > 0;
+
+      return _Count++;
+    }
+
+    /**
+     * @brief Sets task deadline
+     *
+     * @param ID task ID
+     * @param Time millis() value at which the task should run
+     */
+    void RunAt(uint8_t ID, uint32_t Time)  {
+      if(ID >= _Count) return;
+
+      _Tasks[ID].Due = Time;
+      _Tasks[ID].Active = true;
+    }
+
+    /**
+     * @brief Sets task deadline unless the task is already due earlier
+     *
+     * @param ID task ID
+     * @param Time millis() value at which the task should run at the latest
+     */
+    void RunBefore(uint8_t ID, uint32_t Time)  {
+      if(ID >= _Count) return;
+
+      if(!_Tasks[ID].Active || TimeReached(_Tasks[ID].Due, Time)) {
+        RunAt(ID, Time);
+      }
+    }
+
+    /**
+     * @brief Runs task after a given delay
+     *
+     * @param ID task ID
+     * @param Delay delay in ms
+     */
+    void RunIn(uint8_t ID, uint32_t Delay)  {
+      RunAt(ID, millis() + Delay);
+    }
+
+    /**
+     * @brief Runs task in the nearest Run() call
+     *
+     * @param ID task ID
+     */
+    void RunNow(uint8_t ID)  {
+      RunAt(ID, millis());
+    }
+
+    /**
+     * @brief Deactivates task until it is scheduled again
+     *
+     * @param ID task ID
+     */
+    void Stop(uint8_t ID)  {
+      if(ID >= _Count) return;
+
+      _Tasks[ID].Active = false;
+    }
+
+    /**
+     * @brief Calls all tasks which are due; periodic tasks are rescheduled before their callbacks run,
+     * so a callback may override its own deadline
+     *
+     */
+    void Run()  {
+      for(uint8_t i=0; i<_Count; i++)  {
+        Task &T = _Tasks[i];
+        uint32_t Now = millis();
+
+        if(!T.Active || !TimeReached(Now, T.Due))  continue;
+
+        if(T.Period > 0)  {
+          T.Due += T.Period;
+          // Don't try to catch up after a long blocking call
+          if(TimeReached(Now, T.Due)) {
+            T.Due = Now + T.Period;
+          }
+        }
+        else  {
+          T.Active = false;
+        }
+
+        T.Callback();
+      }
+    }
+
+    /**
+     * @brief Calculates time left to the nearest task
+     *
+     * @param Limit maximum value to be returned
+     * @return uint32_t time in ms
+     */
+    uint32_t TimeToNext(uint32_t Limit)  {
+      uint32_t Now = millis();
+
+      for(uint8_t i=0; i<_Count; i++)  {
+        if(!_Tasks[i].Active)  continue;
+        if(TimeReached(Now, _Tasks[i].Due)) return 0;
+
+        uint32_t Left = _Tasks[i].Due - Now;
+        Limit = Left < Limit ? Left : Limit;
+      }
+
+      return Limit;
+    }
+
+    /**
+     * @brief Overflow safe comparison of millis() values
+     *
+     * @param Now current time
+     * @param Deadline compared time
+     * @return true if Deadline has already passed
+     */
+    static bool TimeReached(uint32_t Now, uint32_t Deadline)  {
+      return (int32_t)(Now - Deadline) >= 0;
+    }
+
+  private:
+    struct Task {
+      TaskCallback Callback;
+      uint32_t Period;
+      uint32_t Due;
+      bool Active;
+    };
+
+    Task _Tasks[MAX_TASKS];
+    uint8_t _Count = 0;
+};
+
+#endif
+/*
+   EOF
+*/
@@ -0,0 +1,105 @@
+/*
+ * SendQueue.h file
+ * Outbound message queue: pending updates of the same sensor, type & destination are coalesced,
+ * so only the latest value is transmitted. Routine frames are limited to SEND_BUDGET per second,
+ * priority frames (safety errors) are always sent first and are not limited.
+ *
+ */
+
+#ifndef SendQueue_h
+#define SendQueue_h
+
+#define SEND_SLOT (1000 / SEND_BUDGET)      // Minimum time (ms) between routine frames
+
+class SendQueue {
+
+  public:
+    /**
+     * @brief Queues a message, replaces a pending routine one with the same sensor, type & destination;
+     * sends the message right away if the queue is full. Pending priority messages are never replaced,
+     * so an error state is sent even if it's cleared before the queue is flushed.
+     *
+     * @param Msg message to be sent
+     * @param Priority true - send before all routine messages, regardless of the budget
+     */
+    void Push(MyMessage &Msg, bool Priority)  {
+      uint8_t i;
+
+      for(i=0; i<_Count; i++)  {
+        if(!(_Priority & _BV(i)) && _Queue[i].getSensor() == Msg.getSensor() && _Queue[i].getType() == Msg.getType() &&
+           _Queue[i].getDestination() == Msg.getDestination()) {
+          break;
+        }
+      }
+
+      if(i == _Count) {
+        if(_Count == SEND_QUEUE_SIZE) {
+          send(Msg);
+          return;
+        }
+        _Count++;
+      }
+
+      _Queue[i] = Msg;
+      if(Priority)  _Priority |= _BV(i);
+    }
+
+    /**
+     * @brief Sends all priority messages and one routine message if the budget allows it
+     *
+     * @return true if there are messages left in the queue
+     */
+    bool Flush()  {
+      for(uint8_t i=0; i<_Count; )  {
+        if(_Priority & _BV(i))  {
+          send(_Queue[i]);
+          Remove(i);
+        }
+        else  {
+          i++;
+        }
+      }
+
+      if(_Count > 0 && millis() - _LastSend >= SEND_SLOT) {
+        send(_Queue[0]);
+        Remove(0);
+        _LastSend = millis();
+      }
+
+      return _Count > 0;
+    }
+
+    /**
+     * @brief Calculates time at which the next routine message may be sent
+     *
+     * @return uint32_t millis() value
+     */
+    uint32_t NextSlot()  {
+      return _LastSend + SEND_SLOT;
+    }
+
+  private:
+    /**
+     * @brief Removes message from the queue keeping the order of the others
+     *
+     */
+    void Remove(uint8_t Index)  {
+      uint8_t Mask = _BV(Index) - 1;
+
+      for(uint8_t i=Index; i<_Count-1; i++) {
+        _Queue[i] = _Queue[i+1];
+      }
+      _Priority = (_Priority & Mask) | ((_Priority >> 1) & ~Mask);
+      _Count--;
+    }
+
+    MyMessage _Queue[SEND_QUEUE_SIZE];
+    uint8_t _Priority = 0;                  // Bit mask of priority messages
+    uint8_t _Count = 0;
+    uint32_t _LastSend = 0;
+};
+
+#endif
+/*
+   EOF
+*/
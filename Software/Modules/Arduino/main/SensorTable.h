@@ -0,0 +1,203 @@
+/*
+ * SensorTable.h file
+ * Sensor table stored in flash: every entry binds a sensor ID & message type to its receive() handler,
+ * presentation and initial state. The same table drives presentation(), InitConfirmation() and receive(),
+ * sensor ID -> entry index is generated at compile time, so dispatching a message is a single lookup.
+ *
+ * The table is joined from parts at compile time: a part has Count entries returned by its constexpr At(i),
+ * e.g. one per relay of the node profile (see NodeProfile.h); SensorArray turns a constexpr array into a part.
+ * Entries of the same sensor have to be placed next to each other; only the entries with a name are presented.
+ * Names are stored in flash (PROGMEM). Include after Manifest.h.
+ *
+ */
+
+#ifndef SensorTable_h
+#define SensorTable_h
+
+#define NO_ENTRY 0xFF
+
+typedef void (*MessageHandler)(const MyMessage &message);
+typedef void (*StateSender)(uint8_t Sensor, uint8_t Type);
+typedef void (*StateRequest)(uint8_t Sensor, uint8_t Type);
+
+struct SensorEntry {
+  uint8_t Sensor;                           // Sensor ID
+  uint8_t Presentation;                     // S_ type
+  const char *Name;                         // Presentation name (PROGMEM); nullptr - not presented (next message type of the same sensor)
+  uint8_t Type;                             // V_ type handled by Handler, sent by Init & requested at startup
+  MessageHandler Handler;                   // Called by receive(); nullptr - message ignored
+  StateSender Init;                         // Sends initial state; nullptr - nothing to send
+  bool Request;                             // Request value from controller at startup
+};
+
+// Compile time integer sequence 0..N-1
+template<uint8_t... I> struct IdSeq {};
+template<uint8_t N, uint8_t... I> struct MakeIdSeq : MakeIdSeq<N-1, N-1, I...> {};
+template<uint8_t... I> struct MakeIdSeq<0, I...> {
+  typedef IdSeq<I...> Type;
+};
+
+// Entries of a constexpr array as a table part
+template<const SensorEntry *Entries, uint8_t N>
+struct SensorArray {
+  static constexpr uint8_t Count = N;
+
+  static constexpr SensorEntry At(uint8_t i)  {
+    return Entries[i];
+  }
+};
+
+// Table parts joined in order
+template<class... Parts> struct SensorParts;
+
+template<> struct SensorParts<> {
+  static constexpr uint8_t Count = 0;
+
+  static constexpr SensorEntry At(uint8_t)  {
+    return SensorEntry{NO_ENTRY, 0, nullptr, 0, nullptr, nullptr, false};
+  }
+};
+
+template<class First, class... Rest>
+struct SensorParts<First, Rest...> {
+  static constexpr uint8_t Count = First::Count + SensorParts<Rest...>::Count;
+
+  static constexpr SensorEntry At(uint8_t i)  {
+    return i < First::Count ? First::At(i) : SensorParts<Rest...>::At(i - First::Count);
+  }
+};
+
+/**
+ * @brief Finds the first table entry of a sensor (compile time)
+ *
+ */
+template<class Parts>
+constexpr uint8_t FirstEntry(uint8_t Sensor, uint8_t i = 0) {
+  return i >= Parts::Count ? NO_ENTRY : (Parts::At(i).Sensor == Sensor ? i : FirstEntry<Parts>(Sensor, i + 1));
+}
+
+/**
+ * @brief Finds the highest sensor ID in the table (compile time)
+ *
+ */
+template<class Parts>
+constexpr uint8_t MaxSensor(uint8_t i = 0, uint8_t Max = 0) {
+  return i >= Parts::Count ? Max : MaxSensor<Parts>(i + 1, Parts::At(i).Sensor > Max ? Parts::At(i).Sensor : Max);
+}
+
+/**
+ * @brief Checks if entries of every sensor are placed next to each other (compile time)
+ *
+ */
+template<class Parts>
+constexpr bool Contiguous(uint8_t i = 1) {
+  return i >= Parts::Count ? true : ((Parts::At(i).Sensor == Parts::At(i-1).Sensor || FirstEntry<Parts>(Parts::At(i).Sensor) == i) && Contiguous<Parts>(i + 1));
+}
+
+// Entries of the table in flash, generated at compile time
+template<class Parts, typename Seq> struct SensorEntries;
+template<class Parts, uint8_t... I> struct SensorEntries<Parts, IdSeq<I...>> {
+  static const SensorEntry Table[sizeof...(I)];
+};
+template<class Parts, uint8_t... I>
+const SensorEntry SensorEntries<Parts, IdSeq<I...>>::Table[sizeof...(I)] PROGMEM = {Parts::At(I)...};
+
+// Sensor ID -> first entry index, generated at compile time
+template<class Parts, typename Seq> struct SensorIndex;
+template<class Parts, uint8_t... Id> struct SensorIndex<Parts, IdSeq<Id...>> {
+  static const uint8_t Entry[sizeof...(Id)];
+};
+template<class Parts, uint8_t... Id>
+const uint8_t SensorIndex<Parts, IdSeq<Id...>>::Entry[sizeof...(Id)] PROGMEM = {FirstEntry<Parts>(Id)...};
+
+template<class Parts>
+class SensorTable {
+
+  static_assert(Contiguous<Parts>(), "Entries of the same sensor have to be placed next to each other");
+
+  public:
+    /**
+     * @brief Presents all named entries to the controller
+     *
+     * @param Delay time (ms) to wait between subsequent presentation messages
+     */
+    static void Present(uint16_t Delay)  {
+      for(uint8_t i=0; i<Count; i++)  {
+        SensorEntry E = Read(i);
+        if(E.Name != nullptr) {
+          present(E.Sensor, E.Presentation, reinterpret_cast<const __FlashStringHelper *>(E.Name));
+          wait(Delay);
+        }
+      }
+    }
+
+    /**
+     * @brief Adds presentation of all named entries to FNV-1a hash
+     *
+     */
+    static uint32_t Hash(uint32_t Hash)  {
+      for(uint8_t i=0; i<Count; i++)  {
+        SensorEntry E = Read(i);
+        if(E.Name != nullptr) {
+          Hash = HashSensor(Hash, E.Sensor, E.Presentation, E.Name);
+        }
+      }
+
+      return Hash;
+    }
+
+    /**
+     * @brief Sends initial states of all entries and requests values from controller
+     *
+     * @param Request function sending the request
+     */
+    static void Confirm(StateRequest Request)  {
+      for(uint8_t i=0; i<Count; i++)  {
+        SensorEntry E = Read(i);
+        if(E.Init != nullptr) {
+          E.Init(E.Sensor, E.Type);
+        }
+        if(E.Request) {
+          Request(E.Sensor, E.Type);
+        }
+      }
+    }
+
+    /**
+     * @brief Calls handler bound to message sensor & type
+     *
+     * @param message incoming message
+     * @return true if handler was found
+     */
+    static bool Dispatch(const MyMessage &message)  {
+      if(message.sensor > MaxSensor<Parts>())  return false;
+
+      for(uint8_t i=pgm_read_byte(&Index::Entry[message.sensor]); i<Count; i++) {
+        SensorEntry E = Read(i);
+        if(E.Sensor != message.sensor)  break;
+        if(E.Type == message.type && E.Handler != nullptr) {
+          E.Handler(message);
+          return true;
+        }
+      }
+
+      return false;
+    }
+
+  private:
+    static constexpr uint8_t Count = Parts::Count;
+
+    typedef SensorEntries<Parts, typename MakeIdSeq<Count>::Type> Entries;
+    typedef SensorIndex<Parts, typename MakeIdSeq<MaxSensor<Parts>() + 1>::Type> Index;
+
+    static SensorEntry Read(uint8_t i)  {
+      SensorEntry E;
+      memcpy_P(&E, &Entries::Table[i], sizeof(E));
+      return E;
+    }
+};
+
+#endif
+/*
+   EOF
+*/
@@ -0,0 +1,255 @@
+/*
+ * ShutterMotion.h file
+ * Non-blocking roller shutter motion engine: an explicit state machine driven by millis() timestamps.
+ * Relays are switched by the Shutters class, everything else is handled here:
+ * - requests (buttons, controller) are only recorded and applied by Update(),
+ * - a direction change stops the motor and goes through a relay dead-time state before starting again,
+ * - position is interpolated in ms from travel times, so it can be reported during movement.
+ *
+ * Position: 0 - fully up (open), 100 - fully down (closed).
+ *
+ */
+
+#ifndef ShutterMotion_h
+#define ShutterMotion_h
+
+#define SHUTTER_UP 0
+#define SHUTTER_DOWN 1
+#define SHUTTER_STOP 2
+
+#define SHUTTER_NO_EVENT 0
+#define SHUTTER_STARTED 1
+#define SHUTTER_STOPPED 2
+
+#define SHUTTER_OVERRUN 1000                // Extra time (ms) relays stay on when moving to an end position, so the end switch is always reached
+#define SHUTTER_CURRENT_DELAY 500           // Time (ms) after start when low current is not considered as end position reached
+
+class ShutterMotion {
+
+  public:
+    /**
+     * @brief Constructor
+     *
+     * @param S shutter driving relays & holding position
+     */
+    ShutterMotion(Shutters &S) : _Shutter(S) {}
+
+    /**
+     * @brief Sets full travel times
+     *
+     * @param Up upward travel time (ms)
+     * @param Down downward travel time (ms)
+     * @param DeadTime time (ms) both relays are off between movements
+     */
+    void SetTimes(uint32_t Up, uint32_t Down, uint16_t DeadTime)  {
+      _TravelTime[SHUTTER_UP] = Up > 0 ? Up : 1;
+      _TravelTime[SHUTTER_DOWN] = Down > 0 ? Down : 1;
+      _DeadTime = DeadTime;
+    }
+
+    /**
+     * @brief Requests full travel (V_UP / V_DOWN) or stop (V_STOP)
+     *
+     * @param Direction SHUTTER_UP, SHUTTER_DOWN or SHUTTER_STOP
+     */
+    void Move(uint8_t Direction)  {
+      Request(Direction, Direction == SHUTTER_UP ? 0 : 100, true);
+    }
+
+    /**
+     * @brief Requests movement to a given position
+     *
+     * @param Target position 0-100
+     */
+    void MoveTo(uint8_t Target)  {
+      Request(SHUTTER_STOP, Target, false);
+      _RequestByPosition = true;
+    }
+
+    /**
+     * @brief Wall button: stops a moving shutter, starts full travel otherwise
+     *
+     * @param Direction SHUTTER_UP or SHUTTER_DOWN
+     */
+    void Button(uint8_t Direction)  {
+      bool Busy = _Phase == MOVING || (_Requested && (_RequestDirection != SHUTTER_STOP || _RequestByPosition));
+
+      Move(Busy ? SHUTTER_STOP : Direction);
+    }
+
+    /**
+     * @brief Signals that motor current has dropped (end switch reached); ignored right after start
+     *
+     */
+    void EndReached()  {
+      _EndReached = true;
+    }
+
+    /**
+     * @brief Applies pending requests and timestamps; has to be called at Due() at the latest
+     *
+     * @param Now current time
+     * @return uint8_t SHUTTER_STARTED, SHUTTER_STOPPED or SHUTTER_NO_EVENT
+     */
+    uint8_t Update(uint32_t Now)  {
+      bool EndReached = _EndReached;
+      _EndReached = false;
+
+      if(_Requested && _RequestByPosition) {
+        // Direction is known only now, when the current position is known
+        uint8_t Current = Position(Now);
+        _RequestDirection = _RequestTarget < Current ? SHUTTER_UP : (_RequestTarget > Current ? SHUTTER_DOWN : SHUTTER_STOP);
+        _RequestByPosition = false;
+      }
+
+      switch(_Phase)  {
+        case MOVING:
+          if(_Requested && _RequestDirection == _Direction)  {
+            // Same direction: new target only
+            _Requested = false;
+            Start(_Direction, _RequestTarget, _RequestFull, Now, false);
+            return SHUTTER_NO_EVENT;
+          }
+          if(EndReached && Now - _Start >= SHUTTER_CURRENT_DELAY) {
+            _Target = _Direction == SHUTTER_UP ? 0 : 100;
+            Halt(Now, true);
+            return SHUTTER_STOPPED;
+          }
+          if(_Requested || TimeReached(Now, _Deadline))  {
+            // Requested stop / direction change, or target reached
+            Halt(Now, TimeReached(Now, _Deadline));
+            return SHUTTER_STOPPED;
+          }
+          break;
+        case DEADTIME:
+          if(!TimeReached(Now, _Deadline))  break;
+          _Phase = IDLE;
+          // Fall through
+        case IDLE:
+          if(_Requested)  {
+            _Requested = false;
+            if(_RequestDirection != SHUTTER_STOP) {
+              Start(_RequestDirection, _RequestTarget, _RequestFull, Now, true);
+              return SHUTTER_STARTED;
+            }
+          }
+          break;
+      }
+
+      return SHUTTER_NO_EVENT;
+    }
+
+    /**
+     * @brief Checks if Update() has to be called at Due()
+     *
+     */
+    bool Active()  {
+      return _Phase != IDLE || _Requested;
+    }
+
+    /**
+     * @brief Time of the next transition: stop deadline or end of dead-time
+     *
+     */
+    uint32_t Due()  {
+      return _Deadline;
+    }
+
+    /**
+     * @brief Checks if motor is running
+     *
+     */
+    bool Moving()  {
+      return _Phase == MOVING;
+    }
+
+    /**
+     * @brief Current position; interpolated during movement
+     *
+     * @param Now current time
+     * @return uint8_t position 0-100
+     */
+    uint8_t Position(uint32_t Now)  {
+      if(_Phase != MOVING)  return _Shutter.Position;
+
+      uint32_t Travelled = ((Now - _Start) * 100UL) / _TravelTime[_Direction];
+      int16_t Position = _Direction == SHUTTER_UP ? (int16_t)_StartPosition - (int16_t)Travelled : (int16_t)_StartPosition + (int16_t)Travelled;
+
+      if(Travelled > 100) {
+        return _Direction == SHUTTER_UP ? 0 : 100;
+      }
+      return Position < 0 ? 0 : (Position > 100 ? 100 : Position);
+    }
+
+  private:
+    enum Phase : uint8_t { IDLE, MOVING, DEADTIME };
+
+    void Request(uint8_t Direction, uint8_t Target, bool Full)  {
+      _RequestDirection = Direction;
+      _RequestTarget = Target;
+      _RequestFull = Full;
+      _RequestByPosition = false;
+      _Requested = true;
+    }
+
+    /**
+     * @brief Starts motor or changes target of a moving one
+     *
+     */
+    void Start(uint8_t Direction, uint8_t Target, bool Full, uint32_t Now, bool Relays)  {
+      if(Relays)  {
+        _Shutter.NewState = Direction;
+        _Shutter.Movement();
+        _Phase = MOVING;
+        _Direction = Direction;
+        _Start = Now;
+        _StartPosition = _Shutter.Position;
+      }
+
+      uint8_t Current = Position(Now);
+      uint8_t Distance = Target > Current ? Target - Current : Current - Target;
+
+      _Target = Target;
+      _Deadline = Now + (_TravelTime[Direction] * Distance) / 100 + (Full ? SHUTTER_OVERRUN : 0);
+    }
+
+    /**
+     * @brief Stops motor, fixes position & starts dead-time
+     *
+     * @param AtTarget target position has been reached
+     */
+    void Halt(uint32_t Now, bool AtTarget)  {
+      _Shutter.Position = AtTarget ? _Target : Position(Now);
+      _Shutter.NewState = SHUTTER_STOP;
+      _Shutter.Movement();
+      _Phase = DEADTIME;
+      _Deadline = Now + _DeadTime;
+    }
+
+    static bool TimeReached(uint32_t Now, uint32_t Deadline)  {
+      return (int32_t)(Now - Deadline) >= 0;
+    }
+
+    Shutters &_Shutter;
+    uint32_t _TravelTime[2];
+    uint16_t _DeadTime = 0;
+
+    Phase _Phase = IDLE;
+    uint8_t _Direction = SHUTTER_STOP;
+    uint8_t _StartPosition = 0;
+    uint8_t _Target = 0;
+    uint32_t _Start = 0;
+    uint32_t _Deadline = 0;
+
+    bool _Requested = false;
+    bool _RequestByPosition = false;        // Direction to be calculated from target
+    bool _RequestFull = false;
+    uint8_t _RequestDirection = SHUTTER_STOP;
+    uint8_t _RequestTarget = 0;
+    bool _EndReached = false;
+};
+
+#endif
+/*
+   EOF
+*/
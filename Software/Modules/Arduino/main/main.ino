@@ -23,6 +23,18 @@
 /***** INCLUDES *****/
 #include "Configuration.h"
 #include <GoWired.h>
+#include "Profiler.h"
+#include "NodeProfile.h"
+#include "Scheduler.h"
+#include "AnalogSampler.h"
+#include "SendQueue.h"
+#include "Manifest.h"
+#include "SensorTable.h"
+#include "Journal.h"
+#include "ShutterMotion.h"
+#include "ShutterCalibration.h"
+#include "Fader.h"
+#include "ReportPolicy.h"
 #ifdef SHT30
   #include <SHTSensor.h>
 #elif defined(DHT22)
@@ -30,15 +42,62 @@
 #endif
 
 /***** Globals *****/
-// Shutter
-#ifdef ROLLER_SHUTTER
-  uint32_t MovementTime;
-  uint32_t StartTime;
+// Sensor IDs, pins & array sizes of the board (see NodeProfile.h)
+typedef MODULE_PROFILE ModuleProfile;
+
+// Measurements
+uint16_t Vcc;                               // uC supply voltage (mV)
+uint16_t Current = 0;                       // Last power sensor reading (mA)
+uint32_t LastMeasurement = 0;               // Time of the last power measurement
+#ifdef POWER_SENSOR
+  constexpr uint8_t PowerSensors = ModuleProfile::PowerSensors::Count;
+
+  // Energy counters, integrated at every measurement
+  struct EnergyCounters {
+    uint32_t Wh[PowerSensors];
+  };
+  EnergyCounters Energy;
+  uint32_t EnergyRest[PowerSensors];        // Energy below 1 Wh (mWs)
+  uint16_t EnergyFraction[PowerSensors];    // Energy below 1 mWs (mW * ms)
+  Journal<EnergyCounters, ENERGY_JOURNAL_SLOTS> EnergyJournal(EEA_ENERGY_JOURNAL);
+
+  static_assert(EEA_ENERGY_JOURNAL + decltype(EnergyJournal)::Size <= E2END + 1, "Energy journal doesn't fit in EEPROM");
 #endif
 
-// Timer
-uint32_t LastUpdate = 0;               // Time of last update of interval sensors
-bool CheckNow = false;
+// Fixed point constants, evaluated at compile time; no float math at runtime
+constexpr uint16_t PSOffset = PS_OFFSET * 1000;             // Roller shutter end position current (mA)
+constexpr uint16_t MaxCurrent = MAX_CURRENT * 1000;         // mA
+constexpr uint16_t MVPerAmp = MVPERAMP * 10 + 0.5;          // Power sensor sensitivity (0.1 mV/A)
+constexpr uint16_t CosFi = COSFI * 256 + 0.5;               // cos(fi) in 0.8 fixed point
+constexpr int16_t MVPerC = MVPERC * 10 + 0.5;               // Internal thermometer sensitivity (0.1 mV/C)
+
+// Analog channels
+uint8_t VccChannel;
+#ifdef POWER_SENSOR
+  uint8_t PSChannel[PowerSensors];
+#endif
+#ifdef INTERNAL_TEMP
+  uint8_t ITChannel;
+
+  static_assert(ModuleProfile::ThermometerPin != NO_PIN, "The board has no internal thermometer");
+#endif
+
+constexpr uint8_t AnalogChannels = 1        // Vcc
+  #ifdef POWER_SENSOR
+    + PowerSensors
+  #endif
+  #ifdef INTERNAL_TEMP
+    + 1
+  #endif
+  ;
+
+static_assert(AnalogChannels <= MAX_ADC_CHANNELS, "More analog channels than MAX_ADC_CHANNELS");
+
+// Tasks
+uint8_t SyncTask;                           // Startup synchronization timeout
+uint8_t SendTask;                           // Outbound message queue
+uint8_t IntervalTask;                       // Sensor readings at SENSOR_INTERVAL
+uint8_t JournalTask;                        // Deferred EEPROM writes
 
 // Module Safety Indicators
 bool THERMAL_ERROR = false;                 // Thermal error status
@@ -49,45 +108,46 @@ uint8_t ET_ERROR = 3;                       // External thermometer status (0 -
 
 // Initialization
 bool InitConfirm = false;
+uint8_t SyncPending = 0;                    // Number of values requested at startup & not yet received from controller
+bool SyncComplete = false;
 
 /***** Constructors *****/
+// Scheduler
+Scheduler Sched;
+
+// ADC acquisition engine
+AnalogSampler Sampler;
+
+// Outbound message queue
+SendQueue Queue;
+
 // CommonIO constructor
-#if (NUMBER_OF_RELAYS + NUMBER_OF_INPUTS > 0)
-  CommonIO CommonIO[NUMBER_OF_RELAYS+NUMBER_OF_INPUTS];
-#endif
+CommonIO CommonIO[ModuleProfile::IOs];
 
 MyMessage MsgSTATUS(0, V_STATUS);
 MyMessage MsgPERCENTAGE(0, V_PERCENTAGE);
 MyMessage MsgWATT(0, V_WATT);
+MyMessage MsgKWH(0, V_KWH);
 MyMessage MsgTEMP(0, V_TEMP);
 MyMessage MsgHUM(0, V_HUM);
 MyMessage MsgTEXT(0, V_TEXT);
-
-// Shutter Constructor
-#ifdef ROLLER_SHUTTER
-  Shutters Shutter(EEA_SHUTTER_TIME_DOWN, EEA_SHUTTER_TIME_UP, EEA_SHUTTER_POSITION);
-  MyMessage MsgUP(SHUTTER_ID, V_UP);
-  MyMessage MsgDOWN(SHUTTER_ID, V_DOWN);
-  MyMessage MsgSTOP(SHUTTER_ID, V_STOP);
+MyMessage MsgREADY(CONFIGURATION_SENSOR_ID, V_VAR1);
+Manifest Presentation(CONFIGURATION_SENSOR_ID);
+
+// Report policies
+#ifdef POWER_SENSOR
+  // One per power sensor
+  struct PSReportPolicy : ReportPolicy<int32_t> {
+    PSReportPolicy() : ReportPolicy<int32_t>(PS_POLICY) {}
+  };
+  PSReportPolicy PSPolicy[PowerSensors];
 #endif
-
-// Dimmer
-#if defined(DIMMER) || defined(RGB) || defined(RGBW)
-  Dimmer Dimmer;
-  MyMessage MsgRGB(DIMMER_ID, V_RGB);
-  MyMessage MsgRGBW(DIMMER_ID, V_RGBW);
-#endif
-
-// Power sensor constructor
-#if defined(POWER_SENSOR) && !defined(FOUR_RELAY)
-  PowerSensor PS;
-#elif defined(POWER_SENSOR) && defined(FOUR_RELAY)
-  PowerSensor PS[NUMBER_OF_RELAYS];
-#endif
-
-// Internal thermometer constructor
 #ifdef INTERNAL_TEMP
-  AnalogTemp AnalogTemp(IT_PIN, MAX_TEMPERATURE, MVPERC, ZEROVOLTAGE);
+  ReportPolicy<int16_t> ITPolicy(IT_POLICY);
+#endif
+#ifdef EXTERNAL_TEMP
+  ReportPolicy<float> ETTPolicy(ETT_POLICY);
+  ReportPolicy<float> ETHPolicy(ETH_POLICY);
 #endif
 
 // External thermometer constructor
@@ -106,6 +166,12 @@ MyMessage MsgTEXT(0, V_TEXT);
   MyMessage MsgCUSTOM(0, V_CUSTOM);
 #endif
 
+// Loop profiler
+#ifdef LOOP_PROFILING
+  Profiler Prof;
+  ProfilerData ProfData;
+#endif
+
 /**
  * @brief Function called before setup(); resets wdt
  * 
@@ -117,8 +183,576 @@ void before() {
     MCUSR = 0;
     wdt_disable();
   #endif
+
+  #ifdef LOOP_PROFILING
+    Profiler::PaintStack();
+  #endif
 }
 
+/***** Outputs *****/
+// Presentation names of the outputs
+const char NameRelay1[] PROGMEM = "Relay 1";
+const char NameRelay2[] PROGMEM = "Relay 2";
+const char NameRelay3[] PROGMEM = "Relay 3";
+const char NameRelay4[] PROGMEM = "Relay 4";
+const char NameRollerShutter[] PROGMEM = "Roller Shutter";
+const char NameDimmer[] PROGMEM = "Dimmer";
+const char NameRGB[] PROGMEM = "RGB";
+const char NameRGBW[] PROGMEM = "RGBW";
+
+constexpr const char *RelayNames[] = {NameRelay1, NameRelay2, NameRelay3, NameRelay4};
+
+#define ALL_LOADS 0xFF                      // Cutoff() of every load, not only of one power sensor
+
+/*
+ * Code & objects of the output of the profile (NodeProfile.h); only the handler of the selected output is
+ * compiled, its objects are static members. Every handler provides:
+ *   Count, At()      its part of the sensor table (see SensorTable.h)
+ *   Setup()          outputs & buttons; AddTasks() - its scheduler tasks
+ *   Button()         a button (CommonIO type 3) changed
+ *   Loaded()         load measured by a power sensor is on; Measured() - its current
+ *   Cutoff()         safety stop of the loads of a power sensor (or ALL_LOADS)
+ *   Calibrate()      CONF_MSG_1; Commit() - journal write step, true if pending; Tick() - Timer2 interrupt
+ */
+template<class Output> class OutputHandler;
+
+// Relays: switched by their buttons (CommonIO type 4) or by the controller only (type 2)
+template<uint8_t... Pins>
+class OutputHandler<RelayOutput<Pins...>> {
+
+  typedef RelayOutput<Pins...> Output;
+
+  static_assert(Output::Count <= sizeof(RelayNames) / sizeof(RelayNames[0]), "Relay without a name");
+
+  public:
+    static constexpr uint8_t Count = Output::Count;
+
+    static constexpr SensorEntry At(uint8_t i)  {
+      return {i, S_BINARY, RelayNames[i], V_STATUS, RelayStatus, SendIOState, true};
+    }
+
+    static void Setup()  {
+      for(uint8_t i=0; i<Output::Count; i++) {
+        if(i < ModuleProfile::Buttons::Count)  {
+          CommonIO[i].SetValues(RELAY_OFF, false, 4, ModuleProfile::Buttons::Pin(i), Output::Pin(i));
+        }
+        else  {
+          CommonIO[i].SetValues(RELAY_OFF, 2, Output::Pin(i));
+        }
+      }
+    }
+
+    static void AddTasks()  {}
+
+    static void Button(uint8_t)  {}
+
+    static bool Loaded(uint8_t Sensor)  {
+      for(uint8_t i=0; i<Output::Count; i++) {
+        if(ModuleProfile::PowerSensorOf(i) == Sensor && CommonIO[i].State)  return true;
+      }
+      return false;
+    }
+
+    static void Measured(uint16_t)  {}
+
+    static void Cutoff(uint8_t Sensor)  {
+      for(uint8_t i=0; i<Output::Count; i++) {
+        if(Sensor != ALL_LOADS && ModuleProfile::PowerSensorOf(i) != Sensor)  continue;
+
+        CommonIO[i].NewState = RELAY_OFF;
+        CommonIO[i].SetRelay();
+        send(MsgSTATUS.setSensor(i).set(CommonIO[i].NewState));
+      }
+    }
+
+    static void Calibrate()  {}
+
+    static bool Commit()  { return false; }
+
+    static void Tick()  {}
+
+    /**
+     * @brief Handles V_STATUS: sets relay if safety parameters allow it
+     * 
+     * @param message incoming message data
+     */
+    static void RelayStatus(const MyMessage &message) {
+
+      if (!OVERCURRENT_ERROR[ModuleProfile::PowerSensorOf(message.sensor)] && !THERMAL_ERROR) {
+        CommonIO[message.sensor].SetState(message.getBool());
+        CommonIO[message.sensor].SetRelay();
+      }
+    }
+};
+
+// Roller shutter: up & down buttons (CommonIO type 3), end position by motor current, calibration & position journal
+template<uint8_t UpPin, uint8_t DownPin>
+class OutputHandler<ShutterOutput<UpPin, DownPin>> {
+
+  static constexpr uint8_t Sensor = 0;
+
+  static Shutters Shutter;
+  static ShutterMotion Motion;
+  static ShutterCalibration<CALIBRATION_SAMPLES> Calibrator;
+  static Journal<uint8_t, JOURNAL_SLOTS> PositionJournal;
+  static MyMessage MsgUP;
+  static MyMessage MsgDOWN;
+  static MyMessage MsgSTOP;
+  static uint8_t ShutterTask;               // Shutter stop deadline & state changes
+
+  public:
+    static constexpr uint8_t Count = 4;
+
+    static constexpr SensorEntry At(uint8_t i)  {
+      return i == 0 ? SensorEntry{Sensor, S_COVER, NameRollerShutter, V_UP, ShutterMovement, SendZero, true} :
+             i == 1 ? SensorEntry{Sensor, S_COVER, nullptr, V_DOWN, ShutterMovement, SendZero, true} :
+             i == 2 ? SensorEntry{Sensor, S_COVER, nullptr, V_STOP, ShutterMovement, SendZero, true} :
+                      SensorEntry{Sensor, S_COVER, nullptr, V_PERCENTAGE, ShutterPosition, SendShutterPosition, true};
+    }
+
+    static void Setup()  {
+      Shutter.SetOutputs(RELAY_OFF, UpPin, DownPin);
+      for(uint8_t i=0; i<ModuleProfile::Buttons::Count; i++) {
+        CommonIO[i].SetValues(RELAY_OFF, false, 3, ModuleProfile::Buttons::Pin(i));
+      }
+      if(!Shutter.Calibrated) {
+        Shutter.Calibration(UP_TIME, DOWN_TIME);
+      }
+      // Newest journaled position; position saved by older software otherwise
+      PositionJournal.Begin(Shutter.Position);
+      SetShutterTimes();
+    }
+
+    static void AddTasks()  {
+      ShutterTask = Sched.AddTask(ShutterUpdate, 0);
+    }
+
+    static void Button(uint8_t i)  {
+      if(CommonIO[i].NewState != 2)  {
+        if(!CalibrationAbort()) {
+          Motion.Button(i);
+        }
+        CommonIO[i].State = CommonIO[i].NewState;
+        Sched.RunNow(ShutterTask);
+      }
+      else  {
+        send(MsgSTATUS.setSensor(ModuleProfile::SpecialButtonId(0)).set(true));
+        CommonIO[i].NewState = CommonIO[i].State;
+      }
+    }
+
+    static bool Loaded(uint8_t)  {
+      return digitalRead(UpPin) == RELAY_ON || digitalRead(DownPin) == RELAY_ON;
+    }
+
+    // Shutter reached its end position
+    static void Measured(uint16_t Current)  {
+      if (Motion.Moving() && Current < PSOffset)  {
+        Motion.EndReached();
+        Sched.RunNow(ShutterTask);
+      }
+    }
+
+    static void Cutoff(uint8_t)  {
+      ShutterStop();
+    }
+
+    // Calibration, runs in background
+    static void Calibrate()  {
+      StartCalibration();
+    }
+
+    static bool Commit()  {
+      return PositionJournal.Commit();
+    }
+
+    static void Tick()  {}
+
+  private:
+    /**
+     * @brief Sends current shutter position
+     * 
+     * @param Sensor sensor ID
+     * @param Type value type
+     */
+    static void SendShutterPosition(uint8_t Sensor, uint8_t Type) {
+
+      send(MsgPERCENTAGE.setSensor(Sensor).set(Shutter.Position));
+    }
+
+    /**
+     * @brief Handles V_PERCENTAGE: moves shutter to a new position
+     * 
+     * @param message incoming message data
+     */
+    static void ShutterPosition(const MyMessage &message) {
+
+      if(CalibrationAbort())  return;
+
+      int NewPosition = atoi(message.data);
+      NewPosition = NewPosition > 100 ? 100 : NewPosition;
+      NewPosition = NewPosition < 0 ? 0 : NewPosition;
+      Motion.MoveTo(NewPosition);
+      Sched.RunNow(ShutterTask);
+    }
+
+    /**
+     * @brief Handles V_UP, V_DOWN & V_STOP
+     * 
+     * @param message incoming message data
+     */
+    static void ShutterMovement(const MyMessage &message) {
+
+      if(CalibrationAbort())  return;
+
+      if(message.type == V_UP) {
+        Motion.Move(SHUTTER_UP);
+      }
+      else if(message.type == V_DOWN) {
+        Motion.Move(SHUTTER_DOWN);
+      }
+      else  {
+        Motion.Move(SHUTTER_STOP);
+      }
+      Sched.RunNow(ShutterTask);
+    }
+
+    /**
+     * @brief Starts shutter calibration; measurements run in background from ShutterUpdate()
+     * 
+     */
+    static void StartCalibration()  {
+
+      // Stop current movement first
+      Motion.Move(SHUTTER_STOP);
+      ShutterUpdate();
+
+      Calibrator.Begin(millis());
+      send(MsgTEXT.setSensor(CONFIGURATION_SENSOR_ID).set("CAL START"));
+      Sched.RunNow(ShutterTask);
+    }
+
+    /**
+     * @brief Stops calibration in progress; every shutter command (including STOP) and safety stop aborts calibration
+     * 
+     * @return true if calibration was aborted
+     */
+    static bool CalibrationAbort() {
+
+      if(Calibrator.Active()) {
+        Calibrator.Abort();
+        send(MsgTEXT.setSensor(CONFIGURATION_SENSOR_ID).set("CAL ABORTED"));
+        send(MsgSTOP.setSensor(Sensor));
+        return true;
+      }
+
+      return false;
+    }
+
+    /**
+     * @brief Calibration step: checks motor current, reports progress, saves measured travel times
+     * 
+     * @param Now current time
+     */
+    static void CalibrationUpdate(uint32_t Now)  {
+
+      bool Running = false;
+      char Text[12];
+
+      #ifdef POWER_SENSOR
+        Running = MeasureAC(PSChannel[0], Vcc) > PSOffset;
+      #endif
+
+      switch(Calibrator.Update(Now, Running)) {
+        case CALIBRATION_PROGRESS:
+          snprintf(Text, sizeof(Text), "CAL %u%%", Calibrator.Progress());
+          send(MsgTEXT.setSensor(CONFIGURATION_SENSOR_ID).set(Text));
+          break;
+        case CALIBRATION_DONE:
+          PROFILE_START(PROF_EEPROM);
+          EEPROM.put(EEA_SHUTTER_TRAVEL_DOWN, Calibrator.DownTime);
+          EEPROM.put(EEA_SHUTTER_TRAVEL_UP, Calibrator.UpTime);
+          PROFILE_END(PROF_EEPROM);
+          // Legacy values in seconds (add 1 s to each duration)
+          Shutter.Calibration(Calibrator.UpTime / 1000 + 1, Calibrator.DownTime / 1000 + 1);
+          SetShutterTimes();
+
+          Shutter.Position = 0;
+          StorePosition();
+
+          // Inform Controller about the current state of roller shutter
+          send(MsgTEXT.setSensor(CONFIGURATION_SENSOR_ID).set("CAL DONE"));
+          send(MsgSTOP.setSensor(Sensor));
+          send(MsgPERCENTAGE.setSensor(Sensor).set(Shutter.Position));
+          #ifdef RS485_DEBUG
+            send(MsgDEBUG.set("DownTime ; UpTime"));
+            send(MsgCUSTOM.set(Calibrator.DownTime)); send(MsgCUSTOM.set(Calibrator.UpTime));
+          #endif
+          break;
+        case CALIBRATION_FAILED:
+          send(MsgTEXT.setSensor(CONFIGURATION_SENSOR_ID).set("CAL FAILED"));
+          send(MsgSTOP.setSensor(Sensor));
+          break;
+        default:
+          break;
+      }
+
+      if(Calibrator.Active()) {
+        Sched.RunIn(ShutterTask, CALIBRATION_INTERVAL);
+      }
+    }
+
+    /**
+     * @brief Loads travel times measured by calibration (manually defined UP_TIME / DOWN_TIME if not calibrated)
+     * 
+     */
+    static void SetShutterTimes()  {
+
+      uint32_t DownTime;
+      uint32_t UpTime;
+
+      EEPROM.get(EEA_SHUTTER_TRAVEL_DOWN, DownTime);
+      EEPROM.get(EEA_SHUTTER_TRAVEL_UP, UpTime);
+
+      // Not calibrated in ms: times in seconds saved by older software or manually defined
+      if(DownTime == 0 || DownTime > CALIBRATION_TIMEOUT || UpTime == 0 || UpTime > CALIBRATION_TIMEOUT)  {
+        uint8_t Down = EEPROM.read(EEA_SHUTTER_TIME_DOWN);
+        uint8_t Up = EEPROM.read(EEA_SHUTTER_TIME_UP);
+
+        DownTime = (Down > 0 && Down < 0xFF ? Down : DOWN_TIME) * 1000UL;
+        UpTime = (Up > 0 && Up < 0xFF ? Up : UP_TIME) * 1000UL;
+      }
+
+      Motion.SetTimes(UpTime, DownTime, SHUTTER_DEADTIME);
+    }
+
+    /**
+     * @brief Scheduled shutter task: applies requests from buttons & controller, stop deadlines and dead-time,
+     * informs controller about shutter movement and position; position is streamed during movement
+     * 
+     */
+    static void ShutterUpdate() {
+
+      PROFILE_START(PROF_SHUTTER_UPDATE);
+
+      uint32_t Now = millis();
+
+      if(Calibrator.Active()) {
+        CalibrationUpdate(Now);
+        PROFILE_END(PROF_SHUTTER_UPDATE);
+        return;
+      }
+
+      uint8_t Event = Motion.Update(Now);
+
+      if(Event == SHUTTER_STARTED)  {
+        Shutter.State == SHUTTER_UP ? send(MsgUP.setSensor(Sensor)) : send(MsgDOWN.setSensor(Sensor));
+      }
+      else if(Event == SHUTTER_STOPPED) {
+        send(MsgSTOP.setSensor(Sensor));
+        Report(MsgPERCENTAGE.setSensor(Sensor).set(Shutter.Position));
+        StorePosition();
+      }
+      else if(Motion.Moving() && SHUTTER_REPORT_INTERVAL > 0) {
+        Report(MsgPERCENTAGE.setSensor(Sensor).set(Motion.Position(Now)));
+      }
+
+      // Next transition; earlier if position is streamed
+      if(Motion.Active()) {
+        uint32_t Next = Motion.Due();
+
+        if(Motion.Moving() && SHUTTER_REPORT_INTERVAL > 0 && !Scheduler::TimeReached(Now + SHUTTER_REPORT_INTERVAL, Next)) {
+          Next = Now + SHUTTER_REPORT_INTERVAL;
+        }
+        Sched.RunAt(ShutterTask, Next);
+      }
+
+      PROFILE_END(PROF_SHUTTER_UPDATE);
+    }
+
+    /**
+     * @brief Stops shutter at once (safety)
+     * 
+     */
+    static void ShutterStop()  {
+
+      CalibrationAbort();
+      Motion.Move(SHUTTER_STOP);
+      ShutterUpdate();
+    }
+
+    /**
+     * @brief Stages shutter position in the journal; stored after JOURNAL_DELAY, so subsequent stops are coalesced
+     * 
+     */
+    static void StorePosition() {
+
+      if(PositionJournal.Put(Shutter.Position)) {
+        Sched.RunIn(JournalTask, JOURNAL_DELAY);
+      }
+    }
+};
+
+template<uint8_t UpPin, uint8_t DownPin>
+Shutters OutputHandler<ShutterOutput<UpPin, DownPin>>::Shutter(EEA_SHUTTER_TIME_DOWN, EEA_SHUTTER_TIME_UP, EEA_SHUTTER_POSITION);
+template<uint8_t UpPin, uint8_t DownPin>
+ShutterMotion OutputHandler<ShutterOutput<UpPin, DownPin>>::Motion(Shutter);
+template<uint8_t UpPin, uint8_t DownPin>
+ShutterCalibration<CALIBRATION_SAMPLES> OutputHandler<ShutterOutput<UpPin, DownPin>>::Calibrator(Shutter);
+template<uint8_t UpPin, uint8_t DownPin>
+Journal<uint8_t, JOURNAL_SLOTS> OutputHandler<ShutterOutput<UpPin, DownPin>>::PositionJournal(EEA_JOURNAL);
+template<uint8_t UpPin, uint8_t DownPin>
+MyMessage OutputHandler<ShutterOutput<UpPin, DownPin>>::MsgUP(Sensor, V_UP);
+template<uint8_t UpPin, uint8_t DownPin>
+MyMessage OutputHandler<ShutterOutput<UpPin, DownPin>>::MsgDOWN(Sensor, V_DOWN);
+template<uint8_t UpPin, uint8_t DownPin>
+MyMessage OutputHandler<ShutterOutput<UpPin, DownPin>>::MsgSTOP(Sensor, V_STOP);
+template<uint8_t UpPin, uint8_t DownPin>
+uint8_t OutputHandler<ShutterOutput<UpPin, DownPin>>::ShutterTask;
+
+// LED dimmer: on/off & level buttons (CommonIO type 3), fade engine on Timer2; colors if presented as RGB / RGBW
+template<uint8_t Presentation, uint8_t... Pins>
+class OutputHandler<DimmerOutput<Presentation, Pins...>> {
+
+  static constexpr uint8_t Sensor = 0;
+  static constexpr uint8_t Color = Presentation == S_RGBW_LIGHT ? V_RGBW : V_RGB;    // Color message type
+
+  static Fader<sizeof...(Pins)> Dimmer;
+
+  public:
+    static constexpr uint8_t Count = Presentation == S_DIMMER ? 2 : 4;
+
+    static constexpr SensorEntry At(uint8_t i)  {
+      return i == 0 ? SensorEntry{Sensor, Presentation, Presentation == S_DIMMER ? NameDimmer : Presentation == S_RGB_LIGHT ? NameRGB : NameRGBW,
+                                  V_STATUS, DimmerStatus, SendZero, true} :
+             i == 1 ? SensorEntry{Sensor, S_DIMMER, nullptr, V_PERCENTAGE, DimmerLevel, SendDimmingLevel, true} :
+             i == 2 ? SensorEntry{Sensor, Presentation, nullptr, Color, DimmerColor, SendColor, true} :
+                      SensorEntry{Sensor, Presentation, nullptr, Color == V_RGB ? V_RGBW : V_RGB, DimmerColor, nullptr, false};
+    }
+
+    static void Setup()  {
+      for(uint8_t i=0; i<ModuleProfile::Buttons::Count; i++) {
+        CommonIO[i].SetValues(RELAY_OFF, false, 3, ModuleProfile::Buttons::Pin(i));
+      }
+      Dimmer.Begin(FADE_DURATION, Pins...);
+    }
+
+    static void AddTasks()  {}
+
+    static void Button(uint8_t i)  {
+      if(i == 0)  {
+        if(CommonIO[i].NewState != 2) {
+          // Change dimmer state
+          Dimmer.ChangeState(!Dimmer.CurrentState);
+          send(MsgSTATUS.setSensor(Sensor).set(Dimmer.CurrentState));
+          CommonIO[i].State = CommonIO[i].NewState;
+        }
+        if(CommonIO[i].NewState == 2) {
+          send(MsgSTATUS.setSensor(ModuleProfile::SpecialButtonId(0)).set(true));
+          CommonIO[i].NewState = CommonIO[i].State;
+        }
+      }
+      else if(i == 1) {
+        if(CommonIO[i].NewState != 2)  {
+          if(!Dimmer.CurrentState) return;
+
+          // Toggle dimming level by DIMMING_TOGGLE_STEP
+          uint8_t NewLevel = Dimmer.Level() + DIMMING_TOGGLE_STEP;
+          Dimmer.SetLevel(NewLevel > 100 ? DIMMING_TOGGLE_STEP : NewLevel);
+          send(MsgPERCENTAGE.setSensor(Sensor).set(Dimmer.Level()));
+          CommonIO[i].NewState = CommonIO[i].State;
+        }
+      }
+    }
+
+    static bool Loaded(uint8_t)  {
+      return Dimmer.CurrentState;
+    }
+
+    static void Measured(uint16_t)  {}
+
+    static void Cutoff(uint8_t)  {
+      Dimmer.ChangeState(false);
+      send(MsgSTATUS.setSensor(Sensor).set(Dimmer.CurrentState));
+    }
+
+    static void Calibrate()  {}
+
+    static bool Commit()  { return false; }
+
+    static void Tick()  {
+      Dimmer.Tick();
+    }
+
+  private:
+    /**
+     * @brief Sends current dimming level
+     * 
+     * @param Sensor sensor ID
+     * @param Type value type
+     */
+    static void SendDimmingLevel(uint8_t Sensor, uint8_t Type) {
+
+      send(MsgPERCENTAGE.setSensor(Sensor).set(Dimmer.Level()));
+    }
+
+    /**
+     * @brief Sends initial color of RGB / RGBW dimmer
+     * 
+     * @param Sensor sensor ID
+     * @param Type value type
+     */
+    static void SendColor(uint8_t Sensor, uint8_t Type) {
+
+      MyMessage Msg(Sensor, Type);
+
+      send(Msg.set(Type == V_RGB ? "ffffff" : "ffffffff"));
+    }
+
+    /**
+     * @brief Handles V_STATUS: turns dimmer on/off
+     * 
+     * @param message incoming message data
+     */
+    static void DimmerStatus(const MyMessage &message) {
+
+      Dimmer.ChangeState(message.getBool());
+    }
+
+    /**
+     * @brief Handles V_PERCENTAGE: sets new dimming level
+     * 
+     * @param message incoming message data
+     */
+    static void DimmerLevel(const MyMessage &message) {
+
+      int NewLevel = atoi(message.data);
+
+      // Clamped as int; SetLevel() takes uint8_t
+      NewLevel = NewLevel > 100 ? 100 : NewLevel;
+      NewLevel = NewLevel < 0 ? 0 : NewLevel;
+
+      Dimmer.SetLevel(NewLevel);
+    }
+
+    /**
+     * @brief Handles V_RGB & V_RGBW: sets new color
+     * 
+     * @param message incoming message data
+     */
+    static void DimmerColor(const MyMessage &message) {
+
+      const char *rgbvalues = message.getString();
+
+      Dimmer.NewColorValues(rgbvalues);
+    }
+};
+
+template<uint8_t Presentation, uint8_t... Pins>
+Fader<sizeof...(Pins)> OutputHandler<DimmerOutput<Presentation, Pins...>>::Dimmer;
+
+typedef OutputHandler<ModuleProfile::Output> ModuleOutput;
+
 /**
  * @brief Setups software components: wdt, expander, inputs, outputs
  * 
@@ -129,85 +763,35 @@ void setup() {
     wdt_enable(WDTO_8S);
   #endif
 
-  float Vcc = ReadVcc();  // mV
-
-  // POWER SENSOR
-  #if defined(POWER_SENSOR) && !defined(FOUR_RELAY)
-    PS.SetValues(PS_PIN, MVPERAMP, RECEIVER_VOLTAGE, MAX_CURRENT, POWER_MEASURING_TIME, Vcc);
-  #elif defined(POWER_SENSOR) && defined(FOUR_RELAY)
-    PS[RELAY_ID_1].SetValues(PS_PIN_1, MVPERAMP, RECEIVER_VOLTAGE, MAX_CURRENT, POWER_MEASURING_TIME, Vcc);
-    PS[RELAY_ID_2].SetValues(PS_PIN_2, MVPERAMP, RECEIVER_VOLTAGE, MAX_CURRENT, POWER_MEASURING_TIME, Vcc);
-    PS[RELAY_ID_3].SetValues(PS_PIN_3, MVPERAMP, RECEIVER_VOLTAGE, MAX_CURRENT, POWER_MEASURING_TIME, Vcc);
-    PS[RELAY_ID_4].SetValues(PS_PIN_4, MVPERAMP, RECEIVER_VOLTAGE, MAX_CURRENT, POWER_MEASURING_TIME, Vcc);
-  #endif
-
-  // OUTPUT
-  #ifdef DOUBLE_RELAY
-    CommonIO[RELAY_ID_1].SetValues(RELAY_OFF, false, 4, BUTTON_1, RELAY_1);
-    CommonIO[RELAY_ID_2].SetValues(RELAY_OFF, false, 4, BUTTON_2, RELAY_2);
-  #endif
-
-  #ifdef ROLLER_SHUTTER
-    Shutter.SetOutputs( RELAY_OFF, RELAY_1, RELAY_2);
-    CommonIO[SHUTTER_ID].SetValues(RELAY_OFF, false, 3, BUTTON_1);
-    CommonIO[SHUTTER_ID + 1].SetValues(RELAY_OFF, false, 3, BUTTON_2);
-    if(!Shutter.Calibrated) {
-      Shutter.Calibration(UP_TIME, DOWN_TIME);
+  // ANALOG CHANNELS
+  VccChannel = Sampler.AddBandgap(ADC_WINDOW);
+  #ifdef POWER_SENSOR
+    for(uint8_t i=0; i<PowerSensors; i++) {
+      PSChannel[i] = Sampler.AddChannel(ModuleProfile::PowerSensors::Pin(i), POWER_MEASURING_TIME);
     }
   #endif
-
-  #ifdef FOUR_RELAY
-    CommonIO[RELAY_ID_1].SetValues(RELAY_OFF, 2, RELAY_1);
-    CommonIO[RELAY_ID_2].SetValues(RELAY_OFF, 2, RELAY_2);
-    CommonIO[RELAY_ID_3].SetValues(RELAY_OFF, 2, RELAY_3);
-    CommonIO[RELAY_ID_4].SetValues(RELAY_OFF, 2, RELAY_4);
+  #ifdef INTERNAL_TEMP
+    ITChannel = Sampler.AddChannel(ModuleProfile::ThermometerPin, ADC_WINDOW);
   #endif
 
-  #if defined(DIMMER) || defined(RGB) || defined(RGBW)
-    CommonIO[0].SetValues(0, false, 3, BUTTON_1);
-    CommonIO[1].SetValues(0, false, 3, BUTTON_2);
-  #endif
+  Sampler.Begin();
+  while(!Sampler.Ready());
 
-  #ifdef DIMMER
-    Dimmer.SetValues(NUMBER_OF_CHANNELS, DIMMING_STEP, DIMMING_INTERVAL, LED_PIN_1, LED_PIN_2, LED_PIN_3, LED_PIN_4);
-  #elif defined(RGB)
-    Dimmer.SetValues(NUMBER_OF_CHANNELS, DIMMING_STEP, DIMMING_INTERVAL, LED_PIN_1, LED_PIN_2, LED_PIN_3);
-  #elif defined(RGBW)
-    Dimmer.SetValues(NUMBER_OF_CHANNELS, DIMMING_STEP, DIMMING_INTERVAL, LED_PIN_1, LED_PIN_2, LED_PIN_3, LED_PIN_4);
-  #endif
-
-  // INPUT
-  #ifdef INPUT_1
-    #ifdef PULLUP_1
-      CommonIO[INPUT_ID_1].SetValues(RELAY_OFF, INVERT_1, 0, PIN_1);
-    #else
-      CommonIO[INPUT_ID_1].SetValues(RELAY_OFF, INVERT_1, 1, PIN_1);
-    #endif
-  #endif
+  Vcc = ReadVcc();  // mV
 
-  #ifdef INPUT_2
-    #ifdef PULLUP_2
-      CommonIO[INPUT_ID_2].SetValues(RELAY_OFF, INVERT_2, 0, PIN_2);
-    #else
-      CommonIO[INPUT_ID_2].SetValues(RELAY_OFF, INVERT_2, 1, PIN_2);
-    #endif
+  // POWER SENSOR
+  #ifdef POWER_SENSOR
+    EnergyJournal.Begin(Energy);
   #endif
 
-  #ifdef INPUT_3
-    #ifdef PULLUP_3
-      CommonIO[INPUT_ID_3].SetValues(RELAY_OFF, INVERT_3, 0, PIN_3);
-    #else
-      CommonIO[INPUT_ID_3].SetValues(RELAY_OFF, INVERT_3, 1, PIN_3);
-    #endif
-  #endif
+  // OUTPUT
+  ModuleOutput::Setup();
 
-  #ifdef INPUT_4
-    #ifdef PULLUP_4
-      CommonIO[INPUT_ID_4].SetValues(RELAY_OFF, INVERT_4, 0, PIN_4);
-    #else
-      CommonIO[INPUT_ID_4].SetValues(RELAY_OFF, INVERT_4, 1, PIN_4);
-    #endif
-  #endif
+  // INPUT
+  for(uint8_t i=0; i<ModuleProfile::Inputs::Count; i++) {
+    CommonIO[ModuleProfile::InputId(i)].SetValues(RELAY_OFF, ModuleProfile::Inputs::Invert(i), ModuleProfile::Inputs::Pullup(i) ? 0 : 1,
+                                                  ModuleProfile::Inputs::Pin(i));
+  }
 
   // EXTERNAL THERMOMETER
   #ifdef EXTERNAL_TEMP
@@ -221,248 +805,373 @@ void setup() {
     #endif
   #endif
 
-}
+  // TASKS
+  Sched.AddTask(SafetyUpdate, MEASURING_INTERVAL);
 
-/**
- * @brief Presents module to the controller, send name, software version, info about sensors
- * 
- */
-void presentation() {
+  if (ModuleProfile::IOs > 0) {
+    Sched.AddTask(UpdateIO, IO_INTERVAL);
+  }
 
-  sendSketchInfo(SN, SV);
+  ModuleOutput::AddTasks();
+  JournalTask = Sched.AddTask(JournalUpdate, 0);
 
-  // OUTPUT
-  #ifdef DOUBLE_RELAY
-    present(RELAY_ID_1, S_BINARY, "Relay 1");   wait(PRESENTATION_DELAY);
-    present(RELAY_ID_2, S_BINARY, "Relay 2");   wait(PRESENTATION_DELAY);
+  #ifdef POWER_SENSOR
+    Sched.AddTask(EnergyUpdate, ENERGY_INTERVAL);
   #endif
 
-  #ifdef ROLLER_SHUTTER
-    present(SHUTTER_ID, S_COVER, "Roller Shutter");  wait(PRESENTATION_DELAY);
-  #endif
+  IntervalTask = Sched.AddTask(IntervalUpdate, SENSOR_INTERVAL);
+  SyncTask = Sched.AddTask(SyncUpdate, 0);
+  SendTask = Sched.AddTask(SendUpdate, 0);
 
-  #ifdef FOUR_RELAY
-    present(RELAY_ID_1, S_BINARY, "Relay 1");   wait(PRESENTATION_DELAY);
-    present(RELAY_ID_2, S_BINARY, "Relay 2");   wait(PRESENTATION_DELAY);
-    present(RELAY_ID_3, S_BINARY, "Relay 3");   wait(PRESENTATION_DELAY);
-    present(RELAY_ID_4, S_BINARY, "Relay 4");   wait(PRESENTATION_DELAY);
+  #ifdef LOOP_PROFILING
+    Prof.Reset();
   #endif
+}
 
-  #ifdef DIMMER
-    present(DIMMER_ID, S_DIMMER, "Dimmer"); wait(PRESENTATION_DELAY);
-  #endif
+/**
+ * @brief Sends 0 as initial value of a sensor
+ * 
+ * @param Sensor sensor ID
+ * @param Type value type
+ */
+void SendZero(uint8_t Sensor, uint8_t Type) {
 
-  #ifdef RGB
-    present(DIMMER_ID, S_RGB_LIGHT, "RGB"); wait(PRESENTATION_DELAY);
-  #endif
+  MyMessage Msg(Sensor, Type);
 
-  #ifdef RGBW
-    present(DIMMER_ID, S_RGBW_LIGHT, "RGBW");   wait(PRESENTATION_DELAY);
-  #endif
+  send(Msg.set(0));
+}
 
-  // DIGITAL INPUT
-  #ifdef INPUT_1
-    present(INPUT_ID_1, S_BINARY, "Input 1");   wait(PRESENTATION_DELAY);
-  #endif
+/**
+ * @brief Sends current state of relay or input
+ * 
+ * @param Sensor sensor ID
+ * @param Type value type
+ */
+void SendIOState(uint8_t Sensor, uint8_t Type) {
 
-  #ifdef INPUT_2
-    present(INPUT_ID_2, S_BINARY, "Input 2");   wait(PRESENTATION_DELAY);
-  #endif
+  send(MsgSTATUS.setSensor(Sensor).set(CommonIO[Sensor].NewState));
+}
 
-  #ifdef INPUT_3
-    present(INPUT_ID_3, S_BINARY, "Input 3");   wait(PRESENTATION_DELAY);
-  #endif
+/**
+ * @brief Sends 0 W as initial value of power sensor
+ * 
+ * @param Sensor sensor ID
+ * @param Type value type
+ */
+void SendPower(uint8_t Sensor, uint8_t Type) {
 
-  #ifdef INPUT_4
-    present(INPUT_ID_4, S_BINARY, "Input 4");   wait(PRESENTATION_DELAY);
-  #endif
+  send(MsgWATT.setSensor(Sensor).set("0"));
+}
 
-  #ifdef SPECIAL_BUTTON
-    present(SPECIAL_BUTTON_ID, S_BINARY, "Longpress-1"); wait(PRESENTATION_DELAY);
-    present(SPECIAL_BUTTON_ID+1, S_BINARY, "Longpress-2"); wait(PRESENTATION_DELAY);
-  #endif
+/**
+ * @brief Sends energy counter of a power sensor
+ * 
+ * @param Sensor sensor ID
+ * @param Type value type
+ */
+void SendEnergy(uint8_t Sensor, uint8_t Type) {
 
-  // POWER SENSOR
-  #if defined(POWER_SENSOR) && !defined(FOUR_RELAY)
-    present(PS_ID, S_POWER, "Power Sensor");    wait(PRESENTATION_DELAY);
-  #elif defined(POWER_SENSOR) && defined(FOUR_RELAY)
-    present(PS_ID_1, S_POWER, "Power Sensor 1");    wait(PRESENTATION_DELAY);
-    present(PS_ID_2, S_POWER, "Power Sensor 2");    wait(PRESENTATION_DELAY);
-    present(PS_ID_3, S_POWER, "Power Sensor 3");    wait(PRESENTATION_DELAY);
-    present(PS_ID_4, S_POWER, "Power Sensor 4");    wait(PRESENTATION_DELAY);
-  #endif
+  send(FormatEnergy(MsgKWH.setSensor(Sensor), Sensor - ModuleProfile::PowerSensorId(0)));
+}
+
+/**
+ * @brief Sends current board temperature
+ * 
+ * @param Sensor sensor ID
+ * @param Type value type
+ */
+void SendInternalTemp(uint8_t Sensor, uint8_t Type) {
 
-  // Internal Thermometer
   #ifdef INTERNAL_TEMP
-    present(IT_ID, S_TEMP, "Internal Thermometer"); wait(PRESENTATION_DELAY);
+    send(MsgTEMP.setSensor(Sensor).set(MeasureT(ReadVcc()) / 10));
   #endif
+}
+
+/**
+ * @brief Sends current readings of external thermometer & hygrometer
+ * 
+ * @param Sensor sensor ID
+ * @param Type value type
+ */
+void SendExternalTemp(uint8_t Sensor, uint8_t Type) {
 
-  // External Thermometer
   #ifdef EXTERNAL_TEMP
-    present(ETT_ID, S_TEMP, "External Thermometer"); wait(PRESENTATION_DELAY);
-    present(ETH_ID, S_HUM, "External Hygrometer");  wait(PRESENTATION_DELAY);
+    ETTPolicy.Force();
+    ETHPolicy.Force();
+    ETUpdate();
   #endif
+}
 
-  // I2C
-
+/**
+ * @brief Sends initial text of debug & configuration sensors
+ * 
+ * @param Sensor sensor ID
+ * @param Type value type
+ */
+void SendInfo(uint8_t Sensor, uint8_t Type) {
 
-  // Error Reporting
-  #ifdef ERROR_REPORTING
-    #ifdef POWER_SENSOR
-      present(ES_ID, S_BINARY, "OVERCURRENT ERROR");    wait(PRESENTATION_DELAY);
-    #endif
-    #ifdef INTERNAL_TEMP
-      present(TS_ID, S_BINARY, "THERMAL ERROR");    wait(PRESENTATION_DELAY);
-    #endif
-    #ifdef EXTERNAL_TEMP
-      present(ETS_ID, S_BINARY, "ET STATUS");   wait(PRESENTATION_DELAY);
-    #endif
-  #endif
+  send(MsgTEXT.setSensor(Sensor).set(Sensor == CONFIGURATION_SENSOR_ID ? "CONFIG INIT" : "DEBUG MESSAGE"));
+}
 
-  #ifdef RS485_DEBUG
-    present(DEBUG_ID, S_INFO, "DEBUG INFO");
-  #endif
+#ifdef LOOP_PROFILING
+/**
+ * @brief Handles V_CUSTOM request of the debug sensor: sends data collected by the profiler as binary payload (see Profiler.h), clears them
+ * 
+ * @param message incoming message data
+ */
+void ProfilerRequest(const MyMessage &message)  {
 
-  // Configuration sensor
-  present(CONFIGURATION_SENSOR_ID, S_INFO, "TEXT Msg");
+  // Only explicit requests; an echo of the report (C_SET) must not clear the data
+  if(message.getCommand() != C_REQ) return;
 
+  Prof.Read(ProfData);
+  send(MsgCUSTOM.setSensor(DEBUG_ID).set(&ProfData, sizeof(ProfData)));
+  Prof.Reset();
 }
 
 /**
- * @brief Sends initial value of sensors as required by Home Assistant
+ * @brief Called by MySensors right after every watchdog reset (and by delay())
  * 
  */
-void InitConfirmation() {
+void yield()  {
 
-  // OUTPUT
-  #ifdef DOUBLE_RELAY
-    send(MsgSTATUS.setSensor(RELAY_ID_1).set(CommonIO[RELAY_ID_1].NewState));
-    request(RELAY_ID_1, V_STATUS);
-    wait(2000, C_SET, V_STATUS);
-
-    send(MsgSTATUS.setSensor(RELAY_ID_2).set(CommonIO[RELAY_ID_2].NewState));
-    request(RELAY_ID_2, V_STATUS);
-    wait(2000, C_SET, V_STATUS);
-  #endif
+  Prof.WatchdogReset();
+}
+
+/**
+ * @brief MySensors indication handler: counts failed transmissions
+ * 
+ * @param Indication indication type
+ */
+void indication(const indication_t Indication)  {
 
-  #ifdef ROLLER_SHUTTER
-    send(MsgUP.set(0));
-    request(SHUTTER_ID, V_UP);
-    wait(2000, C_SET, V_UP);
+  if(Indication == INDICATION_ERR_TX) {
+    Prof.SendFailed();
+  }
+}
+#endif
 
-    send(MsgDOWN.set(0));
-    request(SHUTTER_ID, V_DOWN);
-    wait(2000, C_SET, V_DOWN);
+/**
+ * @brief Handles V_STATUS of overcurrent error sensor: error reset by controller
+ * 
+ * @param message incoming message data
+ */
+void OvercurrentStatus(const MyMessage &message) {
 
-    send(MsgSTOP.set(0));
-    request(SHUTTER_ID, V_STOP);
-    wait(2000, C_SET, V_STOP);
+  for (int i = 0; i < 4; i++)  {
+    OVERCURRENT_ERROR[i] = message.getBool();
+  }
+  InformControllerES = false;
+}
 
-    send(MsgPERCENTAGE.setSensor(SHUTTER_ID).set(Shutter.Position));
-    request(SHUTTER_ID, V_PERCENTAGE);
-    wait(2000, C_SET, V_PERCENTAGE);
-  #endif
+/**
+ * @brief Handles V_STATUS of thermal error sensor: error reset by controller
+ * 
+ * @param message incoming message data
+ */
+void ThermalStatus(const MyMessage &message) {
 
-  #ifdef FOUR_RELAY
-    send(MsgSTATUS.setSensor(RELAY_ID_1).set(CommonIO[RELAY_ID_1].NewState));
-    request(RELAY_ID_1, V_STATUS);
-    wait(2000, C_SET, V_STATUS);
-    
-    send(MsgSTATUS.setSensor(RELAY_ID_2).set(CommonIO[RELAY_ID_2].NewState));
-    request(RELAY_ID_2, V_STATUS);
-    wait(2000, C_SET, V_STATUS);
-    
-    send(MsgSTATUS.setSensor(RELAY_ID_3).set(CommonIO[RELAY_ID_3].NewState));
-    request(RELAY_ID_3, V_STATUS);
-    wait(2000, C_SET, V_STATUS);
-    
-    send(MsgSTATUS.setSensor(RELAY_ID_4).set(CommonIO[RELAY_ID_4].NewState));
-    request(RELAY_ID_4, V_STATUS);
-    wait(2000, C_SET, V_STATUS);
-  #endif
+  THERMAL_ERROR = message.getBool();
+  if (THERMAL_ERROR == false)  {
+    InformControllerTS = false;
+  }
+}
 
-  #if defined(DIMMER) || defined(RGB) || defined(RGBW)
-    send(MsgSTATUS.setSensor(DIMMER_ID).set(false));
-    request(DIMMER_ID, V_STATUS);
-    wait(2000, C_SET, V_STATUS);
-    
-    send(MsgPERCENTAGE.setSensor(DIMMER_ID).set(Dimmer.NewDimmingLevel));
-    request(DIMMER_ID, V_PERCENTAGE);
-    wait(2000, C_SET, V_PERCENTAGE);
-  #endif
+/**
+ * @brief Handles V_TEXT of configuration sensor: configuration by message
+ * 
+ * @param message incoming message data
+ */
+void Configuration(const MyMessage &message) {
 
-  #ifdef RGB
-    send(MsgRGB.setSensor(DIMMER_ID).set("ffffff"));
-    request(DIMMER_ID, V_RGB);
-    wait(2000, C_SET, V_RGB);
-  #elif defined(RGBW)
-    send(MsgRGBW.setSensor(DIMMER_ID).set("ffffffff"));
-    request(DIMMER_ID, V_RGBW);
-    wait(2000, C_SET, V_RGBW);
-  #endif
+  // Initialize strings and pointers
+  char ReceivedPayload[10];
+  char *RPaddr = ReceivedPayload;
+  String RPstr = String(message.getString());
 
-  // DIGITAL INPUT
-  #ifdef INPUT_1
-    send(MsgSTATUS.setSensor(INPUT_ID_1).set(CommonIO[INPUT_ID_1].NewState));
-  #endif
+  // Turn String payload to char array and send back to the controller
+  RPstr.toCharArray(ReceivedPayload, 10);
+  send(MsgTEXT.setSensor(CONFIGURATION_SENSOR_ID).set(RPaddr));
 
-  #ifdef INPUT_2
-    send(MsgSTATUS.setSensor(INPUT_ID_2).set(CommonIO[INPUT_ID_2].NewState));
-  #endif
+  if(RPstr.equals(CONF_MSG_1)) {
+    // Roller shutter: calibration, runs in background
+    ModuleOutput::Calibrate();
+  }
+  else if(RPstr.equals(CONF_MSG_2)) {
+    // No effect
+  }
+  else if(RPstr.equals(CONF_MSG_3)) {
+    // Watchdog test procedure / module restart
+    delay(10000);
+  }
+  else if(RPstr.equals(CONF_MSG_4)) {
+    // Clear EEPROM and restart
+    for (int i=0;i<1024;i++) {
+      EEPROM.write(i,0xFF);
+    }
+    delay(10000);
+  }
+}
 
-  #ifdef INPUT_3
-    send(MsgSTATUS.setSensor(INPUT_ID_3).set(CommonIO[INPUT_ID_3].NewState));
-  #endif
+/***** Sensor Table *****/
+// Presentation names
+const char NameInput1[] PROGMEM = "Input 1";
+const char NameInput2[] PROGMEM = "Input 2";
+const char NameInput3[] PROGMEM = "Input 3";
+const char NameInput4[] PROGMEM = "Input 4";
+const char NameLongpress1[] PROGMEM = "Longpress-1";
+const char NameLongpress2[] PROGMEM = "Longpress-2";
+const char NamePowerSensor[] PROGMEM = "Power Sensor";
+const char NamePowerSensor1[] PROGMEM = "Power Sensor 1";
+const char NamePowerSensor2[] PROGMEM = "Power Sensor 2";
+const char NamePowerSensor3[] PROGMEM = "Power Sensor 3";
+const char NamePowerSensor4[] PROGMEM = "Power Sensor 4";
+const char NameInternalThermometer[] PROGMEM = "Internal Thermometer";
+const char NameExternalThermometer[] PROGMEM = "External Thermometer";
+const char NameExternalHygrometer[] PROGMEM = "External Hygrometer";
+const char NameOvercurrentError[] PROGMEM = "OVERCURRENT ERROR";
+const char NameThermalError[] PROGMEM = "THERMAL ERROR";
+const char NameETStatus[] PROGMEM = "ET STATUS";
+const char NameDebugInfo[] PROGMEM = "DEBUG INFO";
+const char NameConfiguration[] PROGMEM = "TEXT Msg";
+
+constexpr const char *InputNames[] = {NameInput1, NameInput2, NameInput3, NameInput4};
+constexpr const char *LongpressNames[] = {NameLongpress1, NameLongpress2};
+constexpr const char *PowerSensorNames[] = {NamePowerSensor, NamePowerSensor1, NamePowerSensor2, NamePowerSensor3, NamePowerSensor4};
+
+static_assert(ModuleProfile::Inputs::Count <= sizeof(InputNames) / sizeof(InputNames[0]), "Input without a name");
+static_assert(ModuleProfile::Buttons::Count <= sizeof(LongpressNames) / sizeof(LongpressNames[0]), "Button without a name");
+
+// Table parts: sensor ID, presentation, name, message type, receive() handler, initial state, request at startup
+// Digital inputs
+struct InputEntries {
+  static constexpr uint8_t Count = ModuleProfile::Inputs::Count;
+
+  static constexpr SensorEntry At(uint8_t i)  {
+    return {ModuleProfile::InputId(i), S_BINARY, InputNames[i], V_STATUS, nullptr, SendIOState, false};
+  }
+};
 
-  #ifdef INPUT_4
-    send(MsgSTATUS.setSensor(INPUT_ID_4).set(CommonIO[INPUT_ID_4].NewState));
-  #endif
+// Longpress of the buttons
+struct SpecialButtonEntries {
+  static constexpr uint8_t Count = ModuleProfile::Buttons::Count;
 
-  #ifdef SPECIAL_BUTTON
-    send(MsgSTATUS.setSensor(SPECIAL_BUTTON_ID).set(0));
-    send(MsgSTATUS.setSensor(SPECIAL_BUTTON_ID+1).set(0));
-  #endif
+  static constexpr SensorEntry At(uint8_t i)  {
+    return {ModuleProfile::SpecialButtonId(i), S_BINARY, LongpressNames[i], V_STATUS, nullptr, SendZero, false};
+  }
+};
 
-  // Built-in sensors
+// Power & energy of the power sensors
+struct PowerEntries {
   #ifdef POWER_SENSOR
-    #if !defined(FOUR_RELAY)
-      send(MsgWATT.setSensor(PS_ID).set("0"));
-    #elif defined(FOUR_RELAY)
-      for(int i=PS_ID_1; i<=PS_ID_4; i++)  {
-        send(MsgWATT.setSensor(i).set("0"));
-      }
-    #endif
+    static constexpr uint8_t Count = 2 * PowerSensors;
+  #else
+    static constexpr uint8_t Count = 0;
   #endif
 
+  static constexpr SensorEntry At(uint8_t i)  {
+    return i % 2 == 0 ? SensorEntry{ModuleProfile::PowerSensorId(i / 2), S_POWER,
+                                    PowerSensorNames[ModuleProfile::PowerSensors::Count > 1 ? i / 2 + 1 : 0], V_WATT, nullptr, SendPower, false} :
+                        SensorEntry{ModuleProfile::PowerSensorId(i / 2), S_POWER, nullptr, V_KWH, nullptr, SendEnergy, false};
+  }
+};
+
+// Thermometers, errors, debug & configuration
+constexpr SensorEntry BoardSensors[] PROGMEM = {
+  // Internal Thermometer
   #ifdef INTERNAL_TEMP
-    send(MsgTEMP.setSensor(IT_ID).set((int)AnalogTemp.MeasureT(ReadVcc())));
+    {IT_ID, S_TEMP, NameInternalThermometer, V_TEMP, nullptr, SendInternalTemp, false},
   #endif
 
-  // External sensors
+  // External Thermometer
   #ifdef EXTERNAL_TEMP
-    ETUpdate();
+    {ETT_ID, S_TEMP, NameExternalThermometer, V_TEMP, nullptr, SendExternalTemp, false},
+    {ETH_ID, S_HUM, NameExternalHygrometer, V_HUM, nullptr, nullptr, false},
   #endif
 
   // Error Reporting
   #ifdef ERROR_REPORTING
     #ifdef POWER_SENSOR
-      send(MsgSTATUS.setSensor(ES_ID).set(0));
+      {ES_ID, S_BINARY, NameOvercurrentError, V_STATUS, OvercurrentStatus, SendZero, false},
     #endif
     #ifdef INTERNAL_TEMP
-      send(MsgSTATUS.setSensor(TS_ID).set(0));
+      {TS_ID, S_BINARY, NameThermalError, V_STATUS, ThermalStatus, SendZero, false},
     #endif
     #ifdef EXTERNAL_TEMP
-      send(MsgSTATUS.setSensor(ETS_ID).set(0));
+      {ETS_ID, S_BINARY, NameETStatus, V_STATUS, nullptr, SendZero, false},
     #endif
   #endif
 
   #ifdef RS485_DEBUG
-    send(MsgDEBUG.setSensor(DEBUG_ID).set("DEBUG MESSAGE"));
+    {DEBUG_ID, S_INFO, NameDebugInfo, V_TEXT, nullptr, SendInfo, false},
+    #ifdef LOOP_PROFILING
+      {DEBUG_ID, S_INFO, nullptr, V_CUSTOM, ProfilerRequest, nullptr, false},
+    #endif
   #endif
 
-  send(MsgTEXT.setSensor(CONFIGURATION_SENSOR_ID).set("CONFIG INIT"));
+  // Configuration sensor
+  {CONFIGURATION_SENSOR_ID, S_INFO, NameConfiguration, V_TEXT, Configuration, SendInfo, false}
+};
+
+typedef SensorParts<ModuleOutput, InputEntries, SpecialButtonEntries, PowerEntries,
+                    SensorArray<BoardSensors, sizeof(BoardSensors) / sizeof(BoardSensors[0])>> ModuleSensors;
+typedef SensorTable<ModuleSensors> SensorList;
+
+/**
+ * @brief Presents module to the controller, send name, software version, info about sensors
+ * 
+ */
+void presentation() {
+
+  sendSketchInfo(F(SN), F(SV));
+
+  // At startup sensors are presented only if the controller doesn't know this manifest, see loop()
+  if(Presentation.Check(SensorList::Hash(HashString_P(HashString_P(FNV_OFFSET, PSTR(SN)), PSTR(SV))))) return;
+
+  SensorList::Present(PRESENTATION_DELAY);
+  Presentation.Presented();
+}
+
+/**
+ * @brief Requests sensor value from controller without waiting for the reply; the reply is handled by receive()
+ * 
+ * @param Sensor sensor ID
+ * @param Type value type
+ */
+void SyncRequest(uint8_t Sensor, uint8_t Type) {
+
+  request(Sensor, Type);
+  SyncPending++;
+}
+
+/**
+ * @brief Finishes startup synchronization when all requested values arrived or INIT_SYNC_TIMEOUT passed; reports boot-to-ready time
+ * 
+ */
+void SyncUpdate() {
+
+  if(SyncComplete)  return;
+
+  SyncComplete = true;
+  send(MsgREADY.set(millis()));
+}
+
+/**
+ * @brief Sends initial value of sensors as required by Home Assistant
+ * 
+ */
+void InitConfirmation() {
+
+  SensorList::Confirm(SyncRequest);
 
   InitConfirm = true;
+
+  if(SyncPending > 0)  {
+    Sched.RunIn(SyncTask, INIT_SYNC_TIMEOUT);
+  }
+  else  {
+    Sched.RunNow(SyncTask);
+  }
 }
 
 
@@ -472,140 +1181,41 @@ void InitConfirmation() {
  * @param message incoming message data
  */
 void receive(const MyMessage &message)  {
-  
-  if (message.type == V_STATUS) {
-    #if defined(POWER_SENSOR) && defined(ERROR_REPORTING)
-      if (message.sensor == ES_ID)  {
-        for (int i = 0; i < 4; i++)  {
-          OVERCURRENT_ERROR[i] = message.getBool();
-        }
-        InformControllerES = false;
-      }
-    #endif
-    #if defined(INTERNAL_TEMP) && defined(ERROR_REPORTING)
-      if (message.sensor == TS_ID)  {
-        THERMAL_ERROR = message.getBool();
-        if (THERMAL_ERROR == false)  {
-          InformControllerTS = false;
-        }
-      }
-    #endif
-    #ifdef SPECIAL_BUTTON
-      if (message.sensor == SPECIAL_BUTTON_ID || message.sensor == SPECIAL_BUTTON_ID+1)  {
-        // Ignore this message
-      }
-    #endif
-    #if defined(DIMMER) || defined(RGB) || defined(RGBW)
-      if (message.sensor == DIMMER_ID) {
-        Dimmer.ChangeState(message.getBool());
-      }
-    #endif
-    #if defined(DOUBLE_RELAY)
-      if (message.sensor == RELAY_ID_1 || message.sensor == RELAY_ID_2)  {
-        if (!OVERCURRENT_ERROR[0] && !THERMAL_ERROR) {
-          CommonIO[message.sensor].SetState(message.getBool());
-          CommonIO[message.sensor].SetRelay();
-        }
-      }
-    #endif
-    #ifdef FOUR_RELAY
-      if (message.sensor >= RELAY_ID_1 && message.sensor < NUMBER_OF_RELAYS) {
-        for (int i = RELAY_ID_1; i < RELAY_ID_1 + NUMBER_OF_RELAYS; i++) {
-          if (message.sensor == i) {
-            if (!OVERCURRENT_ERROR[i] && !THERMAL_ERROR) {
-              CommonIO[message.sensor].NewState = message.getBool();
-              CommonIO[message.sensor].SetRelay();
-            }
-          }
-        }
-      }
-    #endif
-  }
-  else if (message.type == V_PERCENTAGE) {
-    #ifdef ROLLER_SHUTTER
-      if(message.sensor == SHUTTER_ID) {
-        int NewPosition = atoi(message.data);
-        NewPosition = NewPosition > 100 ? 100 : NewPosition;
-        NewPosition = NewPosition < 0 ? 0 : NewPosition;
-        Shutter.NewState = 2;
-        ShutterUpdate(0);
-        MovementTime = Shutter.ReadNewPosition(NewPosition) * 10;
-      }
-    #endif
-    #if defined(DIMMER) || defined(RGB) || defined(RGBW)
-      if(message.sensor == DIMMER_ID) {
-        Dimmer.NewDimmingLevel = atoi(message.data);
-        Dimmer.NewDimmingLevel = Dimmer.NewDimmingLevel > 100 ? 100 : Dimmer.NewDimmingLevel;
-        Dimmer.NewDimmingLevel = Dimmer.NewDimmingLevel < 0 ? 0 : Dimmer.NewDimmingLevel;
-      }
-    #endif
-  }
-  else if (message.type == V_RGB || message.type == V_RGBW) {
-    #if defined(RGB) || defined(RGBW)
-      if(message.sensor == DIMMER_ID) {
-        const char *rgbvalues = message.getString();
 
-        Dimmer.NewColorValues(rgbvalues);
-      }
-    #endif
-  }
-  else if(message.type == V_UP) {
-    #ifdef ROLLER_SHUTTER
-      if(message.sensor == SHUTTER_ID) {
-        MovementTime = Shutter.ReadMessage(0) * 1000;
-      }
-    #endif
-  }
-  else if(message.type == V_DOWN) {
-    #ifdef ROLLER_SHUTTER
-      if(message.sensor == SHUTTER_ID) {
-        MovementTime = Shutter.ReadMessage(1) * 1000;
-      }
-    #endif
-  }
-  else if(message.type == V_STOP) {
-    #ifdef ROLLER_SHUTTER
-      if(message.sensor == SHUTTER_ID) {
-        MovementTime = Shutter.ReadMessage(2);
-      }
-    #endif
-  }
-  else if(message.type == V_TEXT) {
-    // Configuration by message
-    if(message.sensor == CONFIGURATION_SENSOR_ID)  {
-      
-      // Initialize strings and pointers
-      char ReceivedPayload[10];
-      char *RPaddr = ReceivedPayload;
-      String RPstr = String(message.getString());
-
-      // Turn String payload to char array and send back to the controller
-      RPstr.toCharArray(ReceivedPayload, 10);
-      send(MsgTEXT.setSensor(CONFIGURATION_SENSOR_ID).set(RPaddr));
-
-      if(RPstr.equals(CONF_MSG_1)) {
-        #ifdef ROLLER_SHUTTER
-          // Roller shutter: calibration
-          float Vcc = ReadVcc();
-          ShutterCalibration(Vcc);
-        #endif
-      }
-      else if(RPstr.equals(CONF_MSG_2)) {
-        // No effect
-      }
-      else if(RPstr.equals(CONF_MSG_3)) {
-        // Watchdog test procedure / module restart
-        delay(10000);
-      }
-      else if(RPstr.equals(CONF_MSG_4)) {
-        // Clear EEPROM and restart
-        for (int i=0;i<1024;i++) {
-          EEPROM.write(i,0xFF);
-        }
-        delay(10000);
-      }
+  // Manifest hash stored by the controller
+  if(Presentation.Receive(message)) return;
+
+  // Reply to a startup request
+  if (!SyncComplete && SyncPending > 0 && message.getCommand() == C_SET && message.sensor != CONFIGURATION_SENSOR_ID) {
+    if (--SyncPending == 0)  {
+      Sched.RunNow(SyncTask);
     }
   }
+
+  SensorList::Dispatch(message);
+}
+
+/**
+ * @brief Reports external thermometer & hygrometer readings allowed by their report policies
+ * 
+ * @param Temperature measured temperature (C)
+ * @param Humidity measured humidity (%)
+ */
+void ETReport(float Temperature, float Humidity)  {
+
+  #ifdef EXTERNAL_TEMP
+    uint32_t Now = millis();
+
+    if(ETTPolicy.Update(Temperature, Now))  {
+      Report(MsgTEMP.setSensor(ETT_ID).setDestination(0).set(ETTPolicy.Value(), 1));
+      #ifdef HEATING_SECTION_SENSOR
+        Report(MsgTEMP.setSensor(ETT_ID).setDestination(MY_HEATING_CONTROLLER).set(ETTPolicy.Value(), 1));
+      #endif
+    }
+    if(ETHPolicy.Update(Humidity, Now)) {
+      Report(MsgHUM.setSensor(ETH_ID).set(ETHPolicy.Value(), 1));
+    }
+  #endif
 }
 
 /**
@@ -619,49 +1229,41 @@ void ETUpdate()  {
       int chk = DHT.read22(ET_PIN);
       switch (chk)  {
         case DHTLIB_OK:
-          send(MsgTEMP.setSensor(ETT_ID).setDestination(0).set(DHT.temperature, 1));
-          send(MsgHUM.setSensor(ETH_ID).set(DHT.humidity, 1));
-          #ifdef HEATING_SECTION_SENSOR
-            send(MsgTEMP.setSensor(ETT_ID).setDestination(MY_HEATING_CONTROLLER).set(DHT.temperature, 1));
-          #endif
+          ETReport(DHT.temperature, DHT.humidity);
           #ifdef ERROR_REPORTING
             if (ET_ERROR != 0) {
               ET_ERROR = 0;
-              send(MsgSTATUS.setSensor(ETS_ID).set(ET_ERROR));
+              Report(MsgSTATUS.setSensor(ETS_ID).set(ET_ERROR));
             }
           #endif
         break;
         case DHTLIB_ERROR_CHECKSUM:
           #ifdef ERROR_REPORTING
             ET_ERROR = 1;
-            send(MsgSTATUS.setSensor(ETS_ID).set(ET_ERROR));
+            Report(MsgSTATUS.setSensor(ETS_ID).set(ET_ERROR));
           #endif
         break;
         case DHTLIB_ERROR_TIMEOUT:
           #ifdef ERROR_REPORTING
             ET_ERROR = 2;
-            send(MsgSTATUS.setSensor(ETS_ID).set(ET_ERROR));
+            Report(MsgSTATUS.setSensor(ETS_ID).set(ET_ERROR));
           #endif
         break;
         default:
           #ifdef ERROR_REPORTING
             ET_ERROR = 3;
-            send(MsgSTATUS.setSensor(ETS_ID).set(ET_ERROR));
+            Report(MsgSTATUS.setSensor(ETS_ID).set(ET_ERROR));
           #endif
         break;
       }
     #elif defined(SHT30)
       if(sht.readSample())  {
-        send(MsgTEMP.setSensor(ETT_ID).setDestination(0).set(sht.getTemperature(), 1));
-        send(MsgHUM.setSensor(ETH_ID).set(sht.getHumidity(), 1));
-        #ifdef HEATING_SECTION_SENSOR
-          send(MsgTEMP.setSensor(ETT_ID).setDestination(MY_HEATING_CONTROLLER).set(sht.getTemperature(), 1));
-        #endif
+        ETReport(sht.getTemperature(), sht.getHumidity());
       }
       else  {
         #ifdef ERROR_REPORTING
           ET_ERROR = 1;
-          send(MsgSTATUS.setSensor(ETS_ID).set(ET_ERROR));
+          Report(MsgSTATUS.setSensor(ETS_ID).set(ET_ERROR));
         #endif
       }
     #endif
@@ -675,10 +1277,12 @@ void ETUpdate()  {
 void UpdateIO() {
 
   int FirstSensor = 0;
-  int Iterations = NUMBER_OF_RELAYS+NUMBER_OF_INPUTS;
+  int Iterations = ModuleProfile::IOs;
 
   if(Iterations <= 0)  return;
 
+  PROFILE_START(PROF_UPDATE_IO);
+
   for (int i = FirstSensor; i < FirstSensor + Iterations; i++)  {
     CommonIO[i].CheckInput(LONGPRESS_DURATION, DEBOUNCE_VALUE);
 
@@ -698,60 +1302,18 @@ void UpdateIO() {
         break;
       case 3:
         // Button input
-        #ifdef DIMMER_ID
-          if(i == 0)  {
-            if(CommonIO[i].NewState != 2) {
-              // Change dimmer state
-              Dimmer.ChangeState(!Dimmer.CurrentState);
-              send(MsgSTATUS.setSensor(DIMMER_ID).set(Dimmer.CurrentState));
-              CommonIO[i].State = CommonIO[i].NewState;
-            }
-            if(CommonIO[i].NewState == 2) {
-              #ifdef SPECIAL_BUTTON
-                send(MsgSTATUS.setSensor(SPECIAL_BUTTON_ID).set(true));
-              #endif
-              CommonIO[i].NewState = CommonIO[i].State;
-            }
-          }
-          else if(i == 1) {
-            if(CommonIO[i].NewState != 2)  {
-              if(!Dimmer.CurrentState) continue;
-                    
-              // Toggle dimming level by DIMMING_TOGGLE_STEP
-              Dimmer.NewDimmingLevel += DIMMING_TOGGLE_STEP;
-              Dimmer.NewDimmingLevel = Dimmer.NewDimmingLevel > 100 ? DIMMING_TOGGLE_STEP : Dimmer.NewDimmingLevel;
-              send(MsgPERCENTAGE.setSensor(DIMMER_ID).set(Dimmer.NewDimmingLevel));
-              CommonIO[i].NewState = CommonIO[i].State;
-            }
-          }
-        #endif
-        #ifdef ROLLER_SHUTTER
-          if(CommonIO[i].NewState != 2)  {
-            MovementTime = Shutter.ReadButtons(i) * 1000;
-            CommonIO[i].State = CommonIO[i].NewState;
-          }
-          else  {
-            #ifdef SPECIAL_BUTTON
-              send(MsgSTATUS.setSensor(SPECIAL_BUTTON_ID).set(true));
-            #endif
-            CommonIO[i].NewState = CommonIO[i].State;
-          }
-        #endif
+        ModuleOutput::Button(i);
         break;
       case 4:
         // Button input + Relay output
         if (CommonIO[i].NewState != 2)  {
-          if (OVERCURRENT_ERROR[0] || THERMAL_ERROR)  continue;
+          if (OVERCURRENT_ERROR[ModuleProfile::PowerSensorOf(i)] || THERMAL_ERROR)  continue;
 
           CommonIO[i].SetRelay();
           send(MsgSTATUS.setSensor(i).set(CommonIO[i].NewState));
         }
         else if (CommonIO[i].NewState == 2)  {
-          #ifdef SPECIAL_BUTTON
-            uint8_t SensorID = i == 0 ? SPECIAL_BUTTON_ID : SPECIAL_BUTTON_ID+1;
-            send(MsgSTATUS.setSensor(SensorID).set(true));
-          #endif
-          
+          send(MsgSTATUS.setSensor(ModuleProfile::SpecialButtonId(i)).set(true));
           CommonIO[i].NewState = CommonIO[i].State;
         }
         break;
@@ -760,375 +1322,357 @@ void UpdateIO() {
         break;
     }
   }
+
+  PROFILE_END(PROF_UPDATE_IO);
 }
 
 /**
- * @brief Measures shutter movement duration; calls class Calibration() function to save measured durations
+ * @brief Scheduled task: writes pending journal record byte by byte without waiting for the EEPROM
  * 
- * @param Vcc current uC voltage
  */
-void ShutterCalibration(float Vcc)  {
-
-  #ifdef ROLLER_SHUTTER
-
-  float Current = 0;
-  uint32_t DownTimeCumulated = 0;
-  uint32_t UpTimeCumulated = 0;
-  uint32_t StartTime = 0;
-  uint32_t StopTime = 0;
-  uint32_t MeasuredTime = 0;
+void JournalUpdate()  {
 
-  // Opening the shutter  
-  Shutter.NewState = 0;
-  Shutter.Movement();
+  bool Pending = false;
 
-  do  {
-    delay(500);
-    wdt_reset();
-    Current = PS.MeasureAC(Vcc);
-  } while(Current > PS_OFFSET);
-
-  Shutter.NewState = 2;
-  Shutter.Movement();
+  PROFILE_START(PROF_EEPROM);
 
-  delay(1000);
+  Pending |= ModuleOutput::Commit();
+  #ifdef POWER_SENSOR
+    Pending |= EnergyJournal.Commit();
+  #endif
 
-  // Calibrating
-  for(int i=0; i<CALIBRATION_SAMPLES; i++) {
-    for(int j=1; j>=0; j--)  {
-      Shutter.NewState = j;
-      Shutter.Movement();
-      StartTime = millis();
+  PROFILE_END(PROF_EEPROM);
 
-      do  {
-        delay(250);
-        Current = PS.MeasureAC(Vcc);
-        StopTime = millis();
-        wdt_reset();
-      } while(Current > PS_OFFSET);
+  if(Pending)  {
+    Sched.RunIn(JournalTask, JOURNAL_WRITE_TIME);
+  }
+}
 
-      Shutter.NewState = 2;
-      Shutter.Movement();
+/**
+ * @brief Informs controller about power sensor readings
+ * 
+ * @param Current current measured by sensor (mA)
+ * @param Sensor power sensor index
+ */
+void PSUpdate(uint16_t Current, uint8_t Sensor = 0)  {
 
-      MeasuredTime = StopTime - StartTime;
+  #ifdef POWER_SENSOR
+    if(!PSPolicy[Sensor].Update(Current, millis()))  return;
 
-      if(j) {
-        DownTimeCumulated += (int)(MeasuredTime / 1000);
-      }
-      else  {
-        UpTimeCumulated += (int)(MeasuredTime / 1000);
-      }
+    uint16_t Power = (CalculatePower(PSPolicy[Sensor].Value()) + 500) / 1000;
 
-      delay(1000);
-    }
-  }
+    Report(MsgWATT.setSensor(ModuleProfile::PowerSensorId(Sensor)).set(Power));
+  #endif
+}
 
-  Shutter.Position = 0;
+/**
+ * @brief Calculates power consumed by the receiver
+ * 
+ * @param Current current measured by sensor (mA)
+ * @return uint32_t power (mW)
+ */
+uint32_t CalculatePower(uint16_t Current)  {
 
-  uint8_t DownTime = (int)(DownTimeCumulated / CALIBRATION_SAMPLES);
-  uint8_t UpTime = (int)(UpTimeCumulated / CALIBRATION_SAMPLES);
+  return ((uint32_t)Current * RECEIVER_VOLTAGE * CosFi) >> 8;
+}
 
-  Shutter.Calibration(UpTime+1, DownTime+1);
+/**
+ * @brief Adds energy consumed since the last measurement to the counter of a power sensor
+ * 
+ * @param Current current measured by sensor (mA)
+ * @param Elapsed time since the last measurement (ms)
+ * @param Sensor power sensor index
+ */
+void IntegrateEnergy(uint16_t Current, uint16_t Elapsed, uint8_t Sensor = 0)  {
 
-  EEPROM.put(EEA_SHUTTER_TIME_DOWN, DownTime);
-  EEPROM.put(EEA_SHUTTER_TIME_UP, UpTime);
-  EEPROM.put(EEA_SHUTTER_POSITION, Shutter.Position);
+  #ifdef POWER_SENSOR
+    uint32_t Power = CalculatePower(Current);
+    // Power * Elapsed (mW * ms) would overflow above ~4.3 kW; whole watts are integrated in mWs, the mW rest in mW * ms
+    uint32_t Fraction = (Power % 1000) * Elapsed + EnergyFraction[Sensor];
 
-  // Inform Controller about the current state of roller shutter
-  send(MsgSTOP);
-  send(MsgPERCENTAGE.setSensor(SHUTTER_ID).set(Shutter.Position));
-  #ifdef RS485_DEBUG
-    send(MsgDEBUG.set("DownTime ; UpTime"));
-    send(MsgCUSTOM.set(DownTime)); send(MsgCUSTOM.set(UpTime));
-  #endif
+    EnergyFraction[Sensor] = Fraction % 1000;
+    EnergyRest[Sensor] += (Power / 1000) * Elapsed + Fraction / 1000;
 
+    if(EnergyRest[Sensor] >= 3600000UL)  {
+      Energy.Wh[Sensor] += EnergyRest[Sensor] / 3600000UL;
+      EnergyRest[Sensor] %= 3600000UL;
+    }
   #endif
-    
 }
 
 /**
- * @brief Updates shutter condition, informs controller about shutter condition and position
+ * @brief Formats energy counter of a power sensor as kWh with 3 decimals
  * 
+ * @param Msg message to be filled
+ * @param Sensor power sensor index
+ * @return MyMessage& filled message
  */
-void ShutterUpdate(float Current) {
+MyMessage &FormatEnergy(MyMessage &Msg, uint8_t Sensor)  {
 
-  #ifdef ROLLER_SHUTTER
+  #ifdef POWER_SENSOR
+    char Text[14];
 
-  uint32_t StopTime = 0;
-  uint32_t MeasuredTime;
-  uint8_t TempState = 2;
-  bool Direction;
+    snprintf(Text, sizeof(Text), "%lu.%03u", (unsigned long)(Energy.Wh[Sensor] / 1000), (uint16_t)(Energy.Wh[Sensor] % 1000));
+    Msg.set(Text);
+  #endif
 
-  if(Shutter.State != 2) {
-    if((millis() >= StartTime + MovementTime) || (Current < PS_OFFSET)) {
-      StopTime = millis();
-    }
-    else if(millis() < StartTime)  {
-      uint32_t Temp = 4294967295 - StartTime + millis();
-      wait(MovementTime - Temp);
-      StartTime = 0;
-      StopTime = MovementTime;
-    }
-  }
+  return Msg;
+}
 
-  if(Shutter.State != Shutter.NewState) {
-    if(Shutter.NewState != 2)  {
-      if(Shutter.State == 2)  {
-        ShutterStart();
-      }
-      else  {
-        TempState = Shutter.NewState;
-        StopTime = millis();
-      }
-    }
-    else  {
-      StopTime = millis();
+/**
+ * @brief Reports energy counters at ENERGY_INTERVAL and stores them in the journal
+ * 
+ */
+void EnergyUpdate()  {
+
+  #ifdef POWER_SENSOR
+    for(uint8_t i=0; i<PowerSensors; i++)  {
+      Report(FormatEnergy(MsgKWH.setSensor(ModuleProfile::PowerSensorId(i)), i));
     }
-  }
 
-  if(StopTime > 0)  {
-    Direction = Shutter.State;
-    Shutter.NewState = 2;
-    Shutter.Movement();
-    send(MsgSTOP.setSensor(SHUTTER_ID));
-
-    MeasuredTime = StopTime - StartTime;
-    Shutter.CalculatePosition(Direction, MeasuredTime);
-    EEPROM.put(EEA_SHUTTER_POSITION, Shutter.Position);
-  
-    send(MsgPERCENTAGE.setSensor(SHUTTER_ID).set(Shutter.Position));
-  
-    if(TempState != 2)  {
-      wait(500);
-      Shutter.NewState = TempState;
-      ShutterStart();
+    if(EnergyJournal.Put(Energy))  {
+      Sched.RunIn(JournalTask, JOURNAL_WRITE_TIME);
     }
-  }
   #endif
 }
 
-void ShutterStart() {
 
-  #ifdef ROLLER_SHUTTER
+/**
+ * @brief Measures uC supply voltage
+ * 
+ * @return uint16_t measured voltage in mV
+ */
+uint16_t ReadVcc() {
 
-  Shutter.Movement();
-  StartTime = millis();
+  return Sampler.Vcc(VccChannel);
+}
 
-  Shutter.NewState == 0 ? send(MsgUP.setSensor(SHUTTER_ID)) : send(MsgDOWN.setSensor(SHUTTER_ID));
+/**
+ * @brief Calculates AC current from the last sampling window of a power sensor
+ * 
+ * @param Channel power sensor channel
+ * @param Vcc uC supply voltage (mV)
+ * @return uint16_t current (mA)
+ */
+uint16_t MeasureAC(uint8_t Channel, uint16_t Vcc) {
 
-  wait(500);
+  return (Sampler.RMS(Channel, Vcc) * 10000UL) / MVPerAmp;
+}
 
-  #endif
+/**
+ * @brief Calculates DC current from the last sampling window of a power sensor
+ * 
+ * @param Channel power sensor channel
+ * @param Vcc uC supply voltage (mV)
+ * @return uint16_t current (mA)
+ */
+uint16_t MeasureDC(uint8_t Channel, uint16_t Vcc) {
+
+  uint16_t Mean = Sampler.Mean(Channel, Vcc);
+  uint16_t Offset = Mean > Vcc / 2 ? Mean - Vcc / 2 : Vcc / 2 - Mean;
+
+  return (Offset * 10000UL) / MVPerAmp;
 }
 
+#ifdef INTERNAL_TEMP
 /**
- * @brief Informs controller about power sensor readings
+ * @brief Calculates board temperature from the last sampling window of the internal thermometer
  * 
- * @param Current current measured by sensor 
- * @param Sensor sensor ID if more than one sensor is attached
+ * @param Vcc uC supply voltage (mV)
+ * @return int16_t temperature (0.1 C)
  */
-void PSUpdate(float Current, uint8_t Sensor = 0)  {
-
-  if(Current == 0 && PS.OldValue == 0)  return;
-  else if(Current < 1 && (abs(PS.OldValue - Current) < 0.1)) return;
-  else if(Current >= 1 && (abs(PS.OldValue - Current) < (0.1 * PS.OldValue))) return;
-  
-  #if defined(POWER_SENSOR) && !defined(FOUR_RELAY)
-    send(MsgWATT.setSensor(PS_ID).set(PS.CalculatePower(Current, COSFI), 0));
-    PS.OldValue = Current;
-  #elif defined(POWER_SENSOR) && defined(FOUR_RELAY)
-    send(MsgWATT.setSensor(Sensor+4).set(PS[Sensor].CalculatePower(Current, COSFI), 0));
-    PS[Sensor].OldValue = Current;
-  #endif
+int16_t MeasureT(uint16_t Vcc) {
 
+  return ((int32_t)Sampler.Mean(ITChannel, Vcc) - ZEROVOLTAGE) * 100 / MVPerC;
 }
+#endif
 
 /**
- * @brief Measures uC supply voltage
+ * @brief ADC conversion complete interrupt; feeds the acquisition engine
  * 
- * @return long measured voltage in mV
  */
-long ReadVcc() {
-  
-  long result;
-  
-  // Read 1.1V reference against AVcc
-  ADMUX = _BV(REFS0) | _BV(MUX3) | _BV(MUX2) | _BV(MUX1);
-  
-  delay(2);
-  
-  ADCSRA |= _BV(ADSC); // Convert
-  
-  while (bit_is_set(ADCSRA,ADSC));
-  
-  result = ADCL;
-  result |= ADCH<<8;
-  result = 1126400L / result; // Back-calculate AVcc in mV
-  result = result;
-  
-  return result;
+ISR(ADC_vect) {
+
+  Sampler.Sample(ADC);
 }
 
 /**
- * @brief main loop: calls all 'Update' functions, runs all measurements, checks if safety parameters are within limits
+ * @brief Timer2 compare interrupt; fade engine tick of a dimmer output
  * 
  */
-void loop() {
+ISR(TIMER2_COMPA_vect) {
 
-  float Vcc = ReadVcc(); // mV
-  float Current = 0;
+  ModuleOutput::Tick();
+}
 
-  // Sending out states for the first time (as required by Home Assistant)
-  if (!InitConfirm)  {
-    InitConfirmation();
-  }
+/**
+ * @brief Runs all measurements, checks if safety parameters are within limits
+ * 
+ */
+void SafetyUpdate() {
 
-  // Reading power sensor(s)
-  #if defined(POWER_SENSOR) && !defined(FOUR_RELAY)
-    #if defined(DOUBLE_RELAY) || defined(ROLLER_SHUTTER)
-      if (digitalRead(RELAY_1) == RELAY_ON || digitalRead(RELAY_2) == RELAY_ON)  {
-        Current = PS.MeasureAC(Vcc);
-      }
-    #elif defined(DIMMER) || defined(RGB) || defined(RGBW)
-      if (Dimmer.CurrentState)  {
-        Current = PS.MeasureDC(Vcc);
-      }
-    #endif
-      
-    #ifdef ERROR_REPORTING
-      OVERCURRENT_ERROR[0] = PS.ElectricalStatus(Current);
-    #endif
-    
-    PSUpdate(Current);
+  uint32_t Now = millis();
+  // Longer gaps (e.g. blocking transport) are limited, so one reading doesn't stand for a long period
+  uint16_t Elapsed = Now - LastMeasurement < 1000 ? Now - LastMeasurement : 1000;
 
-  #elif defined(POWER_SENSOR) && defined(FOUR_RELAY)
-    for (int i = RELAY_ID_1; i < RELAY_ID_1 + NUMBER_OF_RELAYS; i++) {
-      if (CommonIO[i].State == RELAY_ON)  {
-        Current = PS[i].MeasureAC(Vcc);
-      }
-      else  {
-        Current = 0;
+  LastMeasurement = Now;
+  Vcc = ReadVcc(); // mV
+  Current = 0;
+
+  // Reading power sensor(s)
+  #ifdef POWER_SENSOR
+    for(uint8_t i=0; i<PowerSensors; i++) {
+      Current = 0;
+      if(ModuleOutput::Loaded(i))  {
+        PROFILE_START(PROF_MEASURE);
+        Current = ModuleProfile::Output::DC ? MeasureDC(PSChannel[i], Vcc) : MeasureAC(PSChannel[i], Vcc);
+        PROFILE_END(PROF_MEASURE);
       }
       #ifdef ERROR_REPORTING
-        OVERCURRENT_ERROR[i] = PS[i].ElectricalStatus(Current);
+        OVERCURRENT_ERROR[i] = Current > MaxCurrent;
       #endif
 
+      IntegrateEnergy(Current, Elapsed, i);
       PSUpdate(Current, i);
     }
+
+    // Shutter reached its end position
+    ModuleOutput::Measured(Current);
   #endif
 
-  // Current safety
+  // Current safety; ES_ID is shared by all channels, so it's reported once for all of them
   #if defined(ERROR_REPORTING) && defined(POWER_SENSOR)
-    #ifdef FOUR_RELAY
-      for (int i = RELAY_ID_1; i < RELAY_ID_1 + NUMBER_OF_RELAYS; i++)  {
-        if (OVERCURRENT_ERROR[i]) {
-          // Current to high
-          CommonIO[i].NewState = RELAY_OFF;
-          CommonIO[i].SetRelay();
-          send(MsgSTATUS.setSensor(i).set(CommonIO[i].NewState));
-          send(MsgSTATUS.setSensor(ES_ID).set(OVERCURRENT_ERROR[i]));
-          InformControllerES = true;
-        }
-        else if(!OVERCURRENT_ERROR[i] && InformControllerES) {
-          // Current normal (only after reporting error)
-          send(MsgSTATUS.setSensor(ES_ID).set(OVERCURRENT_ERROR[i]));
-          InformControllerES = false;
-        }
-      }
-    #else
-      if(OVERCURRENT_ERROR[0])  {
-        // Current to high
-        #ifdef DOUBLE_RELAY
-          for (int i = RELAY_ID_1; i < RELAY_ID_1 + NUMBER_OF_RELAYS; i++)  {
-            CommonIO[i].NewState = RELAY_OFF;
-            CommonIO[i].SetRelay();
-            send(MsgSTATUS.setSensor(i).set(CommonIO[i].NewState));
-          }
-        #elif defined(ROLLER_SHUTTER)
-          Shutter.NewState = 2;
-          ShutterUpdate(0);
-        #elif defined(DIMMER) || defined(RGB) || defined(RGBW)
-          //Dimmer.NewState = false;
-          Dimmer.ChangeState(false);
-          send(MsgSTATUS.setSensor(DIMMER_ID).set(Dimmer.CurrentState));
-        #endif
+    bool Overcurrent = false;
 
-        send(MsgSTATUS.setSensor(ES_ID).set(OVERCURRENT_ERROR[0]));
-        InformControllerES = true;
-      }
-      else if(!OVERCURRENT_ERROR[0] && InformControllerES)  {
-        // Current normal (only after reporting error)
-        send(MsgSTATUS.setSensor(ES_ID).set(OVERCURRENT_ERROR[0]));
-        InformControllerES = false;
+    for(uint8_t i=0; i<PowerSensors; i++)  {
+      if(OVERCURRENT_ERROR[i])  {
+        // Current to high
+        ModuleOutput::Cutoff(i);
+        Overcurrent = true;
       }
-    #endif
+    }
+
+    if(Overcurrent)  {
+      ReportError(MsgSTATUS.setSensor(ES_ID).set(true));
+      InformControllerES = true;
+    }
+    else if(InformControllerES)  {
+      // Current normal on all channels (only after reporting error)
+      ReportError(MsgSTATUS.setSensor(ES_ID).set(false));
+      InformControllerES = false;
+    }
   #endif
 
   // Reading internal temperature sensor
   #if defined(ERROR_REPORTING) && defined(INTERNAL_TEMP)
-    THERMAL_ERROR = AnalogTemp.ThermalStatus(AnalogTemp.MeasureT(Vcc));
+    THERMAL_ERROR = MeasureT(Vcc) > MAX_TEMPERATURE * 10;
   #endif
 
   // Thermal safety
   #if defined(ERROR_REPORTING) && defined(INTERNAL_TEMP)
     if (THERMAL_ERROR && !InformControllerTS) {
     // Board temperature to high
-      #ifdef DOUBLE_RELAY
-        for (int i = RELAY_ID_1; i < RELAY_ID_1 + NUMBER_OF_RELAYS; i++)  {
-          CommonIO[i].NewState = RELAY_OFF;
-          CommonIO[i].SetRelay();
-          send(MsgSTATUS.setSensor(i).set(CommonIO[i].NewState));
-        }
-      #elif defined(ROLLER_SHUTTER)
-        Shutter.NewState = 2;
-        ShutterUpdate(0);
-      #elif defined(DIMMER) || defined(RGB) || defined(RGBW)
-        //Dimmer.NewState = false;
-        Dimmer.ChangeState(false);
-        send(MsgSTATUS.setSensor(DIMMER_ID).set(Dimmer.CurrentState));
-      #endif
-      send(MsgSTATUS.setSensor(TS_ID).set(THERMAL_ERROR));
+      ModuleOutput::Cutoff(ALL_LOADS);
+      ReportError(MsgSTATUS.setSensor(TS_ID).set(THERMAL_ERROR));
       InformControllerTS = true;
-      CheckNow = true;
+      #ifdef INTERNAL_TEMP
+        ITPolicy.Force();
+      #endif
+      Sched.RunNow(IntervalTask);
     }
     else if (!THERMAL_ERROR && InformControllerTS) {
-      send(MsgSTATUS.setSensor(TS_ID).set(THERMAL_ERROR));
+      ReportError(MsgSTATUS.setSensor(TS_ID).set(THERMAL_ERROR));
       InformControllerTS = false;
     }
   #endif
+}
+
+/**
+ * @brief Queues a sensor report instead of sending it right away; see SendQueue.h
+ * 
+ * @param Msg message to be sent
+ */
+void Report(MyMessage &Msg) {
+
+  Queue.Push(Msg, false);
+  // A pending error report keeps its earlier deadline
+  Sched.RunBefore(SendTask, Queue.NextSlot());
+}
+
+/**
+ * @brief Queues a safety error report; sent before all other queued messages, regardless of the budget
+ * 
+ * @param Msg message to be sent
+ */
+void ReportError(MyMessage &Msg) {
+
+  Queue.Push(Msg, true);
+  Sched.RunNow(SendTask);
+}
+
+/**
+ * @brief Scheduled task: sends queued messages within the frame budget
+ * 
+ */
+void SendUpdate() {
+
+  PROFILE_START(PROF_SEND);
+
+  bool Pending = Queue.Flush();
 
-  // Reading inputs / activating outputs
-  if (NUMBER_OF_RELAYS + NUMBER_OF_INPUTS > 0) {
-    UpdateIO();
+  PROFILE_END(PROF_SEND);
+
+  if(Pending)  {
+    Sched.RunAt(SendTask, Queue.NextSlot());
   }
+}
+
+/**
+ * @brief Reads temperature & humidity sensors at SENSOR_INTERVAL, reports values allowed by their report policies
+ * 
+ */
+void IntervalUpdate() {
 
-  // Updating roller shutter
-  #ifdef ROLLER_SHUTTER
-    ShutterUpdate(Current);
+  #ifdef INTERNAL_TEMP
+    if(ITPolicy.Update(MeasureT(Vcc), millis()))  {
+      Report(MsgTEMP.setSensor(IT_ID).set(ITPolicy.Value() / 10));
+    }
   #endif
+  #ifdef EXTERNAL_TEMP
+    ETUpdate();
+  #endif
+}
 
-  #if defined(DIMMER) || defined(RGB) || defined(RGBW)
-    Dimmer.UpdateDimmer();
+/**
+ * @brief main loop: sends initial states, runs all tasks which are due, waits for the next one
+ * 
+ */
+void loop() {
+
+  #ifdef LOOP_PROFILING
+    Prof.LoopStart();
   #endif
 
-  // Reset LastUpdate if millis() has overflowed
-  if(LastUpdate > millis()) {
-    LastUpdate = millis();
-  }  
-  
-  // Checking out sensors which report at a defined interval
-  if ((millis() > LastUpdate + INTERVAL) || CheckNow == true)  {
-    #ifdef INTERNAL_TEMP
-      send(MsgTEMP.setSensor(IT_ID).set((int)AnalogTemp.MeasureT(Vcc)));
-    #endif
-    #ifdef EXTERNAL_TEMP
-      ETUpdate();
-    #endif
-    LastUpdate = millis();
-    CheckNow = false;
+  // Presentation deferred at startup: controller doesn't know this manifest or didn't reply
+  if(Presentation.Due())  {
+    SensorList::Present(PRESENTATION_DELAY);
+    Presentation.Presented();
+  }
+
+  // Sending out states for the first time (as required by Home Assistant)
+  if (!InitConfirm && Presentation.Synced())  {
+    InitConfirmation();
   }
 
-  wait(LOOP_TIME);
+  // Measurements, inputs, outputs & interval sensors
+  Sched.Run();
+
+  #ifdef LOOP_PROFILING
+    Prof.LoopEnd();
+  #endif
+
+  // Handling incoming messages until the next task is due
+  wait(Sched.TimeToNext(LOOP_TIME));
 }
 /*
 
@@ -77,7 +77,8 @@
 #define RS_INTERVAL 80                 // Time in seconds to turn off roller shutter after it was turned on (deafult 80)
 
 // Other
-#define LOOP_TIME 100                        // Main loop wait time (default 100)
+#define LOOP_TIME 100                        // Interval (ms) of reading inputs (default 100)
+#define ENABLE_IDLE_SLEEP                    // MCU sleeps in idle mode between interrupts, unused peripherals are powered down
 
 
 /* OUTPUT Config */
@@ -100,6 +101,9 @@
 /* EEPROM Addresses */
 #define SIZE_OF_BYTE 1
 #define EEPROM_OFFSET 512                         // First eeprom address to use (prior addresses are taken)
-#define EEA_RELAY_1 EEPROM_OFFSET+SIZE_OF_BYTE            // EEPROM addresses to save relay states
+#define EEA_RELAY_1 EEPROM_OFFSET+SIZE_OF_BYTE            // EEPROM addresses to save relay states (legacy, read if journal is empty)
 #define EEA_RELAY_2 EEA_RELAY_1+SIZE_OF_BYTE
+#define EEA_JOURNAL EEA_RELAY_2+SIZE_OF_BYTE              // EEPROM address of the relay states journal (3 bytes per slot)
+#define JOURNAL_SLOTS 64                          // Number of journal slots; every slot is written once per JOURNAL_SLOTS changes (default 64)
+#define JOURNAL_DELAY 3000                        // Time (ms) to collect changes before they are stored in EEPROM (default 3000)
 
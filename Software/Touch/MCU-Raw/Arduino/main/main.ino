@@ -22,9 +22,12 @@
 
 /***** INCLUDES *****/
 #include <avr/wdt.h>
+#include <avr/sleep.h>
+#include <avr/power.h>
 #include <EEPROM.h>
 #include "Configuration.h"
 #include <GoWired.h>
+#include "Journal.h"
 
 
 /***** Globals *****/
@@ -40,9 +43,13 @@ uint32_t LastCheck = 0;
 uint32_t RSTimer;
 bool RSReset = false;
 
+volatile bool InputChanged = false;         // Set by pin change of wired inputs, handled without waiting for LOOP_TIME
+
 uint16_t EPPROM_Address[2] = {EEA_RELAY_1, EEA_RELAY_2};
+uint32_t JournalTime = 0;                   // Time of the last change of remembered states
 
 /***** Constructors *****/
+Journal<uint8_t, JOURNAL_SLOTS> StatesJournal(EEA_JOURNAL);     // Remembered relay states, bit 0 - relay 1, bit 1 - relay 2
 CommonIO IO[NUMBER_OF_BUTTONS];
 
 Dimmer D[NUMBER_OF_BUTTONS];
@@ -108,12 +115,17 @@ void setup()  {
     if(!Monostable && !Shutter) {
       RememberStates = true;
       uint8_t RecoveredState;
-      for(int i=0; i<HardwareVariant; i++)  {
+      uint8_t States = 0;
+      // States saved by older software
+      for(int i=0; i<NUMBER_OF_BUTTONS; i++)  {
         EEPROM.get(EPPROM_Address[i], RecoveredState);
-        if(RecoveredState < 2)  {
-          IO[i].SetState(RecoveredState);
-        }
-      }      
+        States |= RecoveredState == 1 ? _BV(i) : 0;
+      }
+      // Newest journaled states
+      StatesJournal.Begin(States);
+      for(int i=0; i<LoadVariant; i++)  {
+        IO[i].SetState(States & _BV(i) ? 1 : 0);
+      }
     }
   }
 
@@ -177,11 +189,84 @@ void setup()  {
     }
   }
 
+  IdleInit();
+
   #ifdef ENABLE_WATCHDOG
     wdt_enable(WDTO_4S);
   #endif
 }
 
+/**
+ * @brief Prepares idle mode: powers down unused peripherals, enables wake up on wired inputs
+ * 
+ */
+void IdleInit()  {
+
+  #ifdef ENABLE_IDLE_SLEEP
+    // No communication: TWI, SPI & USART aren't used
+    power_twi_disable();
+    power_spi_disable();
+    power_usart0_disable();
+
+    // Analog comparator off
+    ACSR = _BV(ACD);
+
+    // Pin change of wired inputs (Power Board AC) wakes MCU up
+    if(HardwareVariant == 0)  {
+      const uint8_t InputPins[2] = {INPUT_PIN_1, INPUT_PIN_2};
+
+      for(int i=0; i<LoadVariant; i++)  {
+        volatile uint8_t *Control = digitalPinToPCICR(InputPins[i]);
+
+        // Not every pin has a pin change interrupt
+        if(!Control)  continue;
+        *digitalPinToPCMSK(InputPins[i]) |= _BV(digitalPinToPCMSKbit(InputPins[i]));
+        *Control |= _BV(digitalPinToPCICRbit(InputPins[i]));
+      }
+    }
+
+    // ADC is powered only while touch fields are read
+    ADCSRA &= ~_BV(ADEN);
+  #endif
+}
+
+/**
+ * @brief Sleeps in idle mode until the next interrupt: Timer0 tick (~1 ms) or pin change of wired inputs;
+ * timers keep running, so LED PWM and millis() are not affected
+ * 
+ */
+void IdleSleep()  {
+
+  #ifdef ENABLE_IDLE_SLEEP
+    set_sleep_mode(SLEEP_MODE_IDLE);
+
+    // Interrupts are enabled by the instruction following sei(), so a pin change can't slip in before sleep_cpu()
+    cli();
+    if(!InputChanged) {
+      sleep_enable();
+      sei();
+      sleep_cpu();
+      sleep_disable();
+    }
+    sei();
+  #endif
+}
+
+#ifdef ENABLE_IDLE_SLEEP
+/**
+ * @brief Pin change of wired inputs
+ * 
+ */
+ISR(PCINT0_vect)  {
+  InputChanged = true;
+}
+ISR(PCINT1_vect, ISR_ALIASOF(PCINT0_vect));
+ISR(PCINT2_vect, ISR_ALIASOF(PCINT0_vect));
+#ifdef PCINT3_vect
+  ISR(PCINT3_vect, ISR_ALIASOF(PCINT0_vect));
+#endif
+#endif
+
 /**
  * @brief performs a rainbow effect on active LEDs
  * 
@@ -276,39 +361,71 @@ void UpdateIO() {
         AdjustLEDs(IO[i].NewState, i);
       }
       // Saving state to eeprom
-      //EEPROM.put(EPPROM_Address[i], IO[i].NewState);
+      if(RememberStates)  {
+        StoreStates();
+      }
     }
   }
 }
 
 /**
- * @brief main loop: resets wdt, updates inputs & outputs
+ * @brief Stages relay states in the journal; stored after JOURNAL_DELAY, so quick subsequent touches result in one record
  * 
  */
-void loop() {
+void StoreStates()  {
 
-  #ifdef ENABLE_WATCHDOG
-    wdt_reset();
-  #endif
+  uint8_t States = 0;
 
-  // Check inputs & adjust outputs
-  if(millis() > LastCheck + LOOP_TIME)  {
-    LastCheck = millis();
-    UpdateIO();
+  for(int i=0; i<LoadVariant; i++)  {
+    States |= IO[i].NewState == 1 ? _BV(i) : 0;
   }
-  else if(millis() < LastCheck) {
-    LastCheck = millis();
+
+  if(StatesJournal.Put(States)) {
+    JournalTime = millis();
   }
+}
 
-  // Roller shutter timer  
-  if(Shutter == true) {
-    if((millis() > RSTimer + RS_INTERVAL) && RSReset)  {
-      for(int i=0; i<2; i++)  {
-        IO[i].SetState(0);
-        IO[i].SetRelay();
-        AdjustLEDs(false, i);
+/**
+ * @brief main loop: every LOOP_TIME or on pin change resets wdt, updates inputs & outputs; sleeps until the next interrupt
+ * 
+ */
+void loop() {
+
+  // Timer0 wakes MCU up every ~1 ms; these wakes go back to sleep right away
+  if(millis() - LastCheck >= LOOP_TIME || InputChanged)  {
+    LastCheck = millis();
+    InputChanged = false;
+
+    #ifdef ENABLE_WATCHDOG
+      wdt_reset();
+    #endif
+
+    // Check inputs & adjust outputs
+    #ifdef ENABLE_IDLE_SLEEP
+      ADCSRA |= _BV(ADEN);
+    #endif
+    UpdateIO();
+    #ifdef ENABLE_IDLE_SLEEP
+      ADCSRA &= ~_BV(ADEN);
+    #endif
+
+    // Deferred EEPROM writes; Commit() never waits for the EEPROM
+    if(RememberStates && millis() - JournalTime >= JOURNAL_DELAY)  {
+      StatesJournal.Commit();
+    }
+
+    // Roller shutter timer
+    if(Shutter == true) {
+      if(RSReset && millis() - RSTimer >= RS_INTERVAL * 1000UL)  {
+        for(int i=0; i<2; i++)  {
+          IO[i].SetState(0);
+          IO[i].SetRelay();
+          AdjustLEDs(false, i);
+        }
+        RSReset = false;
       }
-      RSReset = false;
     }
   }
+
+  IdleSleep();
 }
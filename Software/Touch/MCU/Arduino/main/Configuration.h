@@ -38,6 +38,7 @@
 
 // Other
 #define LP5009_ENABLE_PIN A3
+#define LP5009_ADDRESS 0x14                 // LP5009 I2C address (default 0x14)
 #define RS485_ENABLE_PIN 4
 
 // I2C
@@ -82,6 +83,10 @@
 #define DEBOUNCE_VALUE 100                   // Debounce time in ms (0 - no debounce, >0 active debounce, default 100, max. 255)
 #define LONGPRESS_DURATION 1000             // Duration of longpress in ms (default 1000, max. 65535)
 #define TOUCH_DIAG_TRESHOLD 10              // 
+#define TOUCH_DRIFT_LIMIT 5                 // Reference drift which makes an idle touch field take new reference (default 5)
+#define TOUCH_NOISE_FACTOR 4                // Touch threshold is at least this multiple of field noise (default 4)
+#define TOUCH_IDLE_TIME 2000                // Time (ms) a touch field has to be untouched before taking new reference (default 2000)
+#define TOUCH_STUCK_TIME 60000              // Touch field sensed as touched longer than this (ms) takes new reference (default 60000)
 
 // Power Sensor
 #define MAX_CURRENT 10                      // Maximum current the module can handle before reporting error (2SSR - 3; 4RelayDin - 10A or 16)
@@ -98,9 +103,11 @@
 // Roller Shutter
 //#define RS_AUTO_CALIBRATION                 // Roller shutter auto-calibration. Leave it defined or comment it out and define movement times manually
 #define PS_OFFSET 0.2                     // Power sensor offset for roller shutter calibration (default 0.2)
-#define CALIBRATION_SAMPLES 1             // Number of calibration samples for roller shutter calibration (default 2)
+#define CALIBRATION_SAMPLES 3             // Number of calibration passes (down & up) for roller shutter calibration; outliers are rejected (default 3)
 #define UP_TIME 21                        // Manually defined upward movement time in seconds (0-255)
 #define DOWN_TIME 20                      // Manually defined downward movement time in seconds (0-255)
+#define SHUTTER_DEADTIME 500              // Time (ms) both relays are off before movement direction is changed (default 500)
+#define SHUTTER_REPORT_INTERVAL 1000      // Interval (ms) of position reports during movement; 0 - report position after stop only (default 1000)
 
 // LP5009
 #define R_VALUE_OFF 0
@@ -114,8 +121,8 @@
 #define B_VALUE_INACTIVE 0
 #define BRIGHTNESS_VALUE_OFF 20
 #define BRIGHTNESS_VALUE_ON 40
-#define RAINBOW_DURATION 2000          // Duration of initial rainbow effect (0-65535, default 1000)
-#define RAINBOW_RATE 1                 // Rate of initial reainbow effect (0-255, default 1)
+#define RAINBOW_DURATION 2000          // Duration (ms) of rainbow effect at startup & on longpress (0-65535, default 1000)
+#define RAINBOW_RATE 1                 // Time (ms) per color step of rainbow effect (1-255, default 1)
 
 // Heating system section thermometer
 //#define HEATING_SECTION_SENSOR            // Define if this module if going to be a temperature sensor for a heating controller
@@ -124,11 +131,19 @@
 #endif
 
 // Other
-#define INTERVAL 300000                     // Interval value for reporting readings of the sensors: temperature, power usage (default 300000)
+#define INTERVAL 300000                     // Longest interval (ms) between reports of a sensor (heartbeat), touch diagnosis period (default 300000)
+#define SENSOR_INTERVAL 10000               // Interval (ms) of temperature & humidity readings (default 10000)
 //#define INIT_DELAY 200                      // A value to be multiplied by node ID value to obtain the time to wait during the initialization process
 #define PRESENTATION_DELAY 10               // Time (ms) to wait between subsequent presentation messages (default 10)
+#define PRESENTATION_TIMEOUT 2000           // Time (ms) to wait for manifest hash stored by controller before presenting all sensors (default 2000)
+#define INIT_SYNC_TIMEOUT 5000              // Time (ms) to wait for controller replies to all startup requests (default 5000)
 #define LOOP_TIME 80                        // Main loop wait time (default 100)
 
+// Report policies: absolute deadband, relative deadband (%), hysteresis, min interval (ms), max interval (ms), smoothing (EMA of ~2^n readings, 0 - off)
+#define PS_POLICY 0.1, 10, 0.02, 1000, INTERVAL, 0        // Power sensor current (A)
+#define ETT_POLICY 0.2, 0, 0.1, 30000, INTERVAL, 1        // External thermometer (C)
+#define ETH_POLICY 1.0, 0, 0.5, 30000, INTERVAL, 1        // External hygrometer (%)
+
 /***** Output Config *****/
 // IDs
 #define RELAY_ID_1 0
@@ -198,6 +213,11 @@
   #define DEBUG_ID 12
   // Reporting touch readings
   #define TOUCH_DIAGNOSTIC_ID 13
+  //#define LOOP_PROFILING                  // Collect loop() timing, send failures, watchdog margin & free RAM; sent on request of V_CUSTOM on DEBUG_ID
+#endif
+
+#ifdef LOOP_PROFILING
+  #define MY_INDICATION_HANDLER             // Failed transmissions counted in indication()
 #endif
 
 /***** Configuration by message *****/
@@ -209,6 +229,7 @@
 
 /***** EEPROM Definitions *****/
 #define SIZE_OF_BYTE 1
+#define SIZE_OF_LONG 4
 #define EEPROM_OFFSET 512                               // First eeprom address to use (prior addresses are taken)
 
 // Configuration parameters (version 1.0.0)
@@ -228,6 +249,8 @@
 #define EEA_SHUTTER_TIME_DOWN EEPROM_OFFSET                        // EEPROM address to save Shutter travel down time
 #define EEA_SHUTTER_TIME_UP EEA_SHUTTER_TIME_DOWN+SIZE_OF_BYTE     // EEPROM address to save Shutter travel up time
 #define EEA_SHUTTER_POSITION EEA_SHUTTER_TIME_UP+SIZE_OF_BYTE      // EEPROM address to save Shutter last known position
+#define EEA_SHUTTER_TRAVEL_DOWN EEA_SHUTTER_POSITION+SIZE_OF_BYTE   // EEPROM address to save Shutter travel down time in ms (uint32_t)
+#define EEA_SHUTTER_TRAVEL_UP EEA_SHUTTER_TRAVEL_DOWN+SIZE_OF_LONG  // EEPROM address to save Shutter travel up time in ms (uint32_t)
 
 #endif
 /*
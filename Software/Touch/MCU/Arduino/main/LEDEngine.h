@@ -0,0 +1,150 @@
+/*
+ * LEDEngine.h file
+ * Non-blocking LED effects for the LP5009 controller. LED colors & brightness set by the sketch form
+ * a base frame; a running effect is rendered over it from elapsed time, so it never blocks the loop
+ * and ends exactly after its duration, returning LEDs to the base frame.
+ *
+ * Registers are mirrored in RAM: Update() compares the new frame with what the chip holds and sends
+ * only the span from the first to the last changed register, as one auto-increment burst write
+ * (one I2C transaction per frame). Auto-increment is enabled after LP5009 reset (DEVICE_CONFIG1).
+ *
+ * LEDs are numbered 1-3 like in the LP50XX library (LED0 - LED2 registers).
+ *
+ */
+
+#ifndef LEDEngine_h
+#define LEDEngine_h
+
+#include <Wire.h>
+
+#define LP50XX_LED0_BRIGHTNESS 0x07
+#define LP50XX_OUT0_COLOR 0x0B
+#define LP50XX_BRIGHTNESS_RESET 0xFF        // Brightness registers reset value
+#define LED_ENGINE_LEDS 3                   // LP5009: 3 RGB LEDs
+#define LED_ENGINE_REGISTERS (LP50XX_OUT0_COLOR - LP50XX_LED0_BRIGHTNESS + 3 * LED_ENGINE_LEDS)
+#define LED_FRAME_TIME 20                   // Loop period (ms) while an effect runs
+
+class LEDEngine {
+
+  public:
+    /**
+     * @brief Constructor
+     *
+     * @param Address I2C address of LP5009
+     */
+    LEDEngine(uint8_t Address) : _Address(Address)  {
+      for(uint8_t i=0; i<LED_ENGINE_REGISTERS; i++) {
+        _Base[i] = i < LP50XX_OUT0_COLOR - LP50XX_LED0_BRIGHTNESS ? LP50XX_BRIGHTNESS_RESET : 0;
+        // Chip state unknown; the first Update() sends everything
+        _Chip[i] = ~_Base[i];
+      }
+    }
+
+    /**
+     * @brief Sets base color & brightness of a LED; sent by the next Update()
+     *
+     * @param LED LED number 1-3
+     * @param Brightness brightness 0-255
+     * @param R, G, B color components 0-255
+     */
+    void Set(uint8_t LED, uint8_t Brightness, uint8_t R, uint8_t G, uint8_t B)  {
+      _Base[LED - 1] = Brightness;
+      SetColor(_Base, LED, R, G, B);
+    }
+
+    /**
+     * @brief Starts rainbow effect
+     *
+     * @param Mask LEDs to run the effect on, _BV(LED)
+     * @param Brightness brightness of the effect
+     * @param Duration duration of the effect (ms)
+     * @param Rate time (ms) per color step
+     */
+    void Rainbow(uint8_t Mask, uint8_t Brightness, uint16_t Duration, uint8_t Rate)  {
+      _Mask = Mask;
+      _Brightness = Brightness;
+      _Duration = Duration;
+      _Rate = Rate > 0 ? Rate : 1;
+      _Start = millis();
+    }
+
+    /**
+     * @brief Checks if an effect is running
+     *
+     */
+    bool Active()  {
+      return _Mask != 0;
+    }
+
+    /**
+     * @brief Renders current frame and sends changed registers
+     *
+     * @param Now current time
+     * @return false if I2C transmission failed; registers are sent again by the next call
+     */
+    bool Update(uint32_t Now)  {
+      uint8_t Frame[LED_ENGINE_REGISTERS];
+
+      memcpy(Frame, _Base, LED_ENGINE_REGISTERS);
+
+      if(_Mask && Now - _Start >= _Duration) {
+        _Mask = 0;
+      }
+      if(_Mask) {
+        // Color components are triangle waves (0-255-0) shifted by 1/2, 3/4 & 0 of the period
+        uint16_t Step = (Now - _Start) / _Rate;
+
+        for(uint8_t LED=1; LED<=LED_ENGINE_LEDS; LED++)  {
+          if(!(_Mask & _BV(LED))) continue;
+          Frame[LED - 1] = _Brightness;
+          SetColor(Frame, LED, Triangle(Step + 256), Triangle(Step + 383), Triangle(Step + 1));
+        }
+      }
+
+      uint8_t First = 0;
+      uint8_t Last = LED_ENGINE_REGISTERS;
+
+      while(First < LED_ENGINE_REGISTERS && Frame[First] == _Chip[First]) First++;
+      if(First == LED_ENGINE_REGISTERS) return true;
+      while(Frame[Last - 1] == _Chip[Last - 1]) Last--;
+
+      Wire.beginTransmission(_Address);
+      Wire.write((uint8_t)(LP50XX_LED0_BRIGHTNESS + First));
+      Wire.write(&Frame[First], Last - First);
+      if(Wire.endTransmission() != 0) return false;
+
+      memcpy(&_Chip[First], &Frame[First], Last - First);
+
+      return true;
+    }
+
+  private:
+    static void SetColor(uint8_t *Frame, uint8_t LED, uint8_t R, uint8_t G, uint8_t B)  {
+      // BGR: OUT0 - blue, OUT1 - green, OUT2 - red
+      uint8_t *Color = &Frame[LP50XX_OUT0_COLOR - LP50XX_LED0_BRIGHTNESS + 3 * (LED - 1)];
+
+      Color[0] = B;
+      Color[1] = G;
+      Color[2] = R;
+    }
+
+    static uint8_t Triangle(uint16_t Phase)  {
+      Phase %= 510;
+      return Phase <= 255 ? Phase : 510 - Phase;
+    }
+
+    uint8_t _Address;
+    uint8_t _Base[LED_ENGINE_REGISTERS];    // Frame set by the sketch
+    uint8_t _Chip[LED_ENGINE_REGISTERS];    // Registers as sent to LP5009
+
+    uint8_t _Mask = 0;                      // LEDs running the effect
+    uint8_t _Brightness = 0;
+    uint8_t _Rate = 1;
+    uint16_t _Duration = 0;
+    uint32_t _Start = 0;
+};
+
+#endif
+/*
+   EOF
+*/
@@ -0,0 +1,221 @@
+/*
+ * Profiler.h file
+ * Measures the duration of every loop() pass and the blocking time spent inside selected functions, counts
+ * failed send() calls, the longest gap between watchdog resets and the least free RAM between heap & stack.
+ * Enable it with LOOP_PROFILING in Configuration.h; data are collected in RAM and sent as one binary
+ * payload (ProfilerData) when requested on DEBUG_ID (C_REQ of V_CUSTOM), then cleared.
+ *
+ * MySensors resets the watchdog and calls yield() between loop() passes and inside wait(), so the sketch
+ * calls WatchdogReset() from yield(). delay() calls yield() too, so time inside delay() isn't counted.
+ * Free RAM: PaintStack() fills unused RAM with a pattern at startup; FreeMemory() counts the bytes
+ * the stack & heap have never reached since.
+ *
+ */
+
+#ifndef Profiler_h
+#define Profiler_h
+
+#define PROFILER_BUCKETS 8                  // Loop histogram buckets: <1, <2, <4, <8, <16, <32, <64, >=64 ms
+#define PROFILER_CANARY 0xC5                // Pattern of never used RAM
+#define PROFILER_WATCHDOG_PERIOD 8000       // Watchdog timeout (ms), WDTO_8S
+
+// Functions measured separately from the whole loop() pass
+enum ProfilerSection {
+  PROF_MEASURE,                             // MeasureAC, MeasureDC
+  PROF_UPDATE_IO,
+  PROF_SHUTTER_UPDATE,
+  PROF_SEND,
+  PROF_EEPROM,                              // EEPROM writes
+  PROF_SECTIONS
+};
+
+// Report payload: binary, little endian
+struct __attribute__((packed)) ProfilerData {
+  uint8_t LoopHistogram[PROFILER_BUCKETS];  // Share of loop() passes per duration bucket (1/255)
+  uint16_t LoopMax;                         // Longest loop() pass (100 us)
+  uint8_t SectionLoad[PROF_SECTIONS];       // Share of time spent inside a function (1/255)
+  uint8_t SectionMax[PROF_SECTIONS];        // Longest single call of a function (ms, up to 255)
+  uint8_t SendFailures;                     // Failed send() calls (up to 255)
+  uint16_t WatchdogMargin;                  // Shortest time left before watchdog reset (ms)
+  uint16_t FreeMemory;                      // Least free RAM between heap & stack (bytes)
+};
+
+static_assert(sizeof(ProfilerData) <= 25, "ProfilerData has to fit into MySensors payload");
+
+extern uint8_t __heap_start;
+extern void *__brkval;
+
+class Profiler {
+
+  public:
+    /**
+     * @brief Marks the beginning of loop() pass
+     *
+     */
+    void LoopStart()  {
+      _LoopStart = micros();
+    }
+
+    /**
+     * @brief Marks the end of loop() pass (before the final wait()), updates histogram
+     *
+     */
+    void LoopEnd()  {
+      uint32_t Duration = micros() - _LoopStart;
+      uint32_t Limit = 1000;
+      uint8_t Bucket = 0;
+
+      while(Bucket < PROFILER_BUCKETS - 1 && Duration >= Limit) {
+        Limit <<= 1;
+        Bucket++;
+      }
+
+      if(_LoopHistogram[Bucket] < 0xFFFF)  _LoopHistogram[Bucket]++;
+      if(Duration > _LoopMax)  _LoopMax = Duration;
+    }
+
+    /**
+     * @brief Marks the beginning of measured function
+     *
+     * @param Section measured function
+     */
+    void SectionStart(uint8_t Section)  {
+      _SectionStart[Section] = micros();
+    }
+
+    /**
+     * @brief Marks the end of measured function
+     *
+     * @param Section measured function
+     */
+    void SectionEnd(uint8_t Section)  {
+      uint32_t Duration = micros() - _SectionStart[Section];
+
+      _SectionTotal[Section] += Duration;
+      if(Duration > _SectionMax[Section])  _SectionMax[Section] = Duration;
+    }
+
+    /**
+     * @brief Counts a failed send()
+     *
+     */
+    void SendFailed()  {
+      if(_SendFailures < 0xFF)  _SendFailures++;
+    }
+
+    /**
+     * @brief Marks a watchdog reset; call from yield()
+     *
+     */
+    void WatchdogReset()  {
+      uint32_t Now = millis();
+
+      if(Now - _LastReset > _WatchdogGap)  _WatchdogGap = Now - _LastReset;
+      _LastReset = Now;
+    }
+
+    /**
+     * @brief Fills unused RAM between heap & stack with PROFILER_CANARY; call once at startup
+     *
+     */
+    static void PaintStack()  {
+      uint8_t Top;
+      uint8_t *p = HeapEnd();
+
+      // Some bytes below the current frame are left, they are in use right now
+      while(p < &Top - 16) {
+        *p++ = PROFILER_CANARY;
+      }
+    }
+
+    /**
+     * @brief Counts RAM bytes never reached by stack or heap since PaintStack()
+     *
+     */
+    static uint16_t FreeMemory()  {
+      const uint8_t *p = HeapEnd();
+      uint16_t Free = 0;
+
+      while(*p == PROFILER_CANARY && p < (const uint8_t *)SP) {
+        p++;
+        Free++;
+      }
+
+      return Free;
+    }
+
+    /**
+     * @brief Fills report payload with data collected since last Reset()
+     *
+     * @param Data payload
+     */
+    void Read(ProfilerData &Data)  {
+      uint32_t Passes = 0;
+      uint32_t Window = millis() - _WindowStart;
+
+      for(uint8_t i=0; i<PROFILER_BUCKETS; i++) {
+        Passes += _LoopHistogram[i];
+      }
+      for(uint8_t i=0; i<PROFILER_BUCKETS; i++) {
+        Data.LoopHistogram[i] = Passes > 0 ? _LoopHistogram[i] * 255UL / Passes : 0;
+      }
+      Data.LoopMax = Saturate(_LoopMax / 100, 0xFFFF);
+
+      for(uint8_t i=0; i<PROF_SECTIONS; i++)  {
+        Data.SectionLoad[i] = Window > 0 ? Saturate(_SectionTotal[i] / 1000 * 255 / Window, 0xFF) : 0;
+        Data.SectionMax[i] = Saturate(_SectionMax[i] / 1000, 0xFF);
+      }
+
+      Data.SendFailures = _SendFailures;
+      Data.WatchdogMargin = _WatchdogGap < PROFILER_WATCHDOG_PERIOD ? PROFILER_WATCHDOG_PERIOD - _WatchdogGap : 0;
+      Data.FreeMemory = FreeMemory();
+    }
+
+    /**
+     * @brief Clears all collected data
+     *
+     */
+    void Reset()  {
+      memset(_LoopHistogram, 0, sizeof(_LoopHistogram));
+      memset(_SectionTotal, 0, sizeof(_SectionTotal));
+      memset(_SectionMax, 0, sizeof(_SectionMax));
+      _LoopMax = 0;
+      _SendFailures = 0;
+      _WatchdogGap = 0;
+      _WindowStart = millis();
+      _LastReset = _WindowStart;
+    }
+
+  private:
+    static uint8_t *HeapEnd()  {
+      return __brkval != nullptr ? (uint8_t *)__brkval : &__heap_start;
+    }
+
+    static uint32_t Saturate(uint32_t Value, uint32_t Max)  {
+      return Value < Max ? Value : Max;
+    }
+
+    uint16_t _LoopHistogram[PROFILER_BUCKETS] = {};   // Number of loop() passes per duration bucket
+    uint32_t _LoopMax = 0;                            // Longest loop() pass (us)
+    uint32_t _SectionTotal[PROF_SECTIONS] = {};       // Time spent inside a function (us)
+    uint32_t _SectionMax[PROF_SECTIONS] = {};         // Longest single call of a function (us)
+    uint32_t _SectionStart[PROF_SECTIONS];
+    uint32_t _LoopStart = 0;
+    uint32_t _WindowStart = 0;
+    uint32_t _LastReset = 0;                          // Time of the last watchdog reset
+    uint16_t _WatchdogGap = 0;                        // Longest time between watchdog resets (ms)
+    uint8_t _SendFailures = 0;
+};
+
+#ifdef LOOP_PROFILING
+  #define PROFILE_START(Section) Prof.SectionStart(Section)
+  #define PROFILE_END(Section) Prof.SectionEnd(Section)
+#else
+  #define PROFILE_START(Section)
+  #define PROFILE_END(Section)
+#endif
+
+#endif
+/*
+   EOF
+*/
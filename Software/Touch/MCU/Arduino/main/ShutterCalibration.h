@@ -0,0 +1,193 @@
+/*
+ * ShutterCalibration.h file
+ * Background roller shutter calibration: the shutter is opened, then moved down & up Samples times.
+ * Every movement lasts until motor current drops (end switch reached) and is timed in ms.
+ * Travel times are medians of all passes with outliers rejected, averaged.
+ *
+ * The calibration is a state machine driven by Update() calls; nothing blocks, so the node keeps
+ * handling messages, safety checks & the watchdog. Include after ShutterMotion.h.
+ *
+ */
+
+#ifndef ShutterCalibration_h
+#define ShutterCalibration_h
+
+#define CALIBRATION_INTERVAL 20             // Interval (ms) of end position checks during calibration
+#define CALIBRATION_PAUSE 1000              // Time (ms) between subsequent movements
+#define CALIBRATION_TIMEOUT 180000UL        // Longest travel (ms); calibration fails if end position isn't detected by then
+#define CALIBRATION_TOLERANCE 10            // Samples deviating from median by more than this value (%) are rejected
+
+#define CALIBRATION_RUNNING 0
+#define CALIBRATION_PROGRESS 1              // Next movement measured
+#define CALIBRATION_DONE 2
+#define CALIBRATION_FAILED 3
+
+template<uint8_t Samples>
+class ShutterCalibration {
+
+  public:
+    uint32_t UpTime = 0;                    // Results (ms), valid after CALIBRATION_DONE
+    uint32_t DownTime = 0;
+
+    /**
+     * @brief Constructor
+     *
+     * @param S shutter driving relays
+     */
+    ShutterCalibration(Shutters &S) : _Shutter(S) {}
+
+    /**
+     * @brief Starts calibration by opening the shutter
+     *
+     * @param Now current time
+     */
+    void Begin(uint32_t Now)  {
+      _Pass = 0;
+      _Direction = SHUTTER_UP;
+      _Opening = true;
+      Drive(SHUTTER_UP, Now);
+    }
+
+    /**
+     * @brief Stops calibration and motor
+     *
+     */
+    void Abort()  {
+      if(_Phase != IDLE)  {
+        _Phase = IDLE;
+        _Shutter.NewState = SHUTTER_STOP;
+        _Shutter.Movement();
+      }
+    }
+
+    /**
+     * @brief Checks if calibration is in progress
+     *
+     */
+    bool Active()  {
+      return _Phase != IDLE;
+    }
+
+    /**
+     * @brief Calibration progress
+     *
+     * @return uint8_t percentage of measured movements
+     */
+    uint8_t Progress()  {
+      return (_Pass * 2 + (_Direction == SHUTTER_UP && !_Opening)) * 100 / (Samples * 2);
+    }
+
+    /**
+     * @brief Checks end position & timestamps; call every CALIBRATION_INTERVAL
+     *
+     * @param Now current time
+     * @param Running motor current is above the end position threshold
+     * @return uint8_t CALIBRATION_RUNNING, CALIBRATION_PROGRESS, CALIBRATION_DONE or CALIBRATION_FAILED
+     */
+    uint8_t Update(uint32_t Now, bool Running)  {
+      uint32_t Elapsed = Now - _Start;
+
+      switch(_Phase)  {
+        case MOVING:
+          if(Elapsed < SHUTTER_CURRENT_DELAY) break;
+          if(Running) {
+            if(Elapsed > CALIBRATION_TIMEOUT) {
+              Abort();
+              return CALIBRATION_FAILED;
+            }
+            break;
+          }
+
+          // End position reached
+          _Shutter.NewState = SHUTTER_STOP;
+          _Shutter.Movement();
+          _Phase = PAUSE;
+          _Start = Now;
+
+          if(_Opening)  {
+            _Opening = false;
+            _Direction = SHUTTER_DOWN;
+            break;
+          }
+
+          if(_Direction == SHUTTER_DOWN)  {
+            _Down[_Pass] = Elapsed;
+            _Direction = SHUTTER_UP;
+          }
+          else  {
+            _Up[_Pass] = Elapsed;
+            _Direction = SHUTTER_DOWN;
+            if(++_Pass == Samples)  {
+              _Phase = IDLE;
+              UpTime = Result(_Up);
+              DownTime = Result(_Down);
+              return CALIBRATION_DONE;
+            }
+          }
+          return CALIBRATION_PROGRESS;
+        case PAUSE:
+          if(Elapsed >= CALIBRATION_PAUSE) {
+            Drive(_Direction, Now);
+          }
+          break;
+        default:
+          break;
+      }
+
+      return CALIBRATION_RUNNING;
+    }
+
+  private:
+    enum Phase : uint8_t { IDLE, MOVING, PAUSE };
+
+    void Drive(uint8_t Direction, uint32_t Now)  {
+      _Shutter.NewState = Direction;
+      _Shutter.Movement();
+      _Phase = MOVING;
+      _Start = Now;
+    }
+
+    /**
+     * @brief Average of samples within CALIBRATION_TOLERANCE from median
+     *
+     * @param T samples; sorted in place
+     */
+    static uint32_t Result(uint32_t *T)  {
+      for(uint8_t i=1; i<Samples; i++) {
+        uint32_t Sample = T[i];
+        uint8_t j = i;
+        for(; j>0 && T[j-1] > Sample; j--)  {
+          T[j] = T[j-1];
+        }
+        T[j] = Sample;
+      }
+
+      uint32_t Median = T[(Samples - 1) / 2];
+      uint32_t Limit = Median * CALIBRATION_TOLERANCE / 100;
+      uint32_t Sum = 0;
+      uint8_t N = 0;
+
+      for(uint8_t i=0; i<Samples; i++) {
+        if(T[i] + Limit >= Median && T[i] <= Median + Limit) {
+          Sum += T[i];
+          N++;
+        }
+      }
+
+      return Sum / N;
+    }
+
+    Shutters &_Shutter;
+    Phase _Phase = IDLE;
+    uint8_t _Direction = SHUTTER_UP;
+    bool _Opening = false;                  // Opening before the first measured movement
+    uint8_t _Pass = 0;
+    uint32_t _Start = 0;
+    uint32_t _Up[Samples];
+    uint32_t _Down[Samples];
+};
+
+#endif
+/*
+   EOF
+*/
@@ -0,0 +1,131 @@
+/*
+ * TouchTracker.h file
+ * Continuous touch field baseline tracking. Fed with CommonIO::TouchDiagnosisValue (reading minus
+ * reference) after every CheckInput2(), it keeps per field:
+ * - baseline: slow moving average of untouched readings, i.e. drift of the stored reference,
+ * - noise: moving average of absolute deviation from baseline,
+ * - threshold: touch threshold shifted by baseline and widened when the field is noisy.
+ *
+ * A field whose baseline drifted beyond TOUCH_DRIFT_LIMIT is marked for a new reference, taken
+ * once the field has been untouched for TOUCH_IDLE_TIME; other fields keep working meanwhile.
+ * A field sensed as touched for TOUCH_STUCK_TIME is re-referenced at once - nobody holds
+ * a button that long, so the reference must be wrong.
+ *
+ * Baseline & noise are kept in 24.8 fixed point, so slow drift of a single unit isn't lost.
+ *
+ */
+
+#ifndef TouchTracker_h
+#define TouchTracker_h
+
+#define TOUCH_DRIFT_SHIFT 6                 // Baseline follows untouched readings with weight 1/2^n (~10 s, a field is read every ~170 ms)
+#define TOUCH_NOISE_SHIFT 4                 // Noise estimate weight 1/2^n
+#define TOUCH_MAX_THRESHOLD 255
+
+template<uint8_t Fields>
+class TouchTracker {
+
+  public:
+    /**
+     * @brief Current touch threshold of a field; pass to CommonIO::CheckInput2()
+     *
+     * @param Field CommonIO index
+     */
+    uint16_t Threshold(uint8_t Field)  {
+      int16_t Band = _Noise[Field] * TOUCH_NOISE_FACTOR >> 8;
+      Band = Band > TOUCH_THRESHOLD ? Band : TOUCH_THRESHOLD;
+
+      int16_t Threshold = Drift(Field) + Band;
+
+      return Threshold < 1 ? 1 : (Threshold > TOUCH_MAX_THRESHOLD ? TOUCH_MAX_THRESHOLD : Threshold);
+    }
+
+    /**
+     * @brief Feeds a new reading
+     *
+     * @param Field CommonIO index
+     * @param Value CommonIO::TouchDiagnosisValue
+     * @param Now current time
+     * @return true if a new reference of the field has to be taken now
+     */
+    bool Update(uint8_t Field, int16_t Value, uint32_t Now)  {
+      uint8_t Mask = 1 << Field;
+      bool Touched = Value > (int16_t)Threshold(Field);
+
+      if(Touched != ((_Touched & Mask) != 0)) {
+        _Touched ^= Mask;
+        _Since[Field] = Now;
+      }
+
+      if(Touched) {
+        if(Now - _Since[Field] >= TOUCH_STUCK_TIME) {
+          _Since[Field] = Now;
+          return true;
+        }
+        return false;
+      }
+
+      int32_t Deviation = ((int32_t)Value << 8) - _Baseline[Field];
+      int32_t Absolute = Deviation < 0 ? -Deviation : Deviation;
+
+      // Division rather than shift, so negative drift rounds like positive one
+      _Baseline[Field] += Deviation / (1 << TOUCH_DRIFT_SHIFT);
+      _Noise[Field] += (Absolute - _Noise[Field]) / (1 << TOUCH_NOISE_SHIFT);
+
+      int16_t Drift = this->Drift(Field);
+
+      if(Drift > TOUCH_DRIFT_LIMIT || Drift < -TOUCH_DRIFT_LIMIT) {
+        _Pending |= Mask;
+      }
+
+      return (_Pending & Mask) && Now - _Since[Field] >= TOUCH_IDLE_TIME;
+    }
+
+    /**
+     * @brief Marks all fields for a new reference (taken as each becomes idle)
+     *
+     */
+    void RequestReference()  {
+      _Pending = (1 << Fields) - 1;
+    }
+
+    /**
+     * @brief Clears field baseline after a new reference has been taken
+     *
+     * @param Field CommonIO index
+     */
+    void Rebase(uint8_t Field)  {
+      _Baseline[Field] = 0;
+      _Pending &= ~(1 << Field);
+    }
+
+    /**
+     * @brief Drift of the stored reference (raw units)
+     *
+     */
+    int16_t Drift(uint8_t Field)  {
+      return _Baseline[Field] / 256;
+    }
+
+    /**
+     * @brief Noise of the field (raw units)
+     *
+     */
+    int16_t Noise(uint8_t Field)  {
+      return _Noise[Field] / 256;
+    }
+
+  private:
+    static_assert(Fields <= 8, "TouchTracker supports up to 8 fields");
+
+    int32_t _Baseline[Fields] = {};
+    int32_t _Noise[Fields] = {};
+    uint32_t _Since[Fields] = {};           // Time of last touch state change
+    uint8_t _Touched = 0;                   // Bit per field
+    uint8_t _Pending = 0;                   // Bit per field: new reference requested
+};
+
+#endif
+/*
+   EOF
+*/
@@ -23,6 +23,14 @@
 #include "Configuration.h"
 #include <GoWired.h>
 #include <LP50XX.h>
+#include <new.h>
+#include "ShutterMotion.h"
+#include "ShutterCalibration.h"
+#include "ReportPolicy.h"
+#include "TouchTracker.h"
+#include "LEDEngine.h"
+#include "Manifest.h"
+#include "Profiler.h"
 #ifdef SHT30
   #include <SHTSensor.h>
 #endif
@@ -36,12 +44,29 @@ uint8_t HardwareVariant;
 uint8_t LoadVariant;
 uint8_t Iterations;
 
+// Handlers of a load variant, bound once in before(); loop() & receive() don't check the variant again
+struct VariantHandler {
+  void (*Setup)();                            // Initializes outputs & inputs
+  void (*Confirm)();                          // Sends initial states of outputs
+  void (*Button)(uint8_t Button);             // Applies a touch field state change
+  void (*Receive)(const MyMessage &message);  // Applies output control messages
+  void (*SetLEDs)();                          // Sets LEDs according to output state
+  void (*Update)(float Current);              // Runs output in background, once per loop() pass
+  float (*Measure)(float Vcc);                // Measures load current while output is on
+  void (*Cutoff)();                           // Switches output off (electronic fuse)
+  bool (*Busy)();                             // Checks if load disturbs touch fields
+  void (*Calibrate)();                        // Handles CONF_MSG_1
+};
+
+VariantHandler Variant;
+
 // Shutter
-uint32_t MovementTime;
-uint32_t StartTime;
+uint32_t LastPositionReport = 0;       // Time of the last position report during movement
+uint32_t LastCalibrationBlink = 0;     // Time of the last LED blink during shutter calibration
 
 // Timer
 uint32_t LastUpdate = 0;               // Time of last update of interval sensors
+uint32_t LastSensorReading = 0;        // Time of last external sensor reading
 bool CheckNow = true;
 
 // Module Safety Indicators
@@ -51,6 +76,9 @@ bool ET_ERROR = 0;                       // External thermometer status (0 - ok,
 
 // Initialization
 bool InitConfirm = false;
+uint8_t SyncPending = 0;                  // Number of values requested at startup & not yet received from controller
+uint32_t SyncStart;                       // Time of sending startup requests
+bool SyncComplete = false;
 
 // Touch Diagnosis
 uint8_t LimitTransgressions = 0;
@@ -59,25 +87,48 @@ uint8_t LongpressDetection = 0;
 /***** Constructors *****/
 // LP5009 - onboard RGB LED controller
 LP50XX LP5009(BGR, LP5009_ENABLE_PIN);
+LEDEngine Backlight(LP5009_ADDRESS);
 
 // CommonIO constructor
 CommonIO CommonIO[NUMBER_OF_RELAYS+NUMBER_OF_INPUTS];
+TouchTracker<NUMBER_OF_RELAYS+NUMBER_OF_INPUTS> Touch;
+
+// Shutter objects
+struct ShutterObjects {
+  Shutters Shutter;
+  ShutterMotion Motion;
+  ShutterCalibration<CALIBRATION_SAMPLES> Calibrator;
+
+  ShutterObjects() : Shutter(EEA_SHUTTER_TIME_DOWN, EEA_SHUTTER_TIME_UP, EEA_SHUTTER_POSITION), Motion(Shutter), Calibrator(Shutter) {}
+};
+
+// Load objects share RAM; only those of the detected variant are constructed, see BindVariant()
+union LoadObjects {
+  ShutterObjects Shutter;
+  class Dimmer Dimmer;
 
-// Shutter Constructor
-Shutters Shutter(EEA_SHUTTER_TIME_DOWN, EEA_SHUTTER_TIME_UP, EEA_SHUTTER_POSITION);
+  LoadObjects() {}
+  ~LoadObjects() {}
+};
 
-// Dimmer class constructor
-Dimmer Dimmer;
+LoadObjects Loads;
+Shutters &Shutter = Loads.Shutter.Shutter;
+ShutterMotion &Motion = Loads.Shutter.Motion;
+ShutterCalibration<CALIBRATION_SAMPLES> &Calibrator = Loads.Shutter.Calibrator;
+class Dimmer &Dimmer = Loads.Dimmer;
 
 // Power sensor class constructor
 #ifdef POWER_SENSOR
   PowerSensor PS;
+  ReportPolicy<float> PSPolicy(PS_POLICY);
   MyMessage MsgWATT(0, V_WATT);
 #endif
 
 // SHTSensor class constructor
 #ifdef SHT30
   SHTSensor sht;
+  ReportPolicy<float> ETTPolicy(ETT_POLICY);
+  ReportPolicy<float> ETHPolicy(ETH_POLICY);
   MyMessage MsgTEMP(0, V_TEMP);
   MyMessage MsgHUM(0, V_HUM);
 #endif
@@ -91,12 +142,20 @@ MyMessage MsgPERCENTAGE(0, V_PERCENTAGE);
 MyMessage MsgRGB(0, V_RGB);
 MyMessage MsgRGBW(0, V_RGBW);
 MyMessage MsgTEXT(0, V_TEXT);
+MyMessage MsgREADY(CONFIGURATION_SENSOR_ID, V_VAR1);
+Manifest Presentation(CONFIGURATION_SENSOR_ID);
 
 // Debug
 #ifdef RS485_DEBUG
   MyMessage MsgCUSTOM(0, V_CUSTOM);
 #endif
 
+// Loop profiler
+#ifdef LOOP_PROFILING
+  Profiler Prof;
+  ProfilerData ProfData;
+#endif
+
 /**
  * @brief Setups software components: hardware version, configuration, LED controller, wdt reset
  * 
@@ -109,6 +168,10 @@ void before() {
     wdt_disable();
   #endif
 
+  #ifdef LOOP_PROFILING
+    Profiler::PaintStack();
+  #endif
+
   // Resistive hardware detection
   uint16_t ReadHardware = analogRead(HARDWARE_DETECTION_PIN);
 
@@ -155,6 +218,8 @@ void before() {
   // Calculating number of iterations depending from IO instances
   Iterations = (HardwareVariant == 0 && LoadVariant == 0) ? 1 : 2;
 
+  BindVariant();
+
   // Detecting I2C peripherals
   Wire.begin();
   // TO BE DEVELOPED
@@ -163,7 +228,7 @@ void before() {
   //Wire.setClock(400000UL);
 
   // Initializing LP5009/LP5012
-  LP5009.Begin();
+  LP5009.Begin(LP5009_ADDRESS);
 }
 
 /**
@@ -193,52 +258,7 @@ void setup() {
   #endif
 
   // Initializing inputs & outputs
-  if(HardwareVariant == 0)  {
-    if(LoadVariant == 0)  {
-      // Lighting: One button, single output
-      CommonIO[RELAY_ID_1].SetValues(RELAY_OFF, false, 6, TOUCH_FIELD_3, INPUT_PIN_1, RELAY_PIN_1);
-      // Not used touch field for calibration purposes
-      CommonIO[UNUSED_TF_ID].SetValues(RELAY_OFF, false, 5, TOUCH_FIELD_1);
-    }
-    else if(LoadVariant == 1) {
-      // Lighting: two buttons, double output
-      CommonIO[RELAY_ID_1].SetValues(RELAY_OFF, false, 6, TOUCH_FIELD_1, INPUT_PIN_1, RELAY_PIN_1);
-      CommonIO[RELAY_ID_2].SetValues(RELAY_OFF, false, 6, TOUCH_FIELD_2, INPUT_PIN_2, RELAY_PIN_2);
-      // Not used touch field for calibration purposes
-      CommonIO[UNUSED_TF_ID].SetValues(RELAY_OFF, false, 5, TOUCH_FIELD_3);
-    }
-    else if(LoadVariant == 2) {
-      // Shutter
-      CommonIO[SHUTTER_ID].SetValues(RELAY_OFF, false, 5, TOUCH_FIELD_1);
-      CommonIO[SHUTTER_ID + 1].SetValues(RELAY_OFF, false, 5, TOUCH_FIELD_2);
-      // Not used touch field for calibration purposes
-      CommonIO[UNUSED_TF_ID].SetValues(RELAY_OFF, false, 5, TOUCH_FIELD_3);
-      Shutter.SetOutputs(RELAY_OFF, RELAY_PIN_1, RELAY_PIN_2);
-      // Temporary calibration (first launch only)
-      if(!Shutter.Calibrated) {
-        Shutter.Calibration(UP_TIME, DOWN_TIME);
-      }
-    }
-  }
-  else if(HardwareVariant == 1) {
-    if(LoadVariant == 2)  {
-      // 1-channel dimmer
-      Dimmer.SetValues(NUMBER_OF_CHANNELS, DIMMING_STEP, DIMMING_INTERVAL, LED_PIN_W);
-    }
-    else if(LoadVariant == 0) {
-      // RGB dimmer
-      Dimmer.SetValues(NUMBER_OF_CHANNELS, DIMMING_STEP, DIMMING_INTERVAL, LED_PIN_R, LED_PIN_G, LED_PIN_B);
-    }
-    else if(LoadVariant == 1) {
-      // RGBW dimmer
-      Dimmer.SetValues(NUMBER_OF_CHANNELS, DIMMING_STEP, DIMMING_INTERVAL, LED_PIN_R, LED_PIN_G, LED_PIN_B, LED_PIN_W);
-    }
-    // Every dimmer has two buttons
-    CommonIO[0].SetValues(RELAY_OFF, false, 5, TOUCH_FIELD_1);
-    CommonIO[1].SetValues(RELAY_OFF, false, 5, TOUCH_FIELD_2);
-    // Not used touch field for calibration purposes
-    CommonIO[UNUSED_TF_ID].SetValues(RELAY_OFF, false, 5, TOUCH_FIELD_3);
-  }
+  Variant.Setup();
 
   // Indicate inactivity with LEDs
   for(int i=0; i<Iterations; i++) {
@@ -256,6 +276,105 @@ void setup() {
     wdt_enable(WDTO_8S);
   #endif
 
+  #ifdef LOOP_PROFILING
+    Prof.Reset();
+  #endif
+
+}
+
+/***** Presentation manifest *****/
+// Sketch & sensor names
+const char NameRelay1c[] PROGMEM = "GWT-2R-1c";
+const char NameRelay2c[] PROGMEM = "GWT-2R-2c";
+const char NameRelayShutter[] PROGMEM = "GWT-2R-Shutter";
+const char NameDimmer3c[] PROGMEM = "GWT-D-3c";
+const char NameDimmer4c[] PROGMEM = "GWT-D-4c";
+const char NameDimmer1c[] PROGMEM = "GWT-D-1c";
+const char NameRelay1[] PROGMEM = "Relay 1";
+const char NameRelay2[] PROGMEM = "Relay 2";
+const char NameShutter[] PROGMEM = "Shutter";
+const char NameDimmer[] PROGMEM = "Dimmer";
+const char NameRGB[] PROGMEM = "RGB";
+const char NameRGBW[] PROGMEM = "RGBW";
+const char NameLongpress1[] PROGMEM = "Longpress-1";
+const char NameLongpress2[] PROGMEM = "Longpress-2";
+const char NamePowerSensor[] PROGMEM = "Power Sensor";
+const char NameExternalThermometer[] PROGMEM = "External Thermometer";
+const char NameExternalHygrometer[] PROGMEM = "External Hygrometer";
+const char NameOvercurrentError[] PROGMEM = "OVERCURRENT ERROR";
+const char NameETStatus[] PROGMEM = "ET STATUS";
+const char NameDebugInfo[] PROGMEM = "DEBUG INFO";
+const char NameTouchDiagnostic[] PROGMEM = "Touch Diagnostic";
+const char NameConfiguration[] PROGMEM = "TEXT MSG";
+
+// Sensor ID, count, presentation, name
+const PresentEntry Relay1cSensors[] PROGMEM = {{RELAY_ID_1, 1, S_BINARY, NameRelay1}};
+const PresentEntry Relay2cSensors[] PROGMEM = {{RELAY_ID_1, 1, S_BINARY, NameRelay1}, {RELAY_ID_2, 1, S_BINARY, NameRelay2}};
+const PresentEntry ShutterSensors[] PROGMEM = {{SHUTTER_ID, 1, S_COVER, NameShutter}};
+const PresentEntry RGBSensors[] PROGMEM = {{DIMMER_ID, 1, S_RGB_LIGHT, NameRGB}};
+const PresentEntry RGBWSensors[] PROGMEM = {{DIMMER_ID, 1, S_RGBW_LIGHT, NameRGBW}};
+const PresentEntry DimmerSensors[] PROGMEM = {{DIMMER_ID, 1, S_DIMMER, NameDimmer}};
+
+// Sensors of all variants
+const PresentEntry CommonSensors[] PROGMEM = {
+  #ifdef SPECIAL_BUTTON
+    {SPECIAL_BUTTON_ID, 1, S_BINARY, NameLongpress1},
+    {SPECIAL_BUTTON_ID+1, 1, S_BINARY, NameLongpress2},
+  #endif
+  #ifdef POWER_SENSOR
+    {PS_ID, 1, S_POWER, NamePowerSensor},
+  #endif
+  #ifdef SHT30
+    {ETT_ID, 1, S_TEMP, NameExternalThermometer},
+    {ETH_ID, 1, S_HUM, NameExternalHygrometer},
+  #endif
+  #ifdef ELECTRONIC_FUSE
+    {ES_ID, 1, S_BINARY, NameOvercurrentError},
+  #endif
+  #ifdef SHT30
+    {ETS_ID, 1, S_BINARY, NameETStatus},
+  #endif
+  #ifdef RS485_DEBUG
+    {DEBUG_ID, 1, S_INFO, NameDebugInfo},
+    {TOUCH_DIAGNOSTIC_ID, 1, S_CUSTOM, NameTouchDiagnostic},
+  #endif
+  {CONFIGURATION_SENSOR_ID, 1, S_INFO, NameConfiguration}
+};
+
+#define VARIANT(Name, Sensors) {Name, Sensors, sizeof(Sensors) / sizeof(Sensors[0])}
+
+// [HardwareVariant][LoadVariant]
+const PresentVariant Variants[2][3] PROGMEM = {
+  {VARIANT(NameRelay1c, Relay1cSensors), VARIANT(NameRelay2c, Relay2cSensors), VARIANT(NameRelayShutter, ShutterSensors)},
+  {VARIANT(NameDimmer3c, RGBSensors), VARIANT(NameDimmer4c, RGBWSensors), VARIANT(NameDimmer1c, DimmerSensors)}
+};
+
+/**
+ * @brief Reads manifest of detected hardware variant
+ * 
+ */
+PresentVariant CurrentVariant()  {
+
+  PresentVariant V = {nullptr, nullptr, 0};
+
+  if(HardwareVariant < 2 && LoadVariant < 3)  {
+    memcpy_P(&V, &Variants[HardwareVariant][LoadVariant], sizeof(V));
+  }
+
+  return V;
+}
+
+/**
+ * @brief Presents all sensors of detected hardware variant
+ * 
+ */
+void PresentSensors()  {
+
+  PresentVariant V = CurrentVariant();
+
+  Manifest::Present(V.Sensors, V.Count, PRESENTATION_DELAY);
+  Manifest::Present(CommonSensors, sizeof(CommonSensors) / sizeof(CommonSensors[0]), PRESENTATION_DELAY);
+  Presentation.Presented();
 }
 
 /**
@@ -264,70 +383,46 @@ void setup() {
  */
 void presentation() {
 
-  // OUTPUT
-  if(HardwareVariant == 0)  {
-    if(LoadVariant == 0)  {
-      sendSketchInfo("GWT-2R-1c", SV);
-      present(RELAY_ID_1, S_BINARY, "Relay 1");   wait(PRESENTATION_DELAY);
-    }
-    else if(LoadVariant == 1) {
-      sendSketchInfo("GWT-2R-2c", SV);
-      present(RELAY_ID_1, S_BINARY, "Relay 1");   wait(PRESENTATION_DELAY);
-      present(RELAY_ID_2, S_BINARY, "Relay 2");   wait(PRESENTATION_DELAY);
-    }
-    else if(LoadVariant == 2) {
-      sendSketchInfo("GWT-2R-Shutter", SV);
-      present(SHUTTER_ID, S_COVER, "Shutter");  wait(PRESENTATION_DELAY);     
-    }
-  }
-  else if(HardwareVariant == 1) {
-    if(LoadVariant == 2)  {
-      sendSketchInfo("GWT-D-1c", SV);
-      present(DIMMER_ID, S_DIMMER, "Dimmer"); wait(PRESENTATION_DELAY);
-    }
-    else if(LoadVariant == 0) {
-      sendSketchInfo("GWT-D-3c", SV);
-      present(DIMMER_ID, S_RGB_LIGHT, "RGB"); wait(PRESENTATION_DELAY);
-    }
-    else if(LoadVariant == 1) {
-      sendSketchInfo("GWT-D-4c", SV);
-      present(DIMMER_ID, S_RGBW_LIGHT, "RGBW");   wait(PRESENTATION_DELAY);
-    }
+  PresentVariant V = CurrentVariant();
+
+  if(V.Name != nullptr) {
+    sendSketchInfo(reinterpret_cast<const __FlashStringHelper *>(V.Name), F(SV));
   }
 
-  #ifdef SPECIAL_BUTTON
-    present(SPECIAL_BUTTON_ID, S_BINARY, "Longpress-1"); wait(PRESENTATION_DELAY);
-    present(SPECIAL_BUTTON_ID+1, S_BINARY, "Longpress-2"); wait(PRESENTATION_DELAY);
-  #endif
+  uint32_t Hash = V.Name != nullptr ? HashString_P(FNV_OFFSET, V.Name) : FNV_OFFSET;
 
-  // POWER SENSOR
-  #if defined(POWER_SENSOR)
-    present(PS_ID, S_POWER, "Power Sensor");    wait(PRESENTATION_DELAY);
-  #endif
+  Hash = HashString_P(Hash, PSTR(SV));
+  Hash = Manifest::Hash(Hash, V.Sensors, V.Count);
+  Hash = Manifest::Hash(Hash, CommonSensors, sizeof(CommonSensors) / sizeof(CommonSensors[0]));
 
-  // Onboard Thermometer
-  #ifdef SHT30
-    present(ETT_ID, S_TEMP, "External Thermometer"); wait(PRESENTATION_DELAY);
-    present(ETH_ID, S_HUM, "External Hygrometer");  wait(PRESENTATION_DELAY);
-  #endif
+  // At startup sensors are presented only if the controller doesn't know this manifest, see loop()
+  if(Presentation.Check(Hash)) return;
 
-  // Electronic fuse
-  #ifdef ELECTRONIC_FUSE 
-      present(ES_ID, S_BINARY, "OVERCURRENT ERROR");    wait(PRESENTATION_DELAY);
-  #endif
+  PresentSensors();
+}
 
-  #ifdef SHT30
-    present(ETS_ID, S_BINARY, "ET STATUS");   wait(PRESENTATION_DELAY);
-  #endif
+/**
+ * @brief Requests sensor value from controller without waiting for the reply; the reply is handled by receive()
+ * 
+ * @param Sensor sensor ID
+ * @param Type value type
+ */
+void SyncRequest(uint8_t Sensor, uint8_t Type) {
 
-  #ifdef RS485_DEBUG
-    present(DEBUG_ID, S_INFO, "DEBUG INFO");
-    present(TOUCH_DIAGNOSTIC_ID, S_CUSTOM, "Touch Diagnostic");
-  #endif
+  request(Sensor, Type);
+  SyncPending++;
+}
+
+/**
+ * @brief Finishes startup synchronization when all requested values arrived or INIT_SYNC_TIMEOUT passed; reports boot-to-ready time
+ * 
+ */
+void SyncUpdate() {
 
-  // Configuration sensor
-  present(CONFIGURATION_SENSOR_ID, S_INFO, "TEXT MSG");
+  if(SyncComplete || (SyncPending > 0 && millis() - SyncStart < INIT_SYNC_TIMEOUT)) return;
 
+  SyncComplete = true;
+  send(MsgREADY.set(millis()));
 }
 
 /**
@@ -337,68 +432,7 @@ void presentation() {
 void InitConfirmation() {
 
   // OUTPUT
-  // 2Relay
-  if(HardwareVariant == 0)  {
-    // Single output
-    if(LoadVariant == 0)  {
-      send(MsgSTATUS.setSensor(RELAY_ID_1).set(CommonIO[RELAY_ID_1].NewState));
-      request(RELAY_ID_1, V_STATUS);
-      wait(2000, C_SET, V_STATUS);
-    }
-    // Double output
-    else if(LoadVariant == 1) {
-      send(MsgSTATUS.setSensor(RELAY_ID_1).set(CommonIO[RELAY_ID_1].NewState));
-      request(RELAY_ID_1, V_STATUS);
-      wait(2000, C_SET, V_STATUS);
-
-      send(MsgSTATUS.setSensor(RELAY_ID_2).set(CommonIO[RELAY_ID_2].NewState));
-      request(RELAY_ID_2, V_STATUS);
-      wait(2000, C_SET, V_STATUS);
-    }
-    // Roller shutter
-    else if(LoadVariant == 2) {
-      send(MsgUP.setSensor(SHUTTER_ID).set(0));
-      request(SHUTTER_ID, V_UP);
-      wait(2000, C_SET, V_UP);
-
-      send(MsgDOWN.setSensor(SHUTTER_ID).set(0));
-      request(SHUTTER_ID, V_DOWN);
-      wait(2000, C_SET, V_DOWN);
-
-      send(MsgSTOP.setSensor(SHUTTER_ID).set(0));
-      request(SHUTTER_ID, V_STOP);
-      wait(2000, C_SET, V_STOP);
-
-      send(MsgPERCENTAGE.setSensor(SHUTTER_ID).set(Shutter.Position));
-      request(SHUTTER_ID, V_PERCENTAGE);
-      wait(2000, C_SET, V_PERCENTAGE);
-    }
-  }
-  // RGBW
-  else if(HardwareVariant == 1) {
-    send(MsgSTATUS.setSensor(DIMMER_ID).set(false));
-    request(DIMMER_ID, V_STATUS);
-    wait(2000, C_SET, V_STATUS);
-    
-    send(MsgPERCENTAGE.setSensor(DIMMER_ID).set(Dimmer.NewDimmingLevel));
-    request(DIMMER_ID, V_PERCENTAGE);
-    wait(2000, C_SET, V_PERCENTAGE);
-
-    // RGB dimmer
-    if(LoadVariant == 0)  {
-      send(MsgRGB.setSensor(DIMMER_ID).set("ffffff"));
-      request(DIMMER_ID, V_RGB);
-      wait(2000, C_SET, V_RGB);
-    }
-    // RGBW dimmer
-    else if(LoadVariant == 1) {
-      send(MsgRGBW.setSensor(DIMMER_ID).set("ffffffff"));
-      request(DIMMER_ID, V_RGBW);
-      wait(2000, C_SET, V_RGBW);
-    }
-    // 1-channel dimmer
-    else if(LoadVariant == 2) {}
-  }
+  Variant.Confirm();
 
   #ifdef SPECIAL_BUTTON
     send(MsgSTATUS.setSensor(SPECIAL_BUTTON_ID).set(0));
@@ -412,6 +446,8 @@ void InitConfirmation() {
 
   // External sensors
   #ifdef SHT30
+    ETTPolicy.Force();
+    ETHPolicy.Force();
     ETUpdate();
     send(MsgSTATUS.setSensor(ETS_ID).set(0));
   #endif
@@ -430,60 +466,23 @@ void InitConfirmation() {
 
   SetLEDs();
 
+  SyncStart = millis();
   InitConfirm = true;
 
 }
 
 /**
- * @brief performs a rainbow effect on active LEDs
+ * @brief Starts a rainbow effect on active LEDs; the effect runs in background from the main loop
  * 
  * @param Duration duration of effect
  * @param Rate rate of effect
  */
 void RainbowLED(uint16_t Duration, uint8_t Rate)	{
-	
-  int RValue = 254;
-  int GValue = 127;
-  int BValue = 1;
-  int RDirection = -1;
-  int GDirection = -1;
-  int BDirection = 1;
-  uint32_t StartTime = millis();
-	
-  while(millis() < StartTime + Duration)	{
-
-    if(Iterations == 1)  {
-      AdjustLEDs2(BUILTIN_LED3, BRIGHTNESS_VALUE_ON, RValue, GValue, BValue);
-    }
-    else {
-      uint8_t LEDs[2] = {BUILTIN_LED1, BUILTIN_LED2};
-      for(int i=0; i<Iterations; i++)  {
-        AdjustLEDs2(LEDs[i], BRIGHTNESS_VALUE_ON, RValue, GValue, BValue);
-      }
-    }
-	
-    RValue += RDirection;
-    GValue += GDirection;
-    BValue += BDirection;
-	
-    if(RValue >= 255 || RValue <= 0)	{
-      RDirection = -RDirection;
-    }
-	
-    if(GValue >= 255 || GValue <= 0)	{
-      GDirection = -GDirection;
-    }
-	
-    if(BValue >= 255 || BValue <= 0)	{
-      BDirection = -BDirection;
-    }
 
-    if(millis() < StartTime)  {
-      StartTime = millis();
-    }
+  uint8_t Mask = Iterations == 1 ? _BV(BUILTIN_LED3) : _BV(BUILTIN_LED1) | _BV(BUILTIN_LED2);
 
-    wait(Rate);
-  }
+  Backlight.Rainbow(Mask, BRIGHTNESS_VALUE_ON, Duration, Rate);
+  Backlight.Update(millis());
 }
 
 /**
@@ -496,7 +495,7 @@ void AdjustLEDs(uint8_t State, uint8_t Button) {
 
   uint8_t LED;
 
-  if(HardwareVariant == 0 && LoadVariant == 0)  {
+  if(Iterations == 1)  {
     LED = BUILTIN_LED3;
   }
   else  {
@@ -541,8 +540,8 @@ void AdjustLEDs(uint8_t State, uint8_t Button) {
 void AdjustLEDs2(uint8_t LED, uint8_t Brightness, uint8_t R, uint8_t G, uint8_t B) {
 
   // LED: BUILTIN_LED1 / BUILTIN_LED2 / BUILTIN_LED3
-  LP5009.SetLEDColor(LED, R, G, B);
-  LP5009.SetLEDBrightness(LED, Brightness);
+  Backlight.Set(LED, Brightness, R, G, B);
+  Backlight.Update(millis());
 }
 
 /**
@@ -551,32 +550,7 @@ void AdjustLEDs2(uint8_t LED, uint8_t Brightness, uint8_t R, uint8_t G, uint8_t
 void SetLEDs()  {
 
   // Adjust LEDs back to indicate the states of buttons
-  if(HardwareVariant == 0)  {
-    if(LoadVariant != 2)  {
-      for(int i=0; i<Iterations; i++) {
-        AdjustLEDs(CommonIO[i].State, i);
-      }
-    }
-    else {
-      if(Shutter.State == 2) {
-        AdjustLEDs(0, 0); AdjustLEDs(0, 1);
-      }
-      else if(Shutter.State == 1)  {
-        AdjustLEDs(0, 0); AdjustLEDs(1, 1);
-      }
-      else if(Shutter.State == 0)  {
-        AdjustLEDs(1, 0); AdjustLEDs(0, 1);
-      }
-    }
-  }
-  else if(HardwareVariant == 1) {
-    if(Dimmer.CurrentState) {
-      AdjustLEDs(1, 0); AdjustLEDs(0, 1);
-    }
-    else  {
-      AdjustLEDs(0, 0); AdjustLEDs(0, 1);
-    }
-  }
+  Variant.SetLEDs();
 }
 
 /**
@@ -627,42 +601,40 @@ void TouchDiagnosis(uint16_t Threshold) {
  */
 void TouchDiagnosis2() {
 
-  for(int i=0; i<2; i++)  {
-    CommonIO[UNUSED_TF_ID].CheckInput2(TOUCH_THRESHOLD, LONGPRESS_DURATION, DEBOUNCE_VALUE);
-    if(CommonIO[UNUSED_TF_ID].NewState < 2) return;
-  }
-  
+  ReadTouchField(UNUSED_TF_ID);
+
+  // Nobody touches the unused field; a longpress sensed there means readings of the whole panel went off
+  if(CommonIO[UNUSED_TF_ID].NewState < 2) return;
+
   CommonIO[UNUSED_TF_ID].NewState = 0;
   ReadNewReference();
 }
 
 /**
- * @brief Reads new reference value for touch buttons
+ * @brief Requests new reference values for touch buttons; each field takes its own as soon as it is idle
  * 
  */
 void ReadNewReference() {
 
-  if(HardwareVariant == 0 && LoadVariant == 2)  {
-    Shutter.NewState = 2;
-    Shutter.Movement();
-  }
+  Touch.RequestReference();
+}
 
-  // Blink LEDs to indicate inactivity and take a break from normal operation
-  for(int i=0; i<5; i++)  {
-    BlinkLEDs();
-    delay(1000);
-  }
+/**
+ * @brief Reads touch field, tracks its baseline & takes new reference when due
+ * 
+ * @param Field CommonIO index
+ */
+void ReadTouchField(uint8_t Field) {
 
-  // Read new reference
-  for(int i=0; i<Iterations+1; i++)  {
-    CommonIO[i].ReadReference();
-  }
+  CommonIO[Field].CheckInput2(Touch.Threshold(Field), LONGPRESS_DURATION, DEBOUNCE_VALUE);
 
-  // Rainbow LED visual effect - indicate calibration
-  RainbowLED(RAINBOW_DURATION, RAINBOW_RATE);
+  if(!Touch.Update(Field, CommonIO[Field].TouchDiagnosisValue, millis())) return;
 
-  // Adjust LEDs to indicate button states
-  SetLEDs();
+  // Motor interference would spoil the reference; retried when the shutter stops
+  if(Variant.Busy()) return;
+
+  CommonIO[Field].ReadReference();
+  Touch.Rebase(Field);
 }
 
 /**
@@ -671,83 +643,30 @@ void ReadNewReference() {
  * @param message incoming message data
  */
 void receive(const MyMessage &message)  {
-  
-  // Binary messages
-  if (message.type == V_STATUS) {
-    #ifdef SPECIAL_BUTTON
-      if (message.sensor == SPECIAL_BUTTON_ID || message.sensor == SPECIAL_BUTTON_ID+1)  {
-        // Ignore this message
-      }
-    #endif
-    if(HardwareVariant == 1)  {
-      if (message.sensor == DIMMER_ID) {
-        Dimmer.ChangeState(message.getBool());
-        SetLEDs();
-      }
-    }
-    if(HardwareVariant == 0 && LoadVariant != 2)  {
-      if (message.sensor == RELAY_ID_1 || message.sensor == RELAY_ID_2)  {
-        if (!OVERCURRENT_ERROR) {
-          CommonIO[message.sensor].SetState(message.getBool());
-          CommonIO[message.sensor].SetRelay();
-          AdjustLEDs(CommonIO[message.sensor].State, message.sensor);
-          #ifdef RS485_DEBUG
-            send(MsgCUSTOM.setSensor(TOUCH_DIAGNOSTIC_ID).set(CommonIO[message.sensor].DebugValue));
-          #endif
-        }
-      }
-    }
-  }
-  // Percentage messages
-  else if (message.type == V_PERCENTAGE) {
-    if(HardwareVariant == 0 && LoadVariant == 2)  {
-      // Roller shutter position
-      if(message.sensor == SHUTTER_ID) {
-        int NewPosition = atoi(message.data);
-        NewPosition = NewPosition > 100 ? 100 : NewPosition;
-        NewPosition = NewPosition < 0 ? 0 : NewPosition;
-        Shutter.NewState = 2;
-        ShutterUpdate(0);
-        MovementTime = Shutter.ReadNewPosition(NewPosition) * 10;
-      }
-    }
-    else if(HardwareVariant == 1)  {
-      if(message.sensor == DIMMER_ID) {
-        // Dimming value for dimmers (all variants)
-        Dimmer.NewDimmingLevel = atoi(message.data);
-        Dimmer.NewDimmingLevel = Dimmer.NewDimmingLevel > 100 ? 100 : Dimmer.NewDimmingLevel;
-        Dimmer.NewDimmingLevel = Dimmer.NewDimmingLevel < 0 ? 0 : Dimmer.NewDimmingLevel;
-      }
-    }
-  }
-  // RGB/RGBW messages
-  else if (message.type == V_RGB || message.type == V_RGBW) {
-    if(HardwareVariant == 1 && LoadVariant != 2)  {
-      if(message.sensor == DIMMER_ID) {
-        const char *rgbvalues = message.getString();
 
-        Dimmer.NewColorValues(rgbvalues);
-      }
-    }
-  }
-  // Roller shutter control messages (UP, DOWN, STOP)
-  else if(message.type == V_UP) {
-    if(HardwareVariant == 0 && LoadVariant == 2 && message.sensor == SHUTTER_ID)  {
-      MovementTime = Shutter.ReadMessage(0) * 1000;
-    }
-  }
-  else if(message.type == V_DOWN) {
-    if(HardwareVariant == 0 && LoadVariant == 2 && message.sensor == SHUTTER_ID)  {
-      MovementTime = Shutter.ReadMessage(1) * 1000;
-    }
-  }
-  else if(message.type == V_STOP) {
-    if(HardwareVariant == 0 && LoadVariant == 2 && message.sensor == SHUTTER_ID)  {
-      MovementTime = Shutter.ReadMessage(2);
+  // Manifest hash stored by the controller
+  if(Presentation.Receive(message)) return;
+
+  // Profiler data requested
+  #ifdef LOOP_PROFILING
+    if(message.sensor == DEBUG_ID && message.type == V_CUSTOM && message.getCommand() == C_REQ)  {
+      Prof.Read(ProfData);
+      send(MsgCUSTOM.setSensor(DEBUG_ID).set(&ProfData, sizeof(ProfData)));
+      Prof.Reset();
+      return;
     }
+  #endif
+
+  // Reply to a startup request
+  if (!SyncComplete && SyncPending > 0 && message.getCommand() == C_SET && message.sensor != CONFIGURATION_SENSOR_ID) {
+    SyncPending--;
   }
+  
+  // Output control messages
+  Variant.Receive(message);
+
   // Text messages
-  else if(message.type == V_TEXT) {
+  if(message.type == V_TEXT) {
     // Configuration by message
     if(message.sensor == CONFIGURATION_SENSOR_ID)  {
       
@@ -761,11 +680,8 @@ void receive(const MyMessage &message)  {
       send(MsgTEXT.setSensor(CONFIGURATION_SENSOR_ID).set(RPaddr));
 
       if(RPstr.equals(CONF_MSG_1)) {
-        if(HardwareVariant == 0 && LoadVariant == 2)  {
-          // Roller shutter: calibration
-          float Vcc = ReadVcc();
-          ShutterCalibration(Vcc);
-        }
+        // Roller shutter: calibration, runs in background
+        Variant.Calibrate();
       }
       else if(RPstr.equals(CONF_MSG_2)) {
         // Touch fields calibration
@@ -793,16 +709,24 @@ void receive(const MyMessage &message)  {
 void ETUpdate()  {
 
   #ifdef SHT30
+    uint32_t Now = millis();
+
     if(sht.readSample())  {
-      ET_ERROR = 0;
-      send(MsgSTATUS.setSensor(ETS_ID).set(ET_ERROR));
-      send(MsgTEMP.setSensor(ETT_ID).setDestination(0).set(sht.getTemperature(), 1));
-      send(MsgHUM.setSensor(ETH_ID).set(sht.getHumidity(), 1));
-      #ifdef HEATING_SECTION_SENSOR
-        send(MsgTEMP.setSensor(ETT_ID).setDestination(MY_HEATING_CONTROLLER).set(sht.getTemperature(), 1));
-      #endif
+      if(ET_ERROR)  {
+        ET_ERROR = 0;
+        send(MsgSTATUS.setSensor(ETS_ID).set(ET_ERROR));
+      }
+      if(ETTPolicy.Update(sht.getTemperature(), Now)) {
+        send(MsgTEMP.setSensor(ETT_ID).setDestination(0).set(ETTPolicy.Value(), 1));
+        #ifdef HEATING_SECTION_SENSOR
+          send(MsgTEMP.setSensor(ETT_ID).setDestination(MY_HEATING_CONTROLLER).set(ETTPolicy.Value(), 1));
+        #endif
+      }
+      if(ETHPolicy.Update(sht.getHumidity(), Now))  {
+        send(MsgHUM.setSensor(ETH_ID).set(ETHPolicy.Value(), 1));
+      }
     }
-    else  {
+    else if(!ET_ERROR)  {
       ET_ERROR = 1;
       send(MsgSTATUS.setSensor(ETS_ID).set(ET_ERROR));
     }
@@ -816,7 +740,7 @@ void ETUpdate()  {
 void UpdateIO() {
 
   for(int i=0; i<Iterations; i++) {
-    CommonIO[i].CheckInput2(TOUCH_THRESHOLD, LONGPRESS_DURATION, DEBOUNCE_VALUE);
+    ReadTouchField(i);
     
     if(CommonIO[i].NewState == CommonIO[i].State)  {
       continue;
@@ -824,38 +748,7 @@ void UpdateIO() {
     
     // Binary states
     if(CommonIO[i].NewState != 2)  {
-      // 2Relay Board
-      if(HardwareVariant == 0)  {
-        // Load: lighting
-        if(LoadVariant != 2)  {
-          CommonIO[i].SetRelay();
-          AdjustLEDs(CommonIO[i].NewState, i);
-          send(MsgSTATUS.setSensor(i).set(CommonIO[i].NewState));
-        }
-        // Load: roller shutter
-        else  {
-          MovementTime = Shutter.ReadButtons(i) * 1000;
-          CommonIO[i].State = CommonIO[i].NewState;
-        }
-      }
-      // RGBW Board
-      else if(HardwareVariant == 1) {
-        // Changing dimmer state (ON/OFF)
-        if(i == 0 || (i == 1 && !Dimmer.CurrentState))  {          
-          Dimmer.ChangeState(!Dimmer.CurrentState);
-          AdjustLEDs(Dimmer.CurrentState, i);
-          send(MsgSTATUS.setSensor(DIMMER_ID).set(Dimmer.CurrentState));
-          CommonIO[i].State = CommonIO[i].NewState;
-        }
-        else if(i == 1 && Dimmer.CurrentState) {
-          // Toggle dimming level by DIMMING_TOGGLE_STEP
-          Dimmer.NewDimmingLevel += DIMMING_TOGGLE_STEP;
-
-          Dimmer.NewDimmingLevel = Dimmer.NewDimmingLevel > 100 ? DIMMING_TOGGLE_STEP : Dimmer.NewDimmingLevel;
-          send(MsgPERCENTAGE.setSensor(DIMMER_ID).set(Dimmer.NewDimmingLevel));
-          CommonIO[i].NewState = CommonIO[i].State;
-        }
-      }
+      Variant.Button(i);
     }
     // Longpress
     else  {
@@ -875,159 +768,152 @@ void UpdateIO() {
 }
 
 /**
- * @brief Measures shutter movement duration; calls class Calibration() function to save measured durations
+ * @brief Starts shutter calibration; measurements run in background from CalibrationUpdate()
  * 
- * @param Vcc current uC voltage
  */
-void ShutterCalibration(float Vcc)  {
+void StartCalibration()  {
 
-  float Current = 0;
-  uint16_t DownTimeCumulated = 0;
-  uint16_t UpTimeCumulated = 0;
-  uint32_t StartTime = 0;
-  uint32_t StopTime = 0;
-  uint32_t MeasuredTime = 0;
+  // Stop current movement first
+  ShutterStop();
 
   // Indicate inactivity of buttons with builtin LEDs
   BlinkLEDs(3);
+  LastCalibrationBlink = millis();
 
-  // Open the shutter  
-  Shutter.NewState = 0;
-  Shutter.Movement();
-
-  do  {
-    delay(500);
-    BlinkLEDs();
-    wdt_reset();
-    Current = PS.MeasureAC(Vcc);
-  } while(Current > PS_OFFSET);
+  Calibrator.Begin(millis());
+  send(MsgTEXT.setSensor(CONFIGURATION_SENSOR_ID).set("CAL START"));
+}
 
-  Shutter.NewState = 2;
-  Shutter.Movement();
+/**
+ * @brief Stops calibration in progress; every shutter command (including STOP) and safety stop aborts calibration
+ * 
+ * @return true if calibration was aborted
+ */
+bool CalibrationAbort() {
 
-  delay(1000);
+  if(Calibrator.Active()) {
+    Calibrator.Abort();
+    send(MsgTEXT.setSensor(CONFIGURATION_SENSOR_ID).set("CAL ABORTED"));
+    send(MsgSTOP.setSensor(SHUTTER_ID));
+    SetLEDs();
+    return true;
+  }
 
-  // Calibrating
-  for(int i=0; i<CALIBRATION_SAMPLES; i++) {
-    for(int j=1; j>=0; j--)  {
-      Shutter.NewState = j;
-      Shutter.Movement();
-      StartTime = millis();
+  return false;
+}
 
-      do  {
-        delay(250);
-        BlinkLEDs();
-        Current = PS.MeasureAC(Vcc);
-        StopTime = millis();
-        wdt_reset();
-      } while(Current > PS_OFFSET);
+/**
+ * @brief Calibration step: checks motor current, reports progress, saves measured travel times
+ * 
+ * @param Current current measured by power sensor
+ */
+void CalibrationUpdate(float Current)  {
 
-      Shutter.NewState = 2;
-      Shutter.Movement();
+  uint32_t Now = millis();
+  char Text[12];
 
-      MeasuredTime = StopTime - StartTime;
+  if(Now - LastCalibrationBlink >= CALIBRATION_PAUSE / 2) {
+    BlinkLEDs();
+    LastCalibrationBlink = Now;
+  }
 
-      if(j) {
-        DownTimeCumulated += (int)(MeasuredTime / 1000);
-      }
-      else  {
-        UpTimeCumulated += (int)(MeasuredTime / 1000);
-      }
+  switch(Calibrator.Update(Now, Current > PS_OFFSET)) {
+    case CALIBRATION_PROGRESS:
+      snprintf(Text, sizeof(Text), "CAL %u%%", Calibrator.Progress());
+      send(MsgTEXT.setSensor(CONFIGURATION_SENSOR_ID).set(Text));
+      break;
+    case CALIBRATION_DONE:
+      PROFILE_START(PROF_EEPROM);
+      EEPROM.put(EEA_SHUTTER_TRAVEL_DOWN, Calibrator.DownTime);
+      EEPROM.put(EEA_SHUTTER_TRAVEL_UP, Calibrator.UpTime);
+      PROFILE_END(PROF_EEPROM);
+      // Legacy values in seconds (add 1 s to each duration)
+      Shutter.Calibration(Calibrator.UpTime / 1000 + 1, Calibrator.DownTime / 1000 + 1);
+      SetShutterTimes();
+
+      Shutter.Position = 0;
+      EEPROM.put(EEA_SHUTTER_POSITION, Shutter.Position);
+
+      // Inform Controller about the current state of roller shutter
+      send(MsgTEXT.setSensor(CONFIGURATION_SENSOR_ID).set("CAL DONE"));
+      send(MsgSTOP.setSensor(SHUTTER_ID));
+      send(MsgPERCENTAGE.setSensor(SHUTTER_ID).set(Shutter.Position));
 
-      delay(1000);
-    }
+      // Change LED indication to normal again
+      SetLEDs();
+      break;
+    case CALIBRATION_FAILED:
+      send(MsgTEXT.setSensor(CONFIGURATION_SENSOR_ID).set("CAL FAILED"));
+      send(MsgSTOP.setSensor(SHUTTER_ID));
+      SetLEDs();
+      break;
+    default:
+      break;
   }
+}
 
-  Shutter.Position = 0;
+/**
+ * @brief Loads travel times measured by calibration (manually defined UP_TIME / DOWN_TIME if not calibrated)
+ * 
+ */
+void SetShutterTimes()  {
 
-  // Calculate movement durations
-  uint8_t DownTime = (int)(DownTimeCumulated / CALIBRATION_SAMPLES);
-  uint8_t UpTime = (int)(UpTimeCumulated / CALIBRATION_SAMPLES);
+  uint32_t DownTime;
+  uint32_t UpTime;
 
-  // Pass movement durations to the object (add 1 s to each duration)
-  Shutter.Calibration(UpTime+1, DownTime+1);
+  EEPROM.get(EEA_SHUTTER_TRAVEL_DOWN, DownTime);
+  EEPROM.get(EEA_SHUTTER_TRAVEL_UP, UpTime);
 
-  EEPROM.put(EEA_SHUTTER_TIME_DOWN, DownTime);
-  EEPROM.put(EEA_SHUTTER_TIME_UP, UpTime);
-  EEPROM.put(EEA_SHUTTER_POSITION, Shutter.Position);
+  // Not calibrated in ms: times in seconds saved by older software or manually defined
+  if(DownTime == 0 || DownTime > CALIBRATION_TIMEOUT || UpTime == 0 || UpTime > CALIBRATION_TIMEOUT)  {
+    uint8_t Down = EEPROM.read(EEA_SHUTTER_TIME_DOWN);
+    uint8_t Up = EEPROM.read(EEA_SHUTTER_TIME_UP);
 
-  // Inform Controller about the current state of roller shutter
-  send(MsgSTOP.setSensor(SHUTTER_ID));
-  send(MsgPERCENTAGE.setSensor(SHUTTER_ID).set(Shutter.Position));
+    DownTime = (Down > 0 && Down < 0xFF ? Down : DOWN_TIME) * 1000UL;
+    UpTime = (Up > 0 && Up < 0xFF ? Up : UP_TIME) * 1000UL;
+  }
 
-  // Change LED indication to normal again
-  SetLEDs();
+  Motion.SetTimes(UpTime, DownTime, SHUTTER_DEADTIME);
 }
 
 /**
- * @brief Updates shutter condition, informs controller about shutter condition and position
+ * @brief Applies shutter requests from buttons & controller, stop deadlines and dead-time;
+ * informs controller about shutter movement and position, position is streamed during movement
  * 
  */
-void ShutterUpdate(float Current) {
+void ShutterUpdate() {
 
-  uint32_t StopTime = 0;
-  uint32_t MeasuredTime;
-  uint8_t TempState = 2;
-  bool Direction;
-
-  if(Shutter.State != 2) {
-    if((millis() >= StartTime + MovementTime) || (Current < PS_OFFSET)) {
-      StopTime = millis();
-    }
-    else if(millis() < StartTime)  {
-      uint32_t Temp = 4294967295 - StartTime + millis();
-      wait(MovementTime - Temp);
-      StartTime = 0;
-      StopTime = MovementTime;
-    }
-  }
+  uint32_t Now = millis();
+  uint8_t Event = Motion.Update(Now);
 
-  if(Shutter.State != Shutter.NewState) {
-    if(Shutter.NewState != 2)  {
-      if(Shutter.State == 2)  {
-        ShutterStart();
-      }
-      else  {
-        TempState = Shutter.NewState;
-        StopTime = millis();
-      }
-    }
-    else  {
-      StopTime = millis();
-    }
+  if(Event == SHUTTER_STARTED)  {
+    SetLEDs();
+    Shutter.State == SHUTTER_UP ? send(MsgUP.setSensor(SHUTTER_ID)) : send(MsgDOWN.setSensor(SHUTTER_ID));
+    LastPositionReport = Now;
   }
-
-  if(StopTime > 0)  {
-    Direction = Shutter.State;
-    Shutter.NewState = 2;
-    Shutter.Movement();
+  else if(Event == SHUTTER_STOPPED) {
     SetLEDs();
     send(MsgSTOP.setSensor(SHUTTER_ID));
-
-    MeasuredTime = StopTime - StartTime;
-    Shutter.CalculatePosition(Direction, MeasuredTime);
-    EEPROM.put(EEA_SHUTTER_POSITION, Shutter.Position);
-  
     send(MsgPERCENTAGE.setSensor(SHUTTER_ID).set(Shutter.Position));
-  
-    if(TempState != 2)  {
-      wait(500);
-      Shutter.NewState = TempState;
-      ShutterStart();
-    }
+    PROFILE_START(PROF_EEPROM);
+    EEPROM.put(EEA_SHUTTER_POSITION, Shutter.Position);
+    PROFILE_END(PROF_EEPROM);
+  }
+  else if(Motion.Moving() && SHUTTER_REPORT_INTERVAL > 0 && Now - LastPositionReport >= SHUTTER_REPORT_INTERVAL) {
+    send(MsgPERCENTAGE.setSensor(SHUTTER_ID).set(Motion.Position(Now)));
+    LastPositionReport = Now;
   }
 }
 
-void ShutterStart() {
-
-  Shutter.Movement();
-  StartTime = millis();
-
-  Shutter.NewState == 0 ? send(MsgUP.setSensor(SHUTTER_ID)) : send(MsgDOWN.setSensor(SHUTTER_ID));
-
-  SetLEDs();
+/**
+ * @brief Stops shutter at once (safety, touch reference reading)
+ * 
+ */
+void ShutterStop()  {
 
-  wait(500);
+  CalibrationAbort();
+  Motion.Move(SHUTTER_STOP);
+  ShutterUpdate();
 }
 
 /**
@@ -1038,12 +924,9 @@ void ShutterStart() {
  */
 void PSUpdate(float Current, uint8_t Sensor = 0)  {
 
-  if(Current == 0 && PS.OldValue == 0)  return;
-  else if(Current < 1 && (abs(PS.OldValue - Current) < 0.1)) return;
-  else if(Current >= 1 && (abs(PS.OldValue - Current) < (0.1 * PS.OldValue))) return;
-  
-  send(MsgWATT.setSensor(PS_ID).set(PS.CalculatePower(Current, COSFI), 0));
-  PS.OldValue = Current;
+  if(!PSPolicy.Update(Current, millis())) return;
+
+  send(MsgWATT.setSensor(PS_ID).set(PS.CalculatePower(PSPolicy.Value(), COSFI), 0));
 }
 
 /**
@@ -1072,39 +955,534 @@ long ReadVcc() {
   return result;
 }
 
+/***** Load variants *****/
 /**
- * @brief main loop: calls all 'Update' functions, runs all measurements, checks if safety parameters are within limits
+ * @brief Initializes outputs & inputs of 2Relay Board, lighting: one button, single output
  * 
  */
-void loop() {
+void Relay1cSetup()  {
 
-  float Vcc = ReadVcc(); // mV
-  float Current = 0;
+  CommonIO[RELAY_ID_1].SetValues(RELAY_OFF, false, 6, TOUCH_FIELD_3, INPUT_PIN_1, RELAY_PIN_1);
+  // Not used touch field for calibration purposes
+  CommonIO[UNUSED_TF_ID].SetValues(RELAY_OFF, false, 5, TOUCH_FIELD_1);
+}
 
-  // Sending out states for the first time (as required by Home Assistant)
-  if (!InitConfirm)  {
-    InitConfirmation();
-  }
+/**
+ * @brief Initializes outputs & inputs of 2Relay Board, lighting: two buttons, double output
+ * 
+ */
+void Relay2cSetup()  {
 
-  // Reading power sensor
-  #ifdef POWER_SENSOR
-    // 2Relay Board
-    if(HardwareVariant == 0)  {
-      if (digitalRead(RELAY_PIN_1) == RELAY_ON || digitalRead(RELAY_PIN_2) == RELAY_ON)  {
-        Current = PS.MeasureAC(Vcc);
-      }
-    }
-    // RGBW Board
-    if(HardwareVariant == 1)  {
-      if (Dimmer.CurrentState)  {
-        Current = PS.MeasureDC(Vcc);
-      }
-    }
+  CommonIO[RELAY_ID_1].SetValues(RELAY_OFF, false, 6, TOUCH_FIELD_1, INPUT_PIN_1, RELAY_PIN_1);
+  CommonIO[RELAY_ID_2].SetValues(RELAY_OFF, false, 6, TOUCH_FIELD_2, INPUT_PIN_2, RELAY_PIN_2);
+  // Not used touch field for calibration purposes
+  CommonIO[UNUSED_TF_ID].SetValues(RELAY_OFF, false, 5, TOUCH_FIELD_3);
+}
 
-    PSUpdate(Current);
-      
-    #ifdef ERROR_REPORTING
-      OVERCURRENT_ERROR = PS.ElectricalStatus(Current);
+/**
+ * @brief Initializes outputs & inputs of 2Relay Board, roller shutter
+ * 
+ */
+void ShutterSetup()  {
+
+  CommonIO[SHUTTER_ID].SetValues(RELAY_OFF, false, 5, TOUCH_FIELD_1);
+  CommonIO[SHUTTER_ID + 1].SetValues(RELAY_OFF, false, 5, TOUCH_FIELD_2);
+  // Not used touch field for calibration purposes
+  CommonIO[UNUSED_TF_ID].SetValues(RELAY_OFF, false, 5, TOUCH_FIELD_3);
+  Shutter.SetOutputs(RELAY_OFF, RELAY_PIN_1, RELAY_PIN_2);
+  // Temporary calibration (first launch only)
+  if(!Shutter.Calibrated) {
+    Shutter.Calibration(UP_TIME, DOWN_TIME);
+  }
+  SetShutterTimes();
+}
+
+/**
+ * @brief Initializes buttons of RGBW Board; every dimmer has two buttons
+ * 
+ */
+void DimmerButtonsSetup()  {
+
+  CommonIO[0].SetValues(RELAY_OFF, false, 5, TOUCH_FIELD_1);
+  CommonIO[1].SetValues(RELAY_OFF, false, 5, TOUCH_FIELD_2);
+  // Not used touch field for calibration purposes
+  CommonIO[UNUSED_TF_ID].SetValues(RELAY_OFF, false, 5, TOUCH_FIELD_3);
+}
+
+/**
+ * @brief Initializes outputs & inputs of RGBW Board, RGB dimmer
+ * 
+ */
+void RGBSetup()  {
+
+  Dimmer.SetValues(NUMBER_OF_CHANNELS, DIMMING_STEP, DIMMING_INTERVAL, LED_PIN_R, LED_PIN_G, LED_PIN_B);
+  DimmerButtonsSetup();
+}
+
+/**
+ * @brief Initializes outputs & inputs of RGBW Board, RGBW dimmer
+ * 
+ */
+void RGBWSetup()  {
+
+  Dimmer.SetValues(NUMBER_OF_CHANNELS, DIMMING_STEP, DIMMING_INTERVAL, LED_PIN_R, LED_PIN_G, LED_PIN_B, LED_PIN_W);
+  DimmerButtonsSetup();
+}
+
+/**
+ * @brief Initializes outputs & inputs of RGBW Board, 1-channel dimmer
+ * 
+ */
+void DimmerSetup()  {
+
+  Dimmer.SetValues(NUMBER_OF_CHANNELS, DIMMING_STEP, DIMMING_INTERVAL, LED_PIN_W);
+  DimmerButtonsSetup();
+}
+
+/**
+ * @brief Sends initial states of relays (single or double output)
+ * 
+ */
+void RelayConfirm()  {
+
+  for(int i=RELAY_ID_1; i<RELAY_ID_1+Iterations; i++) {
+    send(MsgSTATUS.setSensor(i).set(CommonIO[i].NewState));
+    SyncRequest(i, V_STATUS);
+  }
+}
+
+/**
+ * @brief Sends initial state of roller shutter
+ * 
+ */
+void ShutterConfirm()  {
+
+  send(MsgUP.setSensor(SHUTTER_ID).set(0));
+  SyncRequest(SHUTTER_ID, V_UP);
+
+  send(MsgDOWN.setSensor(SHUTTER_ID).set(0));
+  SyncRequest(SHUTTER_ID, V_DOWN);
+
+  send(MsgSTOP.setSensor(SHUTTER_ID).set(0));
+  SyncRequest(SHUTTER_ID, V_STOP);
+
+  send(MsgPERCENTAGE.setSensor(SHUTTER_ID).set(Shutter.Position));
+  SyncRequest(SHUTTER_ID, V_PERCENTAGE);
+}
+
+/**
+ * @brief Sends initial state & dimming level of dimmer (all variants)
+ * 
+ */
+void DimmerConfirm()  {
+
+  send(MsgSTATUS.setSensor(DIMMER_ID).set(false));
+  SyncRequest(DIMMER_ID, V_STATUS);
+
+  send(MsgPERCENTAGE.setSensor(DIMMER_ID).set(Dimmer.NewDimmingLevel));
+  SyncRequest(DIMMER_ID, V_PERCENTAGE);
+}
+
+/**
+ * @brief Sends initial state of RGB dimmer
+ * 
+ */
+void RGBConfirm()  {
+
+  DimmerConfirm();
+  send(MsgRGB.setSensor(DIMMER_ID).set("ffffff"));
+  SyncRequest(DIMMER_ID, V_RGB);
+}
+
+/**
+ * @brief Sends initial state of RGBW dimmer
+ * 
+ */
+void RGBWConfirm()  {
+
+  DimmerConfirm();
+  send(MsgRGBW.setSensor(DIMMER_ID).set("ffffffff"));
+  SyncRequest(DIMMER_ID, V_RGBW);
+}
+
+/**
+ * @brief Lighting: switches relay according to button state
+ * 
+ * @param Button number of button (ID)
+ */
+void RelayButton(uint8_t Button)  {
+
+  CommonIO[Button].SetRelay();
+  AdjustLEDs(CommonIO[Button].NewState, Button);
+  send(MsgSTATUS.setSensor(Button).set(CommonIO[Button].NewState));
+}
+
+/**
+ * @brief Roller shutter: moves or stops shutter according to button state
+ * 
+ * @param Button number of button (ID)
+ */
+void ShutterButton(uint8_t Button)  {
+
+  if(!CalibrationAbort()) {
+    Motion.Button(Button);
+  }
+  CommonIO[Button].State = CommonIO[Button].NewState;
+}
+
+/**
+ * @brief Dimmer: changes dimmer state (ON/OFF) or toggles dimming level
+ * 
+ * @param Button number of button (ID)
+ */
+void DimmerButton(uint8_t Button)  {
+
+  if(Button == 0 || (Button == 1 && !Dimmer.CurrentState))  {
+    Dimmer.ChangeState(!Dimmer.CurrentState);
+    AdjustLEDs(Dimmer.CurrentState, Button);
+    send(MsgSTATUS.setSensor(DIMMER_ID).set(Dimmer.CurrentState));
+    CommonIO[Button].State = CommonIO[Button].NewState;
+  }
+  else if(Button == 1 && Dimmer.CurrentState) {
+    // Toggle dimming level by DIMMING_TOGGLE_STEP
+    Dimmer.NewDimmingLevel += DIMMING_TOGGLE_STEP;
+
+    Dimmer.NewDimmingLevel = Dimmer.NewDimmingLevel > 100 ? DIMMING_TOGGLE_STEP : Dimmer.NewDimmingLevel;
+    send(MsgPERCENTAGE.setSensor(DIMMER_ID).set(Dimmer.NewDimmingLevel));
+    CommonIO[Button].NewState = CommonIO[Button].State;
+  }
+}
+
+/**
+ * @brief Lighting: handles relay messages
+ * 
+ * @param message incoming message data
+ */
+void RelayReceive(const MyMessage &message)  {
+
+  if(message.type != V_STATUS || (message.sensor != RELAY_ID_1 && message.sensor != RELAY_ID_2)) return;
+
+  if (!OVERCURRENT_ERROR) {
+    CommonIO[message.sensor].SetState(message.getBool());
+    CommonIO[message.sensor].SetRelay();
+    AdjustLEDs(CommonIO[message.sensor].State, message.sensor);
+    #ifdef RS485_DEBUG
+      send(MsgCUSTOM.setSensor(TOUCH_DIAGNOSTIC_ID).set(CommonIO[message.sensor].DebugValue));
+    #endif
+  }
+}
+
+/**
+ * @brief Roller shutter: handles position & control messages (UP, DOWN, STOP); every command aborts calibration
+ * 
+ * @param message incoming message data
+ */
+void ShutterReceive(const MyMessage &message)  {
+
+  if(message.sensor != SHUTTER_ID) return;
+
+  if(message.type == V_PERCENTAGE) {
+    int NewPosition = atoi(message.data);
+    NewPosition = NewPosition > 100 ? 100 : NewPosition;
+    NewPosition = NewPosition < 0 ? 0 : NewPosition;
+    if(!CalibrationAbort()) {
+      Motion.MoveTo(NewPosition);
+    }
+  }
+  else if(message.type == V_UP) {
+    if(!CalibrationAbort()) Motion.Move(SHUTTER_UP);
+  }
+  else if(message.type == V_DOWN) {
+    if(!CalibrationAbort()) Motion.Move(SHUTTER_DOWN);
+  }
+  else if(message.type == V_STOP) {
+    if(!CalibrationAbort()) Motion.Move(SHUTTER_STOP);
+  }
+}
+
+/**
+ * @brief Dimmer: handles state & dimming level messages (all variants)
+ * 
+ * @param message incoming message data
+ */
+void DimmerReceive(const MyMessage &message)  {
+
+  if(message.sensor != DIMMER_ID) return;
+
+  if(message.type == V_STATUS) {
+    Dimmer.ChangeState(message.getBool());
+    SetLEDs();
+  }
+  else if(message.type == V_PERCENTAGE) {
+    Dimmer.NewDimmingLevel = atoi(message.data);
+    Dimmer.NewDimmingLevel = Dimmer.NewDimmingLevel > 100 ? 100 : Dimmer.NewDimmingLevel;
+    Dimmer.NewDimmingLevel = Dimmer.NewDimmingLevel < 0 ? 0 : Dimmer.NewDimmingLevel;
+  }
+}
+
+/**
+ * @brief RGB/RGBW dimmer: handles color messages, other messages as every dimmer
+ * 
+ * @param message incoming message data
+ */
+void ColorReceive(const MyMessage &message)  {
+
+  if(message.sensor == DIMMER_ID && (message.type == V_RGB || message.type == V_RGBW)) {
+    Dimmer.NewColorValues(message.getString());
+  }
+  else  {
+    DimmerReceive(message);
+  }
+}
+
+/**
+ * @brief Lighting: LEDs indicate relay states
+ * 
+ */
+void RelayLEDs()  {
+
+  for(int i=0; i<Iterations; i++) {
+    AdjustLEDs(CommonIO[i].State, i);
+  }
+}
+
+/**
+ * @brief Roller shutter: LEDs indicate movement direction
+ * 
+ */
+void ShutterLEDs()  {
+
+  if(Shutter.State == 2) {
+    AdjustLEDs(0, 0); AdjustLEDs(0, 1);
+  }
+  else if(Shutter.State == 1)  {
+    AdjustLEDs(0, 0); AdjustLEDs(1, 1);
+  }
+  else if(Shutter.State == 0)  {
+    AdjustLEDs(1, 0); AdjustLEDs(0, 1);
+  }
+}
+
+/**
+ * @brief Dimmer: LED indicates dimmer state
+ * 
+ */
+void DimmerLEDs()  {
+
+  AdjustLEDs(Dimmer.CurrentState ? 1 : 0, 0);
+  AdjustLEDs(0, 1);
+}
+
+/**
+ * @brief Roller shutter: runs calibration or motion, detects end position by current
+ * 
+ * @param Current current measured by power sensor
+ */
+void ShutterLoop(float Current)  {
+
+  if(Calibrator.Active())  {
+    // Shutter calibration in progress
+    CalibrationUpdate(Current);
+    return;
+  }
+
+  // Shutter reached its end position
+  #ifdef POWER_SENSOR
+    if(Motion.Moving() && Current < PS_OFFSET) {
+      Motion.EndReached();
+    }
+  #endif
+  PROFILE_START(PROF_SHUTTER_UPDATE);
+  ShutterUpdate();
+  PROFILE_END(PROF_SHUTTER_UPDATE);
+}
+
+/**
+ * @brief Dimmer: runs dimming
+ * 
+ * @param Current current measured by power sensor
+ */
+void DimmerLoop(float Current)  {
+
+  Dimmer.UpdateDimmer();
+}
+
+/**
+ * @brief Lighting: relays need no background work
+ * 
+ * @param Current current measured by power sensor
+ */
+void RelayLoop(float Current)  {}
+
+/**
+ * @brief 2Relay Board: measures AC current while any relay is on
+ * 
+ * @param Vcc uC supply voltage (mV)
+ * @return float measured current
+ */
+float RelayMeasure(float Vcc)  {
+
+  #ifdef POWER_SENSOR
+    if (digitalRead(RELAY_PIN_1) == RELAY_ON || digitalRead(RELAY_PIN_2) == RELAY_ON)  {
+      return PS.MeasureAC(Vcc);
+    }
+  #endif
+
+  return 0;
+}
+
+/**
+ * @brief RGBW Board: measures DC current while dimmer is on
+ * 
+ * @param Vcc uC supply voltage (mV)
+ * @return float measured current
+ */
+float DimmerMeasure(float Vcc)  {
+
+  #ifdef POWER_SENSOR
+    if (Dimmer.CurrentState)  {
+      return PS.MeasureDC(Vcc);
+    }
+  #endif
+
+  return 0;
+}
+
+/**
+ * @brief Lighting: switches all relays off
+ * 
+ */
+void RelayCutoff()  {
+
+  for (int i = RELAY_ID_1; i < RELAY_ID_1 + NUMBER_OF_RELAYS; i++)  {
+    CommonIO[i].SetState(RELAY_OFF);
+    CommonIO[i].SetRelay();
+    send(MsgSTATUS.setSensor(i).set(RELAY_OFF));
+  }
+}
+
+/**
+ * @brief Dimmer: switches dimmer off
+ * 
+ */
+void DimmerCutoff()  {
+
+  Dimmer.ChangeState(false);
+  send(MsgSTATUS.setSensor(DIMMER_ID).set(Dimmer.CurrentState));
+}
+
+/**
+ * @brief Roller shutter: motor interference disturbs touch fields
+ * 
+ */
+bool ShutterBusy()  {
+
+  return Motion.Moving();
+}
+
+/**
+ * @brief Lighting & dimmers don't disturb touch fields
+ * 
+ */
+bool NotBusy()  {
+
+  return false;
+}
+
+/**
+ * @brief Configuration message not supported by the variant
+ * 
+ */
+void NoAction()  {}
+
+// Setup, Confirm, Button, Receive, SetLEDs, Update, Measure, Cutoff, Busy, Calibrate
+#define RELAY_HANDLERS(Setup) {Setup, RelayConfirm, RelayButton, RelayReceive, RelayLEDs, RelayLoop, RelayMeasure, RelayCutoff, NotBusy, NoAction}
+#define SHUTTER_HANDLERS {ShutterSetup, ShutterConfirm, ShutterButton, ShutterReceive, ShutterLEDs, ShutterLoop, RelayMeasure, ShutterStop, ShutterBusy, StartCalibration}
+#define DIMMER_HANDLERS(Setup, Confirm, Receive) {Setup, Confirm, DimmerButton, Receive, DimmerLEDs, DimmerLoop, DimmerMeasure, DimmerCutoff, NotBusy, NoAction}
+
+// [HardwareVariant][LoadVariant]: 2R-1c, 2R-2c, 2R-Shutter; D-3c, D-4c, D-1c
+const VariantHandler VariantHandlers[2][3] PROGMEM = {
+  {RELAY_HANDLERS(Relay1cSetup), RELAY_HANDLERS(Relay2cSetup), SHUTTER_HANDLERS},
+  {DIMMER_HANDLERS(RGBSetup, RGBConfirm, ColorReceive), DIMMER_HANDLERS(RGBWSetup, RGBWConfirm, ColorReceive), DIMMER_HANDLERS(DimmerSetup, DimmerConfirm, DimmerReceive)}
+};
+
+/**
+ * @brief Binds handlers of detected variant & constructs its load objects; called once from before()
+ * 
+ */
+void BindVariant()  {
+
+  memcpy_P(&Variant, &VariantHandlers[HardwareVariant][LoadVariant], sizeof(Variant));
+
+  if(HardwareVariant == 0 && LoadVariant == 2)  {
+    new (&Loads.Shutter) ShutterObjects;
+  }
+  else if(HardwareVariant == 1)  {
+    new (&Loads.Dimmer) class Dimmer;
+  }
+}
+
+#ifdef LOOP_PROFILING
+/**
+ * @brief Called by MySensors right after every watchdog reset (and by delay())
+ * 
+ */
+void yield()  {
+
+  Prof.WatchdogReset();
+}
+
+/**
+ * @brief MySensors indication handler: counts failed transmissions
+ * 
+ * @param Indication indication type
+ */
+void indication(const indication_t Indication)  {
+
+  if(Indication == INDICATION_ERR_TX) {
+    Prof.SendFailed();
+  }
+}
+#endif
+
+/**
+ * @brief main loop: calls all 'Update' functions, runs all measurements, checks if safety parameters are within limits
+ * 
+ */
+void loop() {
+
+  #ifdef LOOP_PROFILING
+    Prof.LoopStart();
+  #endif
+
+  float Vcc = ReadVcc(); // mV
+  float Current = 0;
+
+  // Presentation deferred at startup: controller doesn't know this manifest or didn't reply
+  if(Presentation.Due())  {
+    PresentSensors();
+  }
+
+  // Sending out states for the first time (as required by Home Assistant)
+  if (!InitConfirm)  {
+    if(Presentation.Synced()) {
+      InitConfirmation();
+    }
+  }
+  else if (!SyncComplete)  {
+    SyncUpdate();
+  }
+
+  // Reading power sensor
+  #ifdef POWER_SENSOR
+    PROFILE_START(PROF_MEASURE);
+    Current = Variant.Measure(Vcc);
+    PROFILE_END(PROF_MEASURE);
+
+    PSUpdate(Current);
+      
+    #ifdef ERROR_REPORTING
+      OVERCURRENT_ERROR = PS.ElectricalStatus(Current);
     #endif
   #endif
 
@@ -1112,27 +1490,7 @@ void loop() {
   #if defined(ELECTRONIC_FUSE) && defined(POWER_SENSOR)
     if(OVERCURRENT_ERROR)  {
       // Current to high
-      // Board: 2Relay 
-      if(HardwareVariant == 0)  {
-        // Load: Lighting
-        if(LoadVariant < 2) {
-          for (int i = RELAY_ID_1; i < RELAY_ID_1 + NUMBER_OF_RELAYS; i++)  {
-            CommonIO[i].SetState(RELAY_OFF);
-            CommonIO[i].SetRelay();
-            send(MsgSTATUS.setSensor(i).set(RELAY_OFF));
-          }
-        }
-        // Load: Roller shutter
-        else if(LoadVariant == 2) {
-          Shutter.NewState = 2;
-          ShutterUpdate(0);
-        }
-      }
-      // Board: RGBW
-      else if(HardwareVariant == 1) {
-        Dimmer.ChangeState(false);
-        send(MsgSTATUS.setSensor(DIMMER_ID).set(Dimmer.CurrentState));
-      }
+      Variant.Cutoff();
       send(MsgSTATUS.setSensor(ES_ID).set(OVERCURRENT_ERROR));
       InformControllerES = true;
     }
@@ -1145,7 +1503,9 @@ void loop() {
 
     // Reading inputs & adjusting outputs
   if(Iterations > 0)  {
+    PROFILE_START(PROF_UPDATE_IO);
     UpdateIO();
+    PROFILE_END(PROF_UPDATE_IO);
     if(LongpressDetection > 0)  {
       
       // Launch Longpress LED sequence
@@ -1162,12 +1522,8 @@ void loop() {
         }
       #endif  
     }
-    if(HardwareVariant == 0 && LoadVariant == 2)  {
-      ShutterUpdate(Current);
-    }
-    else if(HardwareVariant == 1)  {
-      Dimmer.UpdateDimmer();
-    }
+    // Outputs running in background
+    Variant.Update(Current);
   }
 
   // Reset LastUpdate if millis() has overflowed
@@ -1180,20 +1536,29 @@ void loop() {
     TouchDiagnosis2();
   #endif
   
-  // Checking out sensors which report at a defined interval
-  if ((millis() > LastUpdate + INTERVAL) || CheckNow == true)  {
-    #ifdef SHT30
+  // Reading external sensors; reports depend on their policies
+  #ifdef SHT30
+    if(millis() - LastSensorReading >= SENSOR_INTERVAL)  {
       ETUpdate();
-    #elif defined(POWER_SENSOR)
-      PSUpdate(Current);
-    #endif
+      LastSensorReading = millis();
+    }
+  #endif
 
+  // Touch diagnosis period
+  if ((millis() > LastUpdate + INTERVAL) || CheckNow == true)  {
     LimitTransgressions = 0;
     LastUpdate = millis();
     CheckNow = false;
   }
 
-  wait(LOOP_TIME);
+  // LED effects
+  Backlight.Update(millis());
+
+  #ifdef LOOP_PROFILING
+    Prof.LoopEnd();
+  #endif
+
+  wait(Backlight.Active() ? LED_FRAME_TIME : LOOP_TIME);
 }
 /*
 
@@ -0,0 +1,297 @@
+/*
+ * GatewayBench.cpp file
+ * Broker outage benchmark of the MQTT gateway: the Gateway-MQTT sketch bridges the bus to the broker stand-in
+ * (HostBroker.h), which is down during scripted outages. Synthetic nodes with static IDs report states of
+ * BENCH_SENSORS sensors each, in turns; the payload is a sequence number of the node, so every frame is
+ * traced from the bus to the broker.
+ *
+ * Reports the frames published per second, the publish latency and the frames lost away from the outages.
+ * For every outage: frames offered, lost on the bus (collisions, RX buffer overflow while the gateway is
+ * blocked in reconnectMQTT()), published late from the store-and-forward queue and not published, the
+ * sensors whose last state of the outage was restored from the queue and how long the controller stayed
+ * out of date after the broker was back. The counters of the queue (stored / dropped / forwarded) are
+ * summed from the bus statistics reports of the sketch (fwd: lines) received by the broker.
+ *
+ * gateway_bench_<variant> [--minutes N] [--nodes N] [--rate frames/s] [--detect ms] [--log] [--check]
+ *   --detect  the client notices a lost connection that late (keepalive), publications are lost meanwhile
+ *   --check   exits with 1 on a watchdog reset, a frame lost away from the outages, no statistics report
+ *             received or nothing forwarded from the queue
+ *   --log     prints every publication, frame lost in the RX buffer & statistics report
+ *
+ */
+
+#include <Host.h>
+#include <HostBroker.h>
+#include <cstdio>
+#include <cstring>
+
+#define BENCH_START (10 * HOST_S)           // Nodes start reporting after the gateway booted
+#define BENCH_SENSORS 4                     // Sensors of a node
+#define BENCH_FIRST_NODE 2
+#define BENCH_JITTER 20                     // Report period +-%
+#define BENCH_QUIET (10 * HOST_S)           // Frames ending that long before or after an outage are steady state
+#define BENCH_STATS_SENSOR 1                // STATS_SENSOR_ID of the sketch
+
+struct BenchOutage {
+  HostTime Start;                           // From BENCH_START
+  HostTime Length;
+};
+
+static const BenchOutage Outages[] = {
+  {40 * HOST_S, 5 * HOST_S},
+  {90 * HOST_S, 20 * HOST_S},
+  {150 * HOST_S, 60 * HOST_S},
+};
+
+struct BenchFrame {
+  uint8_t Node;
+  uint8_t Sensor;
+  uint32_t Seq;
+  HostTime End;
+  bool Collided;
+  bool RxDropped;                           // RX buffer of the gateway full
+  HostTime Published;                       // 0 - never
+};
+
+/**
+ * @brief Synthetic node: a state of its next sensor every Period (+-BENCH_JITTER %); backs off while the bus
+ * is busy like the RS485 transport, HOST_TX_TRIES times at most
+ *
+ */
+class BenchNode : public HostEndpoint {
+
+  public:
+    BenchNode(uint8_t Id, HostTime Period, HostTime First) : _Period(Period), _Next(First), _Seed(Id)  {
+      Address = Id;
+    }
+
+    void Deliver(const HostFrame &Frame) override  { (void)Frame; }
+
+    HostTime NextAction() override  { return _Next; }
+
+    void Act(HostTime Now) override  {
+      if(Bus->Sense(*this, Now))  {
+        if(++_Tries < HOST_TX_TRIES)  {
+          _Next = Now + Random() % HOST_TX_BACKOFF_MS * HOST_MS;
+          return;
+        }
+        Refused++;
+      }
+      else  {
+        MyMessage Msg(_Seq % BENCH_SENSORS, V_VAR1);
+
+        Msg.setSender(Address).setDestination(GATEWAY_ADDRESS).setLast(Address).setCommand(C_SET).set((uint32_t)_Seq);
+        Bus->Transmit(*this, GATEWAY_ADDRESS, Msg, Now);
+      }
+
+      _Seq++;
+      _Tries = 0;
+      _Next = Now + _Period * (100 - BENCH_JITTER + Random() % (2 * BENCH_JITTER + 1)) / 100;
+    }
+
+  private:
+    uint32_t Random()  {
+      _Seed = _Seed * 1103515245UL + 12345;
+      return _Seed >> 8;
+    }
+
+    HostTime _Period;
+    HostTime _Next;
+    uint32_t _Seed;
+    uint32_t _Seq = 0;
+    uint8_t _Tries = 0;
+};
+
+static HostBus Bus(HostSketch.BaudRate, HostSketch.SohCount);
+static HostBroker Broker;
+static std::vector<std::unique_ptr<BenchNode>> Nodes;
+static std::vector<BenchFrame> Frames;
+static std::map<uint32_t, size_t> ByKey;    // Node & sequence number -> frame
+static std::vector<BenchOutage> Scheduled;  // Outages within the run, absolute times
+static HostStats Latency;                   // End of the frame to its publication, steady state
+static uint32_t Reports = 0;                // Statistics reports (fwd: lines) received
+static uint32_t FwdStored = 0, FwdDropped = 0, FwdSent = 0;
+static bool Logging = false;
+
+static uint32_t Key(uint8_t Node, uint32_t Seq)  {
+  return (uint32_t)Node << 24 | (Seq & 0xFFFFFF);
+}
+
+static bool Steady(HostTime End)  {
+  for(const BenchOutage &O : Scheduled) {
+    if(End + BENCH_QUIET > O.Start && End < O.Start + O.Length + BENCH_QUIET)  return false;
+  }
+  return true;
+}
+
+static void Observe()  {
+  Bus.OnFrame = [](const HostFrame &Frame) {
+    static uint32_t RxDropped = 0;
+    bool Dropped = Mcu.RxDropped != RxDropped;
+
+    RxDropped = Mcu.RxDropped;
+    if(Frame.Sender == &Mcu.Port) return;
+
+    BenchFrame F = {Frame.Msg.sender, Frame.Msg.sensor, Frame.Msg.getULong(), Frame.End, Frame.Corrupt, Dropped, 0};
+
+    if(Logging && Dropped)  printf("%10.3f %3u #%-6u RX buffer full\n", Frame.End / 1e6, F.Node, F.Seq);
+    ByKey[Key(F.Node, F.Seq)] = Frames.size();
+    Frames.push_back(F);
+  };
+
+  Broker.OnMessage = [](const MyMessage &Msg, HostTime Time) {
+    if(Msg.sender == GATEWAY_ADDRESS) {
+      unsigned Stored, Dropped, Sent;
+
+      if(Msg.sensor == BENCH_STATS_SENSOR && Msg.type == V_TEXT && sscanf(Msg.getString(), "fwd:%u/%u/%u", &Stored, &Dropped, &Sent) == 3) {
+        if(Logging) printf("%10.3f report %s\n", Time / 1e6, Msg.getString());
+        Reports++;
+        FwdStored += Stored;
+        FwdDropped += Dropped;
+        FwdSent += Sent;
+      }
+      return;
+    }
+
+    auto It = ByKey.find(Key(Msg.sender, Msg.getULong()));
+
+    if(Msg.getCommand() != C_SET || It == ByKey.end())  return;
+
+    BenchFrame &F = Frames[It->second];
+
+    if(Logging) printf("%10.3f %3u #%-6u published, %.3f s\n", Time / 1e6, F.Node, F.Seq, (Time - F.End) / 1e6);
+    if(!F.Published) F.Published = Time;
+    if(Steady(F.End)) Latency.Add(Time - F.End);
+  };
+}
+
+/**
+ * @brief Frames & states of the sensors of one outage
+ *
+ */
+static void PrintOutage(const BenchOutage &O)  {
+  HostTime Up = O.Start + O.Length;
+  uint32_t Offered = 0, Collided = 0, RxDropped = 0, Late = 0, Live = 0, Unpublished = 0;
+  std::map<uint16_t, const BenchFrame *> Last;       // Last frame of every sensor during the outage
+
+  for(const BenchFrame &F : Frames) {
+    if(F.End < O.Start || F.End >= Up)  continue;
+
+    Offered++;
+    if(F.Collided)  Collided++;
+    else if(F.RxDropped)  RxDropped++;
+    else if(!F.Published) Unpublished++;
+    else if(F.Published >= Up) Late++;
+    else Live++;
+    Last[F.Node << 8 | F.Sensor] = &F;
+  }
+
+  // The controller is up to date with a sensor once its last state of the outage or a newer one was published
+  uint32_t Restored = 0, Never = 0;
+  HostStats UpToDate;
+
+  for(auto &L : Last) {
+    HostTime First = HOST_NEVER;
+
+    for(const BenchFrame &F : Frames) {
+      if(F.Node == L.second->Node && F.Sensor == L.second->Sensor && F.Seq >= L.second->Seq && F.Published)  {
+        First = min(First, F.Published);
+      }
+    }
+    if(L.second->Published >= Up) Restored++;
+    if(First == HOST_NEVER) Never++;
+    else UpToDate.Add(First > Up ? First - Up : 0);
+  }
+
+  printf("Outage %6.1f s %5.1f s %8u offered: %u collided, %u RX buffer, %u live, %u from queue, %u not published\n",
+         (O.Start - BENCH_START) / 1e6, O.Length / 1e6, Offered, Collided, RxDropped, Live, Late, Unpublished);
+  printf("               %13u sensors: %u restored from queue, out of date %.2f s mean, %.2f s max after reconnect, %u until the end\n",
+         (uint32_t)Last.size(), Restored, UpToDate.Mean() / 1e6, UpToDate.Max() / 1e6, Never);
+}
+
+int main(int argc, char *argv[])  {
+  double Minutes = 4;
+  unsigned NodeCount = 8;
+  double Rate = 2;
+  bool Check = false;
+
+  for(int i=1; i<argc; i++)  {
+    if(!strcmp(argv[i], "--minutes") && i + 1 < argc)  Minutes = atof(argv[++i]);
+    else if(!strcmp(argv[i], "--nodes") && i + 1 < argc)  NodeCount = atoi(argv[++i]);
+    else if(!strcmp(argv[i], "--rate") && i + 1 < argc)  Rate = atof(argv[++i]);
+    else if(!strcmp(argv[i], "--detect") && i + 1 < argc)  Broker.DetectTime = atoi(argv[++i]) * HOST_MS;
+    else if(!strcmp(argv[i], "--check"))  Check = true;
+    else if(!strcmp(argv[i], "--log")) Logging = true;
+  }
+
+  HostTime End = (HostTime)(Minutes * 60 * HOST_S);
+  HostTime Period = (HostTime)(NodeCount / Rate * HOST_S);
+  bool Reset = false;
+
+  Bus.Attach(Mcu.Port);
+  for(unsigned i=0; i<NodeCount; i++) {
+    Nodes.emplace_back(new BenchNode(BENCH_FIRST_NODE + i, Period, BENCH_START + Period * i / NodeCount));
+    Bus.Attach(*Nodes.back());
+  }
+
+  for(const BenchOutage &O : Outages) {
+    if(BENCH_START + O.Start + O.Length > End) continue;
+    Scheduled.push_back({BENCH_START + O.Start, O.Length});
+    Broker.Outage(BENCH_START + O.Start, BENCH_START + O.Start + O.Length);
+  }
+
+  _MQTT_client.Broker = &Broker;
+  Observe();
+
+  try {
+    Mcu.Run(End);
+  }
+  catch(const HostWatchdogReset &Wdt)  {
+    printf("Watchdog reset at %.3f s\n", Wdt.Time / 1e6);
+    Reset = true;
+  }
+
+  uint32_t Offered = 0, Collided = 0, RxDropped = 0, Published = 0, SteadyOffered = 0, SteadyLost = 0;
+  uint32_t Refused = 0;
+
+  for(auto &N : Nodes)  Refused += N->Refused;
+  for(const BenchFrame &F : Frames) {
+    Offered++;
+    Collided += F.Collided;
+    RxDropped += F.RxDropped;
+    Published += F.Published != 0;
+    if(!Steady(F.End) || F.End + BENCH_QUIET > End) continue;
+    SteadyOffered++;
+    SteadyLost += !F.Collided && !F.Published;
+  }
+
+  HostTime Time = Mcu.Now() - BENCH_START;
+
+  printf("Gateway-MQTT: %.0f s, %u nodes, %.1f frames/s offered, %u outages, detect %llu ms\n", Time / 1e6, NodeCount, Rate,
+         (uint32_t)Scheduled.size(), (unsigned long long)(Broker.DetectTime / HOST_MS));
+  printf("Frames                 %10u sent, %u refused, %u collided, %u RX buffer, %u published (%.1f / s)\n",
+         Offered, Refused, Collided, RxDropped, Published, Published / (Time / 1e6));
+  printf("Steady state           %10u sent, %u lost\n", SteadyOffered, SteadyLost);
+  printf("Broker                 %10u connections, %u refused, %u published, %u into a lost connection, %u missed\n",
+         Broker.Connects, Broker.Refused, Broker.Published, Broker.Lost, Broker.Missed);
+  printf("Statistics reports     %10u, %u stored, %u dropped, %u forwarded from queue\n", Reports, FwdStored, FwdDropped, FwdSent);
+  printf("Bus load               %10.2f %%\n\n", 100.0 * Bus.Occupied / Mcu.Now());
+
+  for(const BenchOutage &O : Scheduled) PrintOutage(O);
+  printf("\n");
+
+  HostStats::PrintHeader();
+  Latency.Print("frame -> broker", false);
+
+  if(!Check)  return 0;
+
+  bool Ok = !Reset && !SteadyLost && Reports && FwdSent;
+
+  if(!Ok) printf("FAILED:%s%s%s%s\n", Reset ? " watchdog" : "", SteadyLost ? " frames lost" : "", Reports ? "" : " no report",
+                 FwdSent ? "" : " nothing forwarded");
+
+  return Ok ? 0 : 1;
+}
+/*
+   EOF
+*/
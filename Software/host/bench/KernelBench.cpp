@@ -0,0 +1,341 @@
+/*
+ * KernelBench.cpp file
+ * Accuracy test & benchmark of the integer sensor kernels of the Modules sketch (AnalogSampler readings,
+ * ReadVcc, MeasureAC, MeasureDC, MeasureT, CalculatePower) against the float versions they replaced.
+ *
+ * The sampler of the sketch is fed with synthetic conversions: the bandgap at the supply voltage, a 50 Hz
+ * current on the power sensor (AC sweep) or a constant one (DC sweep) & the board thermometer, with +-1 LSB
+ * of noise. The float versions get the same windows, accumulated like the old sampler did. Reported are the
+ * largest differences of every kernel & the host time per call of both versions.
+ *
+ * The host has an FPU, and the integer readings include the ATOMIC_BLOCK snapshot of the virtual MCU: the
+ * host timings don't show the gain on the ATmega328P, where every float operation is a soft-float call.
+ * Measure cycles & flash with the AVR toolchain.
+ *
+ * kernel_bench [--check]
+ *   --check  exits with 1 if a kernel differs from its float version by more than its limit
+ *
+ */
+
+#include <Host.h>
+#include <GoWired.h>
+#include "Configuration.h"                  // Of the prepared sketch
+#include "NodeProfile.h"
+#include "AnalogSampler.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+#define BENCH_CALLS 1000000                 // Calls per timed kernel
+#define BENCH_NOISE 1                       // +-LSB
+#ifdef INTERNAL_TEMP
+  #define BENCH_CHANNELS 3                  // Vcc, power sensor, board thermometer
+#else
+  #define BENCH_CHANNELS 2
+#endif
+
+// Limits of the integer kernels (difference to the float version)
+#define LIMIT_VCC_MV 1
+#define LIMIT_MV 1                          // Mean & RMS
+#define LIMIT_MA 7                          // 1 mV & rounding at 185 mV/A
+#define LIMIT_DECI_C 1                      // 0.1 C
+#define LIMIT_POWER 0.005                   // Relative, above 1 W
+
+// Power sensor & board thermometer of the profile
+typedef MODULE_PROFILE ModuleProfile;
+static constexpr uint8_t PsPin = ModuleProfile::PowerSensors::Pin(0);
+static constexpr uint8_t ItPin = ModuleProfile::ThermometerPin;
+
+// Globals & kernels of the prepared sketch
+extern AnalogSampler Sampler;
+extern uint8_t VccChannel;
+extern uint8_t PSChannel[];
+extern uint8_t ITChannel;
+uint16_t ReadVcc();
+uint16_t MeasureAC(uint8_t Channel, uint16_t Vcc);
+uint16_t MeasureDC(uint8_t Channel, uint16_t Vcc);
+int16_t MeasureT(uint16_t Vcc);
+uint32_t CalculatePower(uint16_t Current);
+
+/**
+ * @brief Window as accumulated by the float version of the sampler: raw sum & sum of squares
+ *
+ */
+struct FloatWindow {
+  uint32_t Sum = 0;
+  uint32_t SumSq = 0;
+  uint16_t N = 0;
+};
+
+static FloatWindow Windows[16];             // Last complete window by MUX value
+
+/***** Float versions (the sketch before the integer kernels) *****/
+static float FloatMean(const FloatWindow &W, float Vcc)  {
+  if(W.N == 0)  return 0;
+
+  return ((float)W.Sum / W.N) * Vcc / 1024.0f;
+}
+
+static float FloatRMS(const FloatWindow &W, float Vcc)  {
+  if(W.N == 0)  return 0;
+
+  float Mean = (float)W.Sum / W.N;
+  float Variance = (float)W.SumSq / W.N - Mean * Mean;
+
+  return Variance > 0 ? sqrtf(Variance) * Vcc / 1024.0f : 0;
+}
+
+static long FloatVcc(const FloatWindow &W)  {
+  if(W.Sum == 0)  return 0;
+
+  return (ADC_BANDGAP_MV * 1024UL * W.N) / W.Sum;
+}
+
+static float FloatMeasureAC(const FloatWindow &W, float Vcc)  {
+  return FloatRMS(W, Vcc) / MVPERAMP;
+}
+
+static float FloatMeasureDC(const FloatWindow &W, float Vcc)  {
+  return fabsf(FloatMean(W, Vcc) - Vcc / 2) / MVPERAMP;
+}
+
+static float FloatMeasureT(const FloatWindow &W, float Vcc)  {
+  return (FloatMean(W, Vcc) - ZEROVOLTAGE) / MVPERC;
+}
+
+static float FloatCalculatePower(float Current)  {
+  return Current * RECEIVER_VOLTAGE * COSFI;
+}
+
+/***** Stimuli *****/
+static struct {
+  uint16_t Vcc;
+  bool Ac;
+  double Value;                             // AC: RMS current (mA), DC: sensor voltage (mV)
+  double Temperature;                       // Board (C)
+} Stimulus;
+
+static uint32_t Seed = 1;
+
+static uint16_t Noise()  {
+  Seed = Seed * 1103515245UL + 12345;
+
+  return (Seed >> 16) % (2 * BENCH_NOISE + 1);
+}
+
+static uint16_t Counts(double Mv, uint16_t Vcc)  {
+  double Value = floor(Mv * 1024 / Vcc) + Noise() - BENCH_NOISE;
+
+  return Value < 0 ? 0 : (Value > 1023 ? 1023 : Value);
+}
+
+static double SensorMv(double Us)  {
+  if(!Stimulus.Ac)  return Stimulus.Value;
+
+  return Stimulus.Vcc / 2.0 + Stimulus.Value / 1000 * MVPERAMP * M_SQRT2 * sin(2 * M_PI * 50 * Us / 1e6);
+}
+
+/**
+ * @brief Feeds the sampler with three rounds of all channels; the float windows get the same conversions
+ *
+ */
+static void Feed()  {
+  static double Us = 0;
+  FloatWindow Current;
+  uint8_t Mux = ADMUX & 0x0F;
+  uint8_t Discard = Mux == ADC_BANDGAP ? ADC_BANDGAP_DISCARD : ADC_DISCARD;
+  uint8_t Complete = 0;
+
+  // The windows of the last round start at the mean of the previous one
+  while(Complete < 3 * BENCH_CHANNELS) {
+    uint16_t Value;
+
+    if(Mux == ADC_BANDGAP)  Value = Counts(ADC_BANDGAP_MV, Stimulus.Vcc);
+    else if(Mux == PsPin - A0)  Value = Counts(SensorMv(Us), Stimulus.Vcc);
+    else  Value = Counts(ZEROVOLTAGE + MVPERC * Stimulus.Temperature, Stimulus.Vcc);
+
+    Sampler.Sample(Value);
+    Us += ADC_CONVERSION_US;
+
+    if(Discard > 0) {
+      Discard--;
+    }
+    else  {
+      Current.Sum += Value;
+      Current.SumSq += (uint32_t)Value * Value;
+      Current.N++;
+    }
+
+    // The sampler moved on: the window of the previous channel is complete
+    if((ADMUX & 0x0F) != Mux) {
+      Windows[Mux] = Current;
+      Current = FloatWindow();
+      Mux = ADMUX & 0x0F;
+      Discard = Mux == ADC_BANDGAP ? ADC_BANDGAP_DISCARD : ADC_DISCARD;
+      Complete++;
+    }
+  }
+}
+
+/***** Accuracy *****/
+struct Error {
+  const char *Name;
+  const char *Unit;
+  double Limit;
+  double Max = 0;
+  double At = 0;                            // Stimulus of the largest difference
+  uint32_t Count = 0;
+
+  void Add(double Integer, double Float, double Stimulus)  {
+    double Difference = fabs(Integer - Float);
+
+    if(Difference > Max)  {
+      Max = Difference;
+      At = Stimulus;
+    }
+    Count++;
+  }
+};
+
+static Error VccError{"Vcc", "mV", LIMIT_VCC_MV};
+static Error MeanError{"Mean", "mV", LIMIT_MV};
+static Error RmsError{"RMS", "mV", LIMIT_MV};
+static Error AcError{"MeasureAC", "mA", LIMIT_MA};
+static Error DcError{"MeasureDC", "mA", LIMIT_MA};
+static Error TError{"MeasureT", "0.1 C", LIMIT_DECI_C};
+static Error PowerError{"CalculatePower", "rel.", LIMIT_POWER};
+
+static void Compare(double At)  {
+  uint16_t Vcc = ReadVcc();
+  long VccF = FloatVcc(Windows[ADC_BANDGAP]);
+  const FloatWindow &Ps = Windows[PsPin - A0];
+
+  VccError.Add(Vcc, VccF, At);
+
+  if(Stimulus.Ac)  {
+    RmsError.Add(Sampler.RMS(PSChannel[0], Vcc), FloatRMS(Ps, VccF), At);
+
+    uint16_t Current = MeasureAC(PSChannel[0], Vcc);
+    float CurrentF = FloatMeasureAC(Ps, VccF);
+
+    AcError.Add(Current, CurrentF * 1000, At);
+
+    // Power of the same current, so the error of the current doesn't count twice
+    float PowerF = FloatCalculatePower(Current / 1000.0f);
+
+    if(PowerF >= 1) PowerError.Add(CalculatePower(Current) / 1000.0 / PowerF, 1, At);
+  }
+  else  {
+    MeanError.Add(Sampler.Mean(PSChannel[0], Vcc), FloatMean(Ps, VccF), At);
+    DcError.Add(MeasureDC(PSChannel[0], Vcc), FloatMeasureDC(Ps, VccF) * 1000, At);
+  }
+
+  #ifdef INTERNAL_TEMP
+    TError.Add(MeasureT(Vcc), FloatMeasureT(Windows[ItPin - A0], VccF) * 10, At);
+  #endif
+}
+
+static void Accuracy()  {
+  static const uint16_t Supplies[] = {4500, 4750, 5000, 5250};
+
+  for(uint16_t Vcc : Supplies)  {
+    Stimulus.Vcc = Vcc;
+
+    // AC current up to the range of the sensor, board temperature -20 to 85 C
+    Stimulus.Ac = true;
+    for(uint16_t Ma = 0; Ma <= 9000; Ma += Ma < 200 ? 10 : (Ma < 2000 ? 50 : 250))  {
+      Stimulus.Value = Ma;
+      Stimulus.Temperature = -20 + Ma % 106;
+      Feed();
+      Compare(Ma);
+    }
+
+    // DC sensor voltage over the whole ADC range
+    Stimulus.Ac = false;
+    Stimulus.Temperature = 25;
+    for(uint16_t Mv = 0; Mv < Vcc; Mv += 25)  {
+      Stimulus.Value = Mv;
+      Feed();
+      Compare(Mv);
+    }
+  }
+}
+
+/***** Benchmark *****/
+static volatile uint32_t Sink;
+
+template<typename Kernel>
+static double Time(Kernel K)  {
+  auto Start = std::chrono::steady_clock::now();
+
+  for(uint32_t i=0; i<BENCH_CALLS; i++) K(i);
+
+  return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - Start).count() / BENCH_CALLS;
+}
+
+static void Benchmark()  {
+  uint16_t Vcc = ReadVcc();
+  const FloatWindow &Ps = Windows[PsPin - A0];
+  const FloatWindow &Bandgap = Windows[ADC_BANDGAP];
+
+  struct {
+    const char *Name;
+    double Integer;
+    double Float;
+  } Rows[] = {
+    {"Vcc", Time([](uint32_t) { Sink = ReadVcc(); }), Time([&](uint32_t) { Sink = FloatVcc(Bandgap); })},
+    {"MeasureAC", Time([&](uint32_t i) { Sink = MeasureAC(PSChannel[0], Vcc + (i & 1)); }),
+                  Time([&](uint32_t i) { Sink = FloatMeasureAC(Ps, Vcc + (i & 1)) * 1000; })},
+    {"MeasureDC", Time([&](uint32_t i) { Sink = MeasureDC(PSChannel[0], Vcc + (i & 1)); }),
+                  Time([&](uint32_t i) { Sink = FloatMeasureDC(Ps, Vcc + (i & 1)) * 1000; })},
+  #ifdef INTERNAL_TEMP
+    {"MeasureT", Time([&](uint32_t i) { Sink = MeasureT(Vcc + (i & 1)); }),
+                 Time([&](uint32_t i) { Sink = FloatMeasureT(Windows[ItPin - A0], Vcc + (i & 1)) * 10; })},
+  #endif
+    {"CalculatePower", Time([](uint32_t i) { Sink = CalculatePower(i & 0x1FFF); }),
+                       Time([](uint32_t i) { Sink = FloatCalculatePower((i & 0x1FFF) / 1000.0f); })},
+  };
+
+  printf("\n%-16s %12s %12s\n", "kernel", "integer ns", "float ns");
+  for(auto &Row : Rows) printf("%-16s %12.1f %12.1f\n", Row.Name, Row.Integer, Row.Float);
+}
+
+int main(int argc, char *argv[])  {
+  bool Check = false;
+
+  for(int i=1; i<argc; i++)  {
+    if(!strcmp(argv[i], "--check")) Check = true;
+  }
+
+  // Channels as registered by setup()
+  VccChannel = Sampler.AddBandgap(ADC_WINDOW);
+  PSChannel[0] = Sampler.AddChannel(PsPin, POWER_MEASURING_TIME);
+  #ifdef INTERNAL_TEMP
+    ITChannel = Sampler.AddChannel(ItPin, ADC_WINDOW);
+  #endif
+  Sampler.Begin();
+
+  Accuracy();
+
+  Error *Errors[] = {&VccError, &MeanError, &RmsError, &AcError, &DcError, &TError, &PowerError};
+  bool Ok = true;
+
+  printf("Integer kernels vs float, %u mV/A, %u V, cos(fi) %.2f\n\n", (unsigned)MVPERAMP, (unsigned)RECEIVER_VOLTAGE, (double)COSFI);
+  printf("%-16s %8s %12s %12s %12s %8s\n", "kernel", "cases", "max diff", "limit", "at", "unit");
+  for(Error *E : Errors)  {
+    if(E->Count == 0) continue;
+
+    bool Failed = E->Max > E->Limit;
+
+    printf("%-16s %8u %12.4g %12.4g %12.0f %8s%s\n", E->Name, E->Count, E->Max, E->Limit, E->At, E->Unit, Failed ? "  FAILED" : "");
+    Ok &= !Failed;
+  }
+
+  Benchmark();
+
+  return Check && !Ok ? 1 : 0;
+}
+/*
+   EOF
+*/
@@ -0,0 +1,313 @@
+/*
+ * LoopBench.cpp file
+ * Loop latency benchmark of one Modules board profile (see NodeProfile.h): boots the node against the gateway & controller stand-in,
+ * then drives it for a few virtual minutes with button presses, input changes, load currents on the power
+ * sensors, the board thermometer and controller commands. Reports boot-to-READY time, the busy time of
+ * loop() passes (until the final wait(), blocking sends & waits included) with a histogram, traced
+ * functions (MeasureAC, ShutterUpdate, InitConfirmation...) and button / command to output latencies.
+ *
+ * loop_bench_<profile> [--minutes N] [--check] [--log]
+ *   --check  exits with 1 unless READY & the manifest were sent and the watchdog never fired
+ *   --log    prints every frame & output change
+ *
+ */
+
+#include <Host.h>
+#include <HostController.h>
+#include <GoWired.h>
+#include "Configuration.h"                  // Of the prepared profile
+#include "NodeProfile.h"
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+#define BENCH_NAME(Profile) #Profile
+#define BENCH_PROFILE(Profile) BENCH_NAME(Profile)
+
+#define BENCH_START (30 * HOST_S)           // Stimuli start after the startup synchronization
+#define BENCH_PRESS (150 * HOST_MS)         // Short press
+#define BENCH_LOAD_MA 1500                  // RMS current of a load switched on (mA)
+#define BENCH_TEMPERATURE 35                // Board temperature (C)
+#define BENCH_STIMULUS_AGE (500 * HOST_MS)  // Output changes later than that aren't attributed to a stimulus
+
+static HostBus Bus(HostSketch.BaudRate, HostSketch.SohCount);
+static HostController Gateway;
+
+static HostStats ButtonLatency;             // Button release to output change
+static HostStats CommandLatency;            // End of the command frame to output change
+static HostTime ButtonHandled = 0;       // Last release attributed to an output change
+static HostTime CommandStimulus = 0;
+static HostTime CommandHandled = 0;
+
+// Board of the profile
+typedef MODULE_PROFILE ModuleProfile;
+typedef ModuleProfile::Output Outputs;
+typedef ModuleProfile::Buttons Buttons;
+typedef ModuleProfile::Inputs Inputs;
+typedef ModuleProfile::PowerSensors PowerSensors;
+
+static bool Output(uint8_t Pin)  {
+  for(uint8_t i=0; i<Outputs::Count; i++) {
+    if(Outputs::Pin(i) == Pin)  return true;
+  }
+  return false;
+}
+
+/**
+ * @brief Button pressed (LOW) for BENCH_PRESS every Period from BENCH_START + Offset
+ *
+ */
+static bool Button(HostTime Now, HostTime Period, HostTime Offset)  {
+  if(Now < BENCH_START + Offset)  return HIGH;
+
+  return (Now - BENCH_START - Offset) % Period < BENCH_PRESS ? LOW : HIGH;
+}
+
+/**
+ * @brief Last release of a button before Now
+ *
+ */
+static HostTime Release(HostTime Now, HostTime Period, HostTime Offset)  {
+  if(Now < BENCH_START + Offset + BENCH_PRESS)  return 0;
+
+  HostTime Start = Now - (Now - BENCH_START - Offset) % Period;
+  HostTime End = Start + BENCH_PRESS;
+
+  return End <= Now ? End : (Start >= Period ? End - Period : 0);
+}
+
+/**
+ * @brief AC load current on a power sensor: sine around Vcc / 2 (mV)
+ *
+ */
+static double AcSensor(HostTime Now, uint16_t Current)  {
+  double Peak = Current / 1000.0 * MVPERAMP * M_SQRT2;
+
+  return 2500 + Peak * sin(2 * M_PI * 50 * Now / 1e6);
+}
+
+// Shutter model: the motor current stops at the end positions (end switches)
+static double ShutterPosition = 0;          // 0 - open, 100 - closed
+static HostTime ShutterTime = 0;
+
+static int8_t ShutterDirection()  {
+  if(Mcu.Output(Outputs::Pin(0)) == RELAY_ON) return -1;
+  if(Mcu.Output(Outputs::Pin(1)) == RELAY_ON) return 1;
+  return 0;
+}
+
+static void ShutterAdvance(HostTime Now)  {
+  int8_t Direction = ShutterDirection();
+  double Travel = (Direction < 0 ? UP_TIME : DOWN_TIME) * 1e6;
+
+  ShutterPosition += Direction * 100.0 * (Now - ShutterTime) / Travel;
+  ShutterPosition = ShutterPosition < 0 ? 0 : (ShutterPosition > 100 ? 100 : ShutterPosition);
+  ShutterTime = Now;
+}
+
+static uint16_t ShutterCurrent(HostTime Now)  {
+  ShutterAdvance(Now);
+
+  int8_t Direction = ShutterDirection();
+  bool End = (Direction < 0 && ShutterPosition <= 0) || (Direction > 0 && ShutterPosition >= 100);
+
+  return Direction != 0 && !End ? BENCH_LOAD_MA : 0;
+}
+
+static void Stimuli()  {
+  Mcu.SetNoise(2);
+
+  // Buttons
+  if(Buttons::Count > 0)  Mcu.SetDigital(Buttons::Pin(0), [](HostTime Now) { return Button(Now, 7 * HOST_S, 0); });
+  if(Buttons::Count > 1)  Mcu.SetDigital(Buttons::Pin(1), [](HostTime Now) { return Button(Now, 11 * HOST_S, 3500 * HOST_MS); });
+
+  // Digital inputs: level changes every 9, 10, 11, 12... s
+  for(uint8_t i=0; i<Inputs::Count; i++) {
+    HostTime Period = (9 + i) * HOST_S;
+    Mcu.SetDigital(Inputs::Pin(i), [Period](HostTime Now) { return (bool)(Now / Period % 2); });
+  }
+
+  // Power sensors
+#ifdef POWER_SENSOR
+  for(uint8_t s=0; s<PowerSensors::Count; s++) {
+    if constexpr(Outputs::Type == S_BINARY) {
+      // A load on the relays of the sensor
+      Mcu.SetAnalog(PowerSensors::Pin(s), [s](HostTime Now) {
+        bool On = false;
+        for(uint8_t i=0; i<Outputs::Count; i++) On |= ModuleProfile::PowerSensorOf(i) == s && Mcu.Output(Outputs::Pin(i)) == RELAY_ON;
+        return AcSensor(Now, On ? BENCH_LOAD_MA : 0);
+      });
+    }
+    else if constexpr(Outputs::Type == S_COVER) {
+      Mcu.SetAnalog(PowerSensors::Pin(s), [](HostTime Now) { return AcSensor(Now, ShutterCurrent(Now)); });
+    }
+    else  {
+      // LED strip: DC current proportional to the duty of all channels
+      Mcu.SetAnalog(PowerSensors::Pin(s), [](HostTime Now) {
+        (void)Now;
+        uint32_t Duty = 0;
+        for(uint8_t i=0; i<Outputs::Count; i++) Duty += Mcu.Duty(Outputs::Pin(i));
+        return 2500 + 2.0 * Duty / 255 / Outputs::Count * MVPERAMP;
+      });
+    }
+  }
+#endif
+
+  // Board thermometer
+  if(ModuleProfile::ThermometerPin != NO_PIN) {
+    Mcu.SetAnalog(ModuleProfile::ThermometerPin, [](HostTime Now) { (void)Now; return (double)ZEROVOLTAGE + MVPERC * BENCH_TEMPERATURE; });
+  }
+}
+
+/**
+ * @brief Controller commands every 5 s: relays toggled, shutter moved, dimming level & color changed
+ *
+ */
+static void Commands(uint8_t Node, HostTime From, HostTime To)  {
+  uint32_t k = 0;
+
+  for(HostTime At = From; At < To; At += 5 * HOST_S, k++) {
+    if constexpr(Outputs::Type == S_BINARY) {
+      Gateway.Command(At, Node, k % Outputs::Count, V_STATUS, k / Outputs::Count % 2 ? "0" : "1");
+    }
+    else if constexpr(Outputs::Type == S_COVER) {
+      if(k % 6 == 0)  Gateway.Command(At, Node, 0, V_PERCENTAGE, k / 6 % 2 ? "20" : "80");
+    }
+    else if constexpr(Outputs::Type == S_DIMMER) {
+      Gateway.Command(At, Node, 0, k % 2 ? V_PERCENTAGE : V_STATUS, k % 2 ? (k / 2 % 2 ? "30" : "90") : "1");
+    }
+    else if constexpr(Outputs::Type == S_RGB_LIGHT) {
+      Gateway.Command(At, Node, 0, k % 2 ? V_RGB : V_STATUS, k % 2 ? (k / 2 % 2 ? "ff8000" : "0080ff") : "1");
+    }
+    else  {
+      Gateway.Command(At, Node, 0, k % 2 ? V_RGBW : V_STATUS, k % 2 ? (k / 2 % 2 ? "ff800040" : "0080ff00") : "1");
+    }
+  }
+}
+
+static void Log()  {
+  Bus.OnFrame = [](const HostFrame &Frame) {
+    char Text[2 * MAX_PAYLOAD_SIZE + 1];
+
+    printf("%10.3f %3u -> %3u  %u %3u %3u %-3u %s%s\n", Frame.End / 1e6, Frame.Msg.sender, Frame.Msg.destination, Frame.Msg.getCommand(),
+           Frame.Msg.type, Frame.Msg.sensor, Frame.Msg.getLength(), Frame.Msg.getString(Text), Frame.Corrupt ? " CORRUPT" : "");
+  };
+  Mcu.OnOutput = [](uint8_t Pin, uint8_t Value, HostTime Now) {
+    printf("%10.3f pin %u = %u (%u)\n", Now / 1e6, Pin, Value, Mcu.Duty(Pin));
+  };
+}
+
+static void Observe(uint8_t Node)  {
+  auto LogFrame = Bus.OnFrame;
+  auto LogOutput = Mcu.OnOutput;
+
+  Bus.OnFrame = [Node, LogFrame](const HostFrame &Frame) {
+    if(LogFrame)  LogFrame(Frame);
+    if(Frame.Sender == &Gateway && !Frame.Corrupt && Frame.Msg.destination == Node && Frame.Msg.getCommand() == C_SET)  {
+      CommandStimulus = Frame.End;
+    }
+  };
+
+  Mcu.OnOutput = [LogOutput](uint8_t Pin, uint8_t Value, HostTime Now) {
+    if(LogOutput) LogOutput(Pin, Value, Now);
+    if(!Output(Pin))  return;
+
+    if(Outputs::Type == S_COVER)  ShutterAdvance(Now);
+
+    HostTime Released = 0;
+    if(Buttons::Count > 0)  Released = max(Released, Release(Now, 7 * HOST_S, 0));
+    if(Buttons::Count > 1)  Released = max(Released, Release(Now, 11 * HOST_S, 3500 * HOST_MS));
+
+    // The latest stimulus not handled yet caused the change
+    bool Button = Released > ButtonHandled && Now - Released <= BENCH_STIMULUS_AGE;
+    bool Command = CommandStimulus > CommandHandled && Now - CommandStimulus <= BENCH_STIMULUS_AGE;
+
+    if(Button && (!Command || Released >= CommandStimulus)) {
+      ButtonLatency.Add(Now - Released);
+      ButtonHandled = Released;
+    }
+    else if(Command)  {
+      CommandLatency.Add(Now - CommandStimulus);
+      CommandHandled = CommandStimulus;
+    }
+  };
+}
+
+int main(int argc, char *argv[])  {
+  double Minutes = 2;
+  bool Check = false;
+  bool Logging = false;
+
+  for(int i=1; i<argc; i++)  {
+    if(!strcmp(argv[i], "--minutes") && i + 1 < argc)  Minutes = atof(argv[++i]);
+    else if(!strcmp(argv[i], "--check"))  Check = true;
+    else if(!strcmp(argv[i], "--log")) Logging = true;
+  }
+
+  HostTime End = (HostTime)(Minutes * 60 * HOST_S);
+  HostTime Ready = 0;
+  bool Manifest = false;
+  bool Reset = false;
+
+  Bus.Attach(Gateway);
+  Bus.Attach(Mcu.Port);
+
+  Gateway.OnMessage = [&](const MyMessage &Msg, HostTime Time) {
+    if(Msg.sensor != CONFIGURATION_SENSOR_ID || Msg.getCommand() != C_SET) return;
+    if(Msg.type == V_VAR1 && !Ready)  Ready = Time;
+    if(Msg.type == V_VAR2)  Manifest = true;
+  };
+
+  // States known to the controller, replied to the startup requests of the node it's going to assign ID 1
+  static const uint8_t Known[] = {V_STATUS, V_PERCENTAGE, V_UP, V_DOWN, V_STOP};
+
+  for(uint8_t Sensor=0; Sensor<4; Sensor++) {
+    for(uint8_t Type : Known) Gateway.Set(Gateway.NextNodeId, Sensor, Type, "0");
+    Gateway.Set(Gateway.NextNodeId, Sensor, V_RGB, "ffffff");
+    Gateway.Set(Gateway.NextNodeId, Sensor, V_RGBW, "ffffffff");
+  }
+
+  Stimuli();
+  if(Logging) Log();
+
+  try {
+    Mcu.Run(0);                             // Boot
+
+    uint8_t Node = getNodeId();
+
+    Observe(Node);
+    Commands(Node, BENCH_START + 2 * HOST_S, End);
+    Mcu.Run(End);
+  }
+  catch(const HostWatchdogReset &Wdt)  {
+    printf("Watchdog reset at %.3f s\n", Wdt.Time / 1e6);
+    Reset = true;
+  }
+
+  printf("Modules " BENCH_PROFILE(MODULE_PROFILE) ": %.0f s, node %u\n", Mcu.Now() / 1e6, getNodeId());
+  printf("Boot to READY          %10.1f ms\n", Ready / 1e3);
+  printf("Frames                 %10u sent, %u refused, %u collided, %u received by controller, %u RX dropped\n",
+         Mcu.Port.Sent, Mcu.Port.Refused, Mcu.Port.Collided, Gateway.Received, Mcu.RxDropped);
+  printf("Gateway                %10u deferred, %u lost\n", Gateway.Deferred, Gateway.Refused);
+  printf("Bus load               %10.2f %%\n", 100.0 * Bus.Occupied / Mcu.Now());
+  printf("EEPROM writes          %10u\n\n", Mcu.EepromWrites);
+
+  HostStats::PrintHeader();
+  Mcu.Passes.Print("loop() busy", true);
+  for(auto &Trace : HostTraces()) Trace.second.Print(Trace.first.c_str(), false);
+  ButtonLatency.Print("button -> output", false);
+  CommandLatency.Print("command -> output", false);
+  Gateway.Replies.Print("C_REQ round trip", false);
+
+  if(!Check)  return 0;
+
+  bool Ok = !Reset && Ready && Manifest && CommandLatency.Count() > 0;
+
+  if(!Ok) printf("FAILED:%s%s%s%s\n", Reset ? " watchdog" : "", Ready ? "" : " no READY", Manifest ? "" : " no manifest",
+                 CommandLatency.Count() ? "" : " commands not executed");
+
+  return Ok ? 0 : 1;
+}
+/*
+   EOF
+*/
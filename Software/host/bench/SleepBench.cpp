@@ -0,0 +1,162 @@
+/*
+ * SleepBench.cpp file
+ * Idle sleep benchmark of Touch MCU-Raw (Power Board AC, two outputs): the sketch runs its own loop() &
+ * IdleSleep(), the virtual MCU counts the time spent in sleep_cpu() and the wakes (Timer0 overflow, pin change
+ * of the wired inputs). Every BENCH_EVENT_PERIOD a touch field is touched or a wired input pressed for
+ * BENCH_EVENT_LENGTH, in turns: touch field 1, touch field 2, input 1, input 2. Every event has to toggle the
+ * relay of its output once.
+ *
+ * Reports wakes per second, loop() passes, awake & asleep time, the average supply current estimated from the
+ * duty cycle and the latency from an event to its relay. Plain computation isn't modelled (see hal/Host.h): a
+ * wake costs the Timer0 ISR & the call of loop(), the rest of the awake time are pin & ADC operations.
+ *
+ * sleep_bench [--minutes N] [--remember] [--log] [--check]
+ *   --remember  DIP switch 4 on: relay states are journaled in EEPROM
+ *   --check     exits with 1 on a watchdog reset or an event which didn't toggle its relay exactly once
+ *   --log       prints every event & relay change
+ *
+ */
+
+#include <Host.h>
+#include "Configuration.h"                  // Of the prepared sketch
+#include <cstdio>
+#include <cstring>
+
+#define BENCH_START (5 * HOST_S)            // First event, after the boot (delay, DIP switches, rainbow effect)
+#define BENCH_EVENT_PERIOD (5 * HOST_S)
+#define BENCH_EVENT_LENGTH (300 * HOST_MS)
+#define BENCH_FIELD_MV 2000                 // Touch field reading at rest
+#define BENCH_TOUCH_MV 200                  // Touch field reading rise while touched
+#define BENCH_ACTIVE_MA 10.0                // ATmega328P supply current at 16 MHz, 5 V: active (typical)
+#define BENCH_IDLE_MA 2.5                   // & in idle mode
+
+struct BenchEvent {
+  HostTime Start;
+  uint8_t Kind;                             // 0, 1 - touch field 1, 2; 2, 3 - input 1, 2
+  uint8_t Toggles = 0;                      // Changes of the relay before the next event
+  HostTime Toggled = 0;                     // First change
+};
+
+static const uint8_t Relays[2] = {RELAY_PIN_1, RELAY_PIN_2};
+static const char *const Names[4] = {"touch 1", "touch 2", "input 1", "input 2"};
+static std::vector<BenchEvent> Events;
+static bool Logging = false;
+
+/**
+ * @brief Event active at Time of the given kind
+ *
+ */
+static bool Active(uint8_t Kind, HostTime Time)  {
+  if(Time < BENCH_START)  return false;
+
+  HostTime Since = Time - BENCH_START;
+  uint64_t n = Since / BENCH_EVENT_PERIOD;
+
+  return n % 4 == Kind && Since - n * BENCH_EVENT_PERIOD < BENCH_EVENT_LENGTH;
+}
+
+static void Script(bool Remember)  {
+  // Power Board AC; DIP switches off (two outputs, bistable, lighting) except 4 with --remember
+  Mcu.SetAnalog(HARDWARE_DETECTION_PIN, [](HostTime) { return 0.0; });
+  if(Remember)  Mcu.SetDigital(DIP_SWITCH_4, [](HostTime) { return false; });
+
+  Mcu.SetAnalog(TOUCH_FIELD_1, [](HostTime T) { return BENCH_FIELD_MV + (Active(0, T) ? BENCH_TOUCH_MV : 0.0); });
+  Mcu.SetAnalog(TOUCH_FIELD_2, [](HostTime T) { return BENCH_FIELD_MV + (Active(1, T) ? BENCH_TOUCH_MV : 0.0); });
+  Mcu.SetDigital(INPUT_PIN_1, [](HostTime T) { return !Active(2, T); });
+  Mcu.SetDigital(INPUT_PIN_2, [](HostTime T) { return !Active(3, T); });
+
+  Mcu.OnOutput = [](uint8_t Pin, uint8_t Value, HostTime Time) {
+    if(Time < BENCH_START || (Time - BENCH_START) / BENCH_EVENT_PERIOD >= Events.size()) return;
+
+    BenchEvent &E = Events[(Time - BENCH_START) / BENCH_EVENT_PERIOD];
+
+    if(Pin != Relays[E.Kind % 2]) return;
+    if(!E.Toggles++)  E.Toggled = Time;
+    if(Logging) printf("%10.3f relay %u %s\n", Time / 1e6, E.Kind % 2 + 1, Value == RELAY_ON ? "on" : "off");
+  };
+}
+
+int main(int argc, char *argv[])  {
+  double Minutes = 10;
+  bool Remember = false;
+  bool Check = false;
+
+  for(int i=1; i<argc; i++)  {
+    if(!strcmp(argv[i], "--minutes") && i + 1 < argc)  Minutes = atof(argv[++i]);
+    else if(!strcmp(argv[i], "--remember")) Remember = true;
+    else if(!strcmp(argv[i], "--check"))  Check = true;
+    else if(!strcmp(argv[i], "--log")) Logging = true;
+  }
+
+  HostTime End = BENCH_START + (HostTime)(Minutes * 60 * HOST_S);
+  HostStats Busy, Latency;
+  HostTime Asleep = 0, Start = 0;
+  uint32_t Wakes = 0, PinWakes = 0, Writes = 0;
+  bool Reset = false;
+
+  for(HostTime T = BENCH_START; T + BENCH_EVENT_PERIOD <= End; T += BENCH_EVENT_PERIOD) {
+    Events.push_back(BenchEvent{T, (uint8_t)(Events.size() % 4)});
+  }
+  End = BENCH_START + Events.size() * BENCH_EVENT_PERIOD;
+  Script(Remember);
+
+  try {
+    Mcu.Run(BENCH_START);
+    Start = Mcu.Now();
+    Asleep = Mcu.Asleep;
+    Wakes = Mcu.Wakes;
+    PinWakes = Mcu.PinWakes;
+    Writes = Mcu.EepromWrites;
+    HostTraces().clear();
+    Mcu.OnPass = [&Busy](HostTime, HostTime Us) { Busy.Add(Us); };
+    Mcu.Run(End);
+  }
+  catch(const HostWatchdogReset &Wdt)  {
+    printf("Watchdog reset at %.3f s\n", Wdt.Time / 1e6);
+    Reset = true;
+  }
+
+  HostTime Time = Mcu.Now() - Start;
+  double Seconds = Time / 1e6;
+  double Sleep = (double)(Mcu.Asleep - Asleep) / Time;
+  uint32_t Handled = 0, Missed = 0, Repeated = 0;
+  HostStats &Io = HostTraces()["UpdateIO"];
+
+  for(const BenchEvent &E : Events) {
+    if(Logging) printf("%10.3f %s: %u relay changes\n", E.Start / 1e6, Names[E.Kind], E.Toggles);
+    if(E.Toggles == 0)  Missed++;
+    else if(E.Toggles > 1)  Repeated++;
+    else  {
+      Handled++;
+      Latency.Add(E.Toggled - E.Start);
+    }
+  }
+
+  printf("Touch MCU-Raw: %.0f s, Power Board AC, 2 outputs, remember states %s\n", Seconds, Remember ? "on" : "off");
+  printf("Wakes                  %10.1f / s, %u pin change\n", (Mcu.Wakes - Wakes) / Seconds, Mcu.PinWakes - PinWakes);
+  printf("loop() passes          %10u, %u reading inputs (UpdateIO)\n", Busy.Count(), Io.Count());
+  printf("Awake                  %10.2f %% (%.3f s), asleep %.2f %%\n", 100 * (1 - Sleep), (1 - Sleep) * Seconds, 100 * Sleep);
+  printf("Reading inputs         %10.2f %%, wakes without reading %.2f %%\n", 100.0 * Io.Total() / Time,
+         100 * (1 - Sleep) - 100.0 * Io.Total() / Time);
+  printf("Supply current         %10.2f mA (active %.1f mA, idle %.1f mA; without sleep %.1f mA)\n",
+         BENCH_ACTIVE_MA * (1 - Sleep) + BENCH_IDLE_MA * Sleep, BENCH_ACTIVE_MA, BENCH_IDLE_MA, BENCH_ACTIVE_MA);
+  printf("Events                 %10u, %u handled, %u missed, %u toggled more than once\n", (uint32_t)Events.size(),
+         Handled, Missed, Repeated);
+  printf("EEPROM writes          %10u\n\n", Mcu.EepromWrites - Writes);
+
+  HostStats::PrintHeader();
+  Busy.Print("loop() pass", false);
+  Io.Print("UpdateIO", false);
+  Latency.Print("event -> relay", false);
+
+  if(!Check)  return 0;
+
+  bool Ok = !Reset && !Missed && !Repeated;
+
+  if(!Ok) printf("FAILED:%s%s%s\n", Reset ? " watchdog" : "", Missed ? " events missed" : "", Repeated ? " events repeated" : "");
+
+  return Ok ? 0 : 1;
+}
+/*
+   EOF
+*/
@@ -0,0 +1,278 @@
+/*
+ * TouchReplay.cpp file
+ * Touch trace replay of the Touch sketch on the 2Relay board (double switch): the readings of a trace
+ * (see traces/touch_trace.py) drive the three touch fields, the labelled touches are matched to the relay
+ * changes. Reports detected & missed touches, false triggers (relay changes without a touch), references
+ * taken, touch / release to relay latencies and how long a covered field takes to work again.
+ *
+ * Touches on a covered field are expected to be missed until TOUCH_STUCK_TIME re-references it, and for
+ * REPLAY_SETTLE after the cover is gone, until the drift takes a new reference (blind).
+ *
+ * touch_replay <trace> [--check] [--log]
+ *   --check  exits with 1 on a false trigger, a missed touch (blind ones aside) or a release to relay latency
+ *            over REPLAY_MAX_LATENCY
+ *   --log    prints every touch, relay change & reference taken
+ *
+ */
+
+#include <Host.h>
+#include <HostController.h>
+#include <GoWired.h>
+#include "Configuration.h"                  // Of the prepared sketch
+#include "TouchTracker.h"
+#include <cstdio>
+#include <cstring>
+
+#define REPLAY_START (30 * HOST_S)          // Trace starts after the startup synchronization
+#define REPLAY_FIELDS 3
+#define REPLAY_ATTRIBUTION (1000 * HOST_MS) // Relay changes later than that after a release aren't attributed to it
+#define REPLAY_SETTLE (5000 * HOST_MS)      // New reference of a field after its cover changed
+#define REPLAY_MAX_LATENCY (500 * HOST_MS)
+
+extern CommonIO CommonIO[];
+extern TouchTracker<NUMBER_OF_RELAYS+NUMBER_OF_INPUTS> Touch;
+
+static HostBus Bus(HostSketch.BaudRate, HostSketch.SohCount);
+static HostController Gateway;
+
+struct ReplayRow {
+  uint32_t Ms;
+  uint16_t Values[REPLAY_FIELDS];
+  uint8_t Labels;
+};
+
+struct ReplayTouch {
+  HostTime Start;
+  HostTime End;
+  bool Blind;                               // On a covered field, before a new reference
+  bool Detected;
+};
+
+struct ReplayCover {
+  uint8_t Field;
+  HostTime Start;
+  HostTime End;
+  HostTime Recovered;                       // First detected touch after Start
+};
+
+static std::vector<ReplayRow> Rows;
+static std::vector<ReplayTouch> Touches[REPLAY_FIELDS];
+static std::vector<ReplayCover> Covers;
+static const uint8_t Fields[REPLAY_FIELDS] = {TOUCH_FIELD_1, TOUCH_FIELD_2, TOUCH_FIELD_3};
+static const uint8_t Relays[] = {RELAY_PIN_1, RELAY_PIN_2};
+
+static HostStats TouchLatency;              // Touch start to relay change
+static HostStats ReleaseLatency;            // Release to relay change
+static uint32_t FalseTriggers = 0;
+static bool Logging = false;
+
+static HostTime Time(uint32_t Ms)  {
+  return REPLAY_START + Ms * HOST_MS;
+}
+
+/**
+ * @brief Reads the trace; touches & covers from the labels
+ *
+ */
+static bool Load(const char *Path)  {
+  FILE *File = fopen(Path, "r");
+  char Line[128];
+
+  if(!File) return false;
+
+  while(fgets(Line, sizeof(Line), File)) {
+    if(Line[0] == '#' || Line[0] == '\n') continue;
+
+    ReplayRow Row;
+    unsigned Values[REPLAY_FIELDS], Labels;
+
+    if(sscanf(Line, "%u,%u,%u,%u,%u", &Row.Ms, &Values[0], &Values[1], &Values[2], &Labels) != 5) {
+      fclose(File);
+      return false;
+    }
+    for(uint8_t i=0; i<REPLAY_FIELDS; i++) Row.Values[i] = Values[i];
+    Row.Labels = Labels;
+
+    uint8_t Previous = Rows.empty() ? 0 : Rows.back().Labels;
+
+    for(uint8_t i=0; i<REPLAY_FIELDS; i++) {
+      uint8_t Finger = 1 << i, Cover = 1 << (i + 4);
+
+      if((Labels & Cover) && !(Previous & Cover)) Covers.push_back({i, Time(Row.Ms), 0, 0});
+      if(!(Labels & Cover) && (Previous & Cover)) Covers.back().End = Time(Row.Ms);
+      if((Labels & Finger) && !(Previous & Finger)) Touches[i].push_back({Time(Row.Ms), 0, false, false});
+      if(!(Labels & Finger) && (Previous & Finger)) Touches[i].back().End = Time(Row.Ms);
+    }
+    Rows.push_back(Row);
+  }
+  fclose(File);
+
+  HostTime Last = Time(Rows.back().Ms + 1);
+
+  for(uint8_t i=0; i<REPLAY_FIELDS; i++) {
+    if(!Touches[i].empty() && !Touches[i].back().End) Touches[i].back().End = Last;
+  }
+
+  for(ReplayCover &C : Covers) {
+    if(!C.End) C.End = Last;
+
+    HostTime Stuck = min(C.End, C.Start + TOUCH_STUCK_TIME * HOST_MS + REPLAY_SETTLE);
+
+    for(ReplayTouch &T : Touches[C.Field]) {
+      T.Blind |= (T.Start >= C.Start && T.Start < Stuck) || (T.Start >= C.End && T.Start < C.End + REPLAY_SETTLE);
+    }
+  }
+
+  return !Rows.empty();
+}
+
+/**
+ * @brief Reading of a field at Now (mV): the row in effect, the first one before the trace starts
+ *
+ */
+static double Reading(uint8_t Field, HostTime Now)  {
+  uint32_t Ms = Now < REPLAY_START ? 0 : (Now - REPLAY_START) / HOST_MS;
+  auto Row = std::upper_bound(Rows.begin(), Rows.end(), Ms, [](uint32_t T, const ReplayRow &R) { return T < R.Ms; });
+
+  if(Row != Rows.begin()) Row--;
+
+  return (Row->Values[Field] + 0.5) * 5000 / 1024;
+}
+
+/**
+ * @brief Relay change: attributed to the first touch of the field not detected yet, which started before it
+ * and was released at most REPLAY_ATTRIBUTION before; a false trigger otherwise
+ *
+ */
+static void Changed(uint8_t Field, HostTime Now)  {
+  for(ReplayTouch &T : Touches[Field]) {
+    if(T.Detected || T.Start > Now || Now > T.End + REPLAY_ATTRIBUTION) continue;
+
+    T.Detected = true;
+    if(Logging) printf("%10.3f relay %u, touch %.3f - %.3f\n", (Now - REPLAY_START) / 1e6, Field + 1,
+                       (T.Start - REPLAY_START) / 1e6, (T.End - REPLAY_START) / 1e6);
+    TouchLatency.Add(Now - T.Start);
+    ReleaseLatency.Add(Now > T.End ? Now - T.End : 0);
+
+    for(ReplayCover &C : Covers) {
+      if(C.Field == Field && !C.Recovered && T.Start >= C.Start) C.Recovered = T.Start;
+    }
+    return;
+  }
+
+  if(Logging) printf("%10.3f relay %u, false trigger\n", (Now - REPLAY_START) / 1e6, Field + 1);
+  FalseTriggers++;
+}
+
+int main(int argc, char *argv[])  {
+  const char *Path = nullptr;
+  bool Check = false;
+
+  for(int i=1; i<argc; i++)  {
+    if(!strcmp(argv[i], "--check"))  Check = true;
+    else if(!strcmp(argv[i], "--log")) Logging = true;
+    else Path = argv[i];
+  }
+
+  if(!Path || !Load(Path))  {
+    printf("Usage: touch_replay <trace> [--check]; trace not readable\n");
+    return 2;
+  }
+
+  HostTime End = Time(Rows.back().Ms) + 2 * HOST_S;
+  bool Reset = false;
+
+  Bus.Attach(Gateway);
+  Bus.Attach(Mcu.Port);
+  Gateway.Set(Gateway.NextNodeId, RELAY_ID_1, V_STATUS, "0");
+  Gateway.Set(Gateway.NextNodeId, RELAY_ID_2, V_STATUS, "0");
+
+  Mcu.SetVcc(5000);
+  Mcu.SetNoise(0);                          // Noise is in the trace
+  for(uint8_t i=0; i<REPLAY_FIELDS; i++) {
+    Mcu.SetAnalog(Fields[i], [i](HostTime Now) { return Reading(i, Now); });
+  }
+
+  Mcu.OnOutput = [](uint8_t Pin, uint8_t Value, HostTime Now) {
+    (void)Value;
+    for(uint8_t i=0; i<sizeof(Relays); i++) {
+      if(Pin == Relays[i] && Now >= REPLAY_START) Changed(i, Now);
+    }
+  };
+
+  if(Logging) {
+    Mcu.OnPass = [](HostTime Start, HostTime Busy) {
+      static uint32_t Taken[REPLAY_FIELDS];
+      (void)Busy;
+      for(uint8_t i=0; i<REPLAY_FIELDS; i++) {
+        if(CommonIO[i].References != Taken[i] && Start >= REPLAY_START) printf("%10.3f field %u reference\n", (Start - REPLAY_START) / 1e6, i + 1);
+        Taken[i] = CommonIO[i].References;
+      }
+    };
+  }
+
+  try {
+    Mcu.Run(End);
+  }
+  catch(const HostWatchdogReset &Wdt)  {
+    printf("Watchdog reset at %.3f s\n", Wdt.Time / 1e6);
+    Reset = true;
+  }
+
+  uint32_t Count = 0, Detected = 0, Missed = 0, Blind = 0, BlindDetected = 0, References = 0;
+
+  for(uint8_t i=0; i<REPLAY_FIELDS && Logging; i++) {
+    for(const ReplayTouch &T : Touches[i]) {
+      if(!T.Detected) printf("Missed touch of field %u %.3f - %.3f%s\n", i + 1, (T.Start - REPLAY_START) / 1e6,
+                             (T.End - REPLAY_START) / 1e6, T.Blind ? " (covered)" : "");
+    }
+  }
+
+  for(uint8_t i=0; i<REPLAY_FIELDS; i++) {
+    References += CommonIO[i].References;
+    for(const ReplayTouch &T : Touches[i]) {
+      Count++;
+      if(T.Blind) {
+        Blind++;
+        BlindDetected += T.Detected;
+      }
+      else if(T.Detected) Detected++;
+      else Missed++;
+    }
+  }
+
+  double Hours = (End - REPLAY_START) / 3600e6;
+
+  printf("Touch replay %s: %.0f s\n", Path, (End - REPLAY_START) / 1e6);
+  printf("TOUCH_DRIFT_LIMIT %d, TOUCH_NOISE_FACTOR %d, TOUCH_STUCK_TIME %d ms\n", TOUCH_DRIFT_LIMIT, TOUCH_NOISE_FACTOR, TOUCH_STUCK_TIME);
+  printf("Touches                %10u, %u detected, %u missed, %u on a covered field (%u detected)\n", Count, Detected, Missed, Blind, BlindDetected);
+  printf("False triggers         %10u, %.1f / h\n", FalseTriggers, FalseTriggers / Hours);
+  printf("References             %10u, %.1f / h\n", References, References / Hours);
+  for(uint8_t i=0; i<REPLAY_FIELDS; i++) {
+    printf("Field %u                %10d drift, %d noise, threshold %u\n", i + 1, Touch.Drift(i), Touch.Noise(i), Touch.Threshold(i));
+  }
+
+  for(const ReplayCover &C : Covers) {
+    printf("Field %u covered at     %10.1f s, ", C.Field + 1, (C.Start - REPLAY_START) / 1e6);
+    if(C.Recovered) printf("first touch detected %.1f s later\n", (C.Recovered - C.Start) / 1e6);
+    else printf("no touch detected after it\n");
+  }
+  printf("\n");
+
+  HostStats::PrintHeader();
+  TouchLatency.Print("touch -> relay", false);
+  ReleaseLatency.Print("release -> relay", false);
+
+  if(!Check)  return 0;
+
+  bool Fast = ReleaseLatency.Count() && ReleaseLatency.Percentile(99) <= REPLAY_MAX_LATENCY;
+  bool Ok = !Reset && !FalseTriggers && !Missed && Detected && Fast;
+
+  if(!Ok) printf("FAILED:%s%s%s%s\n", Reset ? " watchdog" : "", FalseTriggers ? " false triggers" : "",
+                 Missed || !Detected ? " missed touches" : "", Fast ? "" : " slow");
+
+  return Ok ? 0 : 1;
+}
+/*
+   EOF
+*/
@@ -0,0 +1,221 @@
+/*
+ * Arduino.h file
+ * Arduino core & ATmega328P registers for host builds of the sketches. Everything that takes time on the
+ * MCU is routed to the virtual node in Host.h; see Readme.md for the timing model.
+ *
+ */
+
+#ifndef Arduino_h
+#define Arduino_h
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+// Standard headers used by the HAL & the harnesses, before the min() & max() macros of the core
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <system_error>
+#include <vector>
+// errno.h of the host, included by the above; avr-libc defines only EDOM & ERANGE, so the other names are free in the sketches
+#include <errno.h>
+#undef EIO                                  // 8RelayDin: ShadowIO EIO[]
+
+#define F_CPU 16000000UL
+#define E2END 0x3FF                         // ATmega328P: 1 kB EEPROM
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+#define HIGH 0x1
+#define LOW 0x0
+#define INPUT 0x0
+#define OUTPUT 0x1
+#define INPUT_PULLUP 0x2
+
+static const uint8_t A0 = 14;
+static const uint8_t A1 = 15;
+static const uint8_t A2 = 16;
+static const uint8_t A3 = 17;
+static const uint8_t A4 = 18;
+static const uint8_t A5 = 19;
+static const uint8_t A6 = 20;
+static const uint8_t A7 = 21;
+#define NUM_DIGITAL_PINS 24                 // ATmega328PB (Touch MCU-Raw: pin 23); the other registers are the 328P's
+
+/***** Core *****/
+uint32_t millis();
+uint32_t micros();
+void delay(uint32_t Ms);
+void delayMicroseconds(unsigned int Us);
+void pinMode(uint8_t Pin, uint8_t Mode);
+int digitalRead(uint8_t Pin);
+void digitalWrite(uint8_t Pin, uint8_t Value);
+int analogRead(uint8_t Pin);
+void analogWrite(uint8_t Pin, int Value);
+void yield();
+
+#define min(a,b) ((a)<(b)?(a):(b))
+#define max(a,b) ((a)>(b)?(a):(b))
+#define constrain(amt,low,high) ((amt)<(low)?(low):((amt)>(high)?(high):(amt)))
+#define bitRead(value, bit) (((value) >> (bit)) & 0x01)
+#define bitSet(value, bit) ((value) |= (1UL << (bit)))
+#define bitClear(value, bit) ((value) &= ~(1UL << (bit)))
+#define bitWrite(value, bit, bitvalue) ((bitvalue) ? bitSet(value, bit) : bitClear(value, bit))
+
+/***** Flash *****/
+#define PROGMEM
+#define PSTR(s) (s)
+class __FlashStringHelper;
+#define F(s) (reinterpret_cast<const __FlashStringHelper *>(PSTR(s)))
+
+inline uint8_t pgm_read_byte(const void *p)  { return *(const uint8_t *)p; }
+inline uint16_t pgm_read_word(const void *p)  { uint16_t v; memcpy(&v, p, sizeof(v)); return v; }
+inline uint32_t pgm_read_dword(const void *p)  { uint32_t v; memcpy(&v, p, sizeof(v)); return v; }
+inline const void *pgm_read_ptr(const void *p)  { return *(const void * const *)p; }
+#define memcpy_P memcpy
+#define memcmp_P memcmp
+#define strlen_P strlen
+#define strcpy_P strcpy
+#define strncpy_P strncpy
+#define strcmp_P strcmp
+#define strncmp_P strncmp
+#define snprintf_P snprintf
+#define sprintf_P sprintf
+
+/***** AVR libc *****/
+char *itoa(int Value, char *Text, int Radix);
+char *ltoa(long Value, char *Text, int Radix);
+char *utoa(unsigned int Value, char *Text, int Radix);
+char *ultoa(unsigned long Value, char *Text, int Radix);
+char *dtostrf(double Value, signed char Width, unsigned char Precision, char *Text);
+
+/***** Registers *****/
+/**
+ * @brief I/O register whose writes are seen by the virtual node (ADC & Timer2 control); reads may take
+ * time too (a busy loop polling ADSC)
+ *
+ */
+class HostRegister {
+
+  public:
+    constexpr explicit HostRegister(void (*OnWrite)(), void (*OnRead)() = nullptr, uint8_t Reset = 0) : Value(Reset), _OnWrite(OnWrite), _OnRead(OnRead) {}
+
+    operator uint8_t() const  {
+      if(_OnRead) _OnRead();
+      return Value;
+    }
+
+    HostRegister &operator=(uint8_t V)  {
+      Value = V;
+      _OnWrite();
+      return *this;
+    }
+
+    HostRegister &operator=(const HostRegister &R)  {
+      return *this = R.Value;
+    }
+
+    // int like the promoted operand of a uint8_t register: ADCSRA &= ~_BV(ADEN)
+    HostRegister &operator|=(int Bits)  { return *this = Value | Bits; }
+    HostRegister &operator&=(int Bits)  { return *this = Value & Bits; }
+    HostRegister &operator^=(int Bits)  { return *this = Value ^ Bits; }
+
+    uint8_t Value;
+
+  private:
+    void (*_OnWrite)();
+    void (*_OnRead)();
+};
+
+extern HostRegister ADCSRA, TCCR2A, TCCR2B, OCR2A, TIMSK2;
+extern volatile uint8_t ADMUX, ADCSRB, DIDR0, MCUSR, WDTCSR, PCICR, PCMSK0, PCMSK1, PCMSK2, SMCR, PRR, ACSR, SREG;
+extern volatile uint16_t ADC;
+#define ADCL ((uint8_t)(ADC & 0xFF))
+#define ADCH ((uint8_t)(ADC >> 8))
+extern uintptr_t HostStackPointer;          // Profiler.h only; LOOP_PROFILING isn't supported on host
+#define SP HostStackPointer
+
+#define _BV(bit) (1 << (bit))
+#define bit_is_set(sfr, bit) ((sfr) & _BV(bit))
+#define bit_is_clear(sfr, bit) (!((sfr) & _BV(bit)))
+
+// ADMUX
+#define REFS1 7
+#define REFS0 6
+#define ADLAR 5
+#define MUX3 3
+#define MUX2 2
+#define MUX1 1
+#define MUX0 0
+// ADCSRA
+#define ADEN 7
+#define ADSC 6
+#define ADATE 5
+#define ADIF 4
+#define ADIE 3
+#define ADPS2 2
+#define ADPS1 1
+#define ADPS0 0
+// Timer2
+#define WGM21 1
+#define WGM20 0
+#define CS22 2
+#define CS21 1
+#define CS20 0
+#define OCIE2A 1
+// Watchdog, pin change interrupts, analog comparator
+#define WDIF 7
+#define WDIE 6
+#define WDCE 4
+#define WDE 3
+#define PCIE0 0
+#define PCIE1 1
+#define PCIE2 2
+#define ACD 7
+// Sleep mode control, power reduction
+#define SM2 3
+#define SM1 2
+#define SM0 1
+#define SE 0
+#define PRTWI 7
+#define PRTIM2 6
+#define PRTIM0 5
+#define PRTIM1 3
+#define PRSPI 2
+#define PRUSART0 1
+#define PRADC 0
+
+// Pin change interrupts: D0-D7 PCINT16-23 (PCIE2), D8-D13 PCINT0-5 (PCIE0), A0-A5 PCINT8-13 (PCIE1); none on A6, A7 & above
+#define digitalPinToPCICR(p) ((p) < 20 ? &PCICR : (volatile uint8_t *)0)
+#define digitalPinToPCICRbit(p) ((p) < 8 ? PCIE2 : ((p) < 14 ? PCIE0 : PCIE1))
+#define digitalPinToPCMSK(p) ((p) < 8 ? &PCMSK2 : ((p) < 14 ? &PCMSK0 : ((p) < 20 ? &PCMSK1 : (volatile uint8_t *)0)))
+#define digitalPinToPCMSKbit(p) ((p) < 8 ? (p) : ((p) < 14 ? (p) - 8 : (p) - 14))
+
+/***** Interrupts *****/
+void cli();
+void sei();
+#define noInterrupts() cli()
+#define interrupts() sei()
+
+#define ISR(Vector, ...) extern "C" void Vector(void) __VA_ARGS__
+#define ISR_ALIASOF(Vector) __attribute__((alias(#Vector)))
+extern "C" void ADC_vect(void);
+extern "C" void TIMER2_COMPA_vect(void);
+extern "C" void PCINT0_vect(void);
+extern "C" void PCINT1_vect(void);
+extern "C" void PCINT2_vect(void);
+
+#include "WString.h"
+
+#endif
+/*
+   EOF
+*/
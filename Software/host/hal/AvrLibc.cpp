@@ -0,0 +1,53 @@
+/*
+ * AvrLibc.cpp file
+ * Number conversions of AVR libc with 16-bit int & 32-bit long, see Arduino.h
+ *
+ */
+
+#include <Arduino.h>
+
+static char *ToText(unsigned long Value, bool Negative, char *Text, int Radix)  {
+  char Digits[34];
+  uint8_t n = 0;
+
+  do  {
+    uint8_t d = Value % Radix;
+    Digits[n++] = d < 10 ? '0' + d : 'a' + d - 10;
+    Value /= Radix;
+  } while(Value > 0);
+
+  char *p = Text;
+  if(Negative)  *p++ = '-';
+  while(n > 0)  *p++ = Digits[--n];
+  *p = 0;
+
+  return Text;
+}
+
+char *itoa(int Value, char *Text, int Radix)  {
+  // 16-bit int on AVR
+  int16_t V = Value;
+  return Radix == 10 && V < 0 ? ToText(-(int32_t)V, true, Text, Radix) : ToText((uint16_t)V, false, Text, Radix);
+}
+
+char *ltoa(long Value, char *Text, int Radix)  {
+  int32_t V = Value;
+  return Radix == 10 && V < 0 ? ToText(-(int64_t)V, true, Text, Radix) : ToText((uint32_t)V, false, Text, Radix);
+}
+
+char *utoa(unsigned int Value, char *Text, int Radix)  {
+  return ToText((uint16_t)Value, false, Text, Radix);
+}
+
+char *ultoa(unsigned long Value, char *Text, int Radix)  {
+  return ToText((uint32_t)Value, false, Text, Radix);
+}
+
+char *dtostrf(double Value, signed char Width, unsigned char Precision, char *Text)  {
+  sprintf(Text, "%*.*f", Width, Precision, Value);
+
+  return Text;
+}
+/*
+   EOF
+*/
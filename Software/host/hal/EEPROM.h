@@ -0,0 +1,48 @@
+/*
+ * EEPROM.h file
+ * Arduino EEPROM library on top of the EEPROM of the virtual node (avr/eeprom.h).
+ *
+ */
+
+#ifndef EEPROM_h
+#define EEPROM_h
+
+#include <avr/eeprom.h>
+
+struct EEPROMClass {
+
+  uint8_t read(int Address)  {
+    return eeprom_read_byte((const uint8_t *)(intptr_t)Address);
+  }
+
+  void write(int Address, uint8_t Value)  {
+    eeprom_write_byte((uint8_t *)(intptr_t)Address, Value);
+  }
+
+  void update(int Address, uint8_t Value)  {
+    eeprom_update_byte((uint8_t *)(intptr_t)Address, Value);
+  }
+
+  template<typename T> T &get(int Address, T &Value)  {
+    uint8_t *p = (uint8_t *)&Value;
+    for(size_t i=0; i<sizeof(T); i++)  p[i] = read(Address + i);
+    return Value;
+  }
+
+  template<typename T> const T &put(int Address, const T &Value)  {
+    const uint8_t *p = (const uint8_t *)&Value;
+    for(size_t i=0; i<sizeof(T); i++)  update(Address + i, p[i]);
+    return Value;
+  }
+
+  uint16_t length()  {
+    return E2END + 1;
+  }
+};
+
+extern EEPROMClass EEPROM;
+
+#endif
+/*
+   EOF
+*/
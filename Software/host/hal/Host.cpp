@@ -0,0 +1,475 @@
+/*
+ * Host.cpp file
+ * Virtual ATmega328P node & Arduino core of the host builds, see Host.h
+ *
+ */
+
+#include "Host.h"
+#include <EEPROM.h>
+#include <avr/eeprom.h>
+#include <avr/wdt.h>
+#include <avr/sleep.h>
+#include <util/atomic.h>
+
+HostMcu Mcu;
+EEPROMClass EEPROM;
+
+/***** Registers *****/
+static void AdcWritten()  { Mcu.AdcWrite(); }
+static void TimerWritten()  { Mcu.TimerWrite(); }
+static void AdcPolled()  { Mcu.AdcPoll(); }
+
+HostRegister ADCSRA(AdcWritten, AdcPolled, _BV(ADEN) | _BV(ADPS2) | _BV(ADPS1) | _BV(ADPS0));   // As set by init()
+HostRegister TCCR2A(TimerWritten);
+HostRegister TCCR2B(TimerWritten);
+HostRegister OCR2A(TimerWritten);
+HostRegister TIMSK2(TimerWritten);
+volatile uint8_t ADMUX, ADCSRB, DIDR0, MCUSR, WDTCSR, PCICR, PCMSK0, PCMSK1, PCMSK2, SMCR, PRR, ACSR;
+volatile uint8_t SREG = 0x80;               // Interrupts enabled by init()
+volatile uint16_t ADC;
+uintptr_t HostStackPointer;
+
+#define SREG_I 0x80
+
+// Interrupt vectors of sketches which don't use them
+extern "C" __attribute__((weak)) void ADC_vect(void)  {}
+extern "C" __attribute__((weak)) void TIMER2_COMPA_vect(void)  {}
+extern "C" __attribute__((weak)) void PCINT0_vect(void)  {}
+extern "C" __attribute__((weak)) void PCINT1_vect(void)  {}
+extern "C" __attribute__((weak)) void PCINT2_vect(void)  {}
+
+// Timer0 overflow of the core; millis() is derived from the clock
+static void Timer0Overflow()  {}
+
+/***** Traces *****/
+std::map<std::string, HostStats> &HostTraces()  {
+  static std::map<std::string, HostStats> Traces;
+
+  return Traces;
+}
+
+HostTrace::HostTrace(const char *Name) : _Stats(HostTraces()[Name]), _Start(Mcu.Now()) {}
+
+HostTrace::~HostTrace()  {
+  _Stats.Add(Mcu.Now() - _Start);
+}
+
+/***** Virtual MCU *****/
+HostMcu::HostMcu()  {
+  memset(Eeprom, 0xFF, sizeof(Eeprom));
+  memset(_Latch, LOW, sizeof(_Latch));
+  memset(_Duty, 0, sizeof(_Duty));
+  memset(_Mode, INPUT, sizeof(_Mode));
+}
+
+void HostMcu::Cpu(HostTime Us)  {
+  HostTime End = _Now + Us;
+
+  for(;;) {
+    HostTime T = NextEvent();
+    if(T > End) break;
+    if(T > _Now)  _Now = T;
+    ServeEvents(End);
+  }
+
+  if(End > _Now)  _Now = End;
+}
+
+void HostMcu::Idle(HostTime To, bool BreakOnRx, bool Kick)  {
+  HostTime Unused = 0;
+
+  while(_Now < To)  {
+    if(Kick)  WatchdogReset();
+
+    HostTime Next = min(To, NextEvent());
+
+    if(Next > _Now) {
+      _Now = Port.Bus != nullptr ? Port.Bus->Wait(Port, _Now, Next) : Next;
+    }
+
+    if(Kick)  WatchdogReset();
+    ServeEvents(Unused);
+
+    if(BreakOnRx && !Rx.empty())  break;
+  }
+}
+
+HostTime HostMcu::NextEvent() const  {
+  if((SREG & SREG_I) && (_AdcPending || _TimerPending)) return _Now;
+
+  return min(min(_AdcDone, _TimerNext), _WdtDeadline);
+}
+
+bool HostMcu::ServeEvents(HostTime &Stretch)  {
+  bool Served = false;
+
+  if(_WdtDeadline <= _Now)  {
+    _WdtDeadline = HOST_NEVER;
+    throw HostWatchdogReset{_Now};
+  }
+
+  if(_AdcDone <= _Now)  {
+    _AdcDone = HOST_NEVER;
+    ADC = AnalogValue(ADMUX & 0x0F);
+    ADCSRA.Value &= ~_BV(ADSC);
+    ADCSRA.Value |= _BV(ADIF);
+    _AdcPending = ADCSRA.Value & _BV(ADIE);
+  }
+
+  if(_TimerNext <= _Now)  {
+    while(_TimerNext <= _Now) _TimerNext += _TimerPeriod;
+    _TimerPending = true;
+  }
+
+  if(!(SREG & SREG_I))  return false;
+
+  if(_AdcPending) {
+    _AdcPending = false;
+    ADCSRA.Value &= ~_BV(ADIF);
+    Isr(ADC_vect, HOST_ADC_ISR_US, Stretch);
+    Served = true;
+  }
+
+  if(_TimerPending) {
+    _TimerPending = false;
+    Isr(TIMER2_COMPA_vect, HOST_TIMER_ISR_US, Stretch);
+    Served = true;
+  }
+
+  return Served;
+}
+
+void HostMcu::Isr(void (*Vector)(), HostTime Cost, HostTime &Stretch)  {
+  HostTime Start = _Now;
+
+  SREG &= ~SREG_I;
+  Vector();
+  SREG |= SREG_I;
+  _Now += Cost;
+  Stretch += _Now - Start;
+}
+
+void HostMcu::InterruptsOn()  {
+  HostTime Unused = 0;
+
+  while(ServeEvents(Unused));
+}
+
+/***** Sleep *****/
+void HostMcu::Sleep()  {
+  if(!(SMCR & _BV(SE))) return;
+
+  static void (* const Vectors[3])() = {PCINT0_vect, PCINT1_vect, PCINT2_vect};
+  HostTime Start = _Now;
+  HostTime Unused = 0;
+  bool Overflow = false;
+  uint8_t Groups;
+
+  LastWait = _Now;
+
+  while((Groups = PinChanges()) == 0)  {
+    HostTime Tick = PRR & _BV(PRTIM0) ? HOST_NEVER : (_Now / HOST_TIMER0_US + 1) * HOST_TIMER0_US;
+    HostTime Next = min(Tick, NextEvent());
+
+    if(Next > _Now) {
+      _Now = Port.Bus != nullptr ? Port.Bus->Wait(Port, _Now, Next) : Next;
+    }
+
+    if(_Now >= Tick)  {
+      Overflow = true;
+      Groups = PinChanges();
+      break;
+    }
+
+    if(NextEvent() <= _Now) break;
+  }
+
+  Asleep += _Now - Start;
+  Wakes++;
+  if(Groups)  PinWakes++;
+
+  for(uint8_t i=0; i<3; i++)  {
+    if(Groups & _BV(i)) Isr(Vectors[i], HOST_PCINT_ISR_US, Unused);
+  }
+
+  if(Overflow)  Isr(Timer0Overflow, HOST_TIMER0_ISR_US, Unused);
+  while(ServeEvents(Unused));
+}
+
+uint8_t HostMcu::PinChanges()  {
+  uint8_t Groups = 0;
+
+  // Pins A0-A5 & below have a pin change interrupt; the first check only samples the levels
+  for(uint8_t Pin=0; Pin<A6; Pin++) {
+    bool Level = DigitalInput(Pin);
+
+    if(_PinsSampled && Level != _PinLevel[Pin] && (PCICR & _BV(digitalPinToPCICRbit(Pin)))
+       && (*digitalPinToPCMSK(Pin) & _BV(digitalPinToPCMSKbit(Pin))))  {
+      Groups |= _BV(digitalPinToPCICRbit(Pin));
+    }
+
+    _PinLevel[Pin] = Level;
+  }
+
+  _PinsSampled = true;
+
+  return Groups;
+}
+
+/***** ADC *****/
+void HostMcu::AdcWrite()  {
+  if(!(ADCSRA.Value & _BV(ADEN))) {
+    _AdcDone = HOST_NEVER;
+    _AdcEnabled = false;
+    return;
+  }
+
+  // ADIF is cleared by writing 1
+  ADCSRA.Value &= ~_BV(ADIF);
+
+  if((ADCSRA.Value & _BV(ADSC)) && _AdcDone == HOST_NEVER) {
+    uint8_t Ps = ADCSRA.Value & 0x07;
+    uint32_t Prescaler = 1UL << (Ps > 0 ? Ps : 1);
+    uint32_t Clocks = _AdcEnabled ? 13 : 25;        // First conversion initializes the analog circuitry
+
+    _AdcDone = _Now + (Clocks * Prescaler * 1000000ULL + F_CPU / 2) / F_CPU;
+    _AdcEnabled = true;
+  }
+}
+
+uint16_t HostMcu::AnalogValue(uint8_t Mux)  {
+  double Ref = (ADMUX & (_BV(REFS1) | _BV(REFS0))) == (_BV(REFS1) | _BV(REFS0)) ? 1100 : _Vcc;
+  double Mv = 0;
+
+  if(Mux == 0x0E) {
+    Mv = 1100;
+  }
+  else if(Mux < 8 && _Analog[Mux])  {
+    Mv = _Analog[Mux](_Now);
+  }
+
+  int32_t Value = (int32_t)floor(Mv * 1024 / Ref);
+
+  if(_Noise > 0)  {
+    Value += (int32_t)(Random() % (2 * _Noise + 1)) - _Noise;
+  }
+
+  return Value < 0 ? 0 : (Value > 1023 ? 1023 : Value);
+}
+
+uint32_t HostMcu::Random()  {
+  _Seed = _Seed * 1103515245UL + 12345;
+
+  return _Seed >> 8;
+}
+
+/***** Timer2 *****/
+void HostMcu::TimerWrite()  {
+  static const uint16_t Prescalers[8] = {0, 1, 8, 32, 64, 128, 256, 1024};
+  uint16_t Prescaler = Prescalers[TCCR2B.Value & 0x07];
+
+  if(Prescaler == 0 || !(TIMSK2.Value & _BV(OCIE2A))) {
+    _TimerNext = HOST_NEVER;
+    _TimerPeriod = 0;
+    return;
+  }
+
+  HostTime Period = ((uint32_t)(OCR2A.Value + 1) * Prescaler * 1000000ULL + F_CPU / 2) / F_CPU;
+
+  if(Period != _TimerPeriod || _TimerNext == HOST_NEVER)  {
+    _TimerPeriod = Period > 0 ? Period : 1;
+    _TimerNext = _Now + _TimerPeriod;
+  }
+}
+
+/***** Watchdog *****/
+void HostMcu::WatchdogEnable(uint8_t Timeout)  {
+  static const uint16_t Periods[10] = {15, 30, 60, 120, 250, 500, 1000, 2000, 4000, 8000};
+
+  _WdtPeriod = Periods[Timeout < 10 ? Timeout : 9] * HOST_MS;
+  _WdtDeadline = _Now + _WdtPeriod;
+}
+
+/***** Pins *****/
+void HostMcu::SetDigital(uint8_t Pin, std::function<bool(HostTime)> Script)  {
+  _Digital[Pin] = Script;
+}
+
+void HostMcu::SetAnalog(uint8_t Pin, std::function<double(HostTime)> Script)  {
+  _Analog[Pin >= A0 ? Pin - A0 : Pin] = Script;
+}
+
+bool HostMcu::DigitalInput(uint8_t Pin)  {
+  if(_Mode[Pin] == OUTPUT)  return _Latch[Pin];
+  if(_Digital[Pin]) return _Digital[Pin](_Now);
+
+  return _Mode[Pin] == INPUT_PULLUP;
+}
+
+void HostMcu::DigitalOutput(uint8_t Pin, uint8_t Value)  {
+  Drive(Pin, Value ? HIGH : LOW, Value ? 255 : 0);
+}
+
+void HostMcu::Pwm(uint8_t Pin, uint8_t Duty)  {
+  Drive(Pin, Duty > 0 ? HIGH : LOW, Duty);
+}
+
+void HostMcu::Drive(uint8_t Pin, uint8_t Latch, uint8_t Duty)  {
+  if(_Latch[Pin] == Latch && _Duty[Pin] == Duty)  return;
+
+  _Latch[Pin] = Latch;
+  _Duty[Pin] = Duty;
+  if(OnOutput)  OnOutput(Pin, Latch, _Now);
+}
+
+/***** EEPROM *****/
+void HostMcu::EepromWait()  {
+  if(_Now < _EepromBusy)  Idle(_EepromBusy, false, false);
+}
+
+/***** Run *****/
+void HostMcu::Run(HostTime Until)  {
+  if(!_Booted)  {
+    _Booted = true;
+    HostBegin();
+  }
+
+  while(_Now < Until)  {
+    HostProcess();
+
+    HostTime Start = _Now;
+
+    LastWait = HOST_NEVER;
+    loop();
+
+    HostTime Busy = (LastWait != HOST_NEVER ? LastWait : _Now) - Start;
+
+    Passes.Add(Busy);
+    if(OnPass)  OnPass(Start, Busy);
+  }
+}
+
+void HostMcu::Receive(const MyMessage &Msg, uint8_t Bytes, bool ForUs, HostTime Time)  {
+  if(RxBytes + Bytes > HOST_RX_BUFFER)  {
+    RxDropped++;
+    return;
+  }
+
+  Rx.push_back(HostRxFrame{Msg, Time, Bytes, ForUs});
+  RxBytes += Bytes;
+}
+
+/***** Arduino core *****/
+uint32_t millis()  {
+  return Mcu.Now() / 1000;
+}
+
+uint32_t micros()  {
+  return Mcu.Now();
+}
+
+void delay(uint32_t Ms)  {
+  // Busy loop calling yield(); the watchdog isn't reset
+  while(Ms-- > 0) {
+    Mcu.Idle(Mcu.Now() + 1000, false, false);
+    yield();
+  }
+}
+
+void delayMicroseconds(unsigned int Us)  {
+  Mcu.Cpu(Us);
+}
+
+void pinMode(uint8_t Pin, uint8_t Mode)  {
+  Mcu.Cpu(HOST_DIGITAL_US);
+  Mcu.PinMode(Pin, Mode);
+}
+
+int digitalRead(uint8_t Pin)  {
+  Mcu.Cpu(HOST_DIGITAL_US);
+
+  return Mcu.DigitalInput(Pin) ? HIGH : LOW;
+}
+
+void digitalWrite(uint8_t Pin, uint8_t Value)  {
+  Mcu.Cpu(HOST_DIGITAL_US);
+  Mcu.DigitalOutput(Pin, Value);
+}
+
+int analogRead(uint8_t Pin)  {
+  // Single, blocking conversion
+  ADMUX = (ADMUX & 0xF0) | ((Pin >= A0 ? Pin - A0 : Pin) & 0x07);
+  Mcu.Cpu((13UL * 128 * 1000000UL) / F_CPU);
+
+  return Mcu.AnalogValue(ADMUX & 0x0F);
+}
+
+void analogWrite(uint8_t Pin, int Value)  {
+  Mcu.Cpu(HOST_ANALOG_WRITE_US);
+  Mcu.Pwm(Pin, Value < 0 ? 0 : (Value > 255 ? 255 : Value));
+}
+
+__attribute__((weak)) void yield()  {}
+
+void cli()  {
+  SREG &= ~SREG_I;
+}
+
+void sei()  {
+  SREG |= SREG_I;
+  Mcu.InterruptsOn();
+}
+
+/***** util/atomic.h *****/
+HostAtomic::HostAtomic() : _SREG(SREG)  {
+  cli();
+}
+
+HostAtomic::~HostAtomic() noexcept(false)  {
+  SREG = _SREG;
+  Mcu.Cpu(HOST_ATOMIC_US);
+}
+
+/***** avr/wdt.h *****/
+void wdt_enable(uint8_t Timeout)  {
+  Mcu.WatchdogEnable(Timeout);
+}
+
+void wdt_disable()  {
+  Mcu.WatchdogDisable();
+}
+
+void wdt_reset()  {
+  Mcu.WatchdogReset();
+}
+
+/***** avr/sleep.h *****/
+void sleep_cpu()  {
+  Mcu.Sleep();
+}
+
+/***** avr/eeprom.h *****/
+bool eeprom_is_ready()  {
+  return Mcu.Now() >= Mcu.EepromReady();
+}
+
+uint8_t eeprom_read_byte(const uint8_t *Address)  {
+  Mcu.EepromWait();
+  Mcu.Cpu(1);
+
+  return Mcu.Eeprom[(uintptr_t)Address & E2END];
+}
+
+void eeprom_write_byte(uint8_t *Address, uint8_t Value)  {
+  Mcu.EepromWait();
+  Mcu.Eeprom[(uintptr_t)Address & E2END] = Value;
+  Mcu.EepromWritten();
+}
+
+void eeprom_update_byte(uint8_t *Address, uint8_t Value)  {
+  if(eeprom_read_byte(Address) != Value)  eeprom_write_byte(Address, Value);
+}
+
+/*
+   EOF
+*/
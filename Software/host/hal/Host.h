@@ -0,0 +1,279 @@
+/*
+ * Host.h file
+ * Virtual ATmega328P node for host builds of the sketches. Its clock (us) advances only through what the
+ * sketch does: pin access, ADC conversions, EEPROM writes, frames on the bus & waits. The ADC and Timer2
+ * interrupts, the EEPROM, the watchdog and the RS485 port are modelled; pins are driven by scripts of the
+ * harness. Plain computation isn't modelled and takes no time, see Readme.md.
+ *
+ */
+
+#ifndef Host_h
+#define Host_h
+
+#include <Arduino.h>
+#include <MySensors.h>
+#include "HostBus.h"
+#include <map>
+
+#define HOST_MS 1000ULL
+#define HOST_S 1000000ULL
+
+// Estimated CPU time (us) of core functions at 16 MHz
+#define HOST_DIGITAL_US 4                   // digitalRead(), digitalWrite(), pinMode()
+#define HOST_ANALOG_WRITE_US 6
+#define HOST_ADC_ISR_US 7                   // ADC_vect (AnalogSampler::Sample)
+#define HOST_TIMER_ISR_US 12                // TIMER2_COMPA_vect (Fader::Tick)
+#define HOST_TIMER0_ISR_US 5                // TIMER0_OVF_vect of the core (millis() counter)
+#define HOST_PCINT_ISR_US 2                 // PCINTn_vect setting a flag
+#define HOST_ATOMIC_US 1                    // ATOMIC_BLOCK
+#define HOST_POLL_US 1                      // Iteration of a loop polling a register (ADSC)
+#define HOST_PROCESS_US 10                  // MySensors _process() without incoming frames
+#define HOST_LOOP_US 2                      // main() of a sketch without transport: loop() call & serialEventRun()
+#define HOST_PARSE_US 4                     // Transport parser, per received byte
+#define HOST_EEPROM_WRITE_US 3400           // EEPROM byte write (erase & write)
+#define HOST_RX_BUFFER 64                   // HardwareSerial RX buffer (bytes)
+#define HOST_TX_TRIES 10                    // RS485 transportSend(): back-offs before giving up
+#define HOST_TX_BACKOFF_MS 20               // Random back-off after a busy check: 0 to 19 ms
+#define HOST_TIMER0_US 1024                 // Timer0 overflow period of the core (prescaler 64)
+
+/**
+ * @brief Watchdog expired; thrown out of the sketch, ends the run
+ *
+ */
+struct HostWatchdogReset {
+  HostTime Time;
+};
+
+/**
+ * @brief Configuration of the sketch (MY_* definitions); defined in the sketch, see HostSketch.h
+ *
+ */
+struct HostSketchConfig {
+  uint8_t NodeId;                           // MY_NODE_ID
+  uint32_t BaudRate;                        // MY_RS485_BAUD_RATE
+  uint8_t SohCount;                         // MY_RS485_SOH_COUNT
+  uint32_t TransportWaitReady;              // MY_TRANSPORT_WAIT_READY_MS
+  bool Ota;                                 // MY_OTA_FIRMWARE_FEATURE
+  bool Gateway;                             // MY_GATEWAY_MQTT_CLIENT
+  bool Transport;                           // MY_RS485 or MY_GATEWAY_MQTT_CLIENT; false: plain sketch without MySensors
+};
+
+extern const HostSketchConfig HostSketch;
+
+/**
+ * @brief Durations (us) of a traced section: count, mean, max, percentiles & log2 histogram
+ *
+ */
+class HostStats {
+
+  public:
+    void Add(HostTime Value);
+    uint32_t Count() const  { return _Values.size(); }
+    HostTime Max() const  { return _Max; }
+    HostTime Total() const  { return _Total; }
+    double Mean() const  { return _Values.empty() ? 0 : (double)_Total / _Values.size(); }
+    HostTime Percentile(double P) const;
+    void Print(const char *Name, bool Histogram) const;
+    static void PrintHeader();
+
+  private:
+    mutable std::vector<HostTime> _Values;
+    mutable bool _Sorted = true;
+    HostTime _Total = 0;
+    HostTime _Max = 0;
+};
+
+/**
+ * @brief Measures virtual time spent in a scope: HOST_TRACE(Name) at the top of a function
+ *
+ */
+class HostTrace {
+
+  public:
+    explicit HostTrace(const char *Name);
+    ~HostTrace();
+
+  private:
+    HostStats &_Stats;
+    HostTime _Start;
+};
+
+#define HOST_TRACE(Name) HostTrace _HostTrace(#Name)
+
+/**
+ * @brief Frame received by the node, waiting in the RX buffer
+ *
+ */
+struct HostRxFrame {
+  MyMessage Msg;
+  HostTime Arrived;
+  uint8_t Bytes;                            // Bytes on the wire
+  bool ForUs;                               // Addressed to this node (or broadcast)
+};
+
+/**
+ * @brief RS485 port of the node (MySensors RS485 transport)
+ *
+ */
+class HostPort : public HostEndpoint {
+
+  public:
+    void Deliver(const HostFrame &Frame) override;
+
+    /**
+     * @brief Transmits a frame; while a frame is being received it backs off for a random time & checks
+     * again, HOST_TX_TRIES times at most. Blocks until the frame is on the wire.
+     *
+     * @param To next hop
+     * @return false if the bus stayed busy
+     */
+    bool Send(uint8_t To, const MyMessage &Msg);
+
+    uint32_t Backoffs = 0;                  // Back-offs of the collision avoidance
+    std::function<void(const MyMessage &Msg, bool Sent)> OnSend;   // Every Send(), Sent false if refused
+};
+
+class HostMcu {
+
+  public:
+    HostMcu();
+
+    /***** Clock *****/
+    HostTime Now() const  { return _Now; }
+
+    /**
+     * @brief CPU is busy for Us; pending & due interrupts are served and stretch the time
+     *
+     */
+    void Cpu(HostTime Us);
+
+    /**
+     * @brief CPU waits until To; interrupts are served, frames are received
+     *
+     * @param To end of the wait
+     * @param BreakOnRx return as soon as a frame is in the RX buffer
+     * @param Kick the watchdog is reset meanwhile (MySensors wait())
+     */
+    void Idle(HostTime To, bool BreakOnRx, bool Kick);
+
+    /***** Pins *****/
+    void SetDigital(uint8_t Pin, std::function<bool(HostTime)> Script);
+    void SetAnalog(uint8_t Pin, std::function<double(HostTime)> Script);   // mV
+    void SetVcc(uint16_t Vcc)  { _Vcc = Vcc; }
+    void SetNoise(uint8_t Lsb)  { _Noise = Lsb; }                            // Random ADC noise, +-LSB
+    uint8_t Output(uint8_t Pin) const  { return _Latch[Pin]; }
+    uint8_t Duty(uint8_t Pin) const  { return _Duty[Pin]; }
+    uint8_t Mode(uint8_t Pin) const  { return _Mode[Pin]; }
+    std::function<void(uint8_t Pin, uint8_t Value, HostTime Time)> OnOutput;   // Output level or PWM duty changed
+
+    /***** Run *****/
+    /**
+     * @brief Boots the node on the first call (before(), presentation, setup()), then runs loop() passes
+     * until Until; a pass isn't interrupted, so the clock may end past Until
+     *
+     */
+    void Run(HostTime Until);
+    bool Booted() const  { return _Booted; }
+    void PowerOn(HostTime At)  { _Now = At; }                                // Clock at power-on, before Run()
+    void SetSeed(uint32_t Seed)  { _Seed = Seed; }                           // ADC noise & back-offs of this node
+    uint32_t Random();
+    std::function<void(HostTime Start, HostTime Busy)> OnPass;   // After every loop() pass: start, time until final wait()
+    HostStats Passes;                       // Busy time of loop() passes
+
+    /***** Sleep *****/
+    /**
+     * @brief sleep_cpu(): the CPU idles until the next interrupt (Timer0 overflow, ADC, Timer2, watchdog or
+     * pin change) and serves it; no-op without sleep_enable(). Pin changes are sampled on entry & at Timer0
+     * overflows, so a change wakes the CPU at most HOST_TIMER0_US late.
+     *
+     */
+    void Sleep();
+    HostTime Asleep = 0;                    // Time spent in sleep_cpu()
+    uint32_t Wakes = 0;                     // Returns from sleep_cpu()
+    uint32_t PinWakes = 0;                  // Wakes with a pin change interrupt
+
+    /***** EEPROM *****/
+    uint8_t Eeprom[E2END + 1];
+    uint32_t EepromWrites = 0;
+
+    /***** Bus *****/
+    HostPort Port;
+    std::deque<HostRxFrame> Rx;             // HardwareSerial RX buffer & transport parser
+    uint16_t RxBytes = 0;
+    uint32_t RxDropped = 0;                 // Frames lost in a full RX buffer
+    void Receive(const MyMessage &Msg, uint8_t Bytes, bool ForUs, HostTime Time);
+
+    /***** Interrupts & registers (HAL internal) *****/
+    void AdcWrite();
+    void AdcPoll()  { if(ADCSRA.Value & _BV(ADSC)) Cpu(HOST_POLL_US); }
+    void TimerWrite();
+    void InterruptsOn();
+    void WatchdogEnable(uint8_t Timeout);
+    void WatchdogDisable()  { _WdtDeadline = HOST_NEVER; _WdtPeriod = 0; }
+    void WatchdogReset()  { if(_WdtPeriod) _WdtDeadline = _Now + _WdtPeriod; }
+    uint16_t AnalogValue(uint8_t Mux);
+    bool DigitalInput(uint8_t Pin);
+    void DigitalOutput(uint8_t Pin, uint8_t Value);
+    void PinMode(uint8_t Pin, uint8_t Mode)  { _Mode[Pin] = Mode; }
+    void Pwm(uint8_t Pin, uint8_t Duty);
+    HostTime EepromReady() const  { return _EepromBusy; }
+    void EepromWait();
+    void EepromWritten()  { _EepromBusy = _Now + HOST_EEPROM_WRITE_US; EepromWrites++; }
+    HostTime LastWait = 0;                  // Entry of the last wait(), ends the busy part of a pass
+
+  private:
+    HostTime NextEvent() const;
+    bool ServeEvents(HostTime &Stretch);
+    void Isr(void (*Vector)(), HostTime Cost, HostTime &Stretch);
+    void Drive(uint8_t Pin, uint8_t Latch, uint8_t Duty);
+    uint8_t PinChanges();
+
+    HostTime _Now = 0;
+    bool _Booted = false;
+
+    HostTime _AdcDone = HOST_NEVER;
+    bool _AdcPending = false;
+    bool _AdcEnabled = false;
+    HostTime _TimerNext = HOST_NEVER;
+    HostTime _TimerPeriod = 0;
+    bool _TimerPending = false;
+    HostTime _WdtDeadline = HOST_NEVER;
+    HostTime _WdtPeriod = 0;
+    HostTime _EepromBusy = 0;
+
+    uint16_t _Vcc = 5000;
+    uint8_t _Noise = 0;
+    uint32_t _Seed = 1;
+    std::function<bool(HostTime)> _Digital[NUM_DIGITAL_PINS];
+    std::function<double(HostTime)> _Analog[8];
+    uint8_t _Latch[NUM_DIGITAL_PINS];
+    uint8_t _Duty[NUM_DIGITAL_PINS];
+    uint8_t _Mode[NUM_DIGITAL_PINS];
+    bool _PinLevel[NUM_DIGITAL_PINS];       // Levels at the last pin change check
+    bool _PinsSampled = false;
+};
+
+extern HostMcu Mcu;
+
+/**
+ * @brief Traced sections of this node by name
+ *
+ */
+std::map<std::string, HostStats> &HostTraces();
+
+/**
+ * @brief Boots the node: MySensors startup sequence, see MySensors.cpp
+ *
+ */
+void HostBegin();
+
+/**
+ * @brief MySensors _process(): watchdog, transport state & incoming frames
+ *
+ */
+void HostProcess();
+
+#endif
+/*
+   EOF
+*/
@@ -0,0 +1,118 @@
+/*
+ * HostBroker.cpp file
+ * MQTT broker & controller stand-in, see HostBroker.h
+ *
+ */
+
+#include "HostBroker.h"
+
+void HostBroker::Outage(HostTime From, HostTime To)  {
+  _Outages.push_back({From, To});
+  std::sort(_Outages.begin(), _Outages.end());
+}
+
+bool HostBroker::Up(HostTime Now) const  {
+  for(const auto &O : _Outages) {
+    if(Now >= O.first && Now < O.second)  return false;
+  }
+
+  return true;
+}
+
+HostTime HostBroker::Down(HostTime Since) const  {
+  for(const auto &O : _Outages) {
+    if(O.second > Since)  return O.first > Since ? O.first : Since;
+  }
+
+  return HOST_NEVER;
+}
+
+void HostBroker::Command(HostTime At, uint8_t Node, uint8_t Sensor, uint8_t Type, const char *Value)  {
+  MyMessage Msg(Sensor, Type);
+
+  Msg.setSender(GATEWAY_ADDRESS).setDestination(Node).setCommand(C_SET).set(Value);
+  Queue(At, Msg);
+}
+
+void HostBroker::Queue(HostTime At, const MyMessage &Msg)  {
+  auto It = _Queue.begin();
+
+  while(It != _Queue.end() && It->first <= At) It++;
+  _Queue.insert(It, {At, Msg});
+}
+
+bool HostBroker::Take(HostTime Now, HostTime Since, MyMessage &Msg)  {
+  while(!_Queue.empty() && _Queue.front().first <= Now)  {
+    bool Delivered = _Queue.front().first >= Since;
+
+    Msg = _Queue.front().second;
+    _Queue.pop_front();
+
+    if(Delivered) return true;
+    Missed++;
+  }
+
+  return false;
+}
+
+MyMessage HostBroker::Reply(const MyMessage &Msg, uint8_t Command, uint8_t Type) const  {
+  MyMessage R(Msg.sensor, Type);
+
+  R.setSender(GATEWAY_ADDRESS).setDestination(Msg.sender).setCommand(Command);
+  return R;
+}
+
+void HostBroker::Publish(const MyMessage &Msg, HostTime Now, HostTime Since)  {
+  if(Down(Since) <= Now)  {
+    Lost++;
+    return;
+  }
+
+  Published++;
+  if(OnMessage) OnMessage(Msg, Now);
+
+  uint8_t Command = Msg.getCommand();
+  HostTime Controller = Now + ControllerDelay;
+  MyMessage R;
+
+  if(Command == C_INTERNAL) {
+    switch(Msg.type)  {
+      case I_ID_REQUEST:  {
+        char Id[4];
+
+        utoa(NextNodeId++, Id, 10);
+        R = Reply(Msg, C_INTERNAL, I_ID_RESPONSE);
+        Queue(Controller, R.set(Id));
+        break;
+      }
+      case I_CONFIG:
+        R = Reply(Msg, C_INTERNAL, I_CONFIG);
+        Queue(Controller, R.set("M"));
+        break;
+      case I_TIME:
+        R = Reply(Msg, C_INTERNAL, I_TIME);
+        Queue(Controller, R.set((uint32_t)(1600000000UL + Now / HOST_S)));
+        break;
+      default:
+        break;
+    }
+    return;
+  }
+
+  if(Command == C_SET)  {
+    char Text[2 * MAX_PAYLOAD_SIZE + 1];
+
+    _Values[Key(Msg.sender, Msg.sensor, Msg.type)] = Msg.getString(Text);
+  }
+  else if(Command == C_REQ) {
+    auto Known = _Values.find(Key(Msg.sender, Msg.sensor, Msg.type));
+
+    if(Known != _Values.end())  {
+      R = Reply(Msg, C_SET, Msg.type);
+      Queue(Controller, R.set(Known->second.c_str()));
+    }
+  }
+}
+/*
+   EOF
+*/
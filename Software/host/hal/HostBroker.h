@@ -0,0 +1,90 @@
+/*
+ * HostBroker.h file
+ * MQTT broker & controller stand-in of the host builds, the IP side of a gateway sketch (MY_GATEWAY_MQTT_CLIENT).
+ * The gateway publishes messages of the nodes & its own; the controller behind the broker answers node ID,
+ * configuration, time & value requests after ControllerDelay and sends commands scripted by the harness.
+ * Messages for the gateway are delivered only while it's connected (QoS 0, no session).
+ *
+ * The broker is down during scripted outages: connections are refused and an established connection is lost.
+ * The client notices the loss DetectTime after the outage started (0 - the broker closed it); until then its
+ * publications are accepted and lost (Lost), even if the broker is back.
+ *
+ */
+
+#ifndef HostBroker_h
+#define HostBroker_h
+
+#include "Host.h"
+#include <string>
+
+class HostBroker {
+
+  public:
+    /**
+     * @brief Broker down from From until To
+     *
+     */
+    void Outage(HostTime From, HostTime To);
+
+    bool Up(HostTime Now) const;
+
+    /**
+     * @brief Start of the first outage after Since; HOST_NEVER if none
+     *
+     */
+    HostTime Down(HostTime Since) const;
+
+    /**
+     * @brief Message published by the gateway at Now over its connection of Since; lost if the broker was down meanwhile
+     *
+     */
+    void Publish(const MyMessage &Msg, HostTime Now, HostTime Since);
+
+    /**
+     * @brief Sends C_SET with a string payload to a node through the gateway at time At
+     *
+     */
+    void Command(HostTime At, uint8_t Node, uint8_t Sensor, uint8_t Type, const char *Value);
+
+    /**
+     * @brief Time of the next message for the gateway; HOST_NEVER if none
+     *
+     */
+    HostTime NextMessage() const  { return _Queue.empty() ? HOST_NEVER : _Queue.front().first; }
+
+    /**
+     * @brief Takes the next message due at Now; messages due before Since (the connection) are lost
+     *
+     * @return false if none is due
+     */
+    bool Take(HostTime Now, HostTime Since, MyMessage &Msg);
+
+    HostTime ConnectTime = 50 * HOST_MS;    // TCP connection, MQTT CONNECT & SUBSCRIBE (ENC28J60 & uIP)
+    HostTime RefuseTime = 5 * HOST_MS;      // Connection refused, broker down
+    HostTime PublishTime = 2 * HOST_MS;     // PUBLISH of one message
+    HostTime DetectTime = 0;                // Lost connection noticed by the client
+    HostTime ControllerDelay = 20 * HOST_MS;   // Broker - controller - broker round trip
+    uint8_t NextNodeId = 1;
+
+    // Statistics
+    uint32_t Published = 0;                 // Messages received by the broker
+    uint32_t Lost = 0;                      // Published into a lost connection
+    uint32_t Missed = 0;                    // Messages for the gateway while it was disconnected
+    uint32_t Connects = 0;
+    uint32_t Refused = 0;                   // Connections refused
+    std::function<void(const MyMessage &Msg, HostTime Time)> OnMessage;   // Every message received
+
+  private:
+    void Queue(HostTime At, const MyMessage &Msg);
+    MyMessage Reply(const MyMessage &Msg, uint8_t Command, uint8_t Type) const;
+    static uint32_t Key(uint8_t Node, uint8_t Sensor, uint8_t Type)  { return (uint32_t)Node << 16 | Sensor << 8 | Type; }
+
+    std::vector<std::pair<HostTime, HostTime>> _Outages;
+    std::deque<std::pair<HostTime, MyMessage>> _Queue;   // By time
+    std::map<uint32_t, std::string> _Values;
+};
+
+#endif
+/*
+   EOF
+*/
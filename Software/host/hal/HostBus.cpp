@@ -0,0 +1,145 @@
+/*
+ * HostBus.cpp file
+ * RS485 bus of the host builds, see HostBus.h
+ *
+ */
+
+#include "HostBus.h"
+
+HostBus::HostBus(uint32_t Baud, uint8_t SohCount) : _Baud(Baud), _SohCount(SohCount) {}
+
+void HostBus::Attach(HostEndpoint &E)  {
+  E.Bus = this;
+  _Endpoints.push_back(&E);
+}
+
+bool HostBus::Sense(const HostEndpoint &Self, HostTime Now)  {
+  if(!_Stepping)  Sync(Now);
+
+  // A frame is noticed once its first SOH byte has been received
+  for(const HostFrame &F : _Frames) {
+    if(F.Sender != &Self && F.Start + ByteTime() <= Now && Now < F.End)  return true;
+  }
+
+  return false;
+}
+
+HostTime HostBus::Transmit(HostEndpoint &From, uint8_t To, const MyMessage &Msg, HostTime Now)  {
+  if(!_Stepping)  Sync(Now);
+
+  HostFrame F;
+
+  F.Msg = Msg;
+  F.From = From.Address;
+  F.To = To;
+  F.Bytes = FrameBytes(Msg.getLength());
+  F.Start = Now + HOST_DE_TURNAROUND;
+  F.End = F.Start + FrameTime(Msg.getLength());
+  F.Corrupt = false;
+  F.Sender = &From;
+
+  for(HostFrame &G : _Frames) {
+    if(G.End <= F.Start || G.Start >= F.End)  continue;
+
+    if(!G.Corrupt)  {
+      G.Corrupt = true;
+      G.Sender->Collided++;
+      Collisions++;
+    }
+    if(!F.Corrupt)  {
+      F.Corrupt = true;
+      From.Collided++;
+      Collisions++;
+    }
+  }
+
+  if(F.End > _OccupiedUntil)  {
+    Occupied += F.End - (F.Start > _OccupiedUntil ? F.Start : _OccupiedUntil);
+    _OccupiedUntil = F.End;
+  }
+
+  Frames++;
+  From.Sent++;
+  _Frames.push_back(F);
+
+  return F.End;
+}
+
+void HostBus::Sync(HostTime Now)  {
+  HostTime T;
+
+  while((T = NextEvent()) <= Now) {
+    Step(T);
+  }
+}
+
+HostTime HostBus::Wait(HostEndpoint &Self, HostTime From, HostTime To)  {
+  (void)From;
+  HostTime T;
+
+  _Woken = &Self;
+  _WokenFlag = false;
+
+  while((T = NextEvent()) <= To) {
+    Step(T);
+    if(_WokenFlag)  {
+      _Woken = nullptr;
+      return T;
+    }
+  }
+
+  _Woken = nullptr;
+  Sync(To);
+
+  return To;
+}
+
+HostTime HostBus::NextEvent()  {
+  HostTime T = HOST_NEVER;
+
+  for(const HostFrame &F : _Frames) {
+    if(F.End < T) T = F.End;
+  }
+  for(HostEndpoint *E : _Endpoints) {
+    HostTime A = E->NextAction();
+    if(A < T) T = A;
+  }
+
+  return T;
+}
+
+void HostBus::Step(HostTime Time)  {
+  _Stepping = true;
+
+  // Frames ending now, then actions due now (replies may be transmitted)
+  for(size_t i=0; i<_Frames.size(); )  {
+    if(_Frames[i].End > Time)  {
+      i++;
+      continue;
+    }
+
+    HostFrame F = _Frames[i];
+    _Frames.erase(_Frames.begin() + i);
+
+    for(HostEndpoint *E : _Endpoints) {
+      if(E == F.Sender)  continue;
+      E->Deliver(F);
+      Delivered(*E, Time);
+    }
+    if(OnFrame) OnFrame(F);
+  }
+
+  for(HostEndpoint *E : _Endpoints) {
+    if(E->NextAction() <= Time) E->Act(Time);
+  }
+
+  _Stepping = false;
+}
+
+void HostBus::Delivered(HostEndpoint &E, HostTime Time)  {
+  (void)Time;
+  if(&E == _Woken)  _WokenFlag = true;
+}
+/*
+   EOF
+*/
@@ -0,0 +1,142 @@
+/*
+ * HostBus.h file
+ * RS485 bus of the host builds: half-duplex, shared by all endpoints (nodes, gateway), byte timing at the
+ * baud rate of the sketches (8N1). A frame takes SOH count + 15 + payload bytes, see Software/Readme.md.
+ *
+ * Collision avoidance of the MySensors RS485 transport: a node doesn't transmit while it's receiving a
+ * frame. It notices a frame only when the first SOH byte has been received, so two endpoints starting
+ * within one byte time (plus the DE turnaround of the second one) don't see each other: both frames are
+ * corrupted and dropped by the receivers (checksum). There are no acknowledgements on this transport.
+ *
+ */
+
+#ifndef HostBus_h
+#define HostBus_h
+
+#include <MySensors.h>
+#include <deque>
+#include <functional>
+#include <vector>
+
+typedef uint64_t HostTime;                  // us
+#define HOST_NEVER UINT64_MAX
+
+#define HOST_RS485_OVERHEAD 15              // Address, command, length, STX, ETX, checksum, EOT & MySensors header
+#define HOST_DE_TURNAROUND 10               // DE pin write & driver enable (us)
+
+class HostBus;
+class HostEndpoint;
+
+/**
+ * @brief Frame on the bus
+ *
+ */
+struct HostFrame {
+  MyMessage Msg;
+  uint8_t From;                             // Transport addresses: sender & next hop
+  uint8_t To;
+  uint8_t Bytes;
+  HostTime Start;
+  HostTime End;
+  bool Corrupt;                             // Overlapped another frame
+  HostEndpoint *Sender;
+};
+
+/**
+ * @brief Anything attached to the bus
+ *
+ */
+class HostEndpoint {
+
+  public:
+    virtual ~HostEndpoint() {}
+
+    /**
+     * @brief Frame has been received (at Frame.End); called for every frame of other endpoints, corrupted ones too
+     *
+     */
+    virtual void Deliver(const HostFrame &Frame) = 0;
+
+    /**
+     * @brief Time of the next own action of a reactive endpoint (gateway); HOST_NEVER if none
+     *
+     */
+    virtual HostTime NextAction()  { return HOST_NEVER; }
+    virtual void Act(HostTime Now)  { (void)Now; }
+
+    uint8_t Address = AUTO;
+    HostBus *Bus = nullptr;
+
+    // Statistics
+    uint32_t Sent = 0;                      // Frames transmitted
+    uint32_t Refused = 0;                   // Transmissions refused, bus busy
+    uint32_t Collided = 0;                  // Own frames corrupted by a collision
+};
+
+class HostBus {
+
+  public:
+    HostBus(uint32_t Baud = 57600, uint8_t SohCount = 3);
+    virtual ~HostBus() {}
+
+    void Attach(HostEndpoint &E);
+
+    double ByteTime() const  { return 10.0e6 / _Baud; }
+    uint8_t FrameBytes(uint8_t Length) const  { return _SohCount + HOST_RS485_OVERHEAD + Length; }
+    HostTime FrameTime(uint8_t Length) const  { return (HostTime)(FrameBytes(Length) * ByteTime() + 0.5); }
+
+    /**
+     * @brief Carrier sense: Self is receiving a frame at Now
+     *
+     */
+    virtual bool Sense(const HostEndpoint &Self, HostTime Now);
+
+    /**
+     * @brief Puts a frame on the bus after the DE turnaround
+     *
+     * @return HostTime end of the frame; the transmitter is busy until then (Serial.flush())
+     */
+    virtual HostTime Transmit(HostEndpoint &From, uint8_t To, const MyMessage &Msg, HostTime Now);
+
+    /**
+     * @brief Delivers all frames ending and runs all endpoint actions until Now
+     *
+     */
+    virtual void Sync(HostTime Now);
+
+    /**
+     * @brief Self is idle until To; returns earlier, at the end of the first frame delivered to Self
+     *
+     */
+    virtual HostTime Wait(HostEndpoint &Self, HostTime From, HostTime To);
+
+    // Statistics
+    uint32_t Frames = 0;
+    uint32_t Collisions = 0;                // Frames corrupted
+    HostTime Occupied = 0;                  // Time with at least one frame on the bus
+    std::function<void(const HostFrame &Frame)> OnFrame;     // Every frame, at its end
+
+  protected:
+    HostTime NextEvent();
+    void Step(HostTime Time);
+
+    /**
+     * @brief Frame has been delivered to E at Time (by Step()); ends a Wait() of E
+     *
+     */
+    virtual void Delivered(HostEndpoint &E, HostTime Time);
+
+    uint32_t _Baud;
+    uint8_t _SohCount;
+    std::vector<HostEndpoint *> _Endpoints;
+    std::deque<HostFrame> _Frames;          // On the wire, in order of their end
+    HostTime _OccupiedUntil = 0;
+    HostEndpoint *_Woken = nullptr;
+    bool _WokenFlag = false;
+    bool _Stepping = false;
+};
+
+#endif
+/*
+   EOF
+*/
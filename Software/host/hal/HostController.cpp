@@ -0,0 +1,154 @@
+/*
+ * HostController.cpp file
+ * Gateway & controller stand-in, see HostController.h
+ *
+ */
+
+#include "HostController.h"
+
+HostController::HostController()  {
+  Address = GATEWAY_ADDRESS;
+}
+
+void HostController::Set(uint8_t Node, uint8_t Sensor, uint8_t Type, const char *Value)  {
+  _Values[Key(Node, Sensor, Type)] = Value;
+}
+
+const char *HostController::Value(uint8_t Node, uint8_t Sensor, uint8_t Type) const  {
+  auto It = _Values.find(Key(Node, Sensor, Type));
+
+  return It != _Values.end() ? It->second.c_str() : nullptr;
+}
+
+void HostController::Command(HostTime At, uint8_t Node, uint8_t Sensor, uint8_t Type, const char *Value)  {
+  MyMessage Msg(Sensor, Type);
+
+  Msg.setSender(GATEWAY_ADDRESS).setDestination(Node).setCommand(C_SET).set(Value);
+  Queue(At, Node, Msg);
+}
+
+void HostController::Queue(HostTime At, uint8_t To, const MyMessage &Msg, HostTime Since)  {
+  auto It = _Queue.begin();
+
+  while(It != _Queue.end() && It->At <= At) It++;
+  _Queue.insert(It, Pending{At, To, Msg, Since, 0});
+}
+
+MyMessage HostController::Reply(const MyMessage &Msg, uint8_t Command, uint8_t Type) const  {
+  MyMessage R(Msg.sensor, Type);
+
+  R.setSender(GATEWAY_ADDRESS).setDestination(Msg.sender).setCommand(Command);
+  return R;
+}
+
+void HostController::Deliver(const HostFrame &Frame)  {
+  // A deferred message is tried again once the gateway has handled the frame
+  if(!_Queue.empty() && _Queue.front().Tries)  _BusyUntil = Frame.End + GatewayDelay;
+
+  if(Frame.Corrupt || (Frame.To != Address && Frame.To != BROADCAST_ADDRESS))  return;
+
+  const MyMessage &Msg = Frame.Msg;
+  HostTime Now = Frame.End;
+
+  if(OnMessage) OnMessage(Msg, Now);
+
+  // Node to node: routed by the gateway, all nodes are its children
+  if(Msg.destination != GATEWAY_ADDRESS && Msg.destination != BROADCAST_ADDRESS)  {
+    Queue(Now + GatewayDelay, Msg.destination, Msg);
+    return;
+  }
+
+  Received++;
+
+  uint8_t Command = Msg.getCommand();
+  HostTime Controller = Now + ControllerDelay;
+  MyMessage R;
+
+  if(Command == C_INTERNAL) {
+    switch(Msg.type)  {
+      case I_FIND_PARENT_REQUEST:
+        R = Reply(Msg, C_INTERNAL, I_FIND_PARENT_RESPONSE);
+        Queue(Now + GatewayDelay, Msg.sender, R.set((uint8_t)0));
+        break;
+      case I_PING:
+        R = Reply(Msg, C_INTERNAL, I_PONG);
+        Queue(Now + GatewayDelay, Msg.sender, R.set((uint8_t)1));
+        break;
+      case I_REGISTRATION_REQUEST:
+        R = Reply(Msg, C_INTERNAL, I_REGISTRATION_RESPONSE);
+        Queue(Now + GatewayDelay, Msg.sender, R.set(true));
+        break;
+      case I_ID_REQUEST:
+        if(Online)  {
+          char Id[4];
+
+          utoa(NextNodeId++, Id, 10);
+          R = Reply(Msg, C_INTERNAL, I_ID_RESPONSE);
+          Queue(Controller, Msg.sender, R.set(Id));
+        }
+        break;
+      case I_CONFIG:
+        if(Online)  {
+          R = Reply(Msg, C_INTERNAL, I_CONFIG);
+          Queue(Controller, Msg.sender, R.set("M"));
+        }
+        break;
+      case I_TIME:
+        if(Online)  {
+          R = Reply(Msg, C_INTERNAL, I_TIME);
+          Queue(Controller, Msg.sender, R.set((uint32_t)(1600000000UL + Now / HOST_S)));
+        }
+        break;
+      default:
+        break;
+    }
+    return;
+  }
+
+  if(Command == C_SET)  {
+    char Text[2 * MAX_PAYLOAD_SIZE + 1];
+
+    Set(Msg.sender, Msg.sensor, Msg.type, Msg.getString(Text));
+  }
+  else if(Command == C_REQ && Online) {
+    const char *Known = Value(Msg.sender, Msg.sensor, Msg.type);
+
+    if(Known != nullptr)  {
+      R = Reply(Msg, C_SET, Msg.type);
+      Queue(Controller, Msg.sender, R.set(Known), Now);
+    }
+  }
+}
+
+HostTime HostController::NextAction()  {
+  if(_Queue.empty())  return HOST_NEVER;
+
+  return _Queue.front().At > _BusyUntil ? _Queue.front().At : _BusyUntil;
+}
+
+void HostController::Act(HostTime Now)  {
+  if(_Queue.empty() || Now < _BusyUntil) return;
+
+  Pending &P = _Queue.front();
+
+  if(Bus->Sense(*this, Now))  {
+    if(++P.Tries < SendTries)  {
+      Deferred++;
+      _BusyUntil = HOST_NEVER;
+    }
+    else  {
+      Refused++;
+      _Queue.pop_front();
+    }
+    return;
+  }
+
+  P.Msg.last = Address;
+  _BusyUntil = Bus->Transmit(*this, P.To, P.Msg, Now);
+
+  if(P.Since) Replies.Add(_BusyUntil - P.Since);
+  _Queue.pop_front();
+}
+/*
+   EOF
+*/
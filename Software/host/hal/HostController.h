@@ -0,0 +1,81 @@
+/*
+ * HostController.h file
+ * Gateway & controller stand-in of the host builds, attached to the bus at GATEWAY_ADDRESS. The gateway
+ * answers transport requests (find parent, ping, registration) after GatewayDelay and forwards node-to-node
+ * frames; the controller answers node ID, configuration, time & value requests after ControllerDelay,
+ * stores reported values and sends commands scripted by the harness. Controller replies stop while
+ * Online is false (controller or broker unavailable), gateway replies don't.
+ *
+ * Like a node, the gateway doesn't transmit while it's receiving a frame. It holds the message in its uplink
+ * buffer and tries again GatewayDelay after the end of the frame (Deferred); after SendTries attempts the message is lost
+ * (Refused).
+ *
+ */
+
+#ifndef HostController_h
+#define HostController_h
+
+#include "Host.h"
+#include <string>
+
+class HostController : public HostEndpoint {
+
+  public:
+    HostController();
+
+    void Deliver(const HostFrame &Frame) override;
+    HostTime NextAction() override;
+    void Act(HostTime Now) override;
+
+    /**
+     * @brief Stores a value known to the controller; returned to C_REQ of the node
+     *
+     */
+    void Set(uint8_t Node, uint8_t Sensor, uint8_t Type, const char *Value);
+
+    /**
+     * @brief Last value reported by a node or set by the harness; nullptr if unknown
+     *
+     */
+    const char *Value(uint8_t Node, uint8_t Sensor, uint8_t Type) const;
+
+    /**
+     * @brief Sends C_SET with a string payload to a node at time At
+     *
+     */
+    void Command(HostTime At, uint8_t Node, uint8_t Sensor, uint8_t Type, const char *Value);
+
+    HostTime GatewayDelay = HOST_MS;        // Reply of the gateway itself
+    HostTime ControllerDelay = 20 * HOST_MS;   // Gateway - controller - gateway round trip
+    uint8_t SendTries = 20;
+    uint8_t NextNodeId = 1;                 // Next ID assigned to a node with MY_NODE_ID AUTO
+    bool Online = true;
+
+    // Statistics
+    uint32_t Received = 0;                  // Messages for the controller (not forwarded ones)
+    uint32_t Deferred = 0;                  // Transmissions postponed, bus busy
+    HostStats Replies;                      // Request (end of frame) to reply (end of frame) of C_REQ
+    std::function<void(const MyMessage &Msg, HostTime Time)> OnMessage;     // Every message received
+
+  private:
+    struct Pending {
+      HostTime At;
+      uint8_t To;
+      MyMessage Msg;
+      HostTime Since;                       // Request of a C_REQ reply, 0 otherwise
+      uint8_t Tries;
+    };
+
+    void Queue(HostTime At, uint8_t To, const MyMessage &Msg, HostTime Since = 0);
+    MyMessage Reply(const MyMessage &Msg, uint8_t Command, uint8_t Type) const;
+    static uint32_t Key(uint8_t Node, uint8_t Sensor, uint8_t Type)  { return (uint32_t)Node << 16 | Sensor << 8 | Type; }
+
+    std::deque<Pending> _Queue;             // By time
+    std::map<uint32_t, std::string> _Values;
+    HostTime _BusyUntil = 0;
+};
+
+#endif
+/*
+   EOF
+*/
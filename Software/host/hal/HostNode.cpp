@@ -0,0 +1,21 @@
+/*
+ * HostNode.cpp file
+ * Node of the bus simulator, see HostNode.h
+ *
+ */
+
+#include "HostNode.h"
+
+HostTime HostNodeRun(HostTime Until)  {
+  try {
+    Mcu.Run(Until);
+  }
+  catch(const HostWatchdogReset &Wdt)  {
+    return Wdt.Time;
+  }
+
+  return 0;
+}
+/*
+   EOF
+*/
@@ -0,0 +1,72 @@
+/*
+ * HostNode.h file
+ * Node of the bus simulator: a host build of a sketch with its stimuli, built as a module which the
+ * simulator loads once per node (a private copy of the virtual MCU & the globals of the sketch each time).
+ * The simulator reaches the node only through this table & inline members of HostMcu; the adapter of the
+ * sketch fills the table in and returns it from HostNodeEntry().
+ *
+ */
+
+#ifndef HostNode_h
+#define HostNode_h
+
+#include "Host.h"
+
+/**
+ * @brief Value set by the controller: known at boot (replied to C_REQ) or sent as a command
+ *
+ */
+struct HostCommand {
+  uint8_t Sensor;
+  uint8_t Type;
+  const char *Value;
+};
+
+struct HostNode {
+  const char *Type;                         // Sketch, e.g. "Modules"
+  HostMcu *Mcu;
+  std::map<std::string, HostStats> *Traces;
+  uint8_t ReadySensor;                      // Sensor of the READY (V_VAR1) & manifest (V_VAR2) messages
+  const HostCommand *Known;                 // Values known to the controller before the node boots
+  uint8_t KnownCount;
+  const HostCommand *Commands;              // Sent in turns by the simulator
+  uint8_t CommandCount;
+
+  /**
+   * @brief Input & sensor scripts; Start - first input change, Seed - varies periods & phases among nodes
+   *
+   */
+  void (*Stimuli)(HostTime Start, uint32_t Seed);
+
+  /**
+   * @brief Last input change until Now which the node reports to the controller; 0 if none
+   *
+   */
+  HostTime (*LastInput)(HostTime Now);
+
+  /**
+   * @brief Runs the node until Until, see HostMcu::Run()
+   *
+   * @return HostTime time of a watchdog reset, which ends the node; 0 if none
+   */
+  HostTime (*Run)(HostTime Until);
+
+  std::function<void(HostTime Time)> OnOutput;   // Output of the node changed (pin or expander); set by the simulator
+};
+
+/**
+ * @brief Runs the node of this module, see HostNode::Run
+ *
+ */
+HostTime HostNodeRun(HostTime Until);
+
+/**
+ * @brief Table of the node of this module, defined by the adapter of the sketch
+ *
+ */
+extern "C" HostNode *HostNodeEntry();
+
+#endif
+/*
+   EOF
+*/
@@ -0,0 +1,50 @@
+/*
+ * HostSketch.h file
+ * Included at the end of a sketch prepared for the host build (see prepare.py): passes the MySensors
+ * configuration of the sketch (MY_* definitions) to the HAL; a sketch without MY_RS485 or MY_GATEWAY_MQTT_CLIENT
+ * runs without MySensors
+ *
+ */
+
+#ifndef HostSketch_h
+#define HostSketch_h
+
+#ifndef MY_NODE_ID
+  #define MY_NODE_ID AUTO
+#endif
+#ifndef MY_RS485_BAUD_RATE
+  #define MY_RS485_BAUD_RATE 9600
+#endif
+#ifndef MY_RS485_SOH_COUNT
+  #define MY_RS485_SOH_COUNT 1
+#endif
+#ifndef MY_TRANSPORT_WAIT_READY_MS
+  #define MY_TRANSPORT_WAIT_READY_MS 0
+#endif
+
+extern const HostSketchConfig HostSketch = {
+  MY_NODE_ID,
+  MY_RS485_BAUD_RATE,
+  MY_RS485_SOH_COUNT,
+  MY_TRANSPORT_WAIT_READY_MS,
+#ifdef MY_OTA_FIRMWARE_FEATURE
+  true,
+#else
+  false,
+#endif
+#ifdef MY_GATEWAY_MQTT_CLIENT
+  true,
+#else
+  false,
+#endif
+#if defined(MY_RS485) || defined(MY_GATEWAY_MQTT_CLIENT)
+  true,
+#else
+  false,
+#endif
+};
+
+#endif
+/*
+   EOF
+*/
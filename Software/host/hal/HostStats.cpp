@@ -0,0 +1,62 @@
+/*
+ * HostStats.cpp file
+ * Durations of traced sections & latencies, see Host.h
+ *
+ */
+
+#include "Host.h"
+#include <algorithm>
+
+void HostStats::Add(HostTime Value)  {
+  _Values.push_back(Value);
+  _Sorted = false;
+  _Total += Value;
+  if(Value > _Max)  _Max = Value;
+}
+
+HostTime HostStats::Percentile(double P) const  {
+  if(_Values.empty()) return 0;
+
+  if(!_Sorted)  {
+    std::sort(_Values.begin(), _Values.end());
+    _Sorted = true;
+  }
+
+  size_t i = (size_t)(P / 100.0 * _Values.size() + 0.999999);
+
+  return _Values[i > 0 ? (i <= _Values.size() ? i - 1 : _Values.size() - 1) : 0];
+}
+
+void HostStats::PrintHeader()  {
+  printf("%-24s %8s %10s %10s %10s %10s %10s\n", "", "count", "mean us", "p50 us", "p99 us", "max us", "total ms");
+}
+
+void HostStats::Print(const char *Name, bool Histogram) const  {
+  printf("%-24s %8u %10.1f %10llu %10llu %10llu %10.1f\n", Name, Count(), Mean(), (unsigned long long)Percentile(50),
+         (unsigned long long)Percentile(99), (unsigned long long)_Max, _Total / 1000.0);
+
+  if(!Histogram || _Values.empty()) return;
+
+  // log2 buckets: < 1 us, < 2 us, < 4 us, ...
+  uint32_t Buckets[64] = {0};
+  uint8_t Last = 0;
+
+  for(HostTime V : _Values) {
+    uint8_t b = 0;
+    while(b < 63 && V >= (1ULL << b))  b++;
+    Buckets[b]++;
+    if(b > Last)  Last = b;
+  }
+
+  uint32_t Peak = *std::max_element(Buckets, Buckets + 64);
+
+  for(uint8_t b=0; b<=Last; b++) {
+    if(Buckets[b] == 0) continue;
+    printf("    < %8llu us %8u  ", 1ULL << b, Buckets[b]);
+    for(uint32_t i=0; i<(Buckets[b] * 40 + Peak - 1) / Peak; i++) putchar('#');
+    putchar('\n');
+  }
+}
+/*
+   EOF
+*/
@@ -0,0 +1,58 @@
+/*
+ * MyGatewayTransport.cpp file
+ * MQTT gateway transport of the MySensors 2.3 core (MyGatewayTransportMQTTClient) for host builds: PubSubClient
+ * on the ENC28J60, connected to the broker stand-in of the harness (HostBroker.h). Connecting, publishing &
+ * the retry delay after a refused connection block the MCU, frames keep arriving in the RX buffer meanwhile.
+ * The rest of the gateway (routing, reconnection) is in MySensors.cpp.
+ *
+ */
+
+#include "Host.h"
+#include "HostBroker.h"
+
+HostMqttClient _MQTT_client;
+
+bool HostMqttClient::connected()  {
+  if(!_Connected || Broker == nullptr) return false;
+
+  HostTime Down = Broker->Down(_Since);
+
+  if(Down != HOST_NEVER && Mcu.Now() >= Down + Broker->DetectTime)  _Connected = false;
+
+  return _Connected;
+}
+
+bool HostMqttClient::connect()  {
+  if(Broker == nullptr) return false;
+
+  bool Up = Broker->Up(Mcu.Now());
+
+  Mcu.Idle(Mcu.Now() + (Up ? Broker->ConnectTime : Broker->RefuseTime), false, false);
+
+  if(Up)  Broker->Connects++;
+  else  Broker->Refused++;
+
+  _Connected = Up;
+  _Since = Mcu.Now();
+
+  return Up;
+}
+
+bool HostMqttClient::publish(const MyMessage &Msg)  {
+  Mcu.Idle(Mcu.Now() + Broker->PublishTime, false, false);
+  Broker->Publish(Msg, Mcu.Now(), _Since);
+
+  // Written to the TCP connection; lost without notice if the broker is gone
+  return true;
+}
+
+bool gatewayTransportSend(MyMessage &message)  {
+  if(!_MQTT_client.connected()) return false;
+
+  indication(INDICATION_GW_TX);
+
+  return _MQTT_client.publish(message);
+}
+/*
+   EOF
+*/
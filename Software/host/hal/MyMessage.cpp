@@ -0,0 +1,184 @@
+/*
+ * MyMessage.cpp file
+ * MySensors 2.3 message of the host builds: header, payload types & conversions, see MySensors.h
+ *
+ */
+
+#include "MySensors.h"
+
+MyMessage::MyMessage() : MyMessage(0, 0) {}
+
+MyMessage::MyMessage(uint8_t Sensor, uint8_t Type)  {
+  last = 0;
+  sender = 0;
+  destination = GATEWAY_ADDRESS;
+  version_length = PROTOCOL_VERSION;
+  command_echo_payload = 0;
+  type = Type;
+  sensor = Sensor;
+  memset(data, 0, sizeof(data));
+}
+
+MyMessage &MyMessage::SetPayload(uint8_t PayloadType, uint8_t Length)  {
+  command_echo_payload = (command_echo_payload & 0x1F) | (PayloadType << 5);
+  version_length = (version_length & 0x07) | (Length << 3);
+  return *this;
+}
+
+MyMessage &MyMessage::set(const void *Value, uint8_t Length)  {
+  Length = Length > MAX_PAYLOAD_SIZE ? MAX_PAYLOAD_SIZE : Length;
+  memcpy(data, Value, Length);
+  return SetPayload(P_CUSTOM, Length);
+}
+
+MyMessage &MyMessage::set(const char *Value)  {
+  uint8_t Length = Value != nullptr ? strnlen(Value, MAX_PAYLOAD_SIZE) : 0;
+
+  memcpy(data, Value, Length);
+  data[Length] = 0;
+  return SetPayload(P_STRING, Length);
+}
+
+MyMessage &MyMessage::set(const __FlashStringHelper *Value)  {
+  return set(reinterpret_cast<const char *>(Value));
+}
+
+MyMessage &MyMessage::set(float Value, uint8_t Decimals)  {
+  memcpy(data, &Value, sizeof(Value));
+  data[4] = Decimals;
+  return SetPayload(P_FLOAT32, 5);
+}
+
+MyMessage &MyMessage::set(bool Value)  {
+  data[0] = Value;
+  return SetPayload(P_BYTE, 1);
+}
+
+MyMessage &MyMessage::set(uint8_t Value)  {
+  data[0] = Value;
+  return SetPayload(P_BYTE, 1);
+}
+
+MyMessage &MyMessage::set(int16_t Value)  {
+  memcpy(data, &Value, sizeof(Value));
+  return SetPayload(P_INT16, 2);
+}
+
+MyMessage &MyMessage::set(uint16_t Value)  {
+  memcpy(data, &Value, sizeof(Value));
+  return SetPayload(P_UINT16, 2);
+}
+
+MyMessage &MyMessage::set(int32_t Value)  {
+  memcpy(data, &Value, sizeof(Value));
+  return SetPayload(P_LONG32, 4);
+}
+
+MyMessage &MyMessage::set(uint32_t Value)  {
+  memcpy(data, &Value, sizeof(Value));
+  return SetPayload(P_ULONG32, 4);
+}
+
+const char *MyMessage::getString() const  {
+  return getPayloadType() == P_STRING ? data : nullptr;
+}
+
+char *MyMessage::getString(char *Buffer) const  {
+  switch(getPayloadType())  {
+    case P_STRING:
+      strcpy(Buffer, data);
+      break;
+    case P_BYTE:
+      utoa(getByte(), Buffer, 10);
+      break;
+    case P_INT16:
+      itoa(getInt(), Buffer, 10);
+      break;
+    case P_UINT16:
+      utoa(getUInt(), Buffer, 10);
+      break;
+    case P_LONG32:
+      ltoa(getLong(), Buffer, 10);
+      break;
+    case P_ULONG32:
+      ultoa(getULong(), Buffer, 10);
+      break;
+    case P_FLOAT32:
+      dtostrf(getFloat(), 2, data[4], Buffer);
+      break;
+    default:
+      for(uint8_t i=0; i<getLength(); i++) sprintf(Buffer + 2 * i, "%02X", (uint8_t)data[i]);
+      Buffer[2 * getLength()] = 0;
+      break;
+  }
+
+  return Buffer;
+}
+
+bool MyMessage::getBool() const  {
+  return getByte();
+}
+
+uint8_t MyMessage::getByte() const  {
+  if(getPayloadType() == P_BYTE)  return data[0];
+  if(getPayloadType() == P_STRING)  return atoi(data);
+  return 0;
+}
+
+int16_t MyMessage::getInt() const  {
+  int16_t Value;
+
+  if(getPayloadType() == P_INT16) {
+    memcpy(&Value, data, sizeof(Value));
+    return Value;
+  }
+  if(getPayloadType() == P_STRING)  return atoi(data);
+  return 0;
+}
+
+uint16_t MyMessage::getUInt() const  {
+  uint16_t Value;
+
+  if(getPayloadType() == P_UINT16)  {
+    memcpy(&Value, data, sizeof(Value));
+    return Value;
+  }
+  if(getPayloadType() == P_STRING)  return atoi(data);
+  return 0;
+}
+
+int32_t MyMessage::getLong() const  {
+  int32_t Value;
+
+  if(getPayloadType() == P_LONG32)  {
+    memcpy(&Value, data, sizeof(Value));
+    return Value;
+  }
+  if(getPayloadType() == P_STRING)  return atol(data);
+  return 0;
+}
+
+uint32_t MyMessage::getULong() const  {
+  uint32_t Value;
+
+  if(getPayloadType() == P_ULONG32) {
+    memcpy(&Value, data, sizeof(Value));
+    return Value;
+  }
+  if(getPayloadType() == P_STRING)  return strtoul(data, nullptr, 10);
+  return 0;
+}
+
+float MyMessage::getFloat() const  {
+  float Value;
+
+  if(getPayloadType() == P_FLOAT32) {
+    memcpy(&Value, data, sizeof(Value));
+    return Value;
+  }
+  if(getPayloadType() == P_STRING)  return atof(data);
+  return 0;
+}
+/*
+   EOF
+*/
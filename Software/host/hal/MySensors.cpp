@@ -0,0 +1,592 @@
+/*
+ * MySensors.cpp file
+ * MySensors 2.3 node core of the host builds: messages, RS485 transport, startup sequence & _process().
+ * Modelled after the library: the transport state machine (find parent, node ID, uplink check), node
+ * presentation with the configuration exchange, registration, routing of all frames via the parent and
+ * up to MAX_SUBSEQ_MSGS messages handled per _process(). Signing & OTA transfers aren't modelled.
+ *
+ * A gateway sketch (HostSketch.Gateway) is ready at once. It answers the transport requests of the nodes,
+ * hands frames for the controller to the MQTT transport before receive() and routes frames of the controller
+ * & node to node frames to their destination; all nodes are its children. While the broker isn't connected,
+ * every _process() tries to reconnect, a refused connection is followed by delay(1000) like in reconnectMQTT().
+ *
+ */
+
+#include "Host.h"
+#include "HostBroker.h"
+#include <avr/eeprom.h>
+
+#define MYSENSORS_LIBRARY_VERSION "2.3.2"
+#define MY_CORE_VERSION 2
+#define MY_TRANSPORT_STATE_TIMEOUT_MS 2000UL
+#define MY_TRANSPORT_MAX_TX_FAILURES 5
+#define MY_REGISTRATION_RETRIES 3
+#define MAX_SUBSEQ_MSGS 5
+#define ST_FIRMWARE_CONFIG_REQUEST 0
+#define SIGNING_PRESENTATION_VERSION_1 1
+#define MSG_GW_STARTUP_COMPLETE "Gateway startup complete."
+#define MY_MQTT_RETRY_MS 1000               // reconnectMQTT(): delay after a refused connection
+
+// EEPROM layout of the library
+#define EEPROM_NODE_ID_ADDRESS 0
+#define EEPROM_PARENT_NODE_ID_ADDRESS 1
+#define EEPROM_LOCAL_CONFIG_ADDRESS 413
+
+enum TransportState : uint8_t {TRANSPORT_PARENT, TRANSPORT_ID, TRANSPORT_UPLINK, TRANSPORT_READY};
+
+static struct {
+  uint8_t NodeId = AUTO;
+  uint8_t Parent = AUTO;
+  TransportState State = TRANSPORT_PARENT;
+  bool Requested = false;                   // Request of the current state sent at StateTime
+  HostTime StateTime = 0;
+  uint8_t TxFailures = 0;
+  bool Waiting = false;                     // wait(ms, command, type)
+  uint8_t WaitCommand;
+  uint8_t WaitType;
+  bool Matched;
+  uint8_t WaitDepth = 0;                    // wait() called from receive() inside wait()
+} Core;
+
+MyMessage _msg;
+
+/***** Sketch callbacks *****/
+__attribute__((weak)) void before()  {}
+__attribute__((weak)) void presentation()  {}
+__attribute__((weak)) void receive(const MyMessage &message)  { (void)message; }
+__attribute__((weak)) void receiveTime(uint32_t Time)  { (void)Time; }
+__attribute__((weak)) void indication(const indication_t Indication)  { (void)Indication; }
+
+/***** Transport *****/
+void HostPort::Deliver(const HostFrame &Frame)  {
+  bool ForUs = !Frame.Corrupt && (Frame.To == Address || Frame.To == BROADCAST_ADDRESS);
+
+  Mcu.Receive(Frame.Msg, Frame.Bytes, ForUs, Frame.End);
+}
+
+bool HostPort::Send(uint8_t To, const MyMessage &Msg)  {
+  if(Bus == nullptr)  return true;
+
+  // Not while a frame is being received: wait rand() % 20 ms & check again
+  for(uint8_t Tries = HOST_TX_TRIES; Bus->Sense(*this, Mcu.Now()); ) {
+    Backoffs++;
+    Mcu.Idle(Mcu.Now() + Mcu.Random() % HOST_TX_BACKOFF_MS * HOST_MS, false, false);
+
+    if(--Tries == 0)  {
+      Refused++;
+      if(OnSend)  OnSend(Msg, false);
+      return false;
+    }
+  }
+
+  // DE on, frame, Serial.flush(), DE off
+  HostTime End = Bus->Transmit(*this, To, Msg, Mcu.Now());
+
+  if(OnSend)  OnSend(Msg, true);
+
+  Mcu.Idle(End, false, false);
+  Mcu.Cpu(HOST_DIGITAL_US);
+
+  return true;
+}
+
+static MyMessage &Build(MyMessage &Msg, uint8_t Destination, uint8_t Sensor, uint8_t Command, uint8_t Type, bool Echo = false)  {
+  Msg.sender = Core.NodeId;
+  Msg.destination = Destination;
+  Msg.sensor = Sensor;
+  Msg.type = Type;
+  Msg.setCommand(Command);
+  Msg.setRequestEcho(Echo);
+  Msg.setEcho(false);
+  return Msg;
+}
+
+/**
+ * @brief Sends a message to its next hop: broadcasts directly, everything else via the parent
+ *
+ * @param Transport message of the transport state machine, sent before the transport is ready
+ */
+static bool SendRoute(MyMessage &Msg, bool Transport = false)  {
+  if(Core.State != TRANSPORT_READY && !Transport) return false;
+
+  Msg.last = Core.NodeId;
+  Msg.version_length = (Msg.version_length & 0xF8) | PROTOCOL_VERSION;
+
+  if(HostSketch.Gateway)  {
+    // To the controller or straight to the node
+    if(Msg.destination == GATEWAY_ADDRESS)  return gatewayTransportSend(Msg);
+
+    bool Sent = Mcu.Port.Send(Msg.destination, Msg);
+
+    indication(Sent ? INDICATION_TX : INDICATION_ERR_TX);
+    return Sent;
+  }
+
+  uint8_t To = Msg.destination == BROADCAST_ADDRESS ? BROADCAST_ADDRESS : (Core.Parent != AUTO ? Core.Parent : GATEWAY_ADDRESS);
+  bool Sent = Mcu.Port.Send(To, Msg);
+
+  indication(Sent ? INDICATION_TX : INDICATION_ERR_TX);
+
+  if(To == BROADCAST_ADDRESS || Transport)  return Sent;
+
+  if(Sent)  {
+    Core.TxFailures = 0;
+  }
+  else if(++Core.TxFailures >= MY_TRANSPORT_MAX_TX_FAILURES && Core.State == TRANSPORT_READY) {
+    // Uplink lost: find parent again
+    indication(INDICATION_ERR_TRANSPORT_FAILURE);
+    Core.State = TRANSPORT_PARENT;
+    Core.Requested = false;
+    Core.TxFailures = 0;
+  }
+
+  return Sent;
+}
+
+static void SetState(TransportState State)  {
+  Core.State = State;
+  Core.Requested = false;
+}
+
+/**
+ * @brief Transport state machine; requests of the current state are repeated after MY_TRANSPORT_STATE_TIMEOUT_MS
+ *
+ */
+static void TransportUpdate()  {
+  if(Core.State == TRANSPORT_READY) return;
+  if(Core.Requested && Mcu.Now() - Core.StateTime < MY_TRANSPORT_STATE_TIMEOUT_MS * HOST_MS) return;
+
+  MyMessage Msg;
+
+  Core.Requested = true;
+  Core.StateTime = Mcu.Now();
+
+  switch(Core.State)  {
+    case TRANSPORT_PARENT:
+      indication(INDICATION_FIND_PARENT);
+      SendRoute(Build(Msg, BROADCAST_ADDRESS, NODE_SENSOR_ID, C_INTERNAL, I_FIND_PARENT_REQUEST).set(""), true);
+      break;
+    case TRANSPORT_ID:
+      indication(INDICATION_REQ_NODEID);
+      SendRoute(Build(Msg, GATEWAY_ADDRESS, NODE_SENSOR_ID, C_INTERNAL, I_ID_REQUEST).set(""), true);
+      break;
+    case TRANSPORT_UPLINK:
+      indication(INDICATION_CHECK_UPLINK);
+      SendRoute(Build(Msg, GATEWAY_ADDRESS, NODE_SENSOR_ID, C_INTERNAL, I_PING).set((uint8_t)1), true);
+      break;
+    default:
+      break;
+  }
+}
+
+/**
+ * @brief Handles transport & core internal messages
+ *
+ * @return true if the message was consumed
+ */
+static bool InternalMessage(const MyMessage &Msg)  {
+  MyMessage Reply;
+
+  switch(Msg.type)  {
+    case I_FIND_PARENT_RESPONSE:
+      if(Core.State == TRANSPORT_PARENT)  {
+        Core.Parent = Msg.sender;
+        eeprom_update_byte((uint8_t *)EEPROM_PARENT_NODE_ID_ADDRESS, Core.Parent);
+        indication(INDICATION_GOT_PARENT);
+        SetState(Core.NodeId == AUTO ? TRANSPORT_ID : TRANSPORT_UPLINK);
+      }
+      return true;
+    case I_ID_RESPONSE:
+      if(Core.State == TRANSPORT_ID)  {
+        Core.NodeId = atoi(Msg.data);
+        Mcu.Port.Address = Core.NodeId;
+        eeprom_update_byte((uint8_t *)EEPROM_NODE_ID_ADDRESS, Core.NodeId);
+        indication(INDICATION_GOT_NODEID);
+        SetState(TRANSPORT_UPLINK);
+      }
+      return true;
+    case I_PONG:
+      if(Core.State == TRANSPORT_UPLINK)  SetState(TRANSPORT_READY);
+      return false;
+    case I_PING:
+      SendRoute(Build(Reply, Msg.sender, NODE_SENSOR_ID, C_INTERNAL, I_PONG).set((uint8_t)1));
+      return true;
+    case I_FIND_PARENT_REQUEST:
+    case I_ID_REQUEST:
+      // Not a repeater
+      return true;
+    case I_HEARTBEAT_REQUEST:
+      sendHeartbeat();
+      return true;
+    case I_PRESENTATION:
+      presentation();
+      return true;
+    case I_TIME:
+      receiveTime(Msg.getULong());
+      return true;
+    case I_REBOOT:
+      return true;
+    default:
+      return false;
+  }
+}
+
+static void Dispatch(const MyMessage &Msg)  {
+  uint8_t Command = Msg.getCommand();
+
+  indication(INDICATION_RX);
+
+  if(Core.Waiting && Command == Core.WaitCommand && Msg.type == Core.WaitType)  {
+    Core.Matched = true;
+  }
+
+  if(Msg.getRequestEcho() && !Msg.isEcho())  {
+    MyMessage Echo = Msg;
+
+    Echo.destination = Msg.sender;
+    Echo.sender = Core.NodeId;
+    Echo.setRequestEcho(false);
+    Echo.setEcho(true);
+    SendRoute(Echo);
+  }
+
+  if(Command == C_INTERNAL && InternalMessage(Msg)) return;
+  if(Command == C_STREAM) return;
+
+  HostTrace Trace("receive");
+  receive(Msg);
+}
+
+/***** Gateway *****/
+static void PresentGateway()  {
+  indication(INDICATION_PRESENT);
+  present(NODE_SENSOR_ID, S_ARDUINO_NODE);
+  presentation();
+}
+
+/**
+ * @brief Frame of a node: transport requests are answered, the rest goes to the controller & receive() or is routed
+ *
+ */
+static void GatewayDispatch(const MyMessage &Msg)  {
+  MyMessage Reply;
+
+  _msg = Msg;
+  indication(INDICATION_RX);
+
+  if(_msg.destination != GATEWAY_ADDRESS && _msg.destination != BROADCAST_ADDRESS)  {
+    SendRoute(_msg);
+    return;
+  }
+
+  if(_msg.getCommand() == C_INTERNAL) {
+    switch(_msg.type) {
+      case I_FIND_PARENT_REQUEST:
+        SendRoute(Build(Reply, _msg.sender, NODE_SENSOR_ID, C_INTERNAL, I_FIND_PARENT_RESPONSE).set((uint8_t)0));
+        return;
+      case I_PING:
+        SendRoute(Build(Reply, _msg.sender, NODE_SENSOR_ID, C_INTERNAL, I_PONG).set((uint8_t)1));
+        return;
+      case I_REGISTRATION_REQUEST:
+        SendRoute(Build(Reply, _msg.sender, NODE_SENSOR_ID, C_INTERNAL, I_REGISTRATION_RESPONSE).set(true));
+        return;
+      default:
+        break;
+    }
+  }
+
+  if(_msg.destination == BROADCAST_ADDRESS) return;
+
+  gatewayTransportSend(_msg);
+
+  HostTrace Trace("receive");
+  receive(_msg);
+}
+
+/**
+ * @brief gatewayTransportProcess(): reconnects to the broker or handles one message of the controller
+ *
+ */
+static void GatewayProcess()  {
+  if(!_MQTT_client.connected()) {
+    if(_MQTT_client.connect())  {
+      PresentGateway();
+    }
+    else  {
+      delay(MY_MQTT_RETRY_MS);
+    }
+    return;
+  }
+
+  if(!_MQTT_client.Broker->Take(Mcu.Now(), _MQTT_client.Since(), _msg)) return;
+
+  indication(INDICATION_GW_RX);
+
+  if(_msg.destination != GATEWAY_ADDRESS) {
+    SendRoute(_msg);
+    return;
+  }
+
+  if(Core.Waiting && _msg.getCommand() == Core.WaitCommand && _msg.type == Core.WaitType) {
+    Core.Matched = true;
+  }
+
+  if(_msg.getCommand() == C_INTERNAL) {
+    if(_msg.type == I_TIME) receiveTime(_msg.getULong());
+    else if(_msg.type == I_PRESENTATION)  PresentGateway();
+    return;
+  }
+
+  HostTrace Trace("receive");
+  receive(_msg);
+}
+
+/**
+ * @brief End of an idle wait until To: a gateway wakes up for the next message of the controller, and keeps
+ * trying to reconnect while the broker isn't connected
+ *
+ */
+static HostTime Wake(HostTime To)  {
+  if(!HostSketch.Gateway) return To;
+  if(!_MQTT_client.connected()) return Mcu.Now();
+
+  HostTime Next = _MQTT_client.Broker->NextMessage();
+
+  return Next < To ? (Next > Mcu.Now() ? Next : Mcu.Now()) : To;
+}
+
+/***** _process() *****/
+void HostProcess()  {
+  // Plain sketch: Arduino main() calls loop() & serialEventRun()
+  if(!HostSketch.Transport) {
+    Mcu.Cpu(HOST_LOOP_US);
+    return;
+  }
+
+  // doYield()
+  Mcu.WatchdogReset();
+  yield();
+
+  Mcu.Cpu(HOST_PROCESS_US);
+  if(Mcu.Port.Bus != nullptr) Mcu.Port.Bus->Sync(Mcu.Now());
+
+  if(HostSketch.Gateway)  GatewayProcess();
+  else  TransportUpdate();
+
+  uint8_t Processed = 0;
+
+  while(!Mcu.Rx.empty() && Processed < MAX_SUBSEQ_MSGS) {
+    HostRxFrame F = Mcu.Rx.front();
+
+    Mcu.Rx.pop_front();
+    Mcu.RxBytes -= F.Bytes;
+    Mcu.Cpu(HOST_PARSE_US * F.Bytes);
+
+    if(!F.ForUs)  continue;
+
+    Processed++;
+    if(HostSketch.Gateway)  GatewayDispatch(F.Msg);
+    else  Dispatch(F.Msg);
+  }
+}
+
+/***** Startup *****/
+static void PresentNode()  {
+  MyMessage Msg;
+
+  indication(INDICATION_PRESENT);
+
+  if(HostSketch.Ota)  {
+    // Firmware type, version, blocks, CRC & bootloader version from EEPROM
+    uint8_t Config[10];
+
+    memset(Config, 0xFF, sizeof(Config));
+    SendRoute(Build(Msg, GATEWAY_ADDRESS, NODE_SENSOR_ID, C_STREAM, ST_FIRMWARE_CONFIG_REQUEST).set(Config, sizeof(Config)));
+  }
+
+  uint8_t Signing[2] = {SIGNING_PRESENTATION_VERSION_1, 0};
+
+  SendRoute(Build(Msg, GATEWAY_ADDRESS, NODE_SENSOR_ID, C_INTERNAL, I_SIGNING_PRESENTATION).set(Signing, sizeof(Signing)));
+  present(NODE_SENSOR_ID, S_ARDUINO_NODE);
+
+  // Configuration exchange: node sends its parent, controller answers with its configuration
+  SendRoute(Build(Msg, GATEWAY_ADDRESS, NODE_SENSOR_ID, C_INTERNAL, I_CONFIG).set(Core.Parent));
+  wait(2000, C_INTERNAL, I_CONFIG);
+
+  presentation();
+}
+
+static void RegisterNode()  {
+  MyMessage Msg;
+  uint8_t Retries = MY_REGISTRATION_RETRIES;
+
+  do  {
+    SendRoute(Build(Msg, GATEWAY_ADDRESS, NODE_SENSOR_ID, C_INTERNAL, I_REGISTRATION_REQUEST).set((uint8_t)MY_CORE_VERSION));
+  } while(!wait(2000, C_INTERNAL, I_REGISTRATION_RESPONSE) && Retries--);
+}
+
+void HostBegin()  {
+  if(!HostSketch.Transport) {
+    setup();
+    return;
+  }
+
+  before();
+
+  if(HostSketch.Gateway)  {
+    MyMessage Msg;
+
+    // Lost while the broker isn't connected yet; presented again on connection
+    Core.NodeId = GATEWAY_ADDRESS;
+    Mcu.Port.Address = GATEWAY_ADDRESS;
+    SetState(TRANSPORT_READY);
+    PresentGateway();
+    SendRoute(Build(Msg, GATEWAY_ADDRESS, NODE_SENSOR_ID, C_INTERNAL, I_GATEWAY_READY).set(MSG_GW_STARTUP_COMPLETE));
+    setup();
+    return;
+  }
+
+  // Static ID, ID stored in EEPROM or assigned by the controller
+  Core.NodeId = HostSketch.NodeId != AUTO ? HostSketch.NodeId : eeprom_read_byte((const uint8_t *)EEPROM_NODE_ID_ADDRESS);
+  if(HostSketch.NodeId != AUTO) eeprom_update_byte((uint8_t *)EEPROM_NODE_ID_ADDRESS, Core.NodeId);
+  Mcu.Port.Address = Core.NodeId;
+  SetState(TRANSPORT_PARENT);
+
+  // Wait for the transport (0 - forever), _process() meanwhile
+  HostTime Timeout = HostSketch.TransportWaitReady ? Mcu.Now() + HostSketch.TransportWaitReady * HOST_MS : HOST_NEVER;
+
+  while(Core.State != TRANSPORT_READY && Mcu.Now() < Timeout)  {
+    HostProcess();
+    if(Core.State == TRANSPORT_READY) break;
+    // The state changed, its request goes out right away
+    if(!Core.Requested) continue;
+
+    HostTime Retry = Core.StateTime + MY_TRANSPORT_STATE_TIMEOUT_MS * HOST_MS;
+    Mcu.Idle(Retry < Timeout ? Retry : Timeout, true, true);
+  }
+
+  if(Core.State == TRANSPORT_READY) {
+    PresentNode();
+    RegisterNode();
+  }
+
+  setup();
+}
+
+/***** API *****/
+bool send(MyMessage &Msg, const bool Echo)  {
+  Msg.sender = Core.NodeId;
+  Msg.setCommand(C_SET);
+  Msg.setRequestEcho(Echo);
+  Msg.setEcho(false);
+
+  return SendRoute(Msg);
+}
+
+bool present(const uint8_t Sensor, const uint8_t SensorType, const char *Description, const bool Echo)  {
+  MyMessage Msg;
+
+  return SendRoute(Build(Msg, GATEWAY_ADDRESS, Sensor, C_PRESENTATION, SensorType, Echo).set(Sensor == NODE_SENSOR_ID ? MYSENSORS_LIBRARY_VERSION : Description));
+}
+
+bool present(const uint8_t Sensor, const uint8_t SensorType, const __FlashStringHelper *Description, const bool Echo)  {
+  return present(Sensor, SensorType, reinterpret_cast<const char *>(Description), Echo);
+}
+
+bool sendSketchInfo(const char *Name, const char *Version, const bool Echo)  {
+  MyMessage Msg;
+  bool Result = true;
+
+  if(Name != nullptr) Result &= SendRoute(Build(Msg, GATEWAY_ADDRESS, NODE_SENSOR_ID, C_INTERNAL, I_SKETCH_NAME, Echo).set(Name));
+  if(Version != nullptr)  Result &= SendRoute(Build(Msg, GATEWAY_ADDRESS, NODE_SENSOR_ID, C_INTERNAL, I_SKETCH_VERSION, Echo).set(Version));
+
+  return Result;
+}
+
+bool sendSketchInfo(const __FlashStringHelper *Name, const __FlashStringHelper *Version, const bool Echo)  {
+  return sendSketchInfo(reinterpret_cast<const char *>(Name), reinterpret_cast<const char *>(Version), Echo);
+}
+
+bool request(const uint8_t Sensor, const uint8_t Type, const uint8_t Destination)  {
+  MyMessage Msg;
+
+  return SendRoute(Build(Msg, Destination, Sensor, C_REQ, Type).set(""));
+}
+
+bool requestTime(const bool Echo)  {
+  MyMessage Msg;
+
+  return SendRoute(Build(Msg, GATEWAY_ADDRESS, NODE_SENSOR_ID, C_INTERNAL, I_TIME, Echo).set(""));
+}
+
+bool sendHeartbeat(const bool Echo)  {
+  MyMessage Msg;
+
+  return SendRoute(Build(Msg, GATEWAY_ADDRESS, NODE_SENSOR_ID, C_INTERNAL, I_HEARTBEAT_RESPONSE, Echo).set(millis()));
+}
+
+bool sendBatteryLevel(const uint8_t Level, const bool Echo)  {
+  MyMessage Msg;
+
+  return SendRoute(Build(Msg, GATEWAY_ADDRESS, NODE_SENSOR_ID, C_INTERNAL, I_BATTERY_LEVEL, Echo).set(Level));
+}
+
+void wait(const uint32_t Ms)  {
+  // while(hwMillis() - enter < Ms) _process();
+  HostTime To = (Mcu.Now() / HOST_MS + Ms) * HOST_MS;
+
+  if(Core.WaitDepth++ == 0) Mcu.LastWait = Mcu.Now();
+
+  while(Mcu.Now() < To) {
+    HostProcess();
+    if(Mcu.Rx.empty())  Mcu.Idle(Wake(To), true, true);
+  }
+
+  Core.WaitDepth--;
+}
+
+bool wait(const uint32_t Ms, const uint8_t Command, const uint8_t Type)  {
+  HostTime To = (Mcu.Now() / HOST_MS + Ms) * HOST_MS;
+  bool Waiting = Core.Waiting;
+  uint8_t WaitCommand = Core.WaitCommand;
+  uint8_t WaitType = Core.WaitType;
+
+  if(Core.WaitDepth++ == 0) Mcu.LastWait = Mcu.Now();
+  Core.Waiting = true;
+  Core.WaitCommand = Command;
+  Core.WaitType = Type;
+  Core.Matched = false;
+
+  while(Mcu.Now() < To && !Core.Matched)  {
+    HostProcess();
+    if(!Core.Matched && Mcu.Rx.empty()) Mcu.Idle(Wake(To), true, true);
+  }
+
+  bool Matched = Core.Matched;
+
+  Core.Waiting = Waiting;
+  Core.WaitCommand = WaitCommand;
+  Core.WaitType = WaitType;
+  Core.WaitDepth--;
+
+  return Matched;
+}
+
+uint8_t getNodeId()  {
+  return Core.NodeId;
+}
+
+bool isTransportReady()  {
+  return Core.State == TRANSPORT_READY;
+}
+
+void saveState(const uint8_t Position, const uint8_t Value)  {
+  eeprom_update_byte((uint8_t *)(uintptr_t)(EEPROM_LOCAL_CONFIG_ADDRESS + Position), Value);
+}
+
+uint8_t loadState(const uint8_t Position)  {
+  return eeprom_read_byte((const uint8_t *)(uintptr_t)(EEPROM_LOCAL_CONFIG_ADDRESS + Position));
+}
+/*
+   EOF
+*/
@@ -0,0 +1,206 @@
+/*
+ * MySensors.h file
+ * MySensors node API for host builds: MyMessage with the 2.3 wire format (7 byte header, up to 25 bytes
+ * of payload) and the functions used by the sketches. Frames go through the RS485 transport of the
+ * virtual node (Host.h); MySensors' own startup traffic (find parent, signing & node presentation,
+ * registration) is sent as well, so boot time and bus load match a real node. A sketch defining
+ * MY_GATEWAY_MQTT_CLIENT runs as the gateway (address 0) with the MQTT transport of the library, see
+ * MyGatewayTransport.cpp.
+ *
+ */
+
+#ifndef MySensors_h
+#define MySensors_h
+
+#include <Arduino.h>
+// Included by the AVR hardware layer of the library
+#include <avr/eeprom.h>
+#include <avr/pgmspace.h>
+#include <avr/wdt.h>
+#include <util/atomic.h>
+
+#define GATEWAY_ADDRESS ((uint8_t)0)
+#define BROADCAST_ADDRESS ((uint8_t)255)
+#define NODE_SENSOR_ID ((uint8_t)255)
+#define AUTO ((uint8_t)255)
+
+#define MAX_MESSAGE_SIZE 32
+#define HEADER_SIZE 7
+#define MAX_PAYLOAD_SIZE (MAX_MESSAGE_SIZE - HEADER_SIZE)
+#define MAX_PAYLOAD MAX_PAYLOAD_SIZE
+#define PROTOCOL_VERSION 2
+
+typedef enum {
+  C_PRESENTATION = 0,
+  C_SET = 1,
+  C_REQ = 2,
+  C_INTERNAL = 3,
+  C_STREAM = 4
+} mysensors_command_t;
+
+typedef enum {
+  S_DOOR = 0, S_MOTION = 1, S_SMOKE = 2, S_BINARY = 3, S_DIMMER = 4, S_COVER = 5, S_TEMP = 6, S_HUM = 7,
+  S_BARO = 8, S_WIND = 9, S_RAIN = 10, S_UV = 11, S_WEIGHT = 12, S_POWER = 13, S_HEATER = 14, S_DISTANCE = 15,
+  S_LIGHT_LEVEL = 16, S_ARDUINO_NODE = 17, S_ARDUINO_REPEATER_NODE = 18, S_LOCK = 19, S_IR = 20, S_WATER = 21,
+  S_AIR_QUALITY = 22, S_CUSTOM = 23, S_DUST = 24, S_SCENE_CONTROLLER = 25, S_RGB_LIGHT = 26, S_RGBW_LIGHT = 27,
+  S_COLOR_SENSOR = 28, S_HVAC = 29, S_MULTIMETER = 30, S_SPRINKLER = 31, S_WATER_LEAK = 32, S_SOUND = 33,
+  S_VIBRATION = 34, S_MOISTURE = 35, S_INFO = 36, S_GAS = 37, S_GPS = 38, S_WATER_QUALITY = 39
+} mysensors_sensor_t;
+#define S_LIGHT S_BINARY
+
+typedef enum {
+  V_TEMP = 0, V_HUM = 1, V_STATUS = 2, V_PERCENTAGE = 3, V_PRESSURE = 4, V_FORECAST = 5, V_RAIN = 6,
+  V_RAINRATE = 7, V_WIND = 8, V_GUST = 9, V_DIRECTION = 10, V_UV = 11, V_WEIGHT = 12, V_DISTANCE = 13,
+  V_IMPEDANCE = 14, V_ARMED = 15, V_TRIPPED = 16, V_WATT = 17, V_KWH = 18, V_SCENE_ON = 19, V_SCENE_OFF = 20,
+  V_HVAC_FLOW_STATE = 21, V_HVAC_SPEED = 22, V_LIGHT_LEVEL = 23, V_VAR1 = 24, V_VAR2 = 25, V_VAR3 = 26,
+  V_VAR4 = 27, V_VAR5 = 28, V_UP = 29, V_DOWN = 30, V_STOP = 31, V_IR_SEND = 32, V_IR_RECEIVE = 33, V_FLOW = 34,
+  V_VOLUME = 35, V_LOCK_STATUS = 36, V_LEVEL = 37, V_VOLTAGE = 38, V_CURRENT = 39, V_RGB = 40, V_RGBW = 41,
+  V_ID = 42, V_UNIT_PREFIX = 43, V_HVAC_SETPOINT_COOL = 44, V_HVAC_SETPOINT_HEAT = 45, V_HVAC_FLOW_MODE = 46,
+  V_TEXT = 47, V_CUSTOM = 48, V_POSITION = 49, V_IR_RECORD = 50, V_PH = 51, V_ORP = 52, V_EC = 53, V_VAR = 54,
+  V_VA = 55, V_POWER_FACTOR = 56, V_MULTI_MESSAGE = 57
+} mysensors_data_t;
+#define V_LIGHT V_STATUS
+#define V_DIMMER V_PERCENTAGE
+
+typedef enum {
+  I_BATTERY_LEVEL = 0, I_TIME = 1, I_VERSION = 2, I_ID_REQUEST = 3, I_ID_RESPONSE = 4, I_INCLUSION_MODE = 5,
+  I_CONFIG = 6, I_FIND_PARENT_REQUEST = 7, I_FIND_PARENT_RESPONSE = 8, I_LOG_MESSAGE = 9, I_CHILDREN = 10,
+  I_SKETCH_NAME = 11, I_SKETCH_VERSION = 12, I_REBOOT = 13, I_GATEWAY_READY = 14, I_SIGNING_PRESENTATION = 15,
+  I_NONCE_REQUEST = 16, I_NONCE_RESPONSE = 17, I_HEARTBEAT_REQUEST = 18, I_PRESENTATION = 19,
+  I_DISCOVER_REQUEST = 20, I_DISCOVER_RESPONSE = 21, I_HEARTBEAT_RESPONSE = 22, I_LOCKED = 23, I_PING = 24,
+  I_PONG = 25, I_REGISTRATION_REQUEST = 26, I_REGISTRATION_RESPONSE = 27, I_DEBUG = 28
+} mysensors_internal_t;
+
+typedef enum {
+  P_STRING = 0, P_BYTE = 1, P_INT16 = 2, P_UINT16 = 3, P_LONG32 = 4, P_ULONG32 = 5, P_CUSTOM = 6, P_FLOAT32 = 7
+} mysensors_payload_t;
+
+typedef enum {
+  INDICATION_TX, INDICATION_RX, INDICATION_GW_TX, INDICATION_GW_RX, INDICATION_FIND_PARENT,
+  INDICATION_GOT_PARENT, INDICATION_REQ_NODEID, INDICATION_GOT_NODEID, INDICATION_CHECK_UPLINK,
+  INDICATION_REQ_REGISTRATION, INDICATION_GOT_REGISTRATION, INDICATION_REBOOT, INDICATION_PRESENT,
+  INDICATION_CLEAR_ROUTING, INDICATION_SLEEP, INDICATION_WAKEUP, INDICATION_ERR_HW_INIT,
+  INDICATION_ERR_TX, INDICATION_ERR_TRANSPORT_FAILURE, INDICATION_ERR_INIT_TRANSPORT, INDICATION_ERR_FIND_PARENT,
+  INDICATION_ERR_GET_NODEID, INDICATION_ERR_NET_FULL, INDICATION_ERR_CHECK_UPLINK, INDICATION_ERR_SIGN,
+  INDICATION_ERR_LENGTH, INDICATION_ERR_VERSION, INDICATION_ERR_INIT_GWTRANSPORT, INDICATION_ERR_LOCKED,
+  INDICATION_ERR_FW_FLASH_INIT, INDICATION_ERR_FW_TIMEOUT, INDICATION_ERR_FW_CHECKSUM
+} indication_t;
+
+class MyMessage {
+
+  public:
+    MyMessage();
+    MyMessage(uint8_t Sensor, uint8_t Type);
+
+    // Header
+    uint8_t getSender() const  { return sender; }
+    uint8_t getDestination() const  { return destination; }
+    uint8_t getLast() const  { return last; }
+    uint8_t getSensor() const  { return sensor; }
+    uint8_t getType() const  { return type; }
+    uint8_t getCommand() const  { return command_echo_payload & 0x07; }
+    bool getRequestEcho() const  { return (command_echo_payload >> 3) & 0x01; }
+    bool isEcho() const  { return (command_echo_payload >> 4) & 0x01; }
+    uint8_t getPayloadType() const  { return command_echo_payload >> 5; }
+    uint8_t getLength() const  { return version_length >> 3; }
+    uint8_t getSize() const  { return HEADER_SIZE + getLength(); }
+
+    MyMessage &setSender(uint8_t Sender)  { sender = Sender; return *this; }
+    MyMessage &setDestination(uint8_t Destination)  { destination = Destination; return *this; }
+    MyMessage &setLast(uint8_t Last)  { last = Last; return *this; }
+    MyMessage &setSensor(uint8_t Sensor)  { sensor = Sensor; return *this; }
+    MyMessage &setType(uint8_t Type)  { type = Type; return *this; }
+    MyMessage &setCommand(uint8_t Command)  { command_echo_payload = (command_echo_payload & ~0x07) | (Command & 0x07); return *this; }
+    MyMessage &setRequestEcho(bool Echo)  { command_echo_payload = (command_echo_payload & ~0x08) | (Echo << 3); return *this; }
+    MyMessage &setEcho(bool Echo)  { command_echo_payload = (command_echo_payload & ~0x10) | (Echo << 4); return *this; }
+    MyMessage &setPayloadType(uint8_t PayloadType)  { command_echo_payload = (command_echo_payload & 0x1F) | (PayloadType << 5); return *this; }
+
+    // Payload
+    MyMessage &set(const void *Value, uint8_t Length);
+    MyMessage &set(const char *Value);
+    MyMessage &set(const __FlashStringHelper *Value);
+    MyMessage &set(float Value, uint8_t Decimals);
+    MyMessage &set(bool Value);
+    MyMessage &set(uint8_t Value);
+    MyMessage &set(int16_t Value);
+    MyMessage &set(uint16_t Value);
+    MyMessage &set(int32_t Value);
+    MyMessage &set(uint32_t Value);
+    MyMessage &set(long Value)  { return set((int32_t)Value); }                    // 64-bit long on host
+    MyMessage &set(unsigned long Value)  { return set((uint32_t)Value); }
+
+    const char *getString() const;
+    char *getString(char *Buffer) const;
+    const void *getCustom() const  { return data; }
+    bool getBool() const;
+    uint8_t getByte() const;
+    int16_t getInt() const;
+    uint16_t getUInt() const;
+    int32_t getLong() const;
+    uint32_t getULong() const;
+    float getFloat() const;
+
+    uint8_t last;
+    uint8_t sender;
+    uint8_t destination;
+    uint8_t version_length;                 // 2 bits version, 1 bit signed, 5 bits payload length
+    uint8_t command_echo_payload;           // 3 bits command, 1 bit request echo, 1 bit echo, 3 bits payload type
+    uint8_t type;
+    uint8_t sensor;
+    char data[MAX_PAYLOAD_SIZE + 1];
+
+  private:
+    MyMessage &SetPayload(uint8_t PayloadType, uint8_t Length);
+};
+
+bool send(MyMessage &Msg, const bool Echo = false);
+bool present(const uint8_t Sensor, const uint8_t SensorType, const char *Description = "", const bool Echo = false);
+bool present(const uint8_t Sensor, const uint8_t SensorType, const __FlashStringHelper *Description, const bool Echo = false);
+bool sendSketchInfo(const char *Name, const char *Version, const bool Echo = false);
+bool sendSketchInfo(const __FlashStringHelper *Name, const __FlashStringHelper *Version, const bool Echo = false);
+bool request(const uint8_t Sensor, const uint8_t Type, const uint8_t Destination = GATEWAY_ADDRESS);
+bool requestTime(const bool Echo = false);
+bool sendHeartbeat(const bool Echo = false);
+bool sendBatteryLevel(const uint8_t Level, const bool Echo = false);
+void wait(const uint32_t Ms);
+bool wait(const uint32_t Ms, const uint8_t Command, const uint8_t Type);
+uint8_t getNodeId();
+bool isTransportReady();
+void saveState(const uint8_t Position, const uint8_t Value);
+uint8_t loadState(const uint8_t Position);
+
+// Sketch callbacks; all but setup() & loop() are optional
+void before();
+void presentation();
+void setup();
+void loop();
+void receive(const MyMessage &message);
+void receiveTime(uint32_t Time);
+void indication(const indication_t Indication);
+
+// MQTT gateway transport of the library: PubSubClient connected to the broker stand-in of the harness
+class HostBroker;
+
+class HostMqttClient {
+
+  public:
+    bool connected();
+    bool connect();
+    bool publish(const MyMessage &Msg);
+    uint64_t Since() const  { return _Since; }
+
+    HostBroker *Broker = nullptr;
+
+  private:
+    bool _Connected = false;
+    uint64_t _Since = 0;                    // Time of the connection
+};
+
+extern MyMessage _msg;                      // Frame being processed by the core
+extern HostMqttClient _MQTT_client;
+bool gatewayTransportSend(MyMessage &message);
+
+#endif
+/*
+   EOF
+*/
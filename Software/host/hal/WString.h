@@ -0,0 +1,83 @@
+/*
+ * WString.h file
+ * Subset of the Arduino String class used by the sketches.
+ *
+ */
+
+#ifndef WString_h
+#define WString_h
+
+#include <string>
+
+class String {
+
+  public:
+    String(const char *Text = "") : _Text(Text != nullptr ? Text : "") {}
+    String(const __FlashStringHelper *Text) : String(reinterpret_cast<const char *>(Text)) {}
+    String(int Value) : _Text(std::to_string(Value)) {}
+
+    unsigned int length() const  {
+      return _Text.length();
+    }
+
+    const char *c_str() const  {
+      return _Text.c_str();
+    }
+
+    bool equals(const char *Text) const  {
+      return _Text == Text;
+    }
+
+    bool equals(const String &Text) const  {
+      return _Text == Text._Text;
+    }
+
+    bool operator==(const char *Text) const  {
+      return equals(Text);
+    }
+
+    bool operator==(const String &Text) const  {
+      return equals(Text);
+    }
+
+    bool startsWith(const char *Text) const  {
+      return _Text.compare(0, strlen(Text), Text) == 0;
+    }
+
+    int indexOf(char C) const  {
+      size_t i = _Text.find(C);
+      return i == std::string::npos ? -1 : (int)i;
+    }
+
+    String substring(unsigned int From, unsigned int To = 0xFFFF) const  {
+      if(From > _Text.length())  return String();
+      return String(_Text.substr(From, To > From ? To - From : 0).c_str());
+    }
+
+    long toInt() const  {
+      return atol(_Text.c_str());
+    }
+
+    void toCharArray(char *Buffer, unsigned int Size) const  {
+      if(Size == 0) return;
+      strncpy(Buffer, _Text.c_str(), Size - 1);
+      Buffer[Size - 1] = 0;
+    }
+
+    String &operator+=(const char *Text)  {
+      _Text += Text;
+      return *this;
+    }
+
+    char operator[](unsigned int i) const  {
+      return i < _Text.length() ? _Text[i] : 0;
+    }
+
+  private:
+    std::string _Text;
+};
+
+#endif
+/*
+   EOF
+*/
@@ -0,0 +1,20 @@
+/*
+ * avr/eeprom.h file
+ * EEPROM of the virtual node: a write takes EEPROM_WRITE_US, the next access waits for it.
+ *
+ */
+
+#ifndef eeprom_h
+#define eeprom_h
+
+#include <Arduino.h>
+
+bool eeprom_is_ready();
+uint8_t eeprom_read_byte(const uint8_t *Address);
+void eeprom_write_byte(uint8_t *Address, uint8_t Value);
+void eeprom_update_byte(uint8_t *Address, uint8_t Value);
+
+#endif
+/*
+   EOF
+*/
@@ -0,0 +1,15 @@
+/*
+ * avr/interrupt.h file
+ * Interrupts are declared in Arduino.h.
+ *
+ */
+
+#ifndef interrupt_h
+#define interrupt_h
+
+#include <Arduino.h>
+
+#endif
+/*
+   EOF
+*/
@@ -0,0 +1,15 @@
+/*
+ * avr/io.h file
+ * ATmega328P registers are declared in Arduino.h.
+ *
+ */
+
+#ifndef io_h
+#define io_h
+
+#include <Arduino.h>
+
+#endif
+/*
+   EOF
+*/
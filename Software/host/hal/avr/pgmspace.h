@@ -0,0 +1,15 @@
+/*
+ * avr/pgmspace.h file
+ * Flash is ordinary memory on host; see Arduino.h.
+ *
+ */
+
+#ifndef pgmspace_h
+#define pgmspace_h
+
+#include <Arduino.h>
+
+#endif
+/*
+   EOF
+*/
@@ -0,0 +1,28 @@
+/*
+ * avr/power.h file
+ * Power reduction register of the virtual node; the disabled peripherals aren't modelled anyway.
+ *
+ */
+
+#ifndef power_h
+#define power_h
+
+#include <Arduino.h>
+
+#define power_adc_disable() (PRR |= _BV(PRADC))
+#define power_adc_enable() (PRR &= ~_BV(PRADC))
+#define power_usart0_disable() (PRR |= _BV(PRUSART0))
+#define power_usart0_enable() (PRR &= ~_BV(PRUSART0))
+#define power_spi_disable() (PRR |= _BV(PRSPI))
+#define power_spi_enable() (PRR &= ~_BV(PRSPI))
+#define power_twi_disable() (PRR |= _BV(PRTWI))
+#define power_twi_enable() (PRR &= ~_BV(PRTWI))
+#define power_timer1_disable() (PRR |= _BV(PRTIM1))
+#define power_timer1_enable() (PRR &= ~_BV(PRTIM1))
+#define power_timer2_disable() (PRR |= _BV(PRTIM2))
+#define power_timer2_enable() (PRR &= ~_BV(PRTIM2))
+
+#endif
+/*
+   EOF
+*/
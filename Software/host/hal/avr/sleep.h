@@ -0,0 +1,29 @@
+/*
+ * avr/sleep.h file
+ * Sleep modes of the virtual node: sleep_cpu() idles until the next interrupt, see HostMcu::Sleep(). Only the
+ * idle mode is modelled; timers keep running in every mode.
+ *
+ */
+
+#ifndef sleep_h
+#define sleep_h
+
+#include <Arduino.h>
+
+#define SLEEP_MODE_IDLE 0x00
+#define SLEEP_MODE_ADC 0x02
+#define SLEEP_MODE_PWR_DOWN 0x04
+#define SLEEP_MODE_PWR_SAVE 0x06
+#define SLEEP_MODE_STANDBY 0x0C
+#define SLEEP_MODE_EXT_STANDBY 0x0E
+
+#define set_sleep_mode(Mode) (SMCR = (SMCR & ~(_BV(SM2) | _BV(SM1) | _BV(SM0))) | (Mode))
+#define sleep_enable() (SMCR |= _BV(SE))
+#define sleep_disable() (SMCR &= ~_BV(SE))
+
+void sleep_cpu();
+
+#endif
+/*
+   EOF
+*/
@@ -0,0 +1,15 @@
+/*
+ * new.h file
+ * Placement new of the AVR core (new.h) on the host.
+ *
+ */
+
+#ifndef new_h
+#define new_h
+
+#include <new>
+
+#endif
+/*
+   EOF
+*/
@@ -0,0 +1,35 @@
+/*
+ * util/atomic.h file
+ * ATOMIC_BLOCK of the virtual node: interrupts are held off inside the block and the pending ones
+ * run when it ends, which also costs 1 us of CPU time, so busy loops polling shared data make progress.
+ *
+ */
+
+#ifndef atomic_h
+#define atomic_h
+
+#include <Arduino.h>
+
+class HostAtomic {
+
+  public:
+    HostAtomic();
+    ~HostAtomic() noexcept(false);
+
+    bool Once()  {
+      return _Once ? (_Once = false, true) : false;
+    }
+
+  private:
+    bool _Once = true;
+    uint8_t _SREG;
+};
+
+#define ATOMIC_RESTORESTATE
+#define ATOMIC_FORCEON
+#define ATOMIC_BLOCK(Type) for(HostAtomic _Atomic; _Atomic.Once(); )
+
+#endif
+/*
+   EOF
+*/
@@ -0,0 +1,39 @@
+/*
+ * util/crc16.h file
+ * CRC functions of avr-libc.
+ *
+ */
+
+#ifndef crc16_h
+#define crc16_h
+
+#include <stdint.h>
+
+inline uint16_t _crc16_update(uint16_t crc, uint8_t a)  {
+  crc ^= a;
+  for(uint8_t i=0; i<8; ++i)  {
+    crc = (crc & 1) ? (crc >> 1) ^ 0xA001 : (crc >> 1);
+  }
+  return crc;
+}
+
+inline uint8_t _crc8_ccitt_update(uint8_t inCrc, uint8_t inData)  {
+  uint8_t data = inCrc ^ inData;
+  for(uint8_t i=0; i<8; i++) {
+    data = (data & 0x80) != 0 ? (data << 1) ^ 0x07 : data << 1;
+  }
+  return data;
+}
+
+inline uint8_t _crc_ibutton_update(uint8_t crc, uint8_t data)  {
+  crc = crc ^ data;
+  for(uint8_t i=0; i<8; i++) {
+    crc = (crc & 0x01) ? (crc >> 1) ^ 0x8C : crc >> 1;
+  }
+  return crc;
+}
+
+#endif
+/*
+   EOF
+*/
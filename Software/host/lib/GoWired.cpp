@@ -0,0 +1,301 @@
+/*
+ * GoWired.cpp file
+ * Host stand-in of the GoWired library, see GoWired.h
+ *
+ */
+
+#include "GoWired.h"
+
+/***** CommonIO *****/
+void CommonIO::SetValues(bool RelayOFF, bool Invert, uint8_t Type, uint8_t Pin1, uint8_t Pin2, uint8_t Pin3)  {
+  _RelayOFF = RelayOFF;
+  _Invert = Invert;
+  SensorType = Type;
+
+  switch(SensorType)  {
+    case 0:
+    case 3:
+      _SensorPin = Pin1;
+      pinMode(_SensorPin, INPUT_PULLUP);
+      break;
+    case 1:
+      _SensorPin = Pin1;
+      pinMode(_SensorPin, INPUT);
+      break;
+    case 2:
+      _RelayPin = Pin1;
+      pinMode(_RelayPin, OUTPUT);
+      digitalWrite(_RelayPin, _RelayOFF);
+      break;
+    case 4:
+      _SensorPin = Pin1;
+      _RelayPin = Pin2;
+      pinMode(_SensorPin, INPUT_PULLUP);
+      pinMode(_RelayPin, OUTPUT);
+      digitalWrite(_RelayPin, _RelayOFF);
+      break;
+    case 5:
+      _SensorPin = Pin1;
+      ReadReference();
+      break;
+    case 6:
+      _SensorPin = Pin1;
+      _InputPin = Pin2;
+      _RelayPin = Pin3;
+      pinMode(_InputPin, INPUT_PULLUP);
+      pinMode(_RelayPin, OUTPUT);
+      digitalWrite(_RelayPin, _RelayOFF);
+      ReadReference();
+      break;
+    case 7:
+      _SensorPin = Pin1;
+      _RelayPin = Pin2;
+      pinMode(_RelayPin, OUTPUT);
+      digitalWrite(_RelayPin, _RelayOFF);
+      ReadReference();
+      break;
+    default:
+      break;
+  }
+}
+
+void CommonIO::SetValues(bool RelayOFF, uint8_t Type, uint8_t Pin1)  {
+  SetValues(RelayOFF, false, Type, Pin1);
+}
+
+void CommonIO::CheckInput(uint16_t LongpressDuration, uint8_t DebounceValue)  {
+  if(SensorType == 2) return;
+
+  // Inputs are active high, buttons active low (pullup)
+  bool Reading = digitalRead(_SensorPin) == (SensorType >= 3 ? LOW : HIGH);
+
+  Reading ^= _Invert;
+
+  Debounce(Reading, LongpressDuration, DebounceValue);
+}
+
+void CommonIO::CheckInput2(uint16_t Threshold, uint16_t LongpressDuration, uint8_t DebounceValue)  {
+  Debounce(TouchActive(Threshold), LongpressDuration, DebounceValue);
+}
+
+void CommonIO::CheckInput3(uint16_t Threshold, uint8_t DebounceValue, bool Monostable)  {
+  bool Active = TouchActive(Threshold);
+  uint32_t Now = millis();
+
+  if(Active != _Candidate)  {
+    _Candidate = Active;
+    _CandidateTime = Now;
+  }
+  if(_Candidate == _Reading || Now - _CandidateTime < DebounceValue) return;
+
+  _Reading = _Candidate;
+
+  if(Monostable)  {
+    NewState = _Reading;
+  }
+  else if(_Reading) {
+    NewState = !State;
+  }
+}
+
+bool CommonIO::TouchActive(uint16_t Threshold)  {
+  int Reading = TouchRead();
+
+  DebugValue = Reading;
+  TouchDiagnosisValue = Reading - _TouchReference;
+
+  bool Active = TouchDiagnosisValue > (int)Threshold;
+
+  if(SensorType == 6) {
+    Active |= digitalRead(_InputPin) == LOW;
+  }
+
+  return Active;
+}
+
+void CommonIO::ReadReference()  {
+  _TouchReference = TouchRead();
+  References++;
+}
+
+int CommonIO::TouchRead()  {
+  int32_t Sum = 0;
+
+  for(uint8_t i=0; i<HOST_TOUCH_SAMPLES; i++)  {
+    // Pin charged through the pullup, ADC sample & hold discharged on a conversion (discarded)
+    pinMode(_SensorPin, INPUT_PULLUP);
+    analogRead(_SensorPin);
+    pinMode(_SensorPin, INPUT);
+    Sum += analogRead(_SensorPin);
+  }
+
+  return Sum / HOST_TOUCH_SAMPLES;
+}
+
+void CommonIO::Debounce(bool Reading, uint16_t LongpressDuration, uint8_t DebounceValue)  {
+  uint32_t Now = millis();
+
+  if(Reading != _Candidate) {
+    _Candidate = Reading;
+    _CandidateTime = Now;
+  }
+  if(_Candidate != _Reading && Now - _CandidateTime >= DebounceValue) {
+    _Reading = _Candidate;
+
+    if(SensorType < 3)  {
+      NewState = _Reading;
+      return;
+    }
+
+    if(_Reading)  {
+      _PressTime = Now;
+      _LongReported = false;
+    }
+    else if(!_LongReported) {
+      NewState = !State;
+    }
+    return;
+  }
+
+  if(SensorType >= 3 && _Reading && !_LongReported && Now - _PressTime >= LongpressDuration)  {
+    _LongReported = true;
+    NewState = 2;
+  }
+}
+
+void CommonIO::SetRelay()  {
+  digitalWrite(_RelayPin, NewState ? !_RelayOFF : _RelayOFF);
+  State = NewState;
+}
+
+/***** Shutters *****/
+Shutters::Shutters(uint16_t EEA_DownTime, uint16_t EEA_UpTime, uint16_t EEA_Position)
+  : _EEA_DownTime(EEA_DownTime), _EEA_UpTime(EEA_UpTime), _EEA_Position(EEA_Position) {}
+
+void Shutters::SetOutputs(bool RelayOFF, uint8_t Pin1, uint8_t Pin2)  {
+  _RelayOFF = RelayOFF;
+  _Pin1 = Pin1;
+  _Pin2 = Pin2;
+
+  pinMode(_Pin1, OUTPUT);
+  pinMode(_Pin2, OUTPUT);
+  digitalWrite(_Pin1, _RelayOFF);
+  digitalWrite(_Pin2, _RelayOFF);
+
+  // Stored values are read here; the EEPROM isn't available to constructors of globals
+  uint8_t Down = EEPROM.read(_EEA_DownTime);
+  uint8_t Up = EEPROM.read(_EEA_UpTime);
+  uint8_t Stored = EEPROM.read(_EEA_Position);
+
+  Calibrated = Down > 0 && Down < 0xFF && Up > 0 && Up < 0xFF;
+  Position = Stored <= 100 ? Stored : 0;
+}
+
+void Shutters::Calibration(uint8_t UpTime, uint8_t DownTime)  {
+  EEPROM.update(_EEA_UpTime, UpTime);
+  EEPROM.update(_EEA_DownTime, DownTime);
+  Calibrated = true;
+}
+
+void Shutters::Movement()  {
+  // Both off first, never both on
+  digitalWrite(_Pin1, _RelayOFF);
+  digitalWrite(_Pin2, _RelayOFF);
+
+  if(NewState == 0) {
+    digitalWrite(_Pin1, !_RelayOFF);
+  }
+  else if(NewState == 1)  {
+    digitalWrite(_Pin2, !_RelayOFF);
+  }
+
+  State = NewState;
+}
+
+/***** PowerSensor *****/
+void PowerSensor::SetValues(uint8_t Pin, float mVperAmp, uint16_t ReceiverVoltage, float MaxCurrent, uint16_t MeasuringTime, float Vcc)  {
+  (void)Vcc;
+
+  _Pin = Pin;
+  _mVperAmp = mVperAmp;
+  _ReceiverVoltage = ReceiverVoltage;
+  _MaxCurrent = MaxCurrent;
+  _MeasuringTime = MeasuringTime;
+}
+
+float PowerSensor::MeasureAC(float Vcc)  {
+  double Zero = Vcc / 2, Sum = 0;
+  uint32_t Count = 0, Start = millis();
+
+  while(millis() - Start < _MeasuringTime)  {
+    double mV = analogRead(_Pin) * Vcc / 1024 - Zero;
+
+    Sum += mV * mV;
+    Count++;
+  }
+
+  return Count > 0 ? sqrt(Sum / Count) / _mVperAmp : 0;
+}
+
+float PowerSensor::MeasureDC(float Vcc)  {
+  float mV = analogRead(_Pin) * Vcc / 1024 - Vcc / 2;
+
+  return mV > 0 ? mV / _mVperAmp : 0;
+}
+
+/***** Dimmer *****/
+void Dimmer::SetValues(uint8_t NumberOfChannels, uint8_t DimmingStep, uint8_t DimmingInterval, uint8_t Pin1,
+                       uint8_t Pin2, uint8_t Pin3, uint8_t Pin4)  {
+  _NumberOfChannels = NumberOfChannels < 4 ? NumberOfChannels : 4;
+  _DimmingStep = DimmingStep > 0 ? DimmingStep : 1;
+  _DimmingInterval = DimmingInterval;
+  _Pins[0] = Pin1;
+  _Pins[1] = Pin2;
+  _Pins[2] = Pin3;
+  _Pins[3] = Pin4;
+
+  for(uint8_t i=0; i<_NumberOfChannels; i++) {
+    pinMode(_Pins[i], OUTPUT);
+    analogWrite(_Pins[i], 0);
+  }
+}
+
+void Dimmer::ChangeState(bool NewState)  {
+  CurrentState = NewState;
+}
+
+void Dimmer::NewColorValues(const char *Input)  {
+  // "RRGGBB" or "RRGGBBWW", hexadecimal
+  for(uint8_t i=0; i<4 && isxdigit(Input[2*i]) && isxdigit(Input[2*i+1]); i++) {
+    char Hex[3] = {Input[2*i], Input[2*i+1], 0};
+
+    _Values[i] = strtoul(Hex, nullptr, 16);
+  }
+}
+
+void Dimmer::UpdateDimmer()  {
+  int Target = CurrentState ? NewDimmingLevel : 0;
+
+  if(_DimmingLevel == Target || millis() - _LastStep < _DimmingInterval)  return;
+
+  _LastStep = millis();
+  _DimmingLevel += Target > _DimmingLevel ? min((int)_DimmingStep, Target - _DimmingLevel)
+                                          : -min((int)_DimmingStep, _DimmingLevel - Target);
+
+  for(uint8_t i=0; i<_NumberOfChannels; i++) {
+    uint8_t Value = _NumberOfChannels == 1 ? 255 : _Values[i];
+
+    analogWrite(_Pins[i], (int)Value * _DimmingLevel / 100);
+  }
+}
+
+void Dimmer::UpdateLEDs(uint8_t Brightness, uint8_t R, uint8_t G, uint8_t B)  {
+  const uint8_t Values[3] = {R, G, B};
+
+  for(uint8_t i=0; i<_NumberOfChannels && i<3; i++) {
+    analogWrite(_Pins[i], (int)Values[i] * Brightness / 100);
+  }
+}
+/*
+   EOF
+*/
@@ -0,0 +1,162 @@
+/*
+ * GoWired.h file
+ * Host stand-in of the GoWired library (https://github.com/GoWired/GoWired-lib): CommonIO, Shutters,
+ * PowerSensor & Dimmer with the interface used by the sketches. Inputs are debounced across calls of
+ * CheckInput() instead of inside them, so the stand-in never blocks; a short press is reported at its
+ * release, a long press as soon as it lasts LongpressDuration. Touch fields are read like ADCTouch does,
+ * HOST_TOUCH_SAMPLES conversions with the pin charged through the pullup in between.
+ *
+ */
+
+#ifndef GoWired_h
+#define GoWired_h
+
+#include <Host.h>
+#include <EEPROM.h>
+
+#define HOST_TOUCH_SAMPLES 100              // Conversions per touch field reading (ADCTouch default; estimate)
+
+/**
+ * @brief Digital input, relay output or both
+ *
+ * SensorType: 0 - input with pullup (door/window), 1 - input (motion sensor), 2 - relay,
+ * 3 - button, 4 - button & relay, 5 - touch field, 6 - touch field, button (Pin2) & relay (Pin3),
+ * 7 - touch field & relay (Pin2). Buttons & touch fields report NewState = !State (short press) or 2 (long press).
+ */
+class CommonIO {
+
+  public:
+    void SetValues(bool RelayOFF, bool Invert, uint8_t Type, uint8_t Pin1, uint8_t Pin2 = 0, uint8_t Pin3 = 0);
+    void SetValues(bool RelayOFF, uint8_t Type, uint8_t Pin1);
+    void CheckInput(uint16_t LongpressDuration, uint8_t DebounceValue);
+
+    /**
+     * @brief Touch field: active while the reading exceeds the reference by more than Threshold
+     *
+     */
+    void CheckInput2(uint16_t Threshold, uint16_t LongpressDuration, uint8_t DebounceValue);
+
+    /**
+     * @brief Touch field without long press: NewState = !State on a touch, or follows the touch if Monostable
+     *
+     */
+    void CheckInput3(uint16_t Threshold, uint8_t DebounceValue, bool Monostable);
+    void ReadReference();
+    void SetState(bool NewValue)  { NewState = NewValue; }
+    void SetRelay();
+
+    uint8_t SensorType = 0;
+    uint8_t State = 0;
+    uint8_t NewState = 0;
+    int TouchDiagnosisValue = 0;            // Last reading - reference
+    int DebugValue = 0;                     // Last reading
+    uint32_t References = 0;                // Touch references taken (host)
+
+  private:
+    int TouchRead();
+    bool TouchActive(uint16_t Threshold);
+    void Debounce(bool Reading, uint16_t LongpressDuration, uint8_t DebounceValue);
+
+    bool _RelayOFF = LOW;
+    bool _Invert = false;
+    uint8_t _SensorPin = 0;
+    uint8_t _InputPin = 0;
+    uint8_t _RelayPin = 0;
+    int _TouchReference = 0;
+    bool _Reading = false;                  // Debounced input: true - active (button pressed)
+    bool _Candidate = false;
+    uint32_t _CandidateTime = 0;
+    uint32_t _PressTime = 0;
+    bool _LongReported = false;
+};
+
+/**
+ * @brief Roller shutter outputs & stored travel times; Position (0 - open, 100 - closed) is kept by the sketch
+ *
+ */
+class Shutters {
+
+  public:
+    Shutters(uint16_t EEA_DownTime, uint16_t EEA_UpTime, uint16_t EEA_Position);
+    void SetOutputs(bool RelayOFF, uint8_t Pin1, uint8_t Pin2);
+    void Calibration(uint8_t UpTime, uint8_t DownTime);
+    void Movement();
+
+    uint8_t State = 2;                      // SHUTTER_UP, SHUTTER_DOWN, SHUTTER_STOP
+    uint8_t NewState = 2;
+    uint8_t Position = 0;
+    bool Calibrated = false;
+
+  private:
+    uint16_t _EEA_DownTime;
+    uint16_t _EEA_UpTime;
+    uint16_t _EEA_Position;
+    bool _RelayOFF = LOW;
+    uint8_t _Pin1 = 0;                      // Up
+    uint8_t _Pin2 = 0;                      // Down
+};
+
+/**
+ * @brief Current sensor (ACS712 type, zero current at Vcc / 2)
+ *
+ */
+class PowerSensor {
+
+  public:
+    void SetValues(uint8_t Pin, float mVperAmp, uint16_t ReceiverVoltage, float MaxCurrent, uint16_t MeasuringTime, float Vcc);
+
+    /**
+     * @brief RMS current (A) of conversions over MeasuringTime; blocks like the library
+     *
+     */
+    float MeasureAC(float Vcc);
+    float MeasureDC(float Vcc);
+    float CalculatePower(float Current, float Cosfi)  { return Current * _ReceiverVoltage * Cosfi; }
+    bool ElectricalStatus(float Current)  { return Current > _MaxCurrent; }
+
+  private:
+    uint8_t _Pin = 0;
+    float _mVperAmp = 1;
+    uint16_t _ReceiverVoltage = 0;
+    float _MaxCurrent = 0;
+    uint16_t _MeasuringTime = 0;
+};
+
+/**
+ * @brief PWM dimmer of 1, 3 (RGB) or 4 (RGBW) channels; fades to the new level in steps, without blocking
+ *
+ */
+class Dimmer {
+
+  public:
+    void SetValues(uint8_t NumberOfChannels, uint8_t DimmingStep, uint8_t DimmingInterval, uint8_t Pin1,
+                   uint8_t Pin2 = 0, uint8_t Pin3 = 0, uint8_t Pin4 = 0);
+    void ChangeState(bool NewState);
+    void NewColorValues(const char *Input);
+    void UpdateDimmer();
+
+    /**
+     * @brief Sets the channels right away, without fading
+     *
+     * @param Brightness %
+     * @param R, G, B PWM duty (255 - OFF on the Touch boards)
+     */
+    void UpdateLEDs(uint8_t Brightness, uint8_t R, uint8_t G, uint8_t B);
+
+    bool CurrentState = false;
+    int NewDimmingLevel = 20;               // %
+
+  private:
+    uint8_t _NumberOfChannels = 0;
+    uint8_t _DimmingStep = 1;
+    uint8_t _DimmingInterval = 1;
+    uint8_t _Pins[4] = {};
+    uint8_t _Values[4] = {255, 255, 255, 255};
+    int _DimmingLevel = 0;                  // % output now
+    uint32_t _LastStep = 0;
+};
+
+#endif
+/*
+   EOF
+*/
@@ -0,0 +1,44 @@
+/*
+ * GoWired2.cpp file
+ * Host stand-in of the second GoWired library header, see GoWired2.h
+ *
+ */
+
+#include "GoWired2.h"
+
+/***** Heating *****/
+uint16_t Heating::SetSectionValues(uint8_t TID, float DaySP, uint16_t EEAddress, bool RelayOFF)  {
+  float Stored;
+
+  this->TID = TID;
+  _EEAddress = EEAddress;
+  _RelayOFF = RelayOFF;
+  RelayState = RelayOFF;
+
+  EEPROM.get(_EEAddress, Stored);
+  SetPointDay = Stored >= 0 && Stored < 100 ? Stored : DaySP;
+
+  return _EEAddress + sizeof(float);
+}
+
+void Heating::SetTemperature(float SetPoint)  {
+  SetPointDay = SetPoint;
+  EEPROM.put(_EEAddress, SetPointDay);
+}
+
+void Heating::ReadTemperature(float Temperature)  {
+  this->Temperature = Temperature;
+  _Measured = true;
+}
+
+bool Heating::TemperatureCompare(float SetPoint, float Hysteresis)  {
+  if(!_Measured)  return RelayState;
+
+  if(Temperature < SetPoint - Hysteresis)  return !_RelayOFF;
+  if(Temperature > SetPoint + Hysteresis)  return _RelayOFF;
+
+  return RelayState;
+}
+/*
+   EOF
+*/
@@ -0,0 +1,52 @@
+/*
+ * GoWired2.h file
+ * Host stand-in of the second GoWired library header: Heating, a section of the heating controller with
+ * the interface used by the sketches. The day set point of a section is kept in the EEPROM like in the
+ * library; the section compares the last reported temperature with a set point.
+ *
+ */
+
+#ifndef GoWired2_h
+#define GoWired2_h
+
+#include <Host.h>
+#include <EEPROM.h>
+
+/**
+ * @brief Heating section: thermometer node, day set point & relay state
+ *
+ */
+class Heating {
+
+  public:
+    /**
+     * @brief Sets section thermometer & reads day set point from EEPROM (DaySP if not stored)
+     *
+     * @return uint16_t EEPROM address of the next section
+     */
+    uint16_t SetSectionValues(uint8_t TID, float DaySP, uint16_t EEAddress, bool RelayOFF);
+    void SetTemperature(float SetPoint);
+    void ReadTemperature(float Temperature);
+
+    /**
+     * @brief Relay state for the set point: on below SetPoint - Hysteresis, off above SetPoint + Hysteresis,
+     * unchanged in between or without a reading
+     *
+     */
+    bool TemperatureCompare(float SetPoint, float Hysteresis);
+
+    uint8_t TID = 0;                        // Node ID of the thermometer
+    float SetPointDay = 0;
+    float Temperature = 0;
+    bool RelayState = LOW;
+
+  private:
+    uint16_t _EEAddress = 0;
+    bool _RelayOFF = LOW;
+    bool _Measured = false;
+};
+
+#endif
+/*
+   EOF
+*/
@@ -0,0 +1,44 @@
+/*
+ * LP50XX.cpp file
+ * Host stand-in of the LP50XX library, see LP50XX.h
+ *
+ */
+
+#include "LP50XX.h"
+
+#define LP50XX_DEVICE_CONFIG0 0x00
+#define LP50XX_LED0_BRIGHTNESS 0x07
+#define LP50XX_OUT0_COLOR 0x0B
+
+void LP50XX::Begin(uint8_t Address)  {
+  _Address = Address;
+
+  pinMode(_EnablePin, OUTPUT);
+  digitalWrite(_EnablePin, HIGH);
+  delayMicroseconds(500);                   // Chip enable time
+
+  // Chip_EN
+  WriteRegisters(LP50XX_DEVICE_CONFIG0, 1);
+}
+
+void LP50XX::SetLEDColor(uint8_t LED, uint8_t R, uint8_t G, uint8_t B)  {
+  (void)R;
+  (void)G;
+  (void)B;
+  WriteRegisters(LP50XX_OUT0_COLOR + 3 * LED, 3);
+}
+
+void LP50XX::SetLEDBrightness(uint8_t LED, uint8_t Brightness)  {
+  (void)Brightness;
+  WriteRegisters(LP50XX_LED0_BRIGHTNESS + LED, 1);
+}
+
+void LP50XX::WriteRegisters(uint8_t Register, uint8_t Count)  {
+  Wire.beginTransmission(_Address);
+  Wire.write(Register);
+  for(uint8_t i=0; i<Count; i++) Wire.write((uint8_t)0);
+  Wire.endTransmission();
+}
+/*
+   EOF
+*/
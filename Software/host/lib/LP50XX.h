@@ -0,0 +1,35 @@
+/*
+ * LP50XX.h file
+ * Host stand-in of the LP50XX library (LP5009/LP5012 RGB LED driver): enable pin & I2C transfers of the
+ * library calls; the LED state isn't modelled.
+ *
+ */
+
+#ifndef LP50XX_h
+#define LP50XX_h
+
+#include <Wire.h>
+
+enum LED_Configuration {RGB, GRB, BGR, RBG, GBR, BRG};
+
+class LP50XX {
+
+  public:
+    LP50XX(LED_Configuration Configuration, uint8_t EnablePin) : _Configuration(Configuration), _EnablePin(EnablePin) {}
+
+    void Begin(uint8_t Address = 0x14);
+    void SetLEDColor(uint8_t LED, uint8_t R, uint8_t G, uint8_t B);
+    void SetLEDBrightness(uint8_t LED, uint8_t Brightness);
+
+  private:
+    void WriteRegisters(uint8_t Register, uint8_t Count);
+
+    LED_Configuration _Configuration;
+    uint8_t _EnablePin;
+    uint8_t _Address = 0x14;
+};
+
+#endif
+/*
+   EOF
+*/
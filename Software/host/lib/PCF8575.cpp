@@ -0,0 +1,38 @@
+/*
+ * PCF8575.cpp file
+ * Host stand-in of the PCF8575 library, see PCF8575.h
+ *
+ */
+
+#include "PCF8575.h"
+
+std::function<uint16_t(uint8_t Address, HostTime Time)> PCF8575::Inputs;
+std::function<void(uint8_t Address, uint16_t Value, HostTime Time)> PCF8575::OnWrite;
+
+void PCF8575::begin(uint8_t Address)  {
+  _Address = Address;
+  Wire.begin();
+}
+
+uint16_t PCF8575::read()  {
+  Wire.requestFrom(_Address, (uint8_t)2);
+  Wire.read();
+  Wire.read();
+
+  uint16_t Driven = Inputs ? Inputs(_Address, Mcu.Now()) : 0xFFFF;
+
+  return Driven & _Written;
+}
+
+void PCF8575::write(uint16_t Value)  {
+  Wire.beginTransmission(_Address);
+  Wire.write((uint8_t)(Value & 0xFF));
+  Wire.write((uint8_t)(Value >> 8));
+  Wire.endTransmission();
+
+  if(Value != _Written && OnWrite)  OnWrite(_Address, Value, Mcu.Now());
+  _Written = Value;
+}
+/*
+   EOF
+*/
@@ -0,0 +1,33 @@
+/*
+ * PCF8575.h file
+ * Host stand-in of the PCF8575 16-bit I2C expander library: one I2C transfer per read() & write(). The
+ * pins are quasi-bidirectional: a pin written low reads low, a pin written high reads the level driven
+ * by the harness (Inputs, high if none).
+ *
+ */
+
+#ifndef PCF8575_h
+#define PCF8575_h
+
+#include <Wire.h>
+
+class PCF8575 {
+
+  public:
+    void begin(uint8_t Address);
+    void pinMode(uint8_t Pin, uint8_t Mode)  { (void)Pin; (void)Mode; }
+    uint16_t read();
+    void write(uint16_t Value);
+
+    static std::function<uint16_t(uint8_t Address, HostTime Time)> Inputs;               // Levels driven on the pins
+    static std::function<void(uint8_t Address, uint16_t Value, HostTime Time)> OnWrite;   // Pins written
+
+  private:
+    uint8_t _Address = 0x20;
+    uint16_t _Written = 0xFFFF;
+};
+
+#endif
+/*
+   EOF
+*/
@@ -0,0 +1,42 @@
+/*
+ * SHTSensor.cpp file
+ * Host stand-in of the arduino-sht library, see SHTSensor.h
+ *
+ */
+
+#include "SHTSensor.h"
+
+std::function<bool(HostTime Time, float &Temperature, float &Humidity)> SHTSensor::Sample;
+
+bool SHTSensor::init(TwoWire &Bus)  {
+  // Soft reset
+  Bus.beginTransmission(0x44);
+  Bus.write((uint8_t)0x30);
+  Bus.write((uint8_t)0xA2);
+  Bus.endTransmission();
+
+  return (bool)Sample;
+}
+
+bool SHTSensor::setAccuracy(SHTAccuracy Accuracy)  {
+  static const uint8_t Durations[] = {15, 6, 4};
+
+  _Duration = Durations[Accuracy];
+  return true;
+}
+
+bool SHTSensor::readSample()  {
+  // Single shot, no clock stretching
+  Wire.beginTransmission(0x44);
+  Wire.write((uint8_t)0x24);
+  Wire.write((uint8_t)0x00);
+  Wire.endTransmission();
+  delay(_Duration);
+  Wire.requestFrom((uint8_t)0x44, (uint8_t)6);
+  while(Wire.available()) Wire.read();
+
+  return Sample && Sample(Mcu.Now(), _Temperature, _Humidity);
+}
+/*
+   EOF
+*/
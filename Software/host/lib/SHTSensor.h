@@ -0,0 +1,39 @@
+/*
+ * SHTSensor.h file
+ * Host stand-in of the arduino-sht library for an SHT3x: a single shot measurement is a command transfer,
+ * the measurement time of the accuracy (delay(), as the library does) and a 6 byte read. Readings are
+ * scripted by the harness (Sample); without a script the sensor doesn't answer.
+ *
+ */
+
+#ifndef SHTSensor_h
+#define SHTSensor_h
+
+#include <Wire.h>
+
+class SHTSensor {
+
+  public:
+    enum SHTSensorType {AUTO_DETECT, SHT3X, SHT85, SHT3X_ALT, SHTC1, SHTC3, SHTW1, SHTW2, SHT4X};
+    enum SHTAccuracy {SHT_ACCURACY_HIGH, SHT_ACCURACY_MEDIUM, SHT_ACCURACY_LOW};
+
+    explicit SHTSensor(SHTSensorType Type = AUTO_DETECT)  { (void)Type; }
+
+    bool init(TwoWire &Bus = Wire);
+    bool setAccuracy(SHTAccuracy Accuracy);
+    bool readSample();
+    float getTemperature() const  { return _Temperature; }
+    float getHumidity() const  { return _Humidity; }
+
+    static std::function<bool(HostTime Time, float &Temperature, float &Humidity)> Sample;   // false - no answer
+
+  private:
+    uint8_t _Duration = 15;                 // Measurement time (ms)
+    float _Temperature = 0;
+    float _Humidity = 0;
+};
+
+#endif
+/*
+   EOF
+*/
@@ -0,0 +1,17 @@
+/*
+ * UIPEthernet.h file
+ * Host stand-in of the UIPEthernet library (ENC28J60): included by the Ethernet gateway sketches. The MQTT
+ * transport of the MySensors core talks to the broker stand-in directly (see hal/MyGatewayTransport.cpp),
+ * so nothing of the library is used by the sketch itself.
+ *
+ */
+
+#ifndef UIPEthernet_h
+#define UIPEthernet_h
+
+#include <Host.h>
+
+#endif
+/*
+   EOF
+*/
@@ -0,0 +1,67 @@
+/*
+ * Wire.cpp file
+ * Host stand-in of the Arduino Wire library, see Wire.h
+ *
+ */
+
+#include "Wire.h"
+
+TwoWire Wire;
+
+void TwoWire::beginTransmission(uint8_t Address)  {
+  (void)Address;
+  _Length = 0;
+}
+
+size_t TwoWire::write(uint8_t Value)  {
+  (void)Value;
+  if(_Length >= WIRE_BUFFER_LENGTH)  return 0;
+
+  _Length++;
+  return 1;
+}
+
+size_t TwoWire::write(const uint8_t *Data, size_t Length)  {
+  size_t Written = 0;
+
+  while(Written < Length && write(Data[Written]))  Written++;
+
+  return Written;
+}
+
+uint8_t TwoWire::endTransmission(bool Stop)  {
+  (void)Stop;
+  Transfer(_Length);
+  _Length = 0;
+
+  return 0;
+}
+
+uint8_t TwoWire::requestFrom(uint8_t Address, uint8_t Quantity, bool Stop)  {
+  (void)Address;
+  (void)Stop;
+  Quantity = Quantity > WIRE_BUFFER_LENGTH ? WIRE_BUFFER_LENGTH : Quantity;
+  Transfer(Quantity);
+  _Available = Quantity;
+
+  return Quantity;
+}
+
+int TwoWire::read()  {
+  if(_Available == 0) return -1;
+
+  _Available--;
+  return 0xFF;
+}
+
+void TwoWire::Transfer(uint8_t Bytes)  {
+  HostTime Start = Mcu.Now();
+
+  // Address byte & data bytes, 9 clocks each (ACK)
+  Mcu.Cpu(HOST_I2C_OVERHEAD_US + (9ULL * (Bytes + 1) * 1000000 + _Clock - 1) / _Clock);
+  Transfers++;
+  Busy.Add(Mcu.Now() - Start);
+}
+/*
+   EOF
+*/
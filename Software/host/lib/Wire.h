@@ -0,0 +1,50 @@
+/*
+ * Wire.h file
+ * Host stand-in of the Arduino Wire library (TWI master). Transfers take the time of their bytes on the
+ * I2C bus (9 clocks per byte, address included) plus the start & stop conditions; the CPU waits meanwhile,
+ * like twi_writeTo() & twi_readFrom() do. Data of the devices is modelled by their stand-ins (PCF8575,
+ * SHTSensor), Wire itself reads 0xFF.
+ *
+ */
+
+#ifndef Wire_h
+#define Wire_h
+
+#include <Host.h>
+
+#define HOST_I2C_OVERHEAD_US 10             // Start & stop conditions, TWI setup
+#define WIRE_BUFFER_LENGTH 32
+
+class TwoWire {
+
+  public:
+    void begin()  {}
+    void setClock(uint32_t Clock)  { _Clock = Clock; }
+
+    void beginTransmission(uint8_t Address);
+    size_t write(uint8_t Value);
+    size_t write(const uint8_t *Data, size_t Length);
+    uint8_t endTransmission(bool Stop = true);
+
+    uint8_t requestFrom(uint8_t Address, uint8_t Quantity, bool Stop = true);
+    int available()  { return _Available; }
+    int read();
+
+    // Statistics
+    uint32_t Transfers = 0;
+    HostStats Busy;                         // Duration of transfers
+
+  private:
+    void Transfer(uint8_t Bytes);
+
+    uint32_t _Clock = 100000;
+    uint8_t _Length = 0;
+    uint8_t _Available = 0;
+};
+
+extern TwoWire Wire;
+
+#endif
+/*
+   EOF
+*/
@@ -0,0 +1,114 @@
+#!/usr/bin/env python3
+#
+# prepare.py file
+# Turns a sketch into a C++ translation unit for the host builds, like the Arduino builder does:
+# copies the sketch directory, selects the configuration (comments in / out #define lines of its headers, sets
+# values of others), adds prototypes of all functions before the first one and includes the HAL. Functions listed by --trace
+# get HOST_TRACE() at their top, so their virtual time is measured (see hal/Host.h); static member functions defined
+# in a class of the sketch are traced too, they get no prototype.
+#
+# prepare.py <sketch dir> <output dir> [--select NAME] [--unselect NAME] [--set NAME=VALUE] [--trace Function]
+#
+
+import argparse
+import os
+import re
+
+FUNCTION = re.compile(r'^([A-Za-z_][\w\s\*&<>:]*?[\s\*&])([A-Za-z_]\w*)\s*\(([^;{]*)\)\s*\{')
+MEMBER = re.compile(r'^\s+static\s+([\w\s\*&<>:]*?[\s\*&])([A-Za-z_]\w*)\s*\(([^;{]*)\)\s*\{')
+NOT_FUNCTION = ('else', 'if', 'for', 'while', 'switch', 'return', 'struct', 'class', 'template', 'typedef')
+
+
+def configure(text, select, unselect, values, found):
+    # Unselected first, so a default can be unselected & another one selected
+    for name in unselect:
+        text = re.sub(r'^(\s*)(#define\s+%s\b)' % name, r'\1//\2', text, flags=re.M)
+    for name in select:
+        text = re.sub(r'^(\s*)//\s*(#define\s+%s\b)' % name, r'\1\2', text, flags=re.M)
+    for name, value in values.items():
+        text, count = re.subn(r'^(\s*#define\s+%s\s+)\S+' % name, lambda m: m.group(1) + value, text, flags=re.M)
+        if count:
+            found.add(name)
+    return text
+
+
+def prepare(source, path, trace):
+    lines = source.split('\n')
+    prototypes = []
+    first = None
+    traced = {}
+
+    for i, line in enumerate(lines):
+        m = MEMBER.match(line)
+        if m and m.group(2) in trace:
+            traced[i] = m.group(2)
+            continue
+        m = FUNCTION.match(line)
+        if not m or m.group(1).split()[0] in NOT_FUNCTION or m.group(2) == 'ISR':
+            continue
+        arguments = re.sub(r'\s*=\s*[^,]+', '', m.group(3))
+        prototypes.append('%s%s(%s);' % (m.group(1), m.group(2), arguments))
+        if first is None:
+            first = i
+        if m.group(2) in trace:
+            traced[i] = m.group(2)
+
+    missing = set(trace) - set(traced.values())
+    if missing:
+        raise SystemExit('prepare.py: traced functions not found: %s' % ', '.join(sorted(missing)))
+
+    out = ['#include <Host.h>', '#line 1 "%s"' % path]
+    for i, line in enumerate(lines):
+        if i == first:
+            out += prototypes + ['#line %d "%s"' % (i + 1, path)]
+        out.append(line)
+        if i in traced:
+            out += ['HOST_TRACE(%s);' % traced[i], '#line %d "%s"' % (i + 2, path)]
+    out.append('#include <HostSketch.h>')
+
+    return '\n'.join(out) + '\n'
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument('sketch')
+    parser.add_argument('output')
+    parser.add_argument('--select', action='append', default=[])
+    parser.add_argument('--unselect', action='append', default=[])
+    parser.add_argument('--set', action='append', default=[], metavar='NAME=VALUE')
+    parser.add_argument('--trace', action='append', default=[])
+    args = parser.parse_args()
+
+    values = dict(item.split('=', 1) for item in args.set)
+    found = set()
+
+    os.makedirs(args.output, exist_ok=True)
+
+    for name in sorted(os.listdir(args.sketch)):
+        path = os.path.join(args.sketch, name)
+        if not os.path.isfile(path) or not name.endswith(('.ino', '.h', '.cpp')):
+            continue
+
+        with open(path) as f:
+            text = configure(f.read(), args.select, args.unselect, values, found)
+
+        if name.endswith('.ino'):
+            text = prepare(text, os.path.abspath(path), args.trace)
+            name = name[:-4] + '.cpp'
+
+        target = os.path.join(args.output, name)
+        # Unchanged files keep their time stamps, so they aren't rebuilt
+        if os.path.exists(target):
+            with open(target) as f:
+                if f.read() == text:
+                    continue
+        with open(target, 'w') as f:
+            f.write(text)
+
+    missing = set(values) - found
+    if missing:
+        raise SystemExit('prepare.py: defines to set not found: %s' % ', '.join(sorted(missing)))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,421 @@
+/*
+ * BusSim.cpp file
+ * Multi-node RS485 simulator: host builds of the Modules, Touch, 8RelayDin & Heating Controller sketches
+ * share one bus with the gateway & controller stand-in, each node on its own virtual clock (see SimBus.h).
+ * Every node is a copy of the module of its sketch (see HostNode.h), powered on at a random moment of the
+ * first second. Modules & Touch nodes are the thermometers of the heating sections (node IDs of
+ * SECTION_SENSORS) and report to the Heating Controller (node 1) through the gateway; the controller
+ * sends commands to every node in turns.
+ *
+ * Reports frames per second (mean & busiest second), bus load, collisions, back-offs, refused & repeated
+ * frames, boot-to-READY times, input to controller, command to output & node to node latencies and the
+ * C_REQ round trip.
+ *
+ * bus_sim [--modules N] [--touch N] [--relay8 N] [--heating N] [--minutes N] [--check] [--log]
+ *   --check  exits with 1 unless every node sent READY & the manifest, no watchdog fired, commands were
+ *            executed & thermometer readings reached the Heating Controller
+ *   --log    prints every frame
+ *
+ */
+
+#include <HostController.h>
+#include <HostNode.h>
+#include "SimBus.h"
+#include <cstdio>
+#include <cstring>
+#include <dlfcn.h>
+#include <unistd.h>
+
+#define SIM_START (40 * HOST_S)             // Stimuli & commands start after the startup of all nodes
+#define SIM_COMMAND_PERIOD (2 * HOST_S)     // A command to one of the nodes
+#define SIM_STIMULUS_AGE HOST_S             // Reactions later than that aren't attributed to a stimulus
+#define SIM_REPEAT_AGE HOST_S               // Identical frames of a node within that are repeats
+#define SIM_RELAY_AGE (5 * HOST_S)          // Node to node frames not forwarded within that were lost
+#define SIM_HEATING_ID 1                    // MY_HEATING_CONTROLLER of the thermometers
+
+static const uint8_t SectionSensors[] = {31, 35, 37, 38, 40, 51, 52, 53};   // SECTION_SENSORS of the Heating Controller
+
+struct SimType {
+  const char *Option;
+  const char *Path;                         // Module of the sketch
+  uint8_t Count;
+  HostStats Ready;                          // Power on to READY
+  HostStats Input;                          // Input change to message received by the controller
+  HostStats Command;                        // End of the command frame to output change
+};
+
+struct SimNode {
+  HostNode *Node;
+  SimType *Type;
+  uint8_t Id;
+  HostTime PowerOn;
+  HostTime Reset = 0;                       // Watchdog reset
+  HostTime Ready = 0;                       // READY received
+  bool Manifest = false;
+  bool ReadySent = false;                   // Sent by the node, maybe refused or corrupted by a collision
+  bool ManifestSent = false;
+  HostTime InputHandled = 0;
+  HostTime CommandAt = 0;                   // End of the last command frame
+  HostTime CommandHandled = 0;
+  MyMessage Last;                           // Last frame of the node
+  HostTime LastTime = 0;
+  uint32_t Repeats = 0;
+};
+
+static SimType Types[] = {
+  {"--heating", SIM_HEATING_NODE, 1, {}, {}, {}},
+  {"--modules", SIM_MODULES_NODE, 4, {}, {}, {}},
+  {"--touch", SIM_TOUCH_NODE, 2, {}, {}, {}},
+  {"--relay8", SIM_RELAY8_NODE, 2, {}, {}, {}},
+};
+
+static SimBus Bus(57600, 3);                // MY_RS485_BAUD_RATE & MY_RS485_SOH_COUNT of all sketches
+static HostController Gateway;
+static std::vector<std::unique_ptr<SimNode>> Nodes;
+static SimNode *ById[256];
+static HostStats NodeToNode;                // Start of the frame of the sender to the end of the frame forwarded by the gateway
+static std::vector<uint32_t> PerSecond;     // Frames ending in every second
+
+/**
+ * @brief Loads a private copy of the module of a sketch
+ *
+ */
+static HostNode *Load(const char *Path, uint32_t Index)  {
+  char Copy[64];
+
+  snprintf(Copy, sizeof(Copy), "/tmp/bus_sim_%d_%u.so", (int)getpid(), Index);
+
+  FILE *In = fopen(Path, "rb");
+  FILE *Out = fopen(Copy, "wb");
+  char Buffer[65536];
+  size_t Length;
+
+  if(In == nullptr || Out == nullptr) {
+    fprintf(stderr, "Can't copy %s to %s\n", Path, Copy);
+    exit(2);
+  }
+  while((Length = fread(Buffer, 1, sizeof(Buffer), In)) > 0) fwrite(Buffer, 1, Length, Out);
+  fclose(In);
+  fclose(Out);
+
+  void *Module = dlopen(Copy, RTLD_NOW | RTLD_LOCAL);
+  unlink(Copy);
+
+  if(Module == nullptr) {
+    fprintf(stderr, "%s\n", dlerror());
+    exit(2);
+  }
+
+  auto Entry = (HostNode *(*)())dlsym(Module, "HostNodeEntry");
+
+  return Entry();
+}
+
+static uint8_t NextFreeId(uint8_t From)  {
+  while(ById[From] != nullptr || memchr(SectionSensors, From, sizeof(SectionSensors)) || From == SIM_HEATING_ID)  From++;
+
+  return From;
+}
+
+static void Create(uint32_t Seed)  {
+  uint8_t Section = 0;
+  uint8_t Free = 2;
+
+  for(SimType &Type : Types)  {
+    bool Heating = &Type == &Types[0];
+    bool Thermometer = &Type == &Types[1] || &Type == &Types[2];
+
+    for(uint8_t i=0; i<Type.Count; i++) {
+      std::unique_ptr<SimNode> N(new SimNode);
+
+      Seed = Seed * 1103515245UL + 12345;
+
+      N->Node = Load(Type.Path, Nodes.size());
+      N->Type = &Type;
+      if(Heating && i == 0) {
+        N->Id = SIM_HEATING_ID;
+      }
+      else if(Thermometer && Section < sizeof(SectionSensors)) {
+        N->Id = SectionSensors[Section++];
+      }
+      else  {
+        N->Id = Free = NextFreeId(Free);
+      }
+      N->PowerOn = Seed % HOST_S;
+
+      HostMcu &Mcu = *N->Node->Mcu;
+
+      Mcu.Eeprom[0] = N->Id;                // EEPROM_NODE_ID_ADDRESS
+      Mcu.PowerOn(N->PowerOn);
+      Mcu.SetSeed(Seed);
+      N->Node->Stimuli(SIM_START, Seed);
+
+      for(uint8_t k=0; k<N->Node->KnownCount; k++)  {
+        const HostCommand &C = N->Node->Known[k];
+        Gateway.Set(N->Id, C.Sensor, C.Type, C.Value);
+      }
+
+      ById[N->Id] = N.get();
+      Nodes.push_back(std::move(N));
+    }
+  }
+}
+
+/**
+ * @brief A command every SIM_COMMAND_PERIOD, nodes in turns, each node cycling through its commands
+ *
+ */
+static void Commands(HostTime End)  {
+  uint32_t k = 0;
+
+  if(Nodes.empty()) return;
+
+  for(HostTime At = SIM_START; At < End; At += SIM_COMMAND_PERIOD, k++) {
+    SimNode &N = *Nodes[k % Nodes.size()];
+    uint32_t Turn = k / Nodes.size();
+
+    if(N.Node->CommandCount == 0) continue;
+
+    const HostCommand &C = N.Node->Commands[Turn % N.Node->CommandCount];
+    Gateway.Command(At, N.Id, C.Sensor, C.Type, C.Value);
+  }
+}
+
+static SimNode *Sender(const HostFrame &Frame)  {
+  for(auto &N : Nodes)  {
+    if(&N->Node->Mcu->Port == Frame.Sender) return N.get();
+  }
+
+  return nullptr;
+}
+
+static bool Same(const MyMessage &a, const MyMessage &b)  {
+  return a.sender == b.sender && a.destination == b.destination && a.getCommand() == b.getCommand() && a.type == b.type &&
+         a.sensor == b.sensor && a.getLength() == b.getLength() && !memcmp(a.data, b.data, a.getLength());
+}
+
+static void Observe(bool Logging)  {
+  struct Relayed {
+    uint8_t From;
+    uint8_t To;
+    HostTime Start;
+  };
+  static std::deque<Relayed> Relaying;       // Node to node frames received by the gateway, not forwarded yet
+
+  Bus.OnFrame = [Logging](const HostFrame &Frame) {
+    if(Logging) {
+      char Text[2 * MAX_PAYLOAD_SIZE + 1];
+
+      printf("%10.3f %3u -> %3u  %u %3u %3u %-3u %s%s\n", Frame.End / 1e6, Frame.Msg.sender, Frame.Msg.destination, Frame.Msg.getCommand(),
+             Frame.Msg.type, Frame.Msg.sensor, Frame.Msg.getLength(), Frame.Msg.getString(Text), Frame.Corrupt ? " CORRUPT" : "");
+    }
+
+    uint32_t Second = Frame.End / HOST_S;
+
+    if(PerSecond.size() <= Second)  PerSecond.resize(Second + 1);
+    PerSecond[Second]++;
+
+    const MyMessage &Msg = Frame.Msg;
+    bool Routed = Msg.destination != GATEWAY_ADDRESS && Msg.destination != BROADCAST_ADDRESS;
+
+    if(Frame.Sender == &Gateway)  {
+      if(Frame.Corrupt) return;
+
+      if(Msg.sender == GATEWAY_ADDRESS && Msg.getCommand() == C_SET && ById[Msg.destination] != nullptr) {
+        // A command repeating the state last reported by the node doesn't change an output
+        char Text[2 * MAX_PAYLOAD_SIZE + 1];
+        const char *Known = Gateway.Value(Msg.destination, Msg.sensor, Msg.type);
+
+        if(Known == nullptr || strcmp(Known, Msg.getString(Text))) ById[Msg.destination]->CommandAt = Frame.End;
+      }
+      else if(Msg.sender != GATEWAY_ADDRESS && Routed)  {
+        // Forwarded: matches the oldest frame of the sender to the same node
+        for(auto R = Relaying.begin(); R != Relaying.end(); ++R)  {
+          if(R->From == Msg.sender && R->To == Msg.destination)  {
+            NodeToNode.Add(Frame.End - R->Start);
+            Relaying.erase(R);
+            break;
+          }
+        }
+      }
+      return;
+    }
+
+    SimNode *N = Sender(Frame);
+
+    if(N == nullptr)  return;
+    if(N->LastTime && Frame.End - N->LastTime <= SIM_REPEAT_AGE && Same(Msg, N->Last)) N->Repeats++;
+    N->Last = Msg;
+    N->LastTime = Frame.End;
+
+    if(!Frame.Corrupt && Routed && Frame.To == GATEWAY_ADDRESS) {
+      while(!Relaying.empty() && Frame.Start > Relaying.front().Start + SIM_RELAY_AGE) Relaying.pop_front();
+      Relaying.push_back({Msg.sender, Msg.destination, Frame.Start});
+    }
+  };
+
+  Gateway.OnMessage = [](const MyMessage &Msg, HostTime Time) {
+    SimNode *N = ById[Msg.sender];
+
+    if(N == nullptr || Msg.getCommand() != C_SET) return;
+
+    if(Msg.sensor == N->Node->ReadySensor && Msg.type == V_VAR1 && !N->Ready)  {
+      N->Ready = Time;
+      N->Type->Ready.Add(Time - N->PowerOn);
+    }
+    if(Msg.sensor == N->Node->ReadySensor && Msg.type == V_VAR2)  N->Manifest = true;
+
+    if(Msg.type == V_STATUS)  {
+      HostTime Input = N->Node->LastInput(Time);
+
+      if(Input > N->InputHandled && Time - Input <= SIM_STIMULUS_AGE) {
+        N->InputHandled = Input;
+        N->Type->Input.Add(Time - Input);
+      }
+    }
+  };
+}
+
+/**
+ * @brief Hooks of the nodes: startup messages sent; output change, attributed to the last command not handled yet
+ *
+ */
+static void Outputs()  {
+  for(auto &Ptr : Nodes)  {
+    SimNode *N = Ptr.get();
+
+    N->Node->Mcu->Port.OnSend = [N](const MyMessage &Msg, bool Sent) {
+      (void)Sent;
+      if(Msg.getCommand() == C_SET && Msg.sensor == N->Node->ReadySensor)  {
+        if(Msg.type == V_VAR1)  N->ReadySent = true;
+        if(Msg.type == V_VAR2)  N->ManifestSent = true;
+      }
+    };
+
+    N->Node->OnOutput = [N](HostTime Time) {
+      if(N->CommandAt > N->CommandHandled && Time >= N->CommandAt && Time - N->CommandAt <= SIM_STIMULUS_AGE) {
+        N->Type->Command.Add(Time - N->CommandAt);
+        N->CommandHandled = N->CommandAt;
+      }
+    };
+  }
+}
+
+int main(int argc, char *argv[])  {
+  double Minutes = 2;
+  uint32_t Seed = 1;
+  bool Check = false;
+  bool Logging = false;
+
+  for(int i=1; i<argc; i++)  {
+    bool Known = false;
+
+    for(SimType &Type : Types)  {
+      if(!strcmp(argv[i], Type.Option) && i + 1 < argc)  {
+        Type.Count = atoi(argv[++i]);
+        Known = true;
+      }
+    }
+    if(Known) continue;
+
+    if(!strcmp(argv[i], "--minutes") && i + 1 < argc)  Minutes = atof(argv[++i]);
+    else if(!strcmp(argv[i], "--seed") && i + 1 < argc)  Seed = strtoul(argv[++i], nullptr, 0);
+    else if(!strcmp(argv[i], "--check"))  Check = true;
+    else if(!strcmp(argv[i], "--log")) Logging = true;
+  }
+
+  HostTime End = (HostTime)(Minutes * 60 * HOST_S);
+
+  Bus.Attach(Gateway);
+  Create(Seed);
+  Observe(Logging);
+  Outputs();
+  Commands(End);
+
+  for(auto &Ptr : Nodes)  {
+    SimNode *N = Ptr.get();
+    Bus.AddNode(N->Node->Mcu->Port, N->PowerOn, [N, End]() { N->Reset = N->Node->Run(End); });
+  }
+
+  Bus.Run();
+
+  // Summary
+  uint32_t Peak = 0;
+  uint32_t Repeats = 0;
+  uint32_t Refused = 0;
+  uint32_t Backoffs = 0;
+  uint32_t ReadyLost = 0;
+  uint32_t ManifestLost = 0;
+
+  for(uint32_t Second=0; Second<PerSecond.size() && Second<End/HOST_S; Second++) Peak = max(Peak, PerSecond[Second]);
+
+  printf("Bus simulator: %u nodes, %.0f s, seed %u\n", (unsigned)Nodes.size(), End / 1e6, Seed);
+  printf("\n%-5s %-10s %8s %8s %8s %8s %8s %8s %10s %10s %10s\n", "node", "sketch", "sent", "backoffs", "refused", "collided", "repeats",
+         "RX lost", "READY ms", "loop p99", "loop max");
+
+  for(auto &N : Nodes)  {
+    HostMcu &Mcu = *N->Node->Mcu;
+
+    printf("%-5u %-10s %8u %8u %8u %8u %8u %8u %10.1f %10llu %10llu%s\n", N->Id, N->Node->Type, Mcu.Port.Sent, Mcu.Port.Backoffs, Mcu.Port.Refused,
+           Mcu.Port.Collided, N->Repeats, Mcu.RxDropped, N->Ready ? (N->Ready - N->PowerOn) / 1e3 : 0.0,
+           (unsigned long long)Mcu.Passes.Percentile(99), (unsigned long long)Mcu.Passes.Max(), N->Reset ? "  WATCHDOG" : "");
+    Repeats += N->Repeats;
+    Refused += Mcu.Port.Refused;
+    Backoffs += Mcu.Port.Backoffs;
+    ReadyLost += N->ReadySent && !N->Ready;
+    ManifestLost += N->ManifestSent && !N->Manifest;
+  }
+
+  printf("\nFrames                 %10u, %.1f fps mean, %u fps in the busiest second\n", Bus.Frames, Bus.Frames * 1e6 / End, Peak);
+  printf("Bus load               %10.2f %%\n", 100.0 * Bus.Occupied / End);
+  printf("Collisions             %10u frames corrupted, %u back-offs, %u refused (bus busy), %u repeats\n", Bus.Collisions, Backoffs,
+         Refused, Repeats);
+  printf("Lost startup messages  %10u READY, %u manifests\n", ReadyLost, ManifestLost);
+  printf("Gateway                %10u deferred, %u lost, %u received by controller\n", Gateway.Deferred, Gateway.Refused, Gateway.Received);
+  printf("Coroutine switches     %10u\n\n", Bus.Switches);
+
+  HostStats::PrintHeader();
+  for(SimType &Type : Types)  {
+    if(Type.Count == 0) continue;
+
+    char Name[32];
+    const char *Sketch = Type.Option + 2;
+
+    snprintf(Name, sizeof(Name), "%s READY", Sketch);
+    Type.Ready.Print(Name, false);
+    snprintf(Name, sizeof(Name), "%s input -> ctrl", Sketch);
+    Type.Input.Print(Name, false);
+    snprintf(Name, sizeof(Name), "%s command -> out", Sketch);
+    Type.Command.Print(Name, false);
+  }
+  NodeToNode.Print("node -> node", false);
+  Gateway.Replies.Print("C_REQ round trip", false);
+
+  if(!Check)  return 0;
+
+  bool Ok = true;
+
+  for(auto &N : Nodes)  {
+    // A READY or manifest refused or corrupted by a collision is a bus statistic, not a failure of the node
+    if(N->Reset || !N->ReadySent || !N->ManifestSent) {
+      printf("FAILED: node %u%s%s%s\n", N->Id, N->Reset ? " watchdog" : "", N->ReadySent ? "" : " no READY",
+             N->ManifestSent ? "" : " no manifest");
+      Ok = false;
+    }
+  }
+  for(SimType &Type : Types)  {
+    if(Type.Count > 0 && Type.Command.Count() == 0) {
+      printf("FAILED: %s commands not executed\n", Type.Option + 2);
+      Ok = false;
+    }
+  }
+  if(Types[0].Count > 0 && Types[1].Count + Types[2].Count > 0 && NodeToNode.Count() == 0) {
+    printf("FAILED: no temperature forwarded to the heating controller\n");
+    Ok = false;
+  }
+
+  return Ok ? 0 : 1;
+}
+/*
+   EOF
+*/
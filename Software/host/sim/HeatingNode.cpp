@@ -0,0 +1,54 @@
+/*
+ * HeatingNode.cpp file
+ * Bus simulator adapter of the Heating Controller sketch (expander shield, 8 sections): the sections are
+ * switched by the temperatures reported by the thermometer nodes; the controller turns the heating on in
+ * day mode & moves the set points of two sections.
+ *
+ */
+
+#include <HostNode.h>
+#include <PCF8575.h>
+#include "Configuration.h"                  // Of the prepared sketch
+
+static HostNode Node;
+
+static const HostCommand Commands[] = {
+  {SELECTOR_SWITCH_ID, V_STATUS, "1"}, {SELECTOR_SWITCH_ID, V_PERCENTAGE, "10"},
+  {FIRST_SECTION_ID, V_HVAC_SETPOINT_HEAT, "21"}, {FIRST_SECTION_ID + 1, V_HVAC_SETPOINT_HEAT, "19.5"},
+  {FIRST_SECTION_ID, V_HVAC_SETPOINT_HEAT, "20"}, {FIRST_SECTION_ID + 1, V_HVAC_SETPOINT_HEAT, "20"},
+};
+
+static void Stimuli(HostTime First, uint32_t Seed)  {
+  (void)First;
+  (void)Seed;
+
+  PCF8575::OnWrite = [](uint8_t Address, uint16_t Value, HostTime Now) {
+    (void)Address;
+    (void)Value;
+    if(Node.OnOutput) Node.OnOutput(Now);
+  };
+}
+
+static HostTime LastInput(HostTime Now)  {
+  (void)Now;
+  return 0;
+}
+
+extern "C" HostNode *HostNodeEntry()  {
+  Node.Type = "Heating";
+  Node.Mcu = &Mcu;
+  Node.Traces = &HostTraces();
+  Node.ReadySensor = NODE_SENSOR_ID;
+  Node.Known = nullptr;
+  Node.KnownCount = 0;
+  Node.Commands = Commands;
+  Node.CommandCount = sizeof(Commands) / sizeof(Commands[0]);
+  Node.Stimuli = Stimuli;
+  Node.LastInput = LastInput;
+  Node.Run = HostNodeRun;
+
+  return &Node;
+}
+/*
+   EOF
+*/
@@ -0,0 +1,92 @@
+/*
+ * ModulesNode.cpp file
+ * Bus simulator adapter of the Modules sketch (DoubleRelayProfile, SHT30 reporting to the heating controller):
+ * two buttons, four inputs, the load current of the relays, the board & room thermometers; the controller
+ * toggles the relays.
+ *
+ */
+
+#include <HostNode.h>
+#include <SHTSensor.h>
+#include <GoWired.h>
+#include "Configuration.h"                  // Of the prepared sketch
+#include "NodeProfile.h"
+#include "Stimuli.h"
+
+typedef MODULE_PROFILE ModuleProfile;
+typedef ModuleProfile::Output Relays;
+typedef ModuleProfile::Buttons Buttons;
+typedef ModuleProfile::Inputs Inputs;
+
+static_assert(Relays::Type == S_BINARY && Relays::Count == 2 && Buttons::Count == 2 && Inputs::Count == 4, "Adapter of the 2SSR relays");
+
+static HostNode Node;
+static HostTime Start;
+static HostTime Periods[6];                 // Buttons 1-2, inputs 1-4
+
+static const HostCommand Known[] = {
+  {0, V_STATUS, "0"}, {1, V_STATUS, "0"},
+};
+
+static const HostCommand Commands[] = {
+  {0, V_STATUS, "1"}, {1, V_STATUS, "1"}, {0, V_STATUS, "0"}, {1, V_STATUS, "0"},
+};
+
+static void Stimuli(HostTime First, uint32_t Seed)  {
+  Start = First;
+  for(uint8_t i=0; i<6; i++) Periods[i] = (7 + i) * HOST_S + (Seed >> (4 * i)) % 1000 * HOST_MS;
+
+  Mcu.SetNoise(2);
+  Mcu.SetDigital(Buttons::Pin(0), [](HostTime Now) { return !SimPulse(Now, Start, Periods[0]); });
+  Mcu.SetDigital(Buttons::Pin(1), [](HostTime Now) { return !SimPulse(Now, Start, Periods[1]); });
+  Mcu.SetDigital(Inputs::Pin(0), [](HostTime Now) { return SimToggle(Now, Start, Periods[2]); });
+  Mcu.SetDigital(Inputs::Pin(1), [](HostTime Now) { return SimToggle(Now, Start, Periods[3]); });
+  Mcu.SetDigital(Inputs::Pin(2), [](HostTime Now) { return SimToggle(Now, Start, Periods[4]); });
+  Mcu.SetDigital(Inputs::Pin(3), [](HostTime Now) { return SimToggle(Now, Start, Periods[5]); });
+
+  Mcu.SetAnalog(ModuleProfile::PowerSensors::Pin(0), [](HostTime Now) {
+    bool On = Mcu.Output(Relays::Pin(0)) == RELAY_ON || Mcu.Output(Relays::Pin(1)) == RELAY_ON;
+    return SimAcSensor(Now, On ? SIM_LOAD_MA : 0, MVPERAMP);
+  });
+  Mcu.SetAnalog(ModuleProfile::ThermometerPin, [](HostTime Now) { (void)Now; return (double)ZEROVOLTAGE + MVPERC * 35; });
+
+  static double Phase = Seed % 1000 / 1000.0;
+
+  SHTSensor::Sample = [](HostTime Now, float &Temperature, float &Humidity) {
+    Temperature = SimRoom(Now, Phase);
+    Humidity = 45;
+    return true;
+  };
+
+  Mcu.OnOutput = [](uint8_t Pin, uint8_t Value, HostTime Now) {
+    (void)Value;
+    if((Pin == Relays::Pin(0) || Pin == Relays::Pin(1)) && Node.OnOutput) Node.OnOutput(Now);
+  };
+}
+
+static HostTime LastInput(HostTime Now)  {
+  HostTime Last = max(SimPulseEnd(Now, Start, Periods[0]), SimPulseEnd(Now, Start, Periods[1]));
+
+  for(uint8_t i=2; i<6; i++) Last = max(Last, SimToggleEdge(Now, Start, Periods[i]));
+
+  return Last;
+}
+
+extern "C" HostNode *HostNodeEntry()  {
+  Node.Type = "Modules";
+  Node.Mcu = &Mcu;
+  Node.Traces = &HostTraces();
+  Node.ReadySensor = CONFIGURATION_SENSOR_ID;
+  Node.Known = Known;
+  Node.KnownCount = sizeof(Known) / sizeof(Known[0]);
+  Node.Commands = Commands;
+  Node.CommandCount = sizeof(Commands) / sizeof(Commands[0]);
+  Node.Stimuli = Stimuli;
+  Node.LastInput = LastInput;
+  Node.Run = HostNodeRun;
+
+  return &Node;
+}
+/*
+   EOF
+*/
@@ -0,0 +1,78 @@
+/*
+ * Relay8Node.cpp file
+ * Bus simulator adapter of the 8RelayDin Shield sketch: four independent inputs & four buttons on the
+ * expander; the controller toggles the independent relays.
+ *
+ */
+
+#include <HostNode.h>
+#include <PCF8575.h>
+#include "Configuration.h"                  // Of the prepared sketch
+#include "Stimuli.h"
+
+static HostNode Node;
+static HostTime Start;
+static HostTime Periods[8];                 // Expander pins 8-15: inputs, then buttons
+
+static const HostCommand Known[] = {
+  {0, V_STATUS, "0"}, {1, V_STATUS, "0"}, {2, V_STATUS, "0"}, {3, V_STATUS, "0"},
+  {4, V_STATUS, "0"}, {5, V_STATUS, "0"}, {6, V_STATUS, "0"}, {7, V_STATUS, "0"},
+};
+
+static const HostCommand Commands[] = {
+  {0, V_STATUS, "1"}, {1, V_STATUS, "1"}, {2, V_STATUS, "1"}, {3, V_STATUS, "1"},
+  {0, V_STATUS, "0"}, {1, V_STATUS, "0"}, {2, V_STATUS, "0"}, {3, V_STATUS, "0"},
+};
+
+static void Stimuli(HostTime First, uint32_t Seed)  {
+  Start = First;
+  for(uint8_t i=0; i<8; i++) Periods[i] = (9 + i) * HOST_S + (Seed >> (3 * i)) % 1000 * HOST_MS;
+
+  PCF8575::Inputs = [](uint8_t Address, HostTime Now) {
+    (void)Address;
+    uint16_t Pins = 0xFFFF;
+
+    for(uint8_t i=0; i<INDEPENDENT_IO; i++) {
+      if(SimToggle(Now, Start, Periods[i])) Pins &= ~(1 << (TOTAL_NUMBER_OF_OUTPUTS + i));
+      if(SimPulse(Now, Start, Periods[INDEPENDENT_IO + i])) Pins &= ~(1 << (TOTAL_NUMBER_OF_OUTPUTS + INDEPENDENT_IO + i));
+    }
+
+    return Pins;
+  };
+
+  PCF8575::OnWrite = [](uint8_t Address, uint16_t Value, HostTime Now) {
+    (void)Address;
+    (void)Value;
+    if(Node.OnOutput) Node.OnOutput(Now);
+  };
+}
+
+static HostTime LastInput(HostTime Now)  {
+  HostTime Last = 0;
+
+  for(uint8_t i=0; i<INDEPENDENT_IO; i++) {
+    Last = max(Last, SimToggleEdge(Now, Start, Periods[i]));
+    Last = max(Last, SimPulseEnd(Now, Start, Periods[INDEPENDENT_IO + i]));
+  }
+
+  return Last;
+}
+
+extern "C" HostNode *HostNodeEntry()  {
+  Node.Type = "8RelayDin";
+  Node.Mcu = &Mcu;
+  Node.Traces = &HostTraces();
+  Node.ReadySensor = NODE_SENSOR_ID;
+  Node.Known = Known;
+  Node.KnownCount = sizeof(Known) / sizeof(Known[0]);
+  Node.Commands = Commands;
+  Node.CommandCount = sizeof(Commands) / sizeof(Commands[0]);
+  Node.Stimuli = Stimuli;
+  Node.LastInput = LastInput;
+  Node.Run = HostNodeRun;
+
+  return &Node;
+}
+/*
+   EOF
+*/
@@ -0,0 +1,151 @@
+/*
+ * SimBus.cpp file
+ * Bus of the multi-node simulator, see SimBus.h
+ *
+ */
+
+#include "SimBus.h"
+
+SimBus *SimBus::_Running = nullptr;
+
+void SimBus::AddNode(HostEndpoint &Port, HostTime PowerOn, std::function<void()> Body)  {
+  std::unique_ptr<Node> N(new Node);
+
+  N->Port = &Port;
+  N->Body = Body;
+  N->ResumeAt = PowerOn;
+  N->Stack.reset(new char[SIM_STACK_SIZE]);
+
+  getcontext(&N->Context);
+  N->Context.uc_stack.ss_sp = N->Stack.get();
+  N->Context.uc_stack.ss_size = SIM_STACK_SIZE;
+  N->Context.uc_link = &_Scheduler;
+  makecontext(&N->Context, Entry, 0);
+
+  Attach(Port);
+  _Nodes.push_back(std::move(N));
+}
+
+void SimBus::Entry()  {
+  Node *N = _Running->_Current;
+
+  N->Body();
+  N->Done = true;
+  N->ResumeAt = HOST_NEVER;
+  // Returns to the scheduler (uc_link)
+}
+
+void SimBus::Run()  {
+  _Running = this;
+
+  for(;;) {
+    Node *Next = nullptr;
+
+    for(auto &N : _Nodes) {
+      if(!N->Done && (Next == nullptr || N->ResumeAt < Next->ResumeAt))  Next = N.get();
+    }
+    if(Next == nullptr) break;
+
+    // Bus events first on a tie: a node resumed at T finds frames ending at T delivered
+    HostTime T = NextEvent();
+
+    if(T <= Next->ResumeAt) {
+      Step(T);
+      continue;
+    }
+
+    _Current = Next;
+    Switches++;
+    swapcontext(&_Scheduler, &Next->Context);
+    _Current = nullptr;
+  }
+
+  _Running = nullptr;
+}
+
+void SimBus::Sync(HostTime Now)  {
+  if(_Current == nullptr) {
+    HostBus::Sync(Now);
+    return;
+  }
+
+  for(;;) {
+    HostTime T = NextEvent();
+    HostTime Tn = Others();
+
+    if(T <= Now && T <= Tn) {
+      Step(T);
+    }
+    else if(Tn < Now) {
+      Suspend(Now);
+    }
+    else  {
+      return;
+    }
+  }
+}
+
+HostTime SimBus::Wait(HostEndpoint &Self, HostTime From, HostTime To)  {
+  if(_Current == nullptr) return HostBus::Wait(Self, From, To);
+
+  Node *N = _Current;
+  HostTime Lookahead = HOST_DE_TURNAROUND + FrameTime(0);
+
+  N->Waiting = true;
+  N->Woken = false;
+
+  for(;;) {
+    if(N->Woken)  {
+      N->Waiting = false;
+      return N->WokenAt > From ? N->WokenAt : From;
+    }
+
+    HostTime T = NextEvent();
+    HostTime Tn = Others();
+
+    if(T <= To && T <= Tn)  {
+      Step(T);
+    }
+    else if(T > To && (Tn == HOST_NEVER || Tn + Lookahead > To)) {
+      // Nothing can reach this node before To
+      N->Waiting = false;
+      return To;
+    }
+    else  {
+      Suspend(To);
+    }
+  }
+}
+
+void SimBus::Delivered(HostEndpoint &E, HostTime Time)  {
+  for(auto &N : _Nodes) {
+    if(N->Port != &E) continue;
+
+    if(N->Waiting && !N->Woken)  {
+      N->Woken = true;
+      N->WokenAt = Time;
+      if(Time < N->ResumeAt)  N->ResumeAt = Time;
+    }
+    return;
+  }
+}
+
+void SimBus::Suspend(HostTime ResumeAt)  {
+  Node *N = _Current;
+
+  N->ResumeAt = ResumeAt;
+  swapcontext(&N->Context, &_Scheduler);
+}
+
+HostTime SimBus::Others() const  {
+  HostTime T = HOST_NEVER;
+
+  for(const auto &N : _Nodes) {
+    if(N.get() != _Current && !N->Done && N->ResumeAt < T) T = N->ResumeAt;
+  }
+
+  return T;
+}
+/*
+   EOF
+*/
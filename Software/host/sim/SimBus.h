@@ -0,0 +1,71 @@
+/*
+ * SimBus.h file
+ * Bus of the multi-node simulator: every node runs in a coroutine on its own virtual clock; the bus runs the
+ * node which is furthest behind & keeps the clocks consistent wherever a node touches the bus. A node
+ * senses or transmits at T only once all other nodes reached T, so it sees every frame started before T.
+ * A waiting node sleeps as long as no frame can end before its wake-up time: the earliest frame of a node
+ * at Tn ends at Tn + DE turnaround + frame without payload (lookahead).
+ *
+ */
+
+#ifndef SimBus_h
+#define SimBus_h
+
+#include <HostBus.h>
+#include <memory>
+#include <ucontext.h>
+
+#define SIM_STACK_SIZE (1 << 20)            // Coroutine stack of a node (bytes)
+
+class SimBus : public HostBus {
+
+  public:
+    SimBus(uint32_t Baud, uint8_t SohCount) : HostBus(Baud, SohCount) {}
+
+    /**
+     * @brief Attaches the port of a node; Body runs the node in its coroutine, starting at PowerOn
+     *
+     */
+    void AddNode(HostEndpoint &Port, HostTime PowerOn, std::function<void()> Body);
+
+    /**
+     * @brief Runs nodes & bus until all bodies returned
+     *
+     */
+    void Run();
+
+    void Sync(HostTime Now) override;
+    HostTime Wait(HostEndpoint &Self, HostTime From, HostTime To) override;
+
+    uint32_t Switches = 0;                  // Coroutine switches
+
+  protected:
+    void Delivered(HostEndpoint &E, HostTime Time) override;
+
+  private:
+    struct Node {
+      HostEndpoint *Port;
+      std::function<void()> Body;
+      ucontext_t Context;
+      std::unique_ptr<char[]> Stack;
+      HostTime ResumeAt;                    // Clock of the node when it's resumed
+      bool Waiting = false;                 // In Wait(), ends at the first frame delivered
+      bool Woken = false;
+      HostTime WokenAt = 0;
+      bool Done = false;
+    };
+
+    static void Entry();
+    void Suspend(HostTime ResumeAt);
+    HostTime Others() const;                // Earliest clock of the other nodes
+
+    std::vector<std::unique_ptr<Node>> _Nodes;
+    Node *_Current = nullptr;
+    ucontext_t _Scheduler;
+    static SimBus *_Running;
+};
+
+#endif
+/*
+   EOF
+*/
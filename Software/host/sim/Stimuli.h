@@ -0,0 +1,75 @@
+/*
+ * Stimuli.h file
+ * Periodic stimuli of the node adapters: presses (pulses), toggling inputs, load currents & temperatures
+ *
+ */
+
+#ifndef Stimuli_h
+#define Stimuli_h
+
+#include <Host.h>
+#include <cmath>
+
+#define SIM_PRESS (150 * HOST_MS)           // Short press of a button or touch field
+#define SIM_LOAD_MA 1500                    // RMS current of a load switched on (mA)
+
+/**
+ * @brief Pulse of Width every Period from Start: pressed button, touched field
+ *
+ */
+inline bool SimPulse(HostTime Now, HostTime Start, HostTime Period, HostTime Width = SIM_PRESS)  {
+  return Now >= Start && (Now - Start) % Period < Width;
+}
+
+/**
+ * @brief End of the last pulse until Now (button release); 0 if none
+ *
+ */
+inline HostTime SimPulseEnd(HostTime Now, HostTime Start, HostTime Period, HostTime Width = SIM_PRESS)  {
+  if(Now < Start + Width) return 0;
+
+  HostTime End = Now - (Now - Start) % Period + Width;
+
+  return End <= Now ? End : End - Period;
+}
+
+/**
+ * @brief Input level toggling every Period from Start
+ *
+ */
+inline bool SimToggle(HostTime Now, HostTime Start, HostTime Period)  {
+  return Now >= Start && (Now - Start) / Period % 2;
+}
+
+/**
+ * @brief Last change of a toggling input until Now; 0 if none
+ *
+ */
+inline HostTime SimToggleEdge(HostTime Now, HostTime Start, HostTime Period)  {
+  if(Now < Start + Period)  return 0;
+
+  return Now - (Now - Start) % Period;
+}
+
+/**
+ * @brief AC load current on a power sensor (ACS712): 50 Hz sine around Vcc / 2 (mV)
+ *
+ */
+inline double SimAcSensor(HostTime Now, uint16_t Current, double MvPerAmp)  {
+  double Peak = Current / 1000.0 * MvPerAmp * M_SQRT2;
+
+  return 2500 + Peak * sin(2 * M_PI * 50 * Now / 1e6);
+}
+
+/**
+ * @brief Room temperature (C) swinging by 1.5 C around 20 C, period 10 min; Phase in 0-1
+ *
+ */
+inline double SimRoom(HostTime Now, double Phase)  {
+  return 20 + 1.5 * sin(2 * M_PI * (Now / (600.0 * HOST_S) + Phase));
+}
+
+#endif
+/*
+   EOF
+*/
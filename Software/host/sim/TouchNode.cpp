@@ -0,0 +1,79 @@
+/*
+ * TouchNode.cpp file
+ * Bus simulator adapter of the Touch sketch on the 2Relay board (hardware detection pin at 0 V, DIP switches
+ * off: double switch) with SHT30 reporting to the heating controller: two touch fields, the load current of
+ * the relays & the room thermometer; the controller toggles the relays.
+ *
+ */
+
+#include <HostNode.h>
+#include <SHTSensor.h>
+#include "Configuration.h"                  // Of the prepared sketch
+#include "Stimuli.h"
+
+#define SIM_TOUCH_IDLE 1465                 // Touch field reading untouched (mV, ~300 LSB)
+#define SIM_TOUCH_DELTA 150                 // Touch adds ~30 LSB
+#define SIM_TOUCH_PRESS (400 * HOST_MS)     // A field is read every ~170 ms & DEBOUNCE_VALUE takes two readings: shorter taps are missed
+
+static HostNode Node;
+static HostTime Start;
+static HostTime Periods[2];                 // Touch fields 1-2
+
+static const HostCommand Known[] = {
+  {RELAY_ID_1, V_STATUS, "0"}, {RELAY_ID_2, V_STATUS, "0"},
+};
+
+static const HostCommand Commands[] = {
+  {RELAY_ID_1, V_STATUS, "1"}, {RELAY_ID_2, V_STATUS, "1"}, {RELAY_ID_1, V_STATUS, "0"}, {RELAY_ID_2, V_STATUS, "0"},
+};
+
+static void Stimuli(HostTime First, uint32_t Seed)  {
+  Start = First;
+  for(uint8_t i=0; i<2; i++) Periods[i] = (8 + 3 * i) * HOST_S + (Seed >> (4 * i)) % 1000 * HOST_MS;
+
+  Mcu.SetNoise(2);
+  Mcu.SetAnalog(TOUCH_FIELD_1, [](HostTime Now) { return SIM_TOUCH_IDLE + SimPulse(Now, Start, Periods[0], SIM_TOUCH_PRESS) * SIM_TOUCH_DELTA; });
+  Mcu.SetAnalog(TOUCH_FIELD_2, [](HostTime Now) { return SIM_TOUCH_IDLE + SimPulse(Now, Start, Periods[1], SIM_TOUCH_PRESS) * SIM_TOUCH_DELTA; });
+  Mcu.SetAnalog(TOUCH_FIELD_3, [](HostTime Now) { (void)Now; return (double)SIM_TOUCH_IDLE; });
+
+  Mcu.SetAnalog(PS_PIN, [](HostTime Now) {
+    bool On = Mcu.Output(RELAY_PIN_1) == RELAY_ON || Mcu.Output(RELAY_PIN_2) == RELAY_ON;
+    return SimAcSensor(Now, On ? SIM_LOAD_MA : 0, MVPERAMP);
+  });
+
+  static double Phase = Seed % 1000 / 1000.0;
+
+  SHTSensor::Sample = [](HostTime Now, float &Temperature, float &Humidity) {
+    Temperature = SimRoom(Now, Phase);
+    Humidity = 45;
+    return true;
+  };
+
+  Mcu.OnOutput = [](uint8_t Pin, uint8_t Value, HostTime Now) {
+    (void)Value;
+    if((Pin == RELAY_PIN_1 || Pin == RELAY_PIN_2) && Node.OnOutput) Node.OnOutput(Now);
+  };
+}
+
+static HostTime LastInput(HostTime Now)  {
+  return max(SimPulseEnd(Now, Start, Periods[0], SIM_TOUCH_PRESS), SimPulseEnd(Now, Start, Periods[1], SIM_TOUCH_PRESS));
+}
+
+extern "C" HostNode *HostNodeEntry()  {
+  Node.Type = "Touch";
+  Node.Mcu = &Mcu;
+  Node.Traces = &HostTraces();
+  Node.ReadySensor = CONFIGURATION_SENSOR_ID;
+  Node.Known = Known;
+  Node.KnownCount = sizeof(Known) / sizeof(Known[0]);
+  Node.Commands = Commands;
+  Node.CommandCount = sizeof(Commands) / sizeof(Commands[0]);
+  Node.Stimuli = Stimuli;
+  Node.LastInput = LastInput;
+  Node.Run = HostNodeRun;
+
+  return &Node;
+}
+/*
+   EOF
+*/
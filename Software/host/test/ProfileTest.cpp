@@ -0,0 +1,211 @@
+/*
+ * ProfileTest.cpp file
+ * Node profile test of one Modules board profile (see NodeProfile.h): checks the pin map of the profile
+ * (no pin used twice), boots the node and checks that the pins were set up as the profile says and that
+ * the sensor IDs, presentations & startup requests the controller got are the ones derived from it.
+ *
+ * profile_test_<profile>
+ *   exits with 1 & prints the differences if a check fails
+ *
+ */
+
+#include <Host.h>
+#include <HostController.h>
+#include <GoWired.h>
+#include "Configuration.h"                  // Of the prepared profile
+#include "NodeProfile.h"
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <set>
+#include <string>
+
+#define TEST_BOOT (30 * HOST_S)             // Presentation & startup synchronization are over by then
+#define TEST_NAME(Profile) #Profile
+#define TEST_PROFILE(Profile) TEST_NAME(Profile)
+
+typedef MODULE_PROFILE ModuleProfile;
+typedef ModuleProfile::Output Outputs;
+typedef ModuleProfile::Buttons Buttons;
+typedef ModuleProfile::Inputs Inputs;
+typedef ModuleProfile::PowerSensors PowerSensors;
+
+extern CommonIO CommonIO[];
+
+static HostBus Bus(HostSketch.BaudRate, HostSketch.SohCount);
+static HostController Gateway;
+
+struct TestSensor {
+  uint8_t Presentation;
+  std::string Name;
+};
+
+static std::map<uint8_t, TestSensor> Presented;
+static std::set<std::pair<uint8_t, uint8_t>> Requested;     // Sensor, type
+static uint32_t Failures = 0;
+
+static void Check(bool Ok, const char *Format, uint32_t Value = 0, uint32_t Expected = 0)  {
+  if(Ok)  return;
+
+  printf("FAILED: ");
+  printf(Format, Value, Expected);
+  printf("\n");
+  Failures++;
+}
+
+/**
+ * @brief Every pin of the profile once; the thermometer may be missing
+ *
+ */
+static void CheckPins()  {
+  std::set<uint8_t> Pins;
+  auto Use = [&Pins](uint8_t Pin, const char *What) {
+    Check(Pin != NO_PIN && Pins.insert(Pin).second, What, Pin);
+  };
+
+  for(uint8_t i=0; i<Outputs::Count; i++) Use(Outputs::Pin(i), "output pin %u used twice");
+  for(uint8_t i=0; i<Buttons::Count; i++) Use(Buttons::Pin(i), "button pin %u used twice");
+  for(uint8_t i=0; i<Inputs::Count; i++) Use(Inputs::Pin(i), "input pin %u used twice");
+  for(uint8_t i=0; i<PowerSensors::Count; i++) Use(PowerSensors::Pin(i), "power sensor pin %u used twice");
+  if(ModuleProfile::ThermometerPin != NO_PIN) Use(ModuleProfile::ThermometerPin, "thermometer pin %u used twice");
+}
+
+/**
+ * @brief Pin modes & CommonIO types set up by the sketch
+ *
+ */
+static void CheckSetup()  {
+  for(uint8_t i=0; i<Outputs::Count; i++) {
+    Check(Mcu.Mode(Outputs::Pin(i)) == OUTPUT, "output pin %u isn't an output", Outputs::Pin(i));
+  }
+  for(uint8_t i=0; i<Buttons::Count; i++) {
+    uint8_t Type = Outputs::Type == S_BINARY ? 4 : 3;
+
+    Check(Mcu.Mode(Buttons::Pin(i)) == INPUT_PULLUP, "button pin %u without pull-up", Buttons::Pin(i));
+    Check(CommonIO[i].SensorType == Type, "button CommonIO type %u, expected %u", CommonIO[i].SensorType, Type);
+  }
+  for(uint8_t i=Buttons::Count; i<ModuleProfile::FirstInputId; i++) {
+    Check(CommonIO[i].SensorType == 2, "relay CommonIO type %u, expected %u", CommonIO[i].SensorType, 2);
+  }
+  for(uint8_t i=0; i<Inputs::Count; i++) {
+    uint8_t Id = ModuleProfile::InputId(i);
+
+    Check(Mcu.Mode(Inputs::Pin(i)) == (Inputs::Pullup(i) ? INPUT_PULLUP : INPUT), "input pin %u mode", Inputs::Pin(i));
+    Check(CommonIO[Id].SensorType == (Inputs::Pullup(i) ? 0 : 1), "input CommonIO type %u, expected %u", CommonIO[Id].SensorType,
+          Inputs::Pullup(i) ? 0 : 1);
+  }
+}
+
+/**
+ * @brief A sensor presented once with its presentation & name
+ *
+ */
+static void Expect(uint8_t Id, uint8_t Presentation, const std::string &Name)  {
+  auto Sensor = Presented.find(Id);
+
+  if(Sensor == Presented.end()) {
+    Check(false, "sensor %u not presented", Id);
+    return;
+  }
+  Check(Sensor->second.Presentation == Presentation, "sensor presented as %u, expected %u", Sensor->second.Presentation, Presentation);
+  Check(Sensor->second.Name == Name, "sensor %u name", Id);
+  Presented.erase(Sensor);
+}
+
+static void ExpectRequest(uint8_t Id, uint8_t Type)  {
+  Check(Requested.erase({Id, Type}) == 1, "value of sensor %u, type %u not requested", Id, Type);
+}
+
+/**
+ * @brief Presentations & startup requests derived from the profile
+ *
+ */
+static void CheckSensors()  {
+  char Name[32];
+
+  if(Outputs::Type == S_BINARY) {
+    for(uint8_t i=0; i<Outputs::Count; i++) {
+      snprintf(Name, sizeof(Name), "Relay %u", i + 1);
+      Expect(i, S_BINARY, Name);
+      ExpectRequest(i, V_STATUS);
+    }
+  }
+  else if(Outputs::Type == S_COVER) {
+    Expect(0, S_COVER, "Roller Shutter");
+    for(uint8_t Type : {V_UP, V_DOWN, V_STOP, V_PERCENTAGE}) ExpectRequest(0, Type);
+  }
+  else  {
+    Expect(0, Outputs::Type, Outputs::Type == S_DIMMER ? "Dimmer" : Outputs::Type == S_RGB_LIGHT ? "RGB" : "RGBW");
+    ExpectRequest(0, V_STATUS);
+    ExpectRequest(0, V_PERCENTAGE);
+    if(Outputs::Type != S_DIMMER) ExpectRequest(0, Outputs::Type == S_RGB_LIGHT ? V_RGB : V_RGBW);
+  }
+
+  for(uint8_t i=0; i<Inputs::Count; i++) {
+    snprintf(Name, sizeof(Name), "Input %u", i + 1);
+    Expect(ModuleProfile::InputId(i), S_BINARY, Name);
+  }
+
+  for(uint8_t i=0; i<Buttons::Count; i++) {
+    snprintf(Name, sizeof(Name), "Longpress-%u", i + 1);
+    Expect(ModuleProfile::SpecialButtonId(i), S_BINARY, Name);
+  }
+
+  #ifdef POWER_SENSOR
+    for(uint8_t i=0; i<PowerSensors::Count; i++) {
+      if(PowerSensors::Count > 1) snprintf(Name, sizeof(Name), "Power Sensor %u", i + 1);
+      else snprintf(Name, sizeof(Name), "Power Sensor");
+      Expect(ModuleProfile::PowerSensorId(i), S_POWER, Name);
+    }
+  #endif
+
+  #ifdef INTERNAL_TEMP
+    Expect(IT_ID, S_TEMP, "Internal Thermometer");
+  #endif
+
+  // Board sensors (errors, configuration...) aren't part of the profile
+  for(auto &Sensor : Presented) {
+    Check(Sensor.first >= SPECIAL_BUTTON_ID + Buttons::Count, "sensor %u presented, not in the profile", Sensor.first);
+  }
+  for(auto &Request : Requested) {
+    Check(Request.first >= SPECIAL_BUTTON_ID, "value of sensor %u, type %u requested, not in the profile", Request.first, Request.second);
+  }
+}
+
+int main()  {
+  Bus.Attach(Gateway);
+  Bus.Attach(Mcu.Port);
+
+  Gateway.OnMessage = [](const MyMessage &Msg, HostTime Time) {
+    char Text[2 * MAX_PAYLOAD_SIZE + 1];
+
+    (void)Time;
+    if(Msg.getCommand() == C_PRESENTATION && Msg.sensor != NODE_SENSOR_ID)  {
+      Check(!Presented.count(Msg.sensor), "sensor %u presented twice", Msg.sensor);
+      Presented[Msg.sensor] = {Msg.type, Msg.getString(Text)};
+    }
+    if(Msg.getCommand() == C_REQ)  Requested.insert({Msg.sensor, Msg.type});
+  };
+
+  CheckPins();
+
+  try {
+    Mcu.Run(TEST_BOOT);
+  }
+  catch(const HostWatchdogReset &Wdt)  {
+    printf("Watchdog reset at %.3f s\n", Wdt.Time / 1e6);
+    return 1;
+  }
+
+  CheckSetup();
+  CheckSensors();
+
+  printf("Modules " TEST_PROFILE(MODULE_PROFILE) ": %u outputs, %u buttons, %u inputs, %u power sensors, %s; %s\n",
+         Outputs::Count, Buttons::Count, Inputs::Count, PowerSensors::Count,
+         ModuleProfile::ThermometerPin != NO_PIN ? "thermometer" : "no thermometer", Failures ? "FAILED" : "ok");
+
+  return Failures ? 1 : 0;
+}
+/*
+   EOF
+*/
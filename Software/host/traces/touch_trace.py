@@ -0,0 +1,139 @@
+#!/usr/bin/env python3
+#
+# touch_trace.py file
+# Writes the touch traces replayed by touch_replay (see ../Readme.md): readings of the three touch fields of
+# a Touch board (ADCTouch averages, LSB) every 50 ms with labelled touches. The traces are modelled, not
+# recorded on a board: idle levels, noise, touch deltas & drift are the estimates of the host build, the
+# scenarios are the ones the baseline tracking has to handle. A trace recorded on a board in the same format
+# replaces them as is.
+#
+# Columns: ms, field 1, field 2, field 3, labels; labels are a bit mask: bits 0-2 - a finger on field 1-3,
+# bits 4-6 - field 1-3 covered by something else (water film), which nobody expects to switch.
+#
+# touch_trace.py <output dir>
+#
+
+import math
+import os
+import random
+import sys
+
+STEP = 50                                   # ms between rows
+IDLE = (300, 288, 295)                      # Untouched readings of fields 1-3
+NOISE = 0.8                                 # Reading noise of a quiet panel (LSB, sigma)
+
+
+class Trace:
+
+    def __init__(self, name, minutes, seed, description):
+        self.name = name
+        self.rows = int(minutes * 60000 / STEP)
+        self.random = random.Random(seed)
+        self.description = description
+        self.offset = [[0.0] * 3 for _ in range(self.rows)]
+        self.labels = [0] * self.rows
+        self.noise = [NOISE] * self.rows
+
+    def ms(self, row):
+        return row * STEP
+
+    def row(self, ms):
+        return min(self.rows, int(ms / STEP))
+
+    def drift(self, function):
+        # Common to all fields (temperature, humidity), each field with its own gain
+        gains = (1.0, 0.85, 0.92)
+        for r in range(self.rows):
+            d = function(self.ms(r) / 1000.0)
+            for f in range(3):
+                self.offset[r][f] += d * gains[f]
+
+    def touch(self, field, start, duration, delta):
+        # Finger approaching & leaving: one row at half the delta, pressure varies a bit meanwhile
+        first, last = self.row(start), self.row(start + duration)
+        for r in range(first, min(last, self.rows)):
+            edge = r == first or r == last - 1
+            self.offset[r][field] += delta * (0.5 if edge else 1 + self.random.uniform(-0.08, 0.08))
+            self.labels[r] |= 1 << field
+
+    def cover(self, field, start, end, delta):
+        # Water film: wets within a second, dries within a few
+        for r in range(self.row(start), self.row(end + 5000)):
+            t = self.ms(r)
+            level = min(1.0, (t - start) / 1000.0) if t < end else max(0.0, 1 - (t - end) / 5000.0)
+            self.offset[r][field] += delta * level
+            if t < end:
+                self.labels[r] |= 1 << (field + 4)
+
+    def touches(self, start, end, fields, deltas, durations=(400, 900), interval=(6000, 14000)):
+        t = start + self.random.uniform(*interval)
+        while t < end - 2000:
+            duration = round(self.random.uniform(*durations) / STEP) * STEP
+            self.touch(self.random.choice(fields), t, duration, self.random.uniform(*deltas))
+            t += duration + self.random.uniform(*interval)
+
+    def write(self, directory):
+        # Interference: correlated, common to the fields (mains pickup), scaled by the noise of the row
+        pickup = 0.0
+        with open(os.path.join(directory, self.name), 'w') as f:
+            f.write('# %s\n' % self.name)
+            for line in self.description:
+                f.write('# %s\n' % line)
+            f.write('# Modelled by touch_trace.py, not recorded on a board\n')
+            f.write('# ms,field1,field2,field3,labels\n')
+            for r in range(self.rows):
+                extra = max(0.0, self.noise[r] - NOISE)
+                pickup = 0.8 * pickup + 0.6 * self.random.gauss(0, extra)
+                values = []
+                for i in range(3):
+                    value = IDLE[i] + self.offset[r][i] + pickup * (0.8 + 0.2 * i) + self.random.gauss(0, NOISE)
+                    values.append(str(int(round(value))))
+                f.write('%d,%s,%d\n' % (self.ms(r), ','.join(values), self.labels[r]))
+
+
+def drift():
+    trace = Trace('touch_drift.csv', 6, 1, [
+        'Board warming up after the loads were switched on: readings rise 25 LSB within ~3 minutes,',
+        'fall back once they are off; a touch every 6-14 s on field 1 or 2, 16-40 LSB, 400-900 ms.',
+    ])
+    trace.drift(lambda s: 25 * (1 - math.exp(-s / 60)) if s < 200 else 25 * (1 - math.exp(-200 / 60)) * math.exp(-(s - 200) / 50))
+    trace.touches(20000, 360000, (0, 1), (16, 40))
+    return trace
+
+
+def noise():
+    trace = Trace('touch_noise.csv', 5, 2, [
+        'Interference of a dimmer on the same circuit from 1 to 3 minutes: correlated noise of ~6 LSB',
+        'fading in & out within 5 s, single-row spikes of relay switching; touches of 30-50 LSB.',
+    ])
+    for r in range(trace.rows):
+        s = trace.ms(r) / 1000.0
+        level = min(1.0, max(0.0, (s - 60) / 5)) * min(1.0, max(0.0, (180 - s) / 5))
+        trace.noise[r] = NOISE + 6 * level
+    for ms in range(75000, 175000, 11000):
+        r = trace.row(ms + trace.random.uniform(0, 5000))
+        for f in range(3):
+            trace.offset[r][f] += 35
+    trace.touches(20000, 300000, (0, 1), (30, 50))
+    return trace
+
+
+def stuck():
+    trace = Trace('touch_stuck.csv', 5, 3, [
+        'Water film on field 2 from 60 to 200 s raises its readings by 35 LSB; touches go on on both',
+        'fields, 20-40 LSB.',
+    ])
+    trace.drift(lambda s: 3 * math.sin(2 * math.pi * s / 300))
+    trace.cover(1, 60000, 200000, 35)
+    trace.touches(20000, 300000, (0, 1), (20, 40))
+    return trace
+
+
+def main():
+    directory = sys.argv[1] if len(sys.argv) > 1 else os.path.dirname(os.path.abspath(__file__))
+    for trace in (drift(), noise(), stuck()):
+        trace.write(directory)
+
+
+if __name__ == '__main__':
+    main()